@@ -22,10 +22,13 @@ struct probe_config_t
 
     bool probe_publish_dir;
 
+    // The index of the files in a runtime store probe, if the store has one.
+    const store_index_t* store_index = nullptr;
+
     void print() const
     {
-        trace::verbose(_X("probe_config_t: probe=[%s] deps-dir-probe=[%d]"),
-            probe_dir.c_str(), probe_publish_dir);
+        trace::verbose(_X("probe_config_t: probe=[%s] deps-dir-probe=[%d] indexed=[%d]"),
+            probe_dir.c_str(), probe_publish_dir, store_index != nullptr);
     }
 
     probe_config_t(
@@ -82,6 +85,13 @@ struct probe_config_t
         return probe_config_t(dir, nullptr, -1, false, false, false);
     }
 
+    static probe_config_t store(const pal::string_t& dir, const store_index_t* index)
+    {
+        probe_config_t config = lookup(dir);
+        config.store_index = index;
+        return config;
+    }
+
     static probe_config_t published_deps_dir()
     {
         return probe_config_t(_X(""), nullptr, 0, false, false, true);
@@ -106,7 +116,7 @@ struct arguments_t
 
     inline void print()
     {
-        if (trace::is_enabled())
+        if (trace::is_enabled(trace::level_t::verbose))
         {
             trace::verbose(_X("-- arguments_t: host_path='%s' app_root='%s' deps='%s' core_svc='%s' mgd_app='%s'"),
                 host_path.c_str(), app_root.c_str(), deps_path.c_str(), core_servicing.c_str(), managed_application.c_str());
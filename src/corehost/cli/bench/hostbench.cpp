@@ -0,0 +1,601 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "error_codes.h"
+#include "pal.h"
+#include "trace.h"
+#include "utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+/**
+ * Startup benchmark for the host components.
+ *
+ * hostbench lays out a synthetic dotnet root and app under a fresh work directory:
+ *
+ *    - N installed versions of Microsoft.NETCore.App, the app rolls forward to the latest
+ *    - M packages in the app's deps.json and M assemblies in the framework's deps.json
+ *    - K additional probing paths, the packages are only present in the last one
+ *
+ * It then times the hostfxr entry points against that layout. get-native-search-directories
+ * drives the whole resolution in hostfxr and hostpolicy (corehost_main_with_output_buffer)
+ * without loading the runtime. hostfxr_main (--main) goes further, up to the point where it
+ * fails to bind the placeholder coreclr.
+ *
+ * Every call runs with COREHOST_TRACE_TIMING pointed at a file in the work directory, so the
+ * report also has the per-phase durations and file system counters of the host components.
+ * In-process caches are warm after the first call, which is why it is reported separately.
+ */
+
+namespace
+{
+    typedef int(*hostfxr_main_fn) (const int argc, const pal::char_t* argv[]);
+    typedef int32_t(*hostfxr_get_native_search_directories_fn) (const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size);
+
+    const pal::char_t fx_name[] = _X("Microsoft.NETCore.App");
+    const char tfm[] = ".NETCoreApp,Version=v2.0";
+
+    struct options_t
+    {
+        pal::string_t hostfxr_path;
+        pal::string_t hostpolicy_path;
+        pal::string_t work_dir;
+        int frameworks = 5;
+        int packages = 200;
+        int probe_paths = 3;
+        int iterations = 50;
+        bool run_main = false;
+    };
+
+    struct layout_t
+    {
+        pal::string_t host_path;
+        pal::string_t app_path;
+        pal::string_t timing_file;
+    };
+
+    struct phase_samples_t
+    {
+        std::vector<int64_t> durations;
+        int64_t counters[3] = { 0, 0, 0 };
+    };
+
+    struct samples_t
+    {
+        int rc = 0;
+        std::vector<int64_t> durations;
+        std::map<std::string, phase_samples_t> phases;
+    };
+
+    const char* const counter_names[] = { "file_stats", "dir_listings", "files_parsed" };
+
+    void usage()
+    {
+        trace::println(_X("Usage: hostbench --hostfxr <path> --hostpolicy <path> --work-dir <dir> [options]"));
+        trace::println();
+        trace::println(_X("Options:"));
+        trace::println(_X("  --frameworks <N>    Installed framework versions [5]"));
+        trace::println(_X("  --packages <M>      Packages in the app and framework deps.json [200]"));
+        trace::println(_X("  --probe-paths <K>   Additional probing paths [3]"));
+        trace::println(_X("  --iterations <I>    Calls per entry point [50]"));
+        trace::println(_X("  --main              Also time hostfxr_main"));
+        trace::println();
+        trace::println(_X("The work directory must not exist, it is created with the synthetic layout."));
+    }
+
+    bool parse_count(const pal::char_t* value, int min, int* count)
+    {
+        unsigned num;
+        if (!try_stou(value, &num) || num < (unsigned) min)
+        {
+            trace::error(_X("Invalid value [%s], expected a number of at least %d"), value, min);
+            return false;
+        }
+
+        *count = (int) num;
+        return true;
+    }
+
+    bool parse_options(const int argc, const pal::char_t* argv[], options_t* opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            pal::string_t arg = argv[i];
+            if (arg == _X("--main"))
+            {
+                opts->run_main = true;
+                continue;
+            }
+
+            if (i + 1 >= argc)
+            {
+                trace::error(_X("Missing value for [%s]"), arg.c_str());
+                return false;
+            }
+
+            const pal::char_t* value = argv[++i];
+            if (arg == _X("--hostfxr"))
+            {
+                opts->hostfxr_path = value;
+            }
+            else if (arg == _X("--hostpolicy"))
+            {
+                opts->hostpolicy_path = value;
+            }
+            else if (arg == _X("--work-dir"))
+            {
+                opts->work_dir = value;
+            }
+            else if (arg == _X("--frameworks"))
+            {
+                if (!parse_count(value, 1, &opts->frameworks)) return false;
+            }
+            else if (arg == _X("--packages"))
+            {
+                if (!parse_count(value, 0, &opts->packages)) return false;
+            }
+            else if (arg == _X("--probe-paths"))
+            {
+                if (!parse_count(value, 1, &opts->probe_paths)) return false;
+            }
+            else if (arg == _X("--iterations"))
+            {
+                if (!parse_count(value, 1, &opts->iterations)) return false;
+            }
+            else
+            {
+                trace::error(_X("Unknown option [%s]"), arg.c_str());
+                return false;
+            }
+        }
+
+        return !opts->hostfxr_path.empty() && !opts->hostpolicy_path.empty() && !opts->work_dir.empty();
+    }
+
+    // --- File system helpers that the host itself never needs.
+
+    bool create_directory(const pal::string_t& path)
+    {
+#if defined(_WIN32)
+        int rc = ::_wmkdir(path.c_str());
+#else
+        int rc = ::mkdir(path.c_str(), 0755);
+#endif
+        return rc == 0 || errno == EEXIST;
+    }
+
+    bool create_directories(const pal::string_t& path)
+    {
+        for (size_t pos = path.find(DIR_SEPARATOR, 1); pos != pal::string_t::npos; pos = path.find(DIR_SEPARATOR, pos + 1))
+        {
+            if (!create_directory(path.substr(0, pos)))
+            {
+                return false;
+            }
+        }
+
+        if (!create_directory(path))
+        {
+            trace::error(_X("Failed to create directory [%s]"), path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool write_file(const pal::string_t& path, const std::string& content)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file << content;
+        file.close();
+        if (file.fail())
+        {
+            trace::error(_X("Failed to write [%s]"), path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool copy_file(const pal::string_t& from, const pal::string_t& to)
+    {
+        pal::ifstream_t in(from, std::ios::in | std::ios::binary);
+        if (!in.good())
+        {
+            trace::error(_X("Failed to open [%s]"), from.c_str());
+            return false;
+        }
+
+        std::stringstream content;
+        content << in.rdbuf();
+        return write_file(to, content.str());
+    }
+
+    bool set_environment(const pal::char_t* name, const pal::string_t& value)
+    {
+#if defined(_WIN32)
+        return ::_wputenv_s(name, value.c_str()) == 0;
+#else
+        return ::setenv(name, value.c_str(), 1) == 0;
+#endif
+    }
+
+    std::string to_json_string(const pal::string_t& value)
+    {
+        std::vector<char> utf8;
+        pal::pal_utf8string(value, &utf8);
+
+        std::string result = "\"";
+        for (const char* c = utf8.data(); *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                result.push_back('\\');
+            }
+            result.push_back(*c);
+        }
+        result.push_back('"');
+        return result;
+    }
+
+    // --- Synthetic layout.
+
+    // A deps.json with a root library that depends on <count> packages with one assembly each.
+    std::string make_deps_json(const std::string& root_library, const char* root_asset_type, const std::string& root_asset, const char* prefix, const char* asset_dir, int count)
+    {
+        std::ostringstream json;
+        json << "{\"runtimeTarget\":{\"name\":\"" << tfm << "\"},\"targets\":{\"" << tfm << "\":{";
+
+        json << "\"" << root_library << "\":{\"dependencies\":{";
+        for (int i = 0; i < count; ++i)
+        {
+            json << (i ? "," : "") << "\"" << prefix << i << "\":\"1.0.0\"";
+        }
+        json << "},\"" << root_asset_type << "\":{\"" << root_asset << "\":{}}}";
+
+        for (int i = 0; i < count; ++i)
+        {
+            json << ",\"" << prefix << i << "/1.0.0\":{\"runtime\":{\"" << asset_dir << prefix << i << ".dll\":{}}}";
+        }
+
+        json << "}},\"libraries\":{";
+        json << "\"" << root_library << "\":{\"type\":\"project\",\"serviceable\":false,\"sha512\":\"\"}";
+
+        std::string lower_prefix(prefix);
+        std::transform(lower_prefix.begin(), lower_prefix.end(), lower_prefix.begin(), ::tolower);
+        for (int i = 0; i < count; ++i)
+        {
+            json << ",\"" << prefix << i << "/1.0.0\":{\"type\":\"package\",\"serviceable\":false,"
+                 << "\"sha512\":\"sha512-" << i << "\",\"path\":\"" << lower_prefix << i << "/1.0.0\"}";
+        }
+        json << "}}";
+        return json.str();
+    }
+
+    bool create_layout(const options_t& opts, layout_t* layout)
+    {
+        if (pal::directory_exists(opts.work_dir))
+        {
+            trace::error(_X("Work directory [%s] already exists"), opts.work_dir.c_str());
+            return false;
+        }
+
+        pal::string_t dotnet_root = opts.work_dir;
+        append_path(&dotnet_root, _X("dotnet"));
+        if (!create_directories(dotnet_root))
+        {
+            return false;
+        }
+
+        // The host path only has to exist, the muxer derives the dotnet root from it.
+        layout->host_path = dotnet_root;
+        append_path(&layout->host_path, (pal::string_t(_X("dotnet")) + pal::exe_suffix()).c_str());
+        if (!write_file(layout->host_path, std::string()))
+        {
+            return false;
+        }
+
+        pal::string_t fx_dir;
+        for (int i = 0; i < opts.frameworks; ++i)
+        {
+            fx_dir = dotnet_root;
+            append_path(&fx_dir, _X("shared"));
+            append_path(&fx_dir, fx_name);
+            append_path(&fx_dir, (_X("2.0.") + pal::to_string(i)).c_str());
+            if (!create_directories(fx_dir))
+            {
+                return false;
+            }
+        }
+
+        // Only the latest version, which the app rolls forward to, needs to be complete.
+        // hostpolicy finds coreclr through the native assets of the framework's deps.json.
+        std::vector<char> utf8_coreclr_name;
+        pal::pal_utf8string(LIBCORECLR_NAME, &utf8_coreclr_name);
+        std::string utf8_coreclr(utf8_coreclr_name.data());
+
+        pal::string_t hostpolicy = fx_dir, coreclr = fx_dir, fx_deps = fx_dir;
+        append_path(&hostpolicy, LIBHOSTPOLICY_NAME);
+        append_path(&coreclr, LIBCORECLR_NAME);
+        append_path(&fx_deps, (pal::string_t(fx_name) + _X(".deps.json")).c_str());
+        if (!copy_file(opts.hostpolicy_path, hostpolicy) ||
+            !write_file(coreclr, std::string()) ||
+            !write_file(fx_deps, make_deps_json("Microsoft.NETCore.App/2.0.0", "native", "runtimes/native/" + utf8_coreclr, "Fx", "lib/netcoreapp2.0/", opts.packages)))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < opts.packages; ++i)
+        {
+            pal::string_t assembly = fx_dir;
+            append_path(&assembly, (_X("Fx") + pal::to_string(i) + _X(".dll")).c_str());
+            if (!write_file(assembly, std::string()))
+            {
+                return false;
+            }
+        }
+
+        pal::string_t app_dir = opts.work_dir;
+        append_path(&app_dir, _X("app"));
+        if (!create_directories(app_dir))
+        {
+            return false;
+        }
+
+        std::ostringstream probe_paths;
+        pal::string_t probe_dir;
+        for (int i = 0; i < opts.probe_paths; ++i)
+        {
+            probe_dir = opts.work_dir;
+            append_path(&probe_dir, (_X("probe") + pal::to_string(i)).c_str());
+            if (!create_directories(probe_dir))
+            {
+                return false;
+            }
+            probe_paths << (i ? "," : "") << to_json_string(probe_dir);
+        }
+
+        // Packages are only found in the last probe path so every lookup walks all of them.
+        for (int i = 0; i < opts.packages; ++i)
+        {
+            pal::string_t package_dir = probe_dir;
+            append_path(&package_dir, (_X("pkg") + pal::to_string(i)).c_str());
+            append_path(&package_dir, _X("1.0.0"));
+            append_path(&package_dir, _X("lib"));
+            append_path(&package_dir, _X("netstandard2.0"));
+
+            pal::string_t assembly = package_dir;
+            append_path(&assembly, (_X("Pkg") + pal::to_string(i) + _X(".dll")).c_str());
+            if (!create_directories(package_dir) || !write_file(assembly, std::string()))
+            {
+                return false;
+            }
+        }
+
+        pal::string_t app_base = app_dir;
+        append_path(&app_base, _X("app"));
+        layout->app_path = app_base + _X(".dll");
+
+        std::ostringstream config;
+        config << "{\"runtimeOptions\":{\"tfm\":\"netcoreapp2.0\",\"framework\":{\"name\":" << to_json_string(fx_name) << ",\"version\":\"2.0.0\"}}}";
+
+        std::ostringstream dev_config;
+        dev_config << "{\"runtimeOptions\":{\"additionalProbingPaths\":[" << probe_paths.str() << "]}}";
+
+        if (!write_file(layout->app_path, std::string()) ||
+            !write_file(app_base + _X(".runtimeconfig.json"), config.str()) ||
+            !write_file(app_base + _X(".runtimeconfig.dev.json"), dev_config.str()) ||
+            !write_file(app_base + _X(".deps.json"), make_deps_json("app/1.0.0", "runtime", "app.dll", "Pkg", "lib/netstandard2.0/", opts.packages)))
+        {
+            return false;
+        }
+
+        layout->timing_file = opts.work_dir;
+        append_path(&layout->timing_file, _X("timing.json"));
+        return true;
+    }
+
+    // --- Measurement.
+
+    bool read_number(const std::string& line, const char* name, int64_t* value)
+    {
+        std::string key = std::string("\"") + name + "\":";
+        size_t pos = line.find(key);
+        if (pos == std::string::npos)
+        {
+            return false;
+        }
+
+        *value = std::strtoll(line.c_str() + pos + key.size(), nullptr, 10);
+        return true;
+    }
+
+    // Folds the phases that the host components reported for one call into the samples.
+    void collect_phases(const layout_t& layout, samples_t* samples)
+    {
+        pal::ifstream_t file(layout.timing_file);
+        std::string line;
+        const std::string phase_key = "\"phase\":\"";
+        while (std::getline(file, line))
+        {
+            size_t start = line.find(phase_key);
+            int64_t duration;
+            if (start == std::string::npos || !read_number(line, "duration_us", &duration))
+            {
+                continue;
+            }
+
+            start += phase_key.size();
+            auto& phase = samples->phases[line.substr(start, line.find('"', start) - start)];
+            phase.durations.push_back(duration);
+            for (int i = 0; i < 3; ++i)
+            {
+                int64_t count;
+                if (read_number(line, counter_names[i], &count))
+                {
+                    phase.counters[i] += count;
+                }
+            }
+        }
+    }
+
+    template <typename Fn>
+    samples_t measure(const options_t& opts, const layout_t& layout, Fn call)
+    {
+        samples_t samples;
+        for (int i = 0; i < opts.iterations; ++i)
+        {
+            write_file(layout.timing_file, std::string());
+
+            auto start = std::chrono::steady_clock::now();
+            bool retry = false;
+            samples.rc = call(&retry);
+            auto end = std::chrono::steady_clock::now();
+
+            if (retry)
+            {
+                --i;
+                continue;
+            }
+
+            samples.durations.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+            collect_phases(layout, &samples);
+        }
+        return samples;
+    }
+
+    int64_t percentile(std::vector<int64_t> values, int p)
+    {
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (values.size() * p) / 100)];
+    }
+
+    pal::string_t to_palstring(const std::string& utf8)
+    {
+        pal::string_t result;
+        pal::utf8_palstring(utf8, &result);
+        return result;
+    }
+
+    void report(const pal::char_t* name, const samples_t& samples)
+    {
+        const auto& d = samples.durations;
+        trace::println();
+        trace::println(_X("%s: %d calls, last rc=0x%x"), name, (int) d.size(), samples.rc);
+        trace::println(_X("  %-40s %9s %9s %9s %9s %9s %9s"), _X("(us)"), _X("first"), _X("min"), _X("p50"), _X("p90"), _X("p99"), _X("max"));
+        trace::println(_X("  %-40s %9lld %9lld %9lld %9lld %9lld %9lld"), _X("total"),
+            (long long) d.front(), (long long) percentile(d, 0), (long long) percentile(d, 50),
+            (long long) percentile(d, 90), (long long) percentile(d, 99), (long long) percentile(d, 100));
+
+        for (const auto& phase : samples.phases)
+        {
+            const auto& p = phase.second.durations;
+            trace::println(_X("  %-40s %9lld %9lld %9lld %9lld %9lld %9lld"), to_palstring(phase.first).c_str(),
+                (long long) p.front(), (long long) percentile(p, 0), (long long) percentile(p, 50),
+                (long long) percentile(p, 90), (long long) percentile(p, 99), (long long) percentile(p, 100));
+        }
+
+        trace::println(_X("  %-40s %12s %12s %12s"), _X("(per call)"), _X("file_stats"), _X("dir_listings"), _X("files_parsed"));
+        for (const auto& phase : samples.phases)
+        {
+            const auto& c = phase.second.counters;
+            size_t n = phase.second.durations.size();
+            trace::println(_X("  %-40s %12lld %12lld %12lld"), to_palstring(phase.first).c_str(),
+                (long long) (c[0] / n), (long long) (c[1] / n), (long long) (c[2] / n));
+        }
+    }
+}
+
+#if defined(_WIN32)
+int __cdecl wmain(const int argc, const pal::char_t* argv[])
+#else
+int main(const int argc, const pal::char_t* argv[])
+#endif
+{
+    options_t opts;
+    if (!parse_options(argc, argv, &opts))
+    {
+        usage();
+        return StatusCode::InvalidArgFailure;
+    }
+
+    if (!pal::realpath(&opts.hostfxr_path) || !pal::realpath(&opts.hostpolicy_path))
+    {
+        return StatusCode::InvalidArgFailure;
+    }
+
+    if (!pal::is_path_rooted(opts.work_dir))
+    {
+        pal::string_t cwd;
+        if (!pal::getcwd(&cwd))
+        {
+            return StatusCode::InvalidArgFailure;
+        }
+        append_path(&cwd, opts.work_dir.c_str());
+        opts.work_dir = cwd;
+    }
+
+    layout_t layout;
+    if (!create_layout(opts, &layout))
+    {
+        return StatusCode::InvalidArgFailure;
+    }
+
+    pal::dll_t fxr;
+    if (!pal::load_library(&opts.hostfxr_path, &fxr))
+    {
+        trace::error(_X("Failed to load [%s]"), opts.hostfxr_path.c_str());
+        return StatusCode::CoreHostLibLoadFailure;
+    }
+
+    auto main_fn = (hostfxr_main_fn) pal::get_symbol(fxr, "hostfxr_main");
+    auto search_dirs_fn = (hostfxr_get_native_search_directories_fn) pal::get_symbol(fxr, "hostfxr_get_native_search_directories");
+    if (main_fn == nullptr || search_dirs_fn == nullptr)
+    {
+        return StatusCode::CoreHostEntryPointFailure;
+    }
+
+    set_environment(_X("COREHOST_TRACE_TIMING"), layout.timing_file);
+    set_environment(_X("DOTNET_MULTILEVEL_LOOKUP"), _X("0"));
+
+    trace::println(_X("Layout [%s]: %d frameworks, %d packages, %d probe paths"),
+        opts.work_dir.c_str(), opts.frameworks, opts.packages, opts.probe_paths);
+
+    const pal::char_t* host_argv[] = { layout.host_path.c_str(), layout.app_path.c_str() };
+    const int host_argc = sizeof(host_argv) / sizeof(host_argv[0]);
+
+    std::vector<pal::char_t> buffer(4096);
+    report(_X("hostfxr_get_native_search_directories"), measure(opts, layout, [&](bool* retry)
+    {
+        int32_t required_size = 0;
+        int rc = search_dirs_fn(host_argc, host_argv, buffer.data(), (int32_t) buffer.size(), &required_size);
+        if (static_cast<StatusCode>(rc) == StatusCode::HostApiBufferTooSmall)
+        {
+            buffer.resize(required_size);
+            *retry = true;
+        }
+        return rc;
+    }));
+
+    if (opts.run_main)
+    {
+        report(_X("hostfxr_main"), measure(opts, layout, [&](bool*)
+        {
+            return main_fn(host_argc, host_argv);
+        }));
+    }
+
+    pal::unload_library(fxr);
+    return StatusCode::Success;
+}
@@ -0,0 +1,825 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "error_codes.h"
+#include "pal.h"
+#include "trace.h"
+#include "utils.h"
+#include "cpprest/json.h"
+#include "deps_format.h"
+#include "runtime_config.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+/**
+ * Microbenchmark for the vendored JSON parser and the host's manifest models.
+ *
+ * jsonbench parses every *.deps.json and *.runtimeconfig.json file under the corpus
+ * directories, <iterations> times each, through:
+ *
+ *    - dom             json_value::parse over the whole document
+ *    - reader          web::json::reader over the document in memory, visiting every token
+ *    - deps_json       deps_json_t, the model hostpolicy builds from a deps.json
+ *    - runtime_config  runtime_config_t, the model the host builds from a runtimeconfig.json
+ *
+ * For each file and in total it reports the throughput at the median duration, and the heap
+ * allocations and peak heap in use per parse. The models read the file themselves, so their
+ * figures include reading it from the page cache; dom and reader start from memory.
+ *
+ * --generate <dir> writes a corpus modeled on real manifests: a framework manifest, a large
+ * ASP.NET app and a self-contained publish, with their runtimeconfig files. Real-world files,
+ * e.g. the deps.json of an installed framework, can be benchmarked along with it by passing
+ * their directories too.
+ */
+
+namespace
+{
+    // --- Heap accounting. The benchmark is single threaded, and so are the parsers.
+
+    struct heap_stats_t
+    {
+        int64_t allocations;
+        int64_t allocated;
+        int64_t live;
+        int64_t peak;
+    };
+
+    heap_stats_t g_heap;
+
+    // Every block is prefixed with its size so that frees can be accounted for.
+    const size_t heap_header = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+    void* heap_alloc(size_t size)
+    {
+        char* block = static_cast<char*>(std::malloc(size + heap_header));
+        if (block == nullptr)
+        {
+            return nullptr;
+        }
+
+        *reinterpret_cast<size_t*>(block) = size;
+        g_heap.allocations++;
+        g_heap.allocated += size;
+        g_heap.live += size;
+        g_heap.peak = std::max(g_heap.peak, g_heap.live);
+        return block + heap_header;
+    }
+
+    void heap_free(void* ptr)
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+
+        char* block = static_cast<char*>(ptr) - heap_header;
+        g_heap.live -= *reinterpret_cast<size_t*>(block);
+        std::free(block);
+    }
+}
+
+void* operator new(size_t size)
+{
+    void* ptr = heap_alloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return heap_alloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return heap_alloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    heap_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    heap_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    heap_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    heap_free(ptr);
+}
+
+namespace
+{
+    typedef web::json::reader::token json_token;
+
+    struct options_t
+    {
+        std::vector<pal::string_t> corpus;
+        pal::string_t generate_dir;
+        int scale = 1;
+        int iterations = 20;
+    };
+
+    struct file_t
+    {
+        pal::string_t path;
+        bool is_deps;
+        bool is_framework_dependent;
+        std::string utf8;
+        utility::string_t text;
+    };
+
+    struct result_t
+    {
+        const pal::char_t* mode;
+        int64_t size = 0;
+        bool ok = true;
+        std::vector<int64_t> durations;
+        int64_t allocations = 0;
+        int64_t allocated = 0;
+        int64_t peak = 0;
+    };
+
+    void usage()
+    {
+        trace::println(_X("Usage: jsonbench [options] [<corpus dir or file>...]"));
+        trace::println();
+        trace::println(_X("Options:"));
+        trace::println(_X("  --generate <dir>    Write the generated corpus to <dir> and include it"));
+        trace::println(_X("  --scale <N>         Multiplies the size of the generated apps [1]"));
+        trace::println(_X("  --iterations <I>    Parses per file and mode [20]"));
+        trace::println();
+        trace::println(_X("Corpus directories are searched recursively for *.deps.json and *.runtimeconfig.json."));
+    }
+
+    bool parse_count(const pal::char_t* value, int min, int* count)
+    {
+        unsigned num;
+        if (!try_stou(value, &num) || num < (unsigned) min)
+        {
+            trace::error(_X("Invalid value [%s], expected a number of at least %d"), value, min);
+            return false;
+        }
+
+        *count = (int) num;
+        return true;
+    }
+
+    bool parse_options(const int argc, const pal::char_t* argv[], options_t* opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            pal::string_t arg = argv[i];
+            if (arg.compare(0, 2, _X("--")) != 0)
+            {
+                opts->corpus.push_back(arg);
+                continue;
+            }
+
+            if (i + 1 >= argc)
+            {
+                trace::error(_X("Missing value for [%s]"), arg.c_str());
+                return false;
+            }
+
+            const pal::char_t* value = argv[++i];
+            if (arg == _X("--generate"))
+            {
+                opts->generate_dir = value;
+            }
+            else if (arg == _X("--scale"))
+            {
+                if (!parse_count(value, 1, &opts->scale)) return false;
+            }
+            else if (arg == _X("--iterations"))
+            {
+                if (!parse_count(value, 1, &opts->iterations)) return false;
+            }
+            else
+            {
+                trace::error(_X("Unknown option [%s]"), arg.c_str());
+                return false;
+            }
+        }
+
+        if (!opts->generate_dir.empty())
+        {
+            opts->corpus.push_back(opts->generate_dir);
+        }
+        return !opts->corpus.empty();
+    }
+
+    // --- Generated corpus.
+
+    bool write_file(const pal::string_t& path, const std::string& content)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file << content;
+        file.close();
+        if (file.fail())
+        {
+            trace::error(_X("Failed to write [%s]"), path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Deterministic, so that runs on different machines parse the same documents.
+    class random_t
+    {
+    public:
+        random_t(uint32_t seed) : m_state(seed) { }
+
+        int next(int bound)
+        {
+            m_state = m_state * 1103515245 + 12345;
+            return (int) ((m_state >> 16) % (uint32_t) bound);
+        }
+
+        std::string sha512()
+        {
+            static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            std::string hash = "sha512-";
+            for (int i = 0; i < 86; ++i)
+            {
+                hash.push_back(base64[next(64)]);
+            }
+            return hash + "==";
+        }
+
+    private:
+        uint32_t m_state;
+    };
+
+    const char tfm[] = ".NETCoreApp,Version=v2.0";
+    const char* const rids[] = { "win", "win-x64", "win-x86", "unix", "linux", "linux-x64", "linux-musl-x64", "osx", "osx-x64", "rhel", "rhel-x64", "debian", "debian-x64" };
+    const int rid_count = sizeof(rids) / sizeof(rids[0]);
+
+    void write_versions(std::ostringstream& json, int i)
+    {
+        json << "{\"assemblyVersion\":\"4.2." << (i % 4) << ".0\",\"fileVersion\":\"4.6." << (25000 + i) << ".2\"}";
+    }
+
+    // The "runtimes" section with the RID fallback graph, as in a framework manifest.
+    void write_rid_graph(std::ostringstream& json)
+    {
+        json << "\"runtimes\":{";
+        for (int i = 0; i < rid_count; ++i)
+        {
+            json << (i ? "," : "") << "\"" << rids[i] << "\":[";
+            for (int j = i - 1, n = 0; j >= 0; --j, ++n)
+            {
+                json << (n ? "," : "") << "\"" << rids[j] << "\"";
+            }
+            json << (i ? "," : "") << "\"any\",\"base\"]";
+        }
+        json << "}";
+    }
+
+    void write_library(std::ostringstream& json, random_t& random, const std::string& id, const char* type, bool serviceable)
+    {
+        std::string path = id;
+        std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+        json << "\"" << id << "\":{\"type\":\"" << type << "\",\"serviceable\":" << (serviceable ? "true" : "false")
+             << ",\"sha512\":\"" << random.sha512() << "\",\"path\":\"" << path << "\",\"hashPath\":\"";
+        std::replace(path.begin(), path.end(), '/', '.');
+        json << path << ".nupkg.sha512\"}";
+    }
+
+    // A package of an app, with the assets that NuGet packages commonly carry.
+    void write_app_package(std::ostringstream& json, random_t& random, const std::string& name, int index, int count)
+    {
+        json << "\"" << name << index << "/2.0." << (index % 3) << "\":{\"dependencies\":{";
+        int dependencies = random.next(5);
+        for (int d = 0; d < dependencies && index + d + 1 < count; ++d)
+        {
+            int dependency = index + 1 + random.next(count - index - 1);
+            json << (d ? "," : "") << "\"" << name << dependency << "\":\"2.0." << (dependency % 3) << "\"";
+        }
+        json << "},\"runtime\":{\"lib/netstandard2.0/" << name << index << ".dll\":{}}";
+        json << ",\"compile\":{\"lib/netstandard2.0/" << name << index << ".dll\":{}}";
+
+        if (index % 7 == 0)
+        {
+            json << ",\"runtimeTargets\":{"
+                 << "\"runtimes/unix/lib/netstandard2.0/" << name << index << ".dll\":{\"rid\":\"unix\",\"assetType\":\"runtime\"},"
+                 << "\"runtimes/win/lib/netstandard2.0/" << name << index << ".dll\":{\"rid\":\"win\",\"assetType\":\"runtime\"},"
+                 << "\"runtimes/win-x64/native/" << name << index << ".native.dll\":{\"rid\":\"win-x64\",\"assetType\":\"native\"}}";
+        }
+        if (index % 11 == 0)
+        {
+            json << ",\"resources\":{";
+            const char* const cultures[] = { "cs", "de", "es", "fr", "it", "ja", "ko", "pl", "pt-BR", "ru", "tr", "zh-Hans", "zh-Hant" };
+            for (int c = 0; c < 13; ++c)
+            {
+                json << (c ? "," : "") << "\"lib/netstandard2.0/" << cultures[c] << "/" << name << index << ".resources.dll\":{\"locale\":\"" << cultures[c] << "\"}";
+            }
+            json << "}";
+        }
+        json << "}";
+    }
+
+    std::string make_framework_deps(int scale)
+    {
+        random_t random(1);
+        const int assemblies = 160;
+        const int natives = 12;
+
+        std::ostringstream json;
+        json << "{\"runtimeTarget\":{\"name\":\"" << tfm << "\",\"signature\":\"" << random.sha512().substr(7, 40) << "\"},"
+             << "\"compilationOptions\":{},\"targets\":{\"" << tfm << "\":{"
+             << "\"Microsoft.NETCore.App/2.0.0\":{\"dependencies\":{\"runtime.linux-x64.Microsoft.NETCore.App\":\"2.0.0\"},\"runtime\":{";
+        for (int i = 0; i < assemblies * scale; ++i)
+        {
+            json << (i ? "," : "") << "\"lib/netcoreapp2.0/System.Assembly" << i << ".dll\":";
+            write_versions(json, i);
+        }
+        json << "}},\"runtime.linux-x64.Microsoft.NETCore.App/2.0.0\":{\"runtimeTargets\":{";
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int i = 0; i < natives; ++i)
+            {
+                json << (r || i ? "," : "") << "\"runtimes/" << rids[r * 3 + 1] << "/native/libSystem.Native" << i << ".so\":{\"rid\":\"" << rids[r * 3 + 1] << "\",\"assetType\":\"native\"}";
+            }
+        }
+        json << "}}}},\"libraries\":{";
+        write_library(json, random, "Microsoft.NETCore.App/2.0.0", "package", false);
+        json << ",";
+        write_library(json, random, "runtime.linux-x64.Microsoft.NETCore.App/2.0.0", "package", false);
+        json << "},";
+        write_rid_graph(json);
+        json << "}";
+        return json.str();
+    }
+
+    std::string make_app_deps(int scale)
+    {
+        random_t random(2);
+        const int packages = 300 * scale;
+
+        std::ostringstream json;
+        json << "{\"runtimeTarget\":{\"name\":\"" << tfm << "\",\"signature\":\"\"},"
+             << "\"compilationOptions\":{\"defines\":[\"TRACE\",\"RELEASE\",\"NETCOREAPP2_0\"],\"languageVersion\":\"\",\"platform\":\"\","
+             << "\"allowUnsafe\":false,\"warningsAsErrors\":false,\"optimize\":true,\"keyFile\":\"\",\"emitEntryPoint\":true,"
+             << "\"xmlDoc\":false,\"debugType\":\"portable\"},\"targets\":{\"" << tfm << "\":{"
+             << "\"WebApp/1.0.0\":{\"dependencies\":{";
+        for (int i = 0; i < packages; i += 10)
+        {
+            json << (i ? "," : "") << "\"Microsoft.AspNetCore.Package" << i << "\":\"2.0." << (i % 3) << "\"";
+        }
+        json << "},\"runtime\":{\"WebApp.dll\":{}},\"compile\":{\"WebApp.dll\":{}}}";
+        for (int i = 0; i < packages; ++i)
+        {
+            json << ",";
+            write_app_package(json, random, "Microsoft.AspNetCore.Package", i, packages);
+        }
+        json << "}},\"libraries\":{\"WebApp/1.0.0\":{\"type\":\"project\",\"serviceable\":false,\"sha512\":\"\"}";
+        for (int i = 0; i < packages; ++i)
+        {
+            json << ",";
+            std::ostringstream id;
+            id << "Microsoft.AspNetCore.Package" << i << "/2.0." << (i % 3);
+            write_library(json, random, id.str(), "package", true);
+        }
+        json << "}}";
+        return json.str();
+    }
+
+    std::string make_self_contained_deps(int scale)
+    {
+        random_t random(3);
+        const int assemblies = 200;
+        const int packages = 100 * scale;
+        const std::string target = std::string(tfm) + "/linux-x64";
+
+        std::ostringstream json;
+        json << "{\"runtimeTarget\":{\"name\":\"" << target << "\",\"signature\":\"\"},\"compilationOptions\":{},\"targets\":{"
+             << "\"" << tfm << "\":{},\"" << target << "\":{"
+             << "\"ConsoleApp/1.0.0\":{\"dependencies\":{\"runtime.linux-x64.Microsoft.NETCore.App\":\"2.0.0\"";
+        for (int i = 0; i < packages; i += 5)
+        {
+            json << ",\"Contoso.Package" << i << "\":\"2.0." << (i % 3) << "\"";
+        }
+        json << "},\"runtime\":{\"ConsoleApp.dll\":{}}},\"runtime.linux-x64.Microsoft.NETCore.App/2.0.0\":{\"runtime\":{";
+        for (int i = 0; i < assemblies; ++i)
+        {
+            json << (i ? "," : "") << "\"runtimes/linux-x64/lib/netcoreapp2.0/System.Assembly" << i << ".dll\":";
+            write_versions(json, i);
+        }
+        json << "},\"native\":{";
+        const char* const natives[] = { "libcoreclr.so", "libclrjit.so", "libhostpolicy.so", "libhostfxr.so", "libSystem.Native.so",
+            "libSystem.Security.Cryptography.Native.OpenSsl.so", "libSystem.IO.Compression.Native.so", "libSystem.Net.Http.Native.so", "libmscordaccore.so", "libsos.so" };
+        for (int i = 0; i < 10; ++i)
+        {
+            json << (i ? "," : "") << "\"runtimes/linux-x64/native/" << natives[i] << "\":{\"fileVersion\":\"0.0.0.0\"}";
+        }
+        json << "}}";
+        for (int i = 0; i < packages; ++i)
+        {
+            json << ",";
+            write_app_package(json, random, "Contoso.Package", i, packages);
+        }
+        json << "}},\"libraries\":{\"ConsoleApp/1.0.0\":{\"type\":\"project\",\"serviceable\":false,\"sha512\":\"\"},";
+        write_library(json, random, "runtime.linux-x64.Microsoft.NETCore.App/2.0.0", "package", true);
+        for (int i = 0; i < packages; ++i)
+        {
+            json << ",";
+            std::ostringstream id;
+            id << "Contoso.Package" << i << "/2.0." << (i % 3);
+            write_library(json, random, id.str(), "package", true);
+        }
+        json << "}}";
+        return json.str();
+    }
+
+    // Runtime config knobs as the SDK writes them, including escaped paths.
+    std::string make_runtime_config(const char* framework)
+    {
+        std::ostringstream json;
+        json << "{\r\n  \"runtimeOptions\": {\r\n    \"tfm\": \"netcoreapp2.0\",\r\n";
+        if (framework != nullptr)
+        {
+            json << "    \"framework\": {\r\n      \"name\": \"" << framework << "\",\r\n      \"version\": \"2.0.0\"\r\n    },\r\n"
+                 << "    \"applyPatches\": true,\r\n    \"rollForwardOnNoCandidateFx\": 1,\r\n";
+        }
+        json << "    \"configProperties\": {\r\n"
+             << "      \"System.GC.Server\": true,\r\n"
+             << "      \"System.GC.Concurrent\": false,\r\n"
+             << "      \"System.GC.RetainVM\": true,\r\n"
+             << "      \"System.Runtime.TieredCompilation\": true,\r\n"
+             << "      \"System.Globalization.Invariant\": false,\r\n"
+             << "      \"System.Threading.ThreadPool.MinThreads\": 4,\r\n"
+             << "      \"System.Threading.ThreadPool.MaxThreads\": 25,\r\n"
+             << "      \"Contoso.ContentRoot\": \"C:\\\\inetpub\\\\wwwroot\\\\contoso\",\r\n"
+             << "      \"Contoso.Banner\": \"caf\\u00e9 \\\"contoso\\\"\"\r\n"
+             << "    }\r\n  }\r\n}\r\n";
+        return json.str();
+    }
+
+    bool create_directory(const pal::string_t& path)
+    {
+#if defined(_WIN32)
+        int rc = ::_wmkdir(path.c_str());
+#else
+        int rc = ::mkdir(path.c_str(), 0755);
+#endif
+        if (rc != 0)
+        {
+            trace::error(_X("Failed to create directory [%s]"), path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool generate_corpus(const pal::string_t& dir, int scale)
+    {
+        if (pal::directory_exists(dir))
+        {
+            trace::error(_X("Corpus directory [%s] already exists"), dir.c_str());
+            return false;
+        }
+
+        if (!create_directory(dir))
+        {
+            return false;
+        }
+
+        struct document_t
+        {
+            const pal::char_t* name;
+            std::string content;
+        };
+        const document_t documents[] = {
+            { _X("Microsoft.NETCore.App.deps.json"), make_framework_deps(1) },
+            { _X("Microsoft.NETCore.App.runtimeconfig.json"), make_runtime_config(nullptr) },
+            { _X("WebApp.deps.json"), make_app_deps(scale) },
+            { _X("WebApp.runtimeconfig.json"), make_runtime_config("Microsoft.AspNetCore.All") },
+            { _X("ConsoleApp.deps.json"), make_self_contained_deps(scale) },
+            { _X("ConsoleApp.runtimeconfig.json"), make_runtime_config(nullptr) },
+        };
+
+        for (const auto& document : documents)
+        {
+            pal::string_t path = dir;
+            append_path(&path, document.name);
+            if (!write_file(path, document.content))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // --- Corpus.
+
+    // Self-contained manifests name a RID specific runtime target, e.g. ".NETCoreApp,Version=v2.0/linux-x64".
+    bool is_framework_dependent(const std::string& utf8)
+    {
+        try
+        {
+            web::json::reader reader(utf8.data(), utf8.data() + utf8.size());
+            if (reader.read() != json_token::begin_object)
+            {
+                return true;
+            }
+
+            while (reader.read() == json_token::property_name)
+            {
+                if (reader.as_string() != _X("runtimeTarget"))
+                {
+                    reader.skip();
+                    continue;
+                }
+
+                json_value target = reader.read_value();
+                return !target.is_object() || !target.has_field(_X("name")) ||
+                    target.at(_X("name")).as_string().find(_X('/')) == utility::string_t::npos;
+            }
+        }
+        catch (const std::exception&)
+        {
+        }
+        return true;
+    }
+
+    bool load_file(const pal::string_t& path, bool is_deps, std::vector<file_t>* files)
+    {
+        file_contents_t contents;
+        if (!contents.load(path))
+        {
+            trace::error(_X("Failed to read [%s]"), path.c_str());
+            return false;
+        }
+
+        const char* begin = contents.begin();
+        (void) skip_utf8_bom(&begin, contents.end());
+
+        file_t file;
+        file.path = path;
+        file.is_deps = is_deps;
+        file.utf8.assign(begin, contents.end());
+        file.is_framework_dependent = !is_deps || is_framework_dependent(file.utf8);
+        pal::utf8_palstring(file.utf8, &file.text);
+        files->push_back(std::move(file));
+        return true;
+    }
+
+    bool add_corpus(const pal::string_t& path, std::vector<file_t>* files)
+    {
+        const pal::string_t deps_suffix = _X(".deps.json");
+        const pal::string_t config_suffix = _X(".runtimeconfig.json");
+
+        // pal::directory_exists does not tell files from directories, so paths are told apart by name.
+        if (ends_with(path, deps_suffix, false) || ends_with(path, config_suffix, false))
+        {
+            return load_file(path, ends_with(path, deps_suffix, false), files);
+        }
+
+        if (!pal::directory_exists(path))
+        {
+            trace::error(_X("Corpus directory [%s] does not exist"), path.c_str());
+            return false;
+        }
+
+        std::vector<pal::string_t> dirs;
+        pal::readdir_onlydirectories(path, &dirs);
+        std::sort(dirs.begin(), dirs.end());
+
+        std::vector<pal::string_t> names;
+        pal::readdir(path, _X("*.json"), &names);
+        std::sort(names.begin(), names.end());
+        for (const auto& name : names)
+        {
+            bool is_deps = ends_with(name, deps_suffix, false);
+            if ((!is_deps && !ends_with(name, config_suffix, false)) || std::binary_search(dirs.begin(), dirs.end(), name))
+            {
+                continue;
+            }
+
+            pal::string_t file = path;
+            append_path(&file, name.c_str());
+            if (!load_file(file, is_deps, files))
+            {
+                return false;
+            }
+        }
+
+        for (const auto& name : dirs)
+        {
+            pal::string_t dir = path;
+            append_path(&dir, name.c_str());
+            if (!add_corpus(dir, files))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // --- Measurement.
+
+    // Parses through one mode <iterations> times; parse returns false if the document was rejected.
+    template <typename Fn>
+    result_t measure(const pal::char_t* mode, const file_t& file, int iterations, Fn parse)
+    {
+        result_t result;
+        result.mode = mode;
+        result.size = file.utf8.size();
+        for (int i = 0; i < iterations; ++i)
+        {
+            heap_stats_t before = g_heap;
+            g_heap.peak = g_heap.live;
+
+            auto start = std::chrono::steady_clock::now();
+            bool ok;
+            try
+            {
+                ok = parse();
+            }
+            catch (const std::exception&)
+            {
+                ok = false;
+            }
+            auto end = std::chrono::steady_clock::now();
+
+            result.ok = result.ok && ok;
+            result.durations.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            result.allocations += g_heap.allocations - before.allocations;
+            result.allocated += g_heap.allocated - before.allocated;
+            result.peak = std::max(result.peak, g_heap.peak - before.live);
+            g_heap.peak = std::max(g_heap.peak, before.peak);
+        }
+        return result;
+    }
+
+    std::vector<result_t> measure_file(const file_t& file, int iterations)
+    {
+        std::vector<result_t> results;
+
+        results.push_back(measure(_X("dom"), file, iterations, [&]()
+        {
+            std::error_code error;
+            json_value value = json_value::parse(file.text, error);
+            return !error;
+        }));
+
+        results.push_back(measure(_X("reader"), file, iterations, [&]()
+        {
+            web::json::reader reader(file.utf8.data(), file.utf8.data() + file.utf8.size());
+            while (reader.read() != json_token::end_of_document)
+            {
+            }
+            return true;
+        }));
+
+        if (file.is_deps)
+        {
+            results.push_back(measure(_X("deps_json"), file, iterations, [&]()
+            {
+                deps_json_t deps(file.is_framework_dependent, file.path);
+                return deps.is_valid();
+            }));
+        }
+        else
+        {
+            results.push_back(measure(_X("runtime_config"), file, iterations, [&]()
+            {
+                runtime_config_t config;
+                config.parse(file.path, pal::string_t(), nullptr, nullptr);
+                return config.is_valid();
+            }));
+        }
+
+        return results;
+    }
+
+    int64_t median(std::vector<int64_t> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    double megabytes_per_second(int64_t bytes, int64_t nanoseconds)
+    {
+        return nanoseconds == 0 ? 0.0 : (bytes * 1000.0) / nanoseconds;
+    }
+
+    void report_header(const pal::char_t* title)
+    {
+        trace::println();
+        trace::println(_X("  %-44s %-15s %10s %10s %10s %12s %12s %10s"), title, _X("mode"), _X("KB"), _X("p50 us"), _X("MB/s"),
+            _X("allocs"), _X("alloc KB"), _X("peak KB"));
+    }
+
+    void report_line(const pal::string_t& name, const pal::char_t* mode, int64_t size, int64_t nanoseconds, int64_t allocations, int64_t allocated, int64_t peak, bool ok)
+    {
+        trace::println(_X("  %-44s %-15s %10.1f %10.1f %10.1f %12lld %12.1f %10.1f%s"), name.c_str(), mode, size / 1024.0, nanoseconds / 1000.0,
+            megabytes_per_second(size, nanoseconds), (long long) allocations, allocated / 1024.0, peak / 1024.0, ok ? _X("") : _X("  (rejected)"));
+    }
+}
+
+#if defined(_WIN32)
+int __cdecl wmain(const int argc, const pal::char_t* argv[])
+#else
+int main(const int argc, const pal::char_t* argv[])
+#endif
+{
+    options_t opts;
+    if (!parse_options(argc, argv, &opts))
+    {
+        usage();
+        return StatusCode::InvalidArgFailure;
+    }
+
+    if (!opts.generate_dir.empty() && !generate_corpus(opts.generate_dir, opts.scale))
+    {
+        return StatusCode::InvalidArgFailure;
+    }
+
+    std::vector<file_t> files;
+    for (const auto& path : opts.corpus)
+    {
+        if (!add_corpus(path, &files))
+        {
+            return StatusCode::InvalidArgFailure;
+        }
+    }
+
+    if (files.empty())
+    {
+        trace::error(_X("The corpus has no deps.json or runtimeconfig.json files"));
+        return StatusCode::InvalidArgFailure;
+    }
+
+    trace::println(_X("Corpus: %d files, %d iterations per file and mode"), (int) files.size(), opts.iterations);
+
+    // Per mode totals: the corpus size over the sum of the median durations.
+    struct total_t
+    {
+        int64_t size = 0;
+        int64_t nanoseconds = 0;
+        int64_t allocations = 0;
+        int64_t allocated = 0;
+        int64_t peak = 0;
+        bool ok = true;
+    };
+    std::map<pal::string_t, total_t> totals;
+
+    report_header(_X("file (per parse)"));
+    bool all_ok = true;
+    for (const auto& file : files)
+    {
+        for (const auto& result : measure_file(file, opts.iterations))
+        {
+            int64_t nanoseconds = median(result.durations);
+            int64_t allocations = result.allocations / opts.iterations;
+            int64_t allocated = result.allocated / opts.iterations;
+            report_line(get_filename(file.path), result.mode, result.size, nanoseconds, allocations, allocated, result.peak, result.ok);
+
+            total_t& total = totals[result.mode];
+            total.size += result.size;
+            total.nanoseconds += nanoseconds;
+            total.allocations += allocations;
+            total.allocated += allocated;
+            total.peak = std::max(total.peak, result.peak);
+            total.ok = total.ok && result.ok;
+            all_ok = all_ok && result.ok;
+        }
+    }
+
+    report_header(_X("total (peak is the largest of any file)"));
+    for (const auto& total : totals)
+    {
+        const total_t& t = total.second;
+        report_line(_X("corpus"), total.first.c_str(), t.size, t.nanoseconds, t.allocations, t.allocated, t.peak, t.ok);
+    }
+
+    return all_ok ? StatusCode::Success : StatusCode::InvalidArgFailure;
+}
@@ -2,11 +2,115 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <thread>
+#include <chrono>
+#include <cstdlib>
 #include "pal.h"
 #include "utils.h"
 #include "trace.h"
 #include "breadcrumbs.h"
 
+namespace
+{
+    // Servicing only looks at the "netcore,<name>" files. The index is the writer's own record
+    // of the ones already in the store, so that a launch stats a single directory and reads a
+    // single file instead of checking every breadcrumb.
+    const pal::char_t breadcrumb_index_name[] = _X("netcore-breadcrumbs.index");
+
+    // Hashes of the breadcrumb sets that were completely written, so that a launch whose set is
+    // unchanged does not start the background thread at all. Bounded like the other caches.
+    const pal::char_t breadcrumb_summary_name[] = _X("netcore-breadcrumbs.sets");
+    const size_t max_summary_sets = 256;
+
+    // How long exiting waits for the background thread before it is asked to leave the remaining
+    // breadcrumbs to a later launch. It stops after the breadcrumb it is writing, and indexes
+    // only those it wrote.
+    const std::chrono::milliseconds exit_wait_time(100);
+
+    // The index and the summary are only trusted if they were written after the last change to
+    // the store: creating or deleting a breadcrumb updates the timestamp of the store directory.
+    bool is_current(const pal::string_t& store, const pal::string_t& path)
+    {
+        int64_t store_time, time, size;
+        return pal::get_file_stamp(store, &store_time, &size) &&
+            pal::get_file_stamp(path, &time, &size) &&
+            time >= store_time;
+    }
+
+    bool read_index(const pal::string_t& store, const pal::string_t& index_path, std::unordered_set<pal::string_t>* names)
+    {
+        if (!is_current(store, index_path))
+        {
+            return false;
+        }
+
+        pal::ifstream_t file(index_path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            pal::string_t name;
+            if (pal::utf8_palstring(line, &name))
+            {
+                names->insert(name);
+            }
+        }
+
+        return true;
+    }
+
+    void write_index(const pal::string_t& index_path, const std::vector<pal::string_t>& names, bool append)
+    {
+        std::ofstream file(index_path, std::ios::out | (append ? std::ios::app : std::ios::trunc));
+        for (const auto& name : names)
+        {
+            std::vector<char> utf8;
+            pal::pal_utf8string(name, &utf8);
+            file << utf8.data() << '\n';
+        }
+
+        file.close();
+        if (file.fail())
+        {
+            trace::verbose(_X("Failed to write breadcrumb index [%s]"), index_path.c_str());
+        }
+    }
+
+    // Independent of the iteration order of the set.
+    size_t get_set_hash(const std::unordered_set<pal::string_t>& names)
+    {
+        size_t hash = names.size();
+        for (const auto& name : names)
+        {
+            size_t name_hash = std::hash<pal::string_t>()(name);
+            hash += name_hash ^ (name_hash >> 16) * 0x45d9f3b;
+        }
+        return hash;
+    }
+
+    // Returns whether the summary is current and sets 'count' to the number of sets in it.
+    bool read_summary(const pal::string_t& store, const pal::string_t& summary_path, size_t set_hash, bool* found, size_t* count)
+    {
+        *found = false;
+        *count = 0;
+        if (!is_current(store, summary_path))
+        {
+            return false;
+        }
+
+        pal::ifstream_t file(summary_path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            ++*count;
+            if (std::strtoull(line.c_str(), nullptr, 16) == set_hash)
+            {
+                *found = true;
+            }
+        }
+
+        return true;
+    }
+}
+
 breadcrumb_writer_t::breadcrumb_writer_t(bool enabled, const std::unordered_set<pal::string_t>* files)
     : m_status(false)
     , m_enabled(enabled)
@@ -46,19 +150,62 @@ void breadcrumb_writer_t::begin_write()
             m_status = true;
             return;
         }
-        m_thread = std::thread(write_worker_callback, this);
+
+        pal::string_t summary_path = m_breadcrumb_store;
+        append_path(&summary_path, breadcrumb_summary_name);
+
+        bool found;
+        size_t count;
+        size_t set_hash = get_set_hash(*m_files);
+        bool summary_current = read_summary(m_breadcrumb_store, summary_path, set_hash, &found, &count);
+        if (found)
+        {
+            trace::verbose(_X("Breadcrumbs are unchanged since they were last written, skipping write."));
+            m_status = true;
+            return;
+        }
+
+        m_state = std::make_shared<write_state_t>();
+        m_state->breadcrumb_store = m_breadcrumb_store;
+        m_state->files = *m_files;
+        m_state->set_hash = set_hash;
+
+        // Breadcrumbs the writer adds do not invalidate the other sets, but changes made by
+        // anyone else might have, so then the summary starts over.
+        m_state->append_summary = summary_current && count < max_summary_sets;
+        m_thread = std::thread(write_worker_callback, m_state);
         trace::verbose(_X("Breadcrumbs will be written using a background thread"));
     }
 }
 
-// Write the breadcrumbs. This method should be called
+// Write the breadcrumbs missing from the store. This method should be called
 // only from the background thread.
-void breadcrumb_writer_t::write_callback()
+bool breadcrumb_writer_t::write_callback(const write_state_t& state)
 {
+    pal::string_t index_path = state.breadcrumb_store;
+    append_path(&index_path, breadcrumb_index_name);
+
+    std::unordered_set<pal::string_t> indexed;
+    bool index_valid = read_index(state.breadcrumb_store, index_path, &indexed);
+    trace::verbose(_X("Breadcrumb index [%s] has %d valid entries"), index_path.c_str(), (int) indexed.size());
+
     bool successful = true;
-    for (const auto& file : *m_files)
+    std::vector<pal::string_t> existing;
+    for (const auto& file : state.files)
     {
-        pal::string_t file_path = m_breadcrumb_store;
+        if (state.cancelled)
+        {
+            trace::verbose(_X("Breadcrumb write was cancelled, leaving the rest to a later launch"));
+            successful = false;
+            break;
+        }
+
+        if (indexed.count(file))
+        {
+            continue;
+        }
+
+        pal::string_t file_path = state.breadcrumb_store;
         pal::string_t file_name = _X("netcore,") + file;
         append_path(&file_path, file_name.c_str());
         if (!pal::file_exists(file_path))
@@ -66,36 +213,80 @@ void breadcrumb_writer_t::write_callback()
             if (!pal::touch_file(file_path))
             {
                 successful = false;
+                continue;
             }
         }
+
+        existing.push_back(file);
+    }
+
+    // A stale index is replaced rather than appended to, so that it does not keep growing.
+    if (!existing.empty() || !index_valid)
+    {
+        write_index(index_path, existing, index_valid);
+    }
+
+    return successful;
+}
+
+// Record that the set was completely written.
+void breadcrumb_writer_t::write_summary(const write_state_t& state)
+{
+    pal::string_t summary_path = state.breadcrumb_store;
+    append_path(&summary_path, breadcrumb_summary_name);
+
+    std::ofstream file(summary_path, std::ios::out | (state.append_summary ? std::ios::app : std::ios::trunc));
+    file << std::hex << state.set_hash << '\n';
+    file.close();
+    if (file.fail())
+    {
+        trace::verbose(_X("Failed to write breadcrumb summary [%s]"), summary_path.c_str());
     }
-    // m_status should not be modified by anyone else.
-    m_status = successful;
 }
 
 // ThreadProc for the background writer.
-void breadcrumb_writer_t::write_worker_callback(breadcrumb_writer_t* p_this)
+void breadcrumb_writer_t::write_worker_callback(std::shared_ptr<write_state_t> state)
 {
+    bool successful = false;
     try
     {
         trace::verbose(_X("Breadcrumb thread write callback..."));
-        p_this->write_callback();
+        successful = write_callback(*state);
+        if (successful)
+        {
+            write_summary(*state);
+        }
     }
     catch (...)
     {
         trace::warning(_X("An unexpected exception was thrown while leaving breadcrumbs"));
     }
+
+    std::lock_guard<std::mutex> lock(state->lock);
+    state->status = successful;
+    state->done = true;
+    state->completed.notify_all();
 }
 
-// Wait for completion of the background tasks, if any.
+// Wait for completion of the background tasks, if any. Past a bounded time the thread is
+// cancelled, it still has to be joined since it runs code of this library.
 bool breadcrumb_writer_t::end_write()
 {
     if (m_thread.joinable())
     {
         trace::verbose(_X("Waiting for breadcrumb thread to exit..."));
 
-        // Block on the thread to exit.
+        {
+            std::unique_lock<std::mutex> lock(m_state->lock);
+            if (!m_state->completed.wait_for(lock, exit_wait_time, [this]() { return m_state->done; }))
+            {
+                trace::verbose(_X("Breadcrumb thread did not finish in time, cancelling it"));
+                m_state->cancelled = true;
+            }
+        }
+
         m_thread.join();
+        m_status = m_state->status;
     }
     trace::verbose(_X("--- End breadcrumb write %d"), m_status);
     return m_status;
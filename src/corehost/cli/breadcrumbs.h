@@ -4,7 +4,11 @@
 #ifndef __BREADCRUMBS_H__
 #define __BREADCRUMBS_H__
 
+#include <atomic>
 #include <thread>
+#include <mutex>
+#include <memory>
+#include <condition_variable>
 
 class breadcrumb_writer_t
 {
@@ -15,15 +19,34 @@ public:
     void begin_write();
 
 private:
-    void write_callback();
+    // Shared with the background thread, which is always joined before the writer goes away:
+    // it runs code of this library, which may be unloaded once the writer is done.
+    struct write_state_t
+    {
+        write_state_t() : set_hash(0), append_summary(false), cancelled(false), done(false), status(false) { }
+
+        pal::string_t breadcrumb_store;
+        std::unordered_set<pal::string_t> files;
+        size_t set_hash;
+        bool append_summary;
+        std::atomic<bool> cancelled;
+        std::mutex lock;
+        std::condition_variable completed;
+        bool done;
+        bool status;
+    };
+
+    static bool write_callback(const write_state_t& state);
+    static void write_summary(const write_state_t& state);
     bool end_write();
-    static void write_worker_callback(breadcrumb_writer_t* p_this);
+    static void write_worker_callback(std::shared_ptr<write_state_t> state);
 
     pal::string_t m_breadcrumb_store;
     std::thread m_thread;
+    std::shared_ptr<write_state_t> m_state;
     const std::unordered_set<pal::string_t>* m_files;
     bool m_enabled;
-    volatile bool m_status;
+    bool m_status;
 };
 
 #endif // __BREADCRUMBS_H__
@@ -61,6 +61,7 @@ void coreclr::unload()
     assert(g_coreclr != nullptr && coreclr_initialize != nullptr);
 
     pal::unload_library(g_coreclr);
+    g_coreclr = nullptr;
 }
 
 pal::hresult_t coreclr::initialize(
@@ -5,9 +5,19 @@
 #include "utils.h"
 #include "deps_entry.h"
 #include "trace.h"
+#include <mutex>
 
+uint32_t deps_entry_t::get_package_id(const pal::string_t& package)
+{
+    // Deps files can be read on several threads, see deps_resolver_t::load_deps_files.
+    static std::mutex lock;
+    static std::unordered_map<pal::string_t, uint32_t> ids;
+
+    std::lock_guard<std::mutex> guard(lock);
+    return ids.emplace(package, (uint32_t) ids.size()).first->second;
+}
 
-bool deps_entry_t::to_path(const pal::string_t& base, bool look_in_base, pal::string_t* str) const
+bool deps_entry_t::to_path(const pal::string_t& base, bool look_in_base, pal::string_t* str, dir_cache_t* dir_cache) const
 {
     pal::string_t& candidate = *str;
 
@@ -35,7 +45,7 @@ bool deps_entry_t::to_path(const pal::string_t& base, bool look_in_base, pal::st
     pal::string_t sub_path = look_in_base ? get_filename(pal_relative_path) : pal_relative_path;
     append_path(&candidate, sub_path.c_str());
 
-    bool exists = pal::file_exists(candidate);
+    bool exists = dir_cache != nullptr ? dir_cache->file_exists(candidate) : pal::file_exists(candidate);
     const pal::char_t* query_type = look_in_base ? _X("Local") : _X("Relative");
     if (!exists)
     {
@@ -60,7 +70,7 @@ bool deps_entry_t::to_path(const pal::string_t& base, bool look_in_base, pal::st
 // Returns:
 //    If the file exists in the path relative to the "base" directory.
 //
-bool deps_entry_t::to_dir_path(const pal::string_t& base, pal::string_t* str) const
+bool deps_entry_t::to_dir_path(const pal::string_t& base, pal::string_t* str, dir_cache_t* dir_cache) const
 {
     if (asset_type == asset_types::resources)
     {
@@ -84,9 +94,9 @@ bool deps_entry_t::to_dir_path(const pal::string_t& base, pal::string_t* str) co
         pal::string_t base_ietf_dir = base;
         append_path(&base_ietf_dir, ietf.c_str());
         trace::verbose(_X("Detected a resource asset, will query dir/ietf-tag/resource base: %s asset: %s"), base_ietf_dir.c_str(), asset.name.c_str());
-        return to_path(base_ietf_dir, true, str);
+        return to_path(base_ietf_dir, true, str, dir_cache);
     }
-    return to_path(base, true, str);
+    return to_path(base, true, str, dir_cache);
 }
 // -----------------------------------------------------------------------------
 // Given a "base" directory, yield the relative path of this file in the package
@@ -100,9 +110,9 @@ bool deps_entry_t::to_dir_path(const pal::string_t& base, pal::string_t* str) co
 // Returns:
 //    If the file exists in the path relative to the "base" directory.
 //
-bool deps_entry_t::to_rel_path(const pal::string_t& base, pal::string_t* str) const
+bool deps_entry_t::to_rel_path(const pal::string_t& base, pal::string_t* str, dir_cache_t* dir_cache) const
 {
-    return to_path(base, false, str);
+    return to_path(base, false, str, dir_cache);
 }
 
 // -----------------------------------------------------------------------------
@@ -117,7 +127,7 @@ bool deps_entry_t::to_rel_path(const pal::string_t& base, pal::string_t* str) co
 // Returns:
 //    If the file exists in the path relative to the "base" directory.
 //
-bool deps_entry_t::to_full_path(const pal::string_t& base, pal::string_t* str) const
+bool deps_entry_t::to_full_path(const pal::string_t& base, pal::string_t* str, dir_cache_t* dir_cache) const
 {
     str->clear();
 
@@ -127,17 +137,91 @@ bool deps_entry_t::to_full_path(const pal::string_t& base, pal::string_t* str) c
         return false;
     }
 
-    pal::string_t new_base = base;
+    pal::string_t new_base;
+    to_package_dir(base, &new_base);
+
+    // A package that is missing under this base is remembered, so that its other assets
+    // are not looked for.
+    if (dir_cache != nullptr && !dir_cache->directory_exists(new_base))
+    {
+        return false;
+    }
+
+    return to_rel_path(new_base, str, dir_cache);
+}
+
+// -----------------------------------------------------------------------------
+// Given a "base" directory, yield the directory of this entry's package in the
+// package layout.
+//
+void deps_entry_t::to_package_dir(const pal::string_t& base, pal::string_t* str) const
+{
+    str->assign(base);
 
     if (library_path.empty())
     {
-        append_path(&new_base, library_name.c_str());
-        append_path(&new_base, library_version.c_str());
+        append_path(str, library_name.c_str());
+        append_path(str, library_version.c_str());
     }
     else
     {
-        append_path(&new_base, library_path.c_str());
+        append_path(str, library_path.c_str());
     }
+}
+// -----------------------------------------------------------------------------
+// Given a runtime store "base" directory and the index of its files, yield the
+// path of this file in the package layout, as in to_full_path.
+//
+// Parameters:
+//    base  - The runtime store directory
+//    index - The files in "base"
+//    str   - If the method returns true, contains the file path for this deps
+//            entry in the "base" directory
+//
+// Returns:
+//    If the index lists the file.
+//
+bool deps_entry_t::to_indexed_path(const pal::string_t& base, const store_index_t& index, pal::string_t* str) const
+{
+    str->clear();
 
-    return to_rel_path(new_base, str);
-}
\ No newline at end of file
+    if (base.empty())
+    {
+        return false;
+    }
+
+    pal::string_t relative_path;
+    if (library_path.empty())
+    {
+        relative_path.reserve(library_name.length() + library_version.length() + asset.relative_path.length() + 2);
+        relative_path.append(library_name);
+        relative_path.push_back(_X('/'));
+        relative_path.append(library_version);
+    }
+    else
+    {
+        relative_path = get_replaced_char(library_path, _X('\\'), _X('/'));
+        if (relative_path.back() == _X('/'))
+        {
+            relative_path.pop_back();
+        }
+    }
+    relative_path.push_back(_X('/'));
+    relative_path.append(asset.relative_path);
+
+    if (!index.contains(relative_path))
+    {
+        trace::verbose(_X("    Indexed path query did not exist %s"), relative_path.c_str());
+        return false;
+    }
+
+    if (_X('/') != DIR_SEPARATOR)
+    {
+        replace_char(&relative_path, _X('/'), DIR_SEPARATOR);
+    }
+
+    str->assign(base);
+    append_path(str, relative_path.c_str());
+    trace::verbose(_X("    Indexed path query exists %s"), str->c_str());
+    return true;
+}
@@ -9,16 +9,23 @@
 #include <vector>
 #include "pal.h"
 #include "version.h"
+#include "dir_cache.h"
+#include "store_index.h"
 
 struct deps_asset_t
 {
     deps_asset_t() : deps_asset_t(_X(""), _X(""), version_t(), version_t()) { }
 
-    deps_asset_t(const pal::string_t& name, const pal::string_t& relative_path, const version_t& assembly_version, const version_t& file_version)
-        : name(name)
-        , relative_path(get_replaced_char(relative_path, _X('\\'), _X('/'))) // Deps file does not follow spec. It uses '\\', should use '/'
+    // The strings are taken by value so that callers can move them in.
+    deps_asset_t(pal::string_t name, pal::string_t relative_path, const version_t& assembly_version, const version_t& file_version)
+        : name(std::move(name))
+        , relative_path(std::move(relative_path))
         , assembly_version(assembly_version)
-        , file_version(file_version) { }
+        , file_version(file_version)
+    {
+        // Deps file does not follow spec. It uses '\\', should use '/'
+        replace_char(&this->relative_path, _X('\\'), _X('/'));
+    }
 
     pal::string_t name;
     pal::string_t relative_path;
@@ -38,6 +45,11 @@ struct deps_entry_t
 
     static const std::array<const pal::char_t*, deps_entry_t::asset_types::count> s_known_asset_types;
 
+    // Library keys ("name/version") are interned into small process-wide ids so that
+    // package checks across deps files compare integers instead of strings.
+    static const uint32_t invalid_package_id = UINT32_MAX;
+    static uint32_t get_package_id(const pal::string_t& package);
+
     pal::string_t deps_file;
     pal::string_t library_type;
     pal::string_t library_name;
@@ -50,18 +62,27 @@ struct deps_entry_t
     deps_asset_t asset;
     bool is_serviceable;
     bool is_rid_specific;
+    uint32_t package_id = invalid_package_id;
+
+    // The queries below check for the file through "dir_cache" when one is given.
 
     // Given a "base" dir, yield the filepath within this directory or relative to this directory based on "look_in_base"
-    bool to_path(const pal::string_t& base, bool look_in_base, pal::string_t* str) const;
+    bool to_path(const pal::string_t& base, bool look_in_base, pal::string_t* str, dir_cache_t* dir_cache = nullptr) const;
 
     // Given a "base" dir, yield the file path within this directory.
-    bool to_dir_path(const pal::string_t& base, pal::string_t* str) const;
+    bool to_dir_path(const pal::string_t& base, pal::string_t* str, dir_cache_t* dir_cache = nullptr) const;
 
     // Given a "base" dir, yield the relative path in the package layout.
-    bool to_rel_path(const pal::string_t& base, pal::string_t* str) const;
+    bool to_rel_path(const pal::string_t& base, pal::string_t* str, dir_cache_t* dir_cache = nullptr) const;
+
+    // Given a "base" dir, yield the package directory in the package layout, whether or not it exists.
+    void to_package_dir(const pal::string_t& base, pal::string_t* str) const;
 
     // Given a "base" dir, yield the relative path with package name, version in the package layout.
-    bool to_full_path(const pal::string_t& root, pal::string_t* str) const;
+    bool to_full_path(const pal::string_t& root, pal::string_t* str, dir_cache_t* dir_cache = nullptr) const;
+
+    // Given a runtime store "base" dir and its index, yield the same path as to_full_path without touching the disk.
+    bool to_indexed_path(const pal::string_t& base, const store_index_t& index, pal::string_t* str) const;
 };
 
 #endif // __DEPS_ENTRY_H_
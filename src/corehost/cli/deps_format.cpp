@@ -5,16 +5,95 @@
 #include "deps_format.h"
 #include "utils.h"
 #include "trace.h"
+#include "timing.h"
+#include "host_env.h"
 #include <tuple>
 #include <array>
 #include <iterator>
 #include <cassert>
+#include <climits>
 #include <functional>
+#include <algorithm>
 
 const std::array<const pal::char_t*, deps_entry_t::asset_types::count> deps_entry_t::s_known_asset_types = {
     _X("runtime"), _X("resources"), _X("native")
 };
 
+namespace
+{
+    typedef web::json::reader::token json_token;
+
+    void throw_missing_key()
+    {
+        throw web::json::json_exception(_X("Key not found"));
+    }
+
+    void read_object_start(web::json::reader& reader)
+    {
+        if (reader.read() != json_token::begin_object)
+        {
+            throw web::json::json_exception(_X("not an object"));
+        }
+    }
+
+    void read_array_start(web::json::reader& reader)
+    {
+        if (reader.read() != json_token::begin_array)
+        {
+            throw web::json::json_exception(_X("not an array"));
+        }
+    }
+
+    // Advances to the next property of the current object, returns false at the end of the object.
+    bool read_property(web::json::reader& reader)
+    {
+        return reader.read() == json_token::property_name;
+    }
+
+    pal::string_t read_string(web::json::reader& reader)
+    {
+        reader.read();
+        return reader.as_string();
+    }
+
+    pal::string_t read_path(web::json::reader& reader)
+    {
+        pal::string_t path = read_string(reader);
+
+        if (path.length() > 0 && _X('/') != DIR_SEPARATOR)
+        {
+            replace_char(&path, _X('/'), DIR_SEPARATOR);
+        }
+
+        return path;
+    }
+
+    int get_known_asset_type(const pal::string_t& type)
+    {
+        for (int i = 0; i < deps_entry_t::s_known_asset_types.size(); ++i)
+        {
+            if (pal::strcasecmp(type.c_str(), deps_entry_t::s_known_asset_types[i]) == 0)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // A malformed assembly or file version, including one with a component above 65535,
+    // is reported and left absent rather than cut down to a different version.
+    version_t parse_asset_version(const pal::string_t& version, const pal::char_t* kind, const pal::string_t& asset)
+    {
+        version_t parsed;
+        if (version.length() > 0 && !version_t::parse(version, &parsed))
+        {
+            trace::warning(_X("Ignoring the invalid %s '%s' of asset [%s]"), kind, version.c_str(), asset.c_str());
+        }
+
+        return parsed;
+    }
+}
+
 const deps_entry_t& deps_json_t::try_ni(const deps_entry_t& entry) const
 {
     if (m_ni_entries.count(entry.asset.name))
@@ -25,111 +104,266 @@ const deps_entry_t& deps_json_t::try_ni(const deps_entry_t& entry) const
     return entry;
 }
 
-pal::string_t deps_json_t::get_optional_property(
-    const json_object& properties,
-    const pal::string_t& key) const
+void deps_json_t::read_runtime_target(json_reader& reader, pal::string_t* target_name)
 {
-    pal::string_t value;
+    if (reader.read() == json_token::string)
+    {
+        *target_name = reader.as_string();
+        return;
+    }
 
-    const auto& iter = properties.find(key);
+    if (reader.current() != json_token::begin_object)
+    {
+        throw web::json::json_exception(_X("not an object"));
+    }
 
-    if (iter != properties.end())
+    bool has_name = false;
+    while (read_property(reader))
     {
-        value = iter->second.as_string();
+        if (reader.as_string() == _X("name"))
+        {
+            *target_name = read_string(reader);
+            has_name = true;
+        }
+        else
+        {
+            reader.skip();
+        }
+    }
+
+    if (!has_name)
+    {
+        throw_missing_key();
+    }
+}
+
+void deps_json_t::read_target_files(json_reader& reader, bool runtime_targets, std::vector<target_file_t>* files)
+{
+    read_object_start(reader);
+    while (read_property(reader))
+    {
+        target_file_t file;
+        file.name = reader.as_string();
+
+        bool has_asset_type = false;
+        bool has_rid = false;
+
+        read_object_start(reader);
+        while (read_property(reader))
+        {
+            const pal::string_t& property = reader.as_string();
+            if (property == _X("assemblyVersion"))
+            {
+                file.assembly_version = read_string(reader);
+            }
+            else if (property == _X("fileVersion"))
+            {
+                file.file_version = read_string(reader);
+            }
+            else if (runtime_targets && property == _X("assetType"))
+            {
+                file.asset_type = read_string(reader);
+                has_asset_type = true;
+            }
+            else if (runtime_targets && property == _X("rid"))
+            {
+                file.rid = read_string(reader);
+                has_rid = true;
+            }
+            else
+            {
+                reader.skip();
+            }
+        }
+
+        // The rid is only required for the asset types that are consumed.
+        if (runtime_targets && (!has_asset_type || (!has_rid && get_known_asset_type(file.asset_type) >= 0)))
+        {
+            throw_missing_key();
+        }
+
+        files->push_back(std::move(file));
     }
 
-    return value;
+    // Process files in name order, independent of the order in the manifest.
+    std::stable_sort(files->begin(), files->end(), [](const target_file_t& a, const target_file_t& b) {
+        return a.name < b.name;
+    });
 }
 
-pal::string_t deps_json_t::get_optional_path(
-    const json_object& properties,
-    const pal::string_t& key) const
+void deps_json_t::read_target(json_reader& reader, bool is_framework_dependent, target_t* target)
 {
-    pal::string_t path = get_optional_property(properties, key);
+    read_object_start(reader);
+    while (read_property(reader))
+    {
+        auto& package = (*target)[reader.as_string()];
 
-    if (path.length() > 0 && _X('/') != DIR_SEPARATOR)
+        read_object_start(reader);
+        while (read_property(reader))
+        {
+            const pal::string_t& property = reader.as_string();
+            if (property == _X("runtimeTargets") && is_framework_dependent)
+            {
+                read_target_files(reader, true, &package.runtime_targets);
+                continue;
+            }
+
+            int i = 0;
+            while (i < deps_entry_t::s_known_asset_types.size() && property != deps_entry_t::s_known_asset_types[i])
+            {
+                ++i;
+            }
+
+            if (i < deps_entry_t::s_known_asset_types.size())
+            {
+                read_target_files(reader, false, &package.assets[i]);
+            }
+            else
+            {
+                reader.skip();
+            }
+        }
+    }
+}
+
+void deps_json_t::read_libraries(json_reader& reader, libraries_t* libraries)
+{
+    read_object_start(reader);
+    while (read_property(reader))
     {
-        replace_char(&path, _X('/'), DIR_SEPARATOR);
+        auto& library = (*libraries)[reader.as_string()];
+
+        read_object_start(reader);
+        while (read_property(reader))
+        {
+            const pal::string_t& property = reader.as_string();
+            if (property == _X("type"))
+            {
+                library.type = pal::to_lower(read_string(reader));
+                library.has_type = true;
+            }
+            else if (property == _X("sha512"))
+            {
+                library.sha512 = read_string(reader);
+                library.has_sha512 = true;
+            }
+            else if (property == _X("serviceable"))
+            {
+                reader.read();
+                library.serviceable = reader.as_bool();
+                library.has_serviceable = true;
+            }
+            else if (property == _X("path"))
+            {
+                library.path = read_path(reader);
+            }
+            else if (property == _X("hashPath"))
+            {
+                library.hash_path = read_path(reader);
+            }
+            else if (property == _X("runtimeStoreManifestName"))
+            {
+                library.runtime_store_manifest_name = read_path(reader);
+            }
+            else
+            {
+                reader.skip();
+            }
+        }
     }
+}
 
-    return path;
+void deps_json_t::read_runtimes(json_reader& reader)
+{
+    read_object_start(reader);
+    while (read_property(reader))
+    {
+        auto& vec = m_rid_fallback_graph[reader.as_string()];
+
+        read_array_start(reader);
+        while (reader.read() != json_token::end_array)
+        {
+            vec.push_back(reader.as_string());
+        }
+    }
 }
 
 void deps_json_t::reconcile_libraries_with_targets(
     const pal::string_t& deps_path,
-    const json_value& json,
+    const libraries_t& libraries,
     const std::function<bool(const pal::string_t&)>& library_exists_fn,
     const std::function<const vec_asset_t&(const pal::string_t&, int, bool*)>& get_assets_fn)
 {
     pal::string_t deps_file = get_filename(deps_path);
 
-    const auto& libraries = json.at(_X("libraries")).as_object();
     for (const auto& library : libraries)
     {
-        trace::info(_X("Reconciling library %s"), library.first.c_str());
+        trace::verbose(_X("Reconciling library %s"), library.first.c_str());
 
         if (!library_exists_fn(library.first))
         {
-            trace::info(_X("Library %s does not exist"), library.first.c_str());
+            trace::verbose(_X("Library %s does not exist"), library.first.c_str());
             continue;
         }
 
-        const auto& properties = library.second.as_object();
-
-        const pal::string_t& hash = properties.at(_X("sha512")).as_string();
-        bool serviceable = properties.at(_X("serviceable")).as_bool();
+        const auto& properties = library.second;
+        if (!properties.has_sha512 || !properties.has_serviceable)
+        {
+            throw_missing_key();
+        }
 
-        pal::string_t library_path = get_optional_path(properties, _X("path"));
-        pal::string_t library_hash_path = get_optional_path(properties, _X("hashPath"));
-        pal::string_t runtime_store_manifest_list = get_optional_path(properties, _X("runtimeStoreManifestName"));
+        size_t pos = library.first.find(_X("/"));
+        const pal::string_t library_name = library.first.substr(0, pos);
+        const pal::string_t library_version = library.first.substr(pos + 1);
+        const uint32_t package_id = deps_entry_t::get_package_id(library.first);
 
         for (int i = 0; i < deps_entry_t::s_known_asset_types.size(); ++i)
         {
             bool rid_specific = false;
             for (const auto& asset : get_assets_fn(library.first, i, &rid_specific))
             {
-                bool ni_dll = false;
-                auto asset_name = asset.name;
-                if (ends_with(asset_name, _X(".ni"), false))
+                if (!properties.has_type)
                 {
-                    ni_dll = true;
-                    asset_name = strip_file_ext(asset_name);
+                    throw_missing_key();
                 }
 
-                deps_entry_t entry;
-                size_t pos = library.first.find(_X("/"));
-                entry.library_name = library.first.substr(0, pos);
-                entry.library_version = library.first.substr(pos + 1);
-                entry.library_type = pal::to_lower(properties.at(_X("type")).as_string());
-                entry.library_hash = hash;
-                entry.library_path = library_path;
-                entry.library_hash_path = library_hash_path;
-                entry.runtime_store_manifest_list = runtime_store_manifest_list;
+                // Build the entry in place to avoid copying its strings.
+                m_deps_entries[i].emplace_back();
+                deps_entry_t& entry = m_deps_entries[i].back();
+                entry.library_name = library_name;
+                entry.library_version = library_version;
+                entry.library_type = properties.type;
+                entry.library_hash = properties.sha512;
+                entry.library_path = properties.path;
+                entry.library_hash_path = properties.hash_path;
+                entry.runtime_store_manifest_list = properties.runtime_store_manifest_name;
                 entry.asset_type = (deps_entry_t::asset_types) i;
-                entry.is_serviceable = serviceable;
+                entry.is_serviceable = properties.serviceable;
                 entry.is_rid_specific = rid_specific;
                 entry.deps_file = deps_file;
+                entry.package_id = package_id;
                 entry.asset = asset;
-                entry.asset.name = asset_name;
-
-                m_deps_entries[i].push_back(entry);
 
-                if (ni_dll)
+                if (ends_with(entry.asset.name, _X(".ni"), false))
                 {
+                    entry.asset.name = strip_file_ext(entry.asset.name);
                     m_ni_entries[entry.asset.name] = m_deps_entries
                         [deps_entry_t::asset_types::runtime].size() - 1;
                 }
 
-                trace::info(_X("Parsed %s deps entry %d for asset name: %s from %s: %s, library version: %s, relpath: %s, assemblyVersion %s, fileVersion %s"),
-                    deps_entry_t::s_known_asset_types[i],
-                    m_deps_entries[i].size() - 1,
-                    entry.asset.name.c_str(),
-                    entry.library_type.c_str(),
-                    entry.library_name.c_str(),
-                    entry.library_version.c_str(),
-                    entry.asset.relative_path.c_str(),
-                    entry.asset.assembly_version.as_str().c_str(),
-                    entry.asset.file_version.as_str().c_str());
+                if (trace::is_enabled(trace::level_t::verbose))
+                {
+                    trace::verbose(_X("Parsed %s deps entry %d for asset name: %s from %s: %s, library version: %s, relpath: %s, assemblyVersion %s, fileVersion %s"),
+                        deps_entry_t::s_known_asset_types[i],
+                        m_deps_entries[i].size() - 1,
+                        entry.asset.name.c_str(),
+                        entry.library_type.c_str(),
+                        entry.library_name.c_str(),
+                        entry.library_version.c_str(),
+                        entry.asset.relative_path.c_str(),
+                        entry.asset.assembly_version.as_str().c_str(),
+                        entry.asset.file_version.as_str().c_str());
+                }
             }
         }
     }
@@ -140,7 +374,7 @@ pal::string_t deps_json_t::get_current_rid(const rid_fallback_graph_t& rid_fallb
 {
     
     pal::string_t currentRid;
-    if (!pal::getenv(_X("DOTNET_RUNTIME_ID"), &currentRid))
+    if (!host_env::get(host_env::runtime_id, &currentRid))
     {
         currentRid = pal::get_current_os_rid_platform();
         if (!currentRid.empty())
@@ -166,153 +400,130 @@ pal::string_t deps_json_t::get_current_rid(const rid_fallback_graph_t& rid_fallb
     return currentRid;
 }
 
-bool deps_json_t::perform_rid_fallback(rid_specific_assets_t* portable_assets, const rid_fallback_graph_t& rid_fallback_graph)
+// Flattens the RID fallback graph for the host RID once per manifest, so that choosing
+// the RID specific assets of a package does not walk the graph again.
+void deps_json_t::get_rid_ranks(const rid_fallback_graph_t& rid_fallback_graph, rid_ranks_t* rid_ranks)
 {
-    pal::string_t host_rid = get_current_rid(rid_fallback_graph);
-    
-    for (auto& package : portable_assets->libs)
+    rid_ranks->rids.push_back(get_current_rid(rid_fallback_graph));
+
+    auto iter = rid_fallback_graph.find(rid_ranks->rids.front());
+    rid_ranks->host_rid_in_graph = iter != rid_fallback_graph.end();
+    if (rid_ranks->host_rid_in_graph)
     {
-        pal::string_t matched_rid = package.second.rid_assets.count(host_rid) ? host_rid : _X("");
-        if (matched_rid.empty())
-        {
-            if (rid_fallback_graph.count(host_rid) == 0)
-            {
-                trace::warning(_X("The targeted framework does not support the runtime '%s'. Some native libraries from [%s] may fail to load on this platform."), host_rid.c_str(), package.first.c_str());
-            }
-            else
-            {
-                const auto& fallback_rids = rid_fallback_graph.find(host_rid)->second;
-                auto iter = std::find_if(fallback_rids.begin(), fallback_rids.end(), [&package](const pal::string_t& rid) {
-                    return package.second.rid_assets.count(rid);
-                });
-                if (iter != fallback_rids.end())
-                {
-                    matched_rid = *iter;
-                }
-            }
-        }
+        rid_ranks->rids.insert(rid_ranks->rids.end(), iter->second.begin(), iter->second.end());
+    }
 
-        if (matched_rid.empty())
-        {
-            package.second.rid_assets.clear();
-        }
+    // The first occurrence of a RID is its rank.
+    for (size_t i = 0; i < rid_ranks->rids.size(); ++i)
+    {
+        rid_ranks->ranks.emplace(rid_ranks->rids[i], (int) i);
+    }
+}
 
-        for (auto iter = package.second.rid_assets.begin(); iter != package.second.rid_assets.end(); /* */)
+// Returns the host RID followed by its fallbacks, used to validate binary manifests.
+pal::string_t deps_json_t::get_rid_key(const rid_ranks_t& rid_ranks)
+{
+    pal::string_t rid_key;
+    for (const auto& rid : rid_ranks.rids)
+    {
+        if (!rid_key.empty())
         {
-            if (iter->first != matched_rid)
-            {
-                trace::verbose(_X("Chose %s, so removing rid (%s) specific assets for package %s"), matched_rid.c_str(), iter->first.c_str(), package.first.c_str());
-                iter = package.second.rid_assets.erase(iter);
-            }
-            else
-            {
-                ++iter;
-            }
+            rid_key.push_back(PATH_SEPARATOR);
         }
+        rid_key.append(rid);
     }
-    return true;
-}
 
+    return rid_key;
+}
 
-bool deps_json_t::process_runtime_targets(const json_value& json, const pal::string_t& target_name, const rid_fallback_graph_t& rid_fallback_graph, rid_specific_assets_t* p_assets)
+// Keeps the RID specific assets of each package for the most preferred RID it has, which is
+// the host RID or the closest of its fallbacks. Packages without such a RID keep no assets.
+bool deps_json_t::process_runtime_targets(const target_t& target, const rid_ranks_t& rid_ranks, rid_specific_assets_t* p_assets)
 {
     rid_specific_assets_t& assets = *p_assets;
-    for (const auto& package : json.at(_X("targets")).at(target_name).as_object())
+    for (const auto& package : target)
     {
-        const auto& targets = package.second.as_object();
-        auto iter = targets.find(_X("runtimeTargets"));
-        if (iter == targets.end())
-        {
-            continue;
-        }
+        rid_assets_t* package_assets = nullptr;
+        int matched_rank = INT_MAX;
 
-        const auto& files = iter->second.as_object();
-        for (const auto& file : files)
+        for (const auto& file : package.second.runtime_targets)
         {
-            const auto& type = file.second.at(_X("assetType")).as_string();
-            for (int i = 0; i < deps_entry_t::s_known_asset_types.size(); ++i)
+            int i = get_known_asset_type(file.asset_type);
+            if (i < 0)
             {
-                if (pal::strcasecmp(type.c_str(), deps_entry_t::s_known_asset_types[i]) == 0)
-                {
-                    const auto& rid = file.second.at(_X("rid")).as_string();
+                continue;
+            }
 
-                    version_t assembly_version, file_version;
-                    const auto& properties = file.second.as_object();
+            if (package_assets == nullptr)
+            {
+                package_assets = &assets.libs[package.first];
+            }
 
-                    pal::string_t assembly_version_str = get_optional_property(properties, _X("assemblyVersion"));
-                    if (assembly_version_str.length() > 0)
-                    {
-                        version_t::parse(assembly_version_str, &assembly_version);
-                    }
+            auto rank = rid_ranks.ranks.find(file.rid);
+            if (rank == rid_ranks.ranks.end() || rank->second > matched_rank)
+            {
+                trace::verbose(_X("Skipping rid (%s) specific asset %s for package %s"), file.rid.c_str(), file.name.c_str(), package.first.c_str());
+                continue;
+            }
 
-                    pal::string_t file_version_str = get_optional_property(properties, _X("fileVersion"));
-                    if (file_version_str.length() > 0)
-                    {
-                        version_t::parse(file_version_str, &file_version);
-                    }
+            if (rank->second < matched_rank)
+            {
+                package_assets->rid_assets.clear();
+                matched_rank = rank->second;
+            }
 
-                    deps_asset_t asset(get_filename_without_ext(file.first), file.first, assembly_version, file_version);
+            version_t assembly_version = parse_asset_version(file.assembly_version, _X("assemblyVersion"), file.name);
+            version_t file_version = parse_asset_version(file.file_version, _X("fileVersion"), file.name);
 
-                    trace::info(_X("Adding runtimeTargets %s asset %s rid=%s assemblyVersion=%s fileVersion=%s from %s"),
-                        deps_entry_t::s_known_asset_types[i],
-                        asset.relative_path.c_str(),
-                        rid.c_str(),
-                        asset.assembly_version.as_str().c_str(),
-                        asset.file_version.as_str().c_str(),
-                        package.first.c_str());
+            auto& rid_assets = package_assets->rid_assets[file.rid][i];
+            rid_assets.emplace_back(get_filename_without_ext(file.name), file.name, assembly_version, file_version);
+            const deps_asset_t& asset = rid_assets.back();
 
-                    assets.libs[package.first].rid_assets[rid][i].push_back(asset);
-                }
+            if (trace::is_enabled(trace::level_t::verbose))
+            {
+                trace::verbose(_X("Adding runtimeTargets %s asset %s rid=%s assemblyVersion=%s fileVersion=%s from %s"),
+                    deps_entry_t::s_known_asset_types[i],
+                    asset.relative_path.c_str(),
+                    file.rid.c_str(),
+                    asset.assembly_version.as_str().c_str(),
+                    asset.file_version.as_str().c_str(),
+                    package.first.c_str());
             }
         }
-    }
 
-    if (!perform_rid_fallback(&assets, rid_fallback_graph))
-    {
-        return false;
+        if (package_assets != nullptr && package_assets->rid_assets.empty() && !rid_ranks.host_rid_in_graph)
+        {
+            trace::warning(_X("The targeted framework does not support the runtime '%s'. Some native libraries from [%s] may fail to load on this platform."), rid_ranks.rids.front().c_str(), package.first.c_str());
+        }
     }
 
     return true;
 }
 
-bool deps_json_t::process_targets(const json_value& json, const pal::string_t& target_name, deps_assets_t* p_assets)
+bool deps_json_t::process_targets(const target_t& target, deps_assets_t* p_assets)
 {
     deps_assets_t& assets = *p_assets;
-    for (const auto& package : json.at(_X("targets")).at(target_name).as_object())
+    for (const auto& package : target)
     {
-        const auto& asset_types = package.second.as_object();
         for (int i = 0; i < deps_entry_t::s_known_asset_types.size(); ++i)
         {
-            auto iter = asset_types.find(deps_entry_t::s_known_asset_types[i]);
-            if (iter != asset_types.end())
+            for (const auto& file : package.second.assets[i])
             {
-                for (const auto& file : iter->second.as_object())
-                {
-                    const auto& properties = file.second.as_object();
-                    version_t assembly_version, file_version;
+                version_t assembly_version = parse_asset_version(file.assembly_version, _X("assemblyVersion"), file.name);
+                version_t file_version = parse_asset_version(file.file_version, _X("fileVersion"), file.name);
 
-                    pal::string_t assembly_version_str = get_optional_property(properties, _X("assemblyVersion"));
-                    if (assembly_version_str.length() > 0)
-                    {
-                        version_t::parse(assembly_version_str, &assembly_version);
-                    }
+                auto& package_assets = assets.libs[package.first][i];
+                package_assets.emplace_back(get_filename_without_ext(file.name), file.name, assembly_version, file_version);
+                const deps_asset_t& asset = package_assets.back();
 
-                    pal::string_t file_version_str = get_optional_property(properties, _X("fileVersion"));
-                    if (file_version_str.length() > 0)
-                    {
-                        version_t::parse(file_version_str, &file_version);
-                    }
-
-                    deps_asset_t asset(get_filename_without_ext(file.first), file.first, assembly_version, file_version);
-
-                    trace::info(_X("Adding %s asset %s assemblyVersion=%s fileVersion=%s from %s"),
+                if (trace::is_enabled(trace::level_t::verbose))
+                {
+                    trace::verbose(_X("Adding %s asset %s assemblyVersion=%s fileVersion=%s from %s"),
                         deps_entry_t::s_known_asset_types[i],
                         asset.relative_path.c_str(),
                         asset.assembly_version.as_str().c_str(),
                         asset.file_version.as_str().c_str(),
                         package.first.c_str());
-
-                    assets.libs[package.first][i].push_back(asset);
                 }
             }
         }
@@ -320,14 +531,14 @@ bool deps_json_t::process_targets(const json_value& json, const pal::string_t& t
     return true;
 }
 
-bool deps_json_t::load_framework_dependent(const pal::string_t& deps_path, const json_value& json, const pal::string_t& target_name, const rid_fallback_graph_t& rid_fallback_graph)
+bool deps_json_t::load_framework_dependent(const pal::string_t& deps_path, const target_t& target, const libraries_t& libraries, const rid_ranks_t& rid_ranks)
 {
-    if (!process_runtime_targets(json, target_name, rid_fallback_graph, &m_rid_assets))
+    if (!process_runtime_targets(target, rid_ranks, &m_rid_assets))
     {
         return false;
     }
 
-    if (!process_targets(json, target_name, &m_assets))
+    if (!process_targets(target, &m_assets))
     {
         return false;
     }
@@ -362,14 +573,15 @@ bool deps_json_t::load_framework_dependent(const pal::string_t& deps_path, const
         return empty;
     };
 
-    reconcile_libraries_with_targets(deps_path, json, package_exists, get_relpaths);
+    reconcile_libraries_with_targets(deps_path, libraries, package_exists, get_relpaths);
+    index_packages();
 
     return true;
 }
 
-bool deps_json_t::load_self_contained(const pal::string_t& deps_path, const json_value& json, const pal::string_t& target_name)
+bool deps_json_t::load_self_contained(const pal::string_t& deps_path, const target_t& target, const libraries_t& libraries)
 {
-    if (!process_targets(json, target_name, &m_assets))
+    if (!process_targets(target, &m_assets))
     {
         return false;
     }
@@ -383,23 +595,10 @@ bool deps_json_t::load_self_contained(const pal::string_t& deps_path, const json
         return m_assets.libs[package][type_index];
     };
 
-    reconcile_libraries_with_targets(deps_path, json, package_exists, get_relpaths);
+    reconcile_libraries_with_targets(deps_path, libraries, package_exists, get_relpaths);
+    index_packages();
 
-    const auto& json_object = json.as_object();
-    const auto iter = json_object.find(_X("runtimes"));
-    if (iter != json_object.end())
-    {
-        for (const auto& rid : iter->second.as_object())
-        {
-            auto& vec = m_rid_fallback_graph[rid.first];
-            for (const auto& fallback : rid.second.as_array())
-            {
-                vec.push_back(fallback.as_string());
-            }
-        }
-    }
-
-    if (trace::is_enabled())
+    if (trace::is_enabled(trace::level_t::verbose))
     {
         trace::verbose(_X("The rid fallback graph is: {"));
         for (const auto& rid : m_rid_fallback_graph)
@@ -416,22 +615,30 @@ bool deps_json_t::load_self_contained(const pal::string_t& deps_path, const json
     return true;
 }
 
-bool deps_json_t::has_package(const pal::string_t& name, const pal::string_t& ver) const
+void deps_json_t::add_package(const pal::string_t& package)
 {
-    pal::string_t pv = name;
-    pv.push_back(_X('/'));
-    pv.append(ver);
-    
-    auto iter = m_rid_assets.libs.find(pv);
-    if (iter != m_rid_assets.libs.end())
+    uint32_t id = deps_entry_t::get_package_id(package);
+    if (id >= m_packages.size())
     {
-        if (!iter->second.rid_assets.empty())
+        m_packages.resize(id + 1);
+    }
+    m_packages[id] = true;
+}
+
+// A package is known if it has portable assets or assets for some rid.
+void deps_json_t::index_packages()
+{
+    for (const auto& package : m_assets.libs)
+    {
+        add_package(package.first);
+    }
+    for (const auto& package : m_rid_assets.libs)
+    {
+        if (!package.second.rid_assets.empty())
         {
-            return true;
+            add_package(package.first);
         }
     }
-    
-    return m_assets.libs.count(pv);
 }
 
 // -----------------------------------------------------------------------------
@@ -450,32 +657,169 @@ bool deps_json_t::load(bool is_framework_dependent, const pal::string_t& deps_pa
         return true;
     }
 
-    // Somehow the file stream could not be opened. This is an error.
-    pal::ifstream_t file(deps_path);
-    if (!file.good())
+    // Only framework dependent manifests have RID specific assets to choose from.
+    rid_ranks_t rid_ranks;
+    if (is_framework_dependent)
+    {
+        get_rid_ranks(rid_fallback_graph, &rid_ranks);
+    }
+
+    if (!binary_deps_enabled())
+    {
+        return load_json(is_framework_dependent, deps_path, rid_ranks);
+    }
+
+    // The RID specific assets of a framework dependent manifest depend on the host RID,
+    // so a binary manifest is only reused for the same RID and fallbacks.
+    pal::string_t rid_key = get_rid_key(rid_ranks);
+    if (load_binary(deps_path, is_framework_dependent, rid_key))
+    {
+        return true;
+    }
+
+    if (!load_json(is_framework_dependent, deps_path, rid_ranks))
+    {
+        return false;
+    }
+
+    save_binary(deps_path, is_framework_dependent, rid_key);
+    return true;
+}
+
+void deps_json_t::prefetch(const pal::string_t& deps_path)
+{
+    // Binary manifests are cheap to load and depend on the RID fallback graph, leave them to load().
+    if (binary_deps_enabled() || !pal::file_exists(deps_path))
+    {
+        return;
+    }
+
+    m_manifest.reset(new manifest_t());
+    m_manifest->deps_path = deps_path;
+    m_manifest->valid = read_manifest(true, deps_path, m_manifest.get());
+}
+
+bool deps_json_t::read_manifest(bool is_framework_dependent, const pal::string_t& deps_path, manifest_t* manifest)
+{
+    // Somehow the file could not be read. This is an error.
+    file_contents_t file;
+    if (!file.load(deps_path))
     {
         trace::error(_X("Could not open dependencies manifest file [%s]"), deps_path.c_str());
         return false;
     }
 
-    if (skip_utf8_bom(&file))
+    const char* begin = file.begin();
+    if (skip_utf8_bom(&begin, file.end()))
     {
         trace::verbose(_X("UTF-8 BOM skipped while reading [%s]"), deps_path.c_str());
     }
 
+    timing::increment(timing::files_parsed);
+
     try
     {
-        const auto json = json_value::parse(file);
+        // Read the manifest as a stream, keeping only the target that is being loaded. The
+        // runtimeTarget normally precedes the targets; if it does not, all targets are kept
+        // until the name is known.
+        json_reader reader(begin, file.end());
+
+        pal::string_t name;
+        bool has_runtime_target = false;
+        bool has_targets = false;
+        bool has_libraries = false;
+        std::map<pal::string_t, target_t> targets;
+
+        read_object_start(reader);
+        while (read_property(reader))
+        {
+            const pal::string_t& property = reader.as_string();
+            if (property == _X("runtimeTarget"))
+            {
+                read_runtime_target(reader, &name);
+                has_runtime_target = true;
+            }
+            else if (property == _X("targets"))
+            {
+                read_object_start(reader);
+                while (read_property(reader))
+                {
+                    if (has_runtime_target && reader.as_string() != name)
+                    {
+                        reader.skip();
+                        continue;
+                    }
+
+                    read_target(reader, is_framework_dependent, &targets[reader.as_string()]);
+                }
+                has_targets = true;
+            }
+            else if (property == _X("libraries"))
+            {
+                read_libraries(reader, &manifest->libraries);
+                has_libraries = true;
+            }
+            else if (property == _X("runtimes") && !is_framework_dependent)
+            {
+                read_runtimes(reader);
+            }
+            else
+            {
+                reader.skip();
+            }
+        }
 
-        const auto& runtime_target = json.at(_X("runtimeTarget"));
+        // Fails if anything follows the document.
+        reader.read();
+
+        if (!has_runtime_target || !has_targets || !has_libraries)
+        {
+            throw_missing_key();
+        }
 
-        const pal::string_t& name = runtime_target.is_string()?
-            runtime_target.as_string():
-            runtime_target.at(_X("name")).as_string();
+        auto target = targets.find(name);
+        if (target == targets.end())
+        {
+            throw_missing_key();
+        }
 
+        manifest->target = std::move(target->second);
+        return true;
+    }
+    catch (const std::exception& je)
+    {
+        pal::string_t jes;
+        (void) pal::utf8_palstring(je.what(), &jes);
+        trace::error(_X("A JSON parsing exception occurred in [%s]: %s"), deps_path.c_str(), jes.c_str());
+        return false;
+    }
+}
+
+bool deps_json_t::load_json(bool is_framework_dependent, const pal::string_t& deps_path, const rid_ranks_t& rid_ranks)
+{
+    // Use the manifest read by prefetch() if there is one, errors were reported when it was read.
+    std::unique_ptr<manifest_t> manifest = std::move(m_manifest);
+    if (manifest && is_framework_dependent && manifest->deps_path == deps_path)
+    {
+        if (!manifest->valid)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        manifest.reset(new manifest_t());
+        if (!read_manifest(is_framework_dependent, deps_path, manifest.get()))
+        {
+            return false;
+        }
+    }
+
+    try
+    {
         trace::verbose(_X("Loading deps file... %s as framework dependent=[%d]"), deps_path.c_str(), is_framework_dependent);
 
-        return (is_framework_dependent) ? load_framework_dependent(deps_path, json, name, rid_fallback_graph) : load_self_contained(deps_path, json, name);
+        return (is_framework_dependent) ? load_framework_dependent(deps_path, manifest->target, manifest->libraries, rid_ranks) : load_self_contained(deps_path, manifest->target, manifest->libraries);
     }
     catch (const std::exception& je)
     {
@@ -8,14 +8,15 @@
 #include <vector>
 #include <unordered_set>
 #include <functional>
+#include <map>
+#include <memory>
 #include "pal.h"
 #include "deps_entry.h"
 #include "cpprest/json.h"
 
 class deps_json_t
 {
-    typedef web::json::value json_value;
-    typedef web::json::object json_object;
+    typedef web::json::reader json_reader;
     typedef std::vector<deps_asset_t> vec_asset_t;
     typedef std::array<vec_asset_t, deps_entry_t::asset_types::count> assets_t;
     struct deps_assets_t { std::unordered_map<pal::string_t, assets_t> libs; };
@@ -24,6 +25,56 @@ class deps_json_t
 
     typedef std::unordered_map<pal::string_t, std::vector<pal::string_t>> str_to_vector_map_t;
 
+    // The parts of the manifest that are kept while it is read. Maps are ordered
+    // so that libraries and packages are processed in a stable order.
+    struct target_file_t
+    {
+        pal::string_t name;
+        pal::string_t rid;
+        pal::string_t asset_type;
+        pal::string_t assembly_version;
+        pal::string_t file_version;
+    };
+    struct target_package_t
+    {
+        std::array<std::vector<target_file_t>, deps_entry_t::asset_types::count> assets;
+        std::vector<target_file_t> runtime_targets;
+    };
+    typedef std::map<pal::string_t, target_package_t> target_t;
+    struct library_t
+    {
+        library_t() : has_type(false), has_sha512(false), has_serviceable(false), serviceable(false) { }
+
+        bool has_type;
+        bool has_sha512;
+        bool has_serviceable;
+        pal::string_t type;
+        pal::string_t sha512;
+        bool serviceable;
+        pal::string_t path;
+        pal::string_t hash_path;
+        pal::string_t runtime_store_manifest_name;
+    };
+    typedef std::map<pal::string_t, library_t> libraries_t;
+    // The host RID followed by its fallbacks, a RID's rank is its position in that list.
+    struct rid_ranks_t
+    {
+        rid_ranks_t() : host_rid_in_graph(false) { }
+
+        bool host_rid_in_graph;
+        std::vector<pal::string_t> rids;
+        std::unordered_map<pal::string_t, int> ranks;
+    };
+    struct manifest_t
+    {
+        manifest_t() : valid(false) { }
+
+        pal::string_t deps_path;
+        bool valid;
+        target_t target;
+        libraries_t libraries;
+    };
+
 public:
     typedef str_to_vector_map_t rid_fallback_graph_t;
 
@@ -54,13 +105,21 @@ public:
         m_valid = load(is_framework_dependent, deps_path, graph);
     }
 
+    // Reads a framework dependent manifest ahead of parse(). Only processing the manifest needs
+    // the RID fallback graph, so this can run before the graph is known and on another thread.
+    void prefetch(const pal::string_t& deps_path);
+
     const std::vector<deps_entry_t>& get_entries(deps_entry_t::asset_types type) const
     {
         assert(type < deps_entry_t::asset_types::count);
         return m_deps_entries[type];
     }
 
-    bool has_package(const pal::string_t& name, const pal::string_t& ver) const;
+    // Whether the deps file has assets for the entry's library, regardless of their paths.
+    bool has_package(const deps_entry_t& entry) const
+    {
+        return entry.package_id < m_packages.size() && m_packages[entry.package_id];
+    }
 
     bool exists() const
     {
@@ -85,23 +144,39 @@ public:
     }
 
 private:
-    bool load_self_contained(const pal::string_t& deps_path, const json_value& json, const pal::string_t& target_name);
-    bool load_framework_dependent(const pal::string_t& deps_path, const json_value& json, const pal::string_t& target_name, const rid_fallback_graph_t& rid_fallback_graph);
+    bool load_self_contained(const pal::string_t& deps_path, const target_t& target, const libraries_t& libraries);
+    bool load_framework_dependent(const pal::string_t& deps_path, const target_t& target, const libraries_t& libraries, const rid_ranks_t& rid_ranks);
     bool load(bool is_framework_dependent, const pal::string_t& deps_path, const rid_fallback_graph_t& rid_fallback_graph);
-    bool process_runtime_targets(const json_value& json, const pal::string_t& target_name, const rid_fallback_graph_t& rid_fallback_graph, rid_specific_assets_t* p_assets);
-    bool process_targets(const json_value& json, const pal::string_t& target_name, deps_assets_t* p_assets);
+    bool load_json(bool is_framework_dependent, const pal::string_t& deps_path, const rid_ranks_t& rid_ranks);
+    bool read_manifest(bool is_framework_dependent, const pal::string_t& deps_path, manifest_t* manifest);
+    bool process_runtime_targets(const target_t& target, const rid_ranks_t& rid_ranks, rid_specific_assets_t* p_assets);
+    bool process_targets(const target_t& target, deps_assets_t* p_assets);
 
     void reconcile_libraries_with_targets(
         const pal::string_t& deps_path,
-        const json_value& json,
+        const libraries_t& libraries,
         const std::function<bool(const pal::string_t&)>& library_exists_fn,
         const std::function<const vec_asset_t&(const pal::string_t&, int, bool*)>& get_assets_fn);
 
-    pal::string_t get_optional_property(const json_object& properties, const pal::string_t& key) const;
-    pal::string_t get_optional_path(const json_object& properties, const pal::string_t& key) const;
+    // Streaming readers for the sections of the manifest
+    static void read_runtime_target(json_reader& reader, pal::string_t* target_name);
+    static void read_target(json_reader& reader, bool is_framework_dependent, target_t* target);
+    static void read_target_files(json_reader& reader, bool runtime_targets, std::vector<target_file_t>* files);
+    static void read_libraries(json_reader& reader, libraries_t* libraries);
+    void read_runtimes(json_reader& reader);
 
     pal::string_t get_current_rid(const rid_fallback_graph_t& rid_fallback_graph);
-    bool perform_rid_fallback(rid_specific_assets_t* portable_assets, const rid_fallback_graph_t& rid_fallback_graph);
+    void get_rid_ranks(const rid_fallback_graph_t& rid_fallback_graph, rid_ranks_t* rid_ranks);
+    static pal::string_t get_rid_key(const rid_ranks_t& rid_ranks);
+    void add_package(const pal::string_t& package);
+    void index_packages();
+
+    // Binary deps manifest (*.deps.<hash>.bin in the startup cache directory) support
+    static bool binary_deps_enabled();
+    static pal::string_t get_binary_deps_path(const pal::string_t& deps_path);
+    bool load_binary(const pal::string_t& deps_path, bool is_framework_dependent, const pal::string_t& rid_key);
+    bool load_binary_body(const char* data, size_t length, const pal::string_t& deps_path, const pal::string_t& rid_key);
+    void save_binary(const pal::string_t& deps_path, bool is_framework_dependent, const pal::string_t& rid_key) const;
 
     std::vector<deps_entry_t> m_deps_entries[deps_entry_t::asset_types::count];
 
@@ -109,11 +184,17 @@ private:
     rid_specific_assets_t m_rid_assets;
 
     std::unordered_map<pal::string_t, int> m_ni_entries;
+
+    // Indexed by package id, set for the packages that has_package reports
+    std::vector<bool> m_packages;
     rid_fallback_graph_t m_rid_fallback_graph;
     bool m_file_exists;
     bool m_valid;
 
     pal::string_t m_deps_file;
+
+    // Manifest read by prefetch() that has not been processed yet
+    std::unique_ptr<manifest_t> m_manifest;
 };
 
 #endif // __DEPS_FORMAT_H_
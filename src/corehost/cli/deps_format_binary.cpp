@@ -0,0 +1,584 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "deps_entry.h"
+#include "deps_format.h"
+#include "utils.h"
+#include "trace.h"
+#include "timing.h"
+#include "host_env.h"
+
+// -----------------------------------------------------------------------------
+// Binary deps manifest (*.deps.bin)
+//
+// A machine local sidecar holding the result of loading a deps.json: a string
+// table followed by fixed size entry records that index into it. Loading it skips
+// parsing the JSON and selecting the RID specific assets; the strings are read from
+// the mapped file and copied once, into the loaded entries. The sidecar is only
+// valid for the deps.json it was produced from (path, timestamp and size) and, for
+// framework dependent manifests, for the host RID and its fallbacks that were
+// used to select the RID specific assets.
+//
+// The sidecars are kept in the DOTNET_HOST_STARTUP_CACHE directory, named after
+// the deps.json path, and never next to the deps.json: that may be an install
+// location shared by every user, or read-only.
+//
+// Layout (native endianness, every section 4-byte aligned):
+//   deps_binary_header_t
+//   u32 string count, then per string: u32 length in pal::char_t, chars, padding
+//   u32 rid key, u32 deps path
+//   u32 rid graph count, then per rid: u32 rid, u32 count, u32 fallbacks[count]
+//   per asset type: u32 count, deps_binary_entry_t[count]
+//   u32 ni entry count, then per entry: u32 name, u32 index
+//   u32 package count, u32 packages[count]
+//
+namespace
+{
+    const char deps_binary_magic[8] = { 'D', 'E', 'P', 'S', 'B', 'I', 'N', '\0' };
+    const uint32_t deps_binary_format_version = 2;
+
+    struct deps_binary_header_t
+    {
+        char magic[8];
+        uint32_t format_version;
+        uint32_t char_size;
+        uint32_t is_framework_dependent;
+        uint32_t checksum;
+        int64_t deps_write_time;
+        int64_t deps_size;
+    };
+
+    enum deps_binary_string_field
+    {
+        deps_file = 0,
+        library_type,
+        library_name,
+        library_version,
+        library_hash,
+        library_path,
+        library_hash_path,
+        runtime_store_manifest_list,
+        asset_name,
+        asset_relative_path,
+        string_field_count
+    };
+
+    const uint32_t entry_is_serviceable = 0x1;
+    const uint32_t entry_is_rid_specific = 0x2;
+
+    struct deps_binary_entry_t
+    {
+        uint32_t strings[string_field_count];
+        int32_t assembly_version[4];
+        int32_t file_version[4];
+        uint32_t flags;
+    };
+
+    // A string of the table, read in place from the mapped file.
+    struct deps_binary_string_t
+    {
+        const pal::char_t* data;
+        size_t length;
+
+        pal::string_t str() const
+        {
+            return pal::string_t(data, length);
+        }
+
+        bool equals(const pal::string_t& other) const
+        {
+            return other.length() == length && other.compare(0, length, data, length) == 0;
+        }
+    };
+
+    uint32_t compute_checksum(const char* data, size_t length)
+    {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    class deps_binary_writer_t
+    {
+    public:
+        uint32_t add_string(const pal::string_t& str)
+        {
+            auto iter = m_string_index.find(str);
+            if (iter != m_string_index.end())
+            {
+                return iter->second;
+            }
+
+            uint32_t index = (uint32_t)m_strings.size();
+            m_strings.push_back(&str);
+            m_string_index.emplace(str, index);
+            return index;
+        }
+
+        void write_u32(uint32_t value)
+        {
+            write(&value, sizeof(value));
+        }
+
+        void write(const void* data, size_t length)
+        {
+            const char* bytes = (const char*)data;
+            m_records.insert(m_records.end(), bytes, bytes + length);
+        }
+
+        // Produce the string table followed by the records written so far.
+        void get_body(std::vector<char>* body) const
+        {
+            body->clear();
+            append_u32(body, (uint32_t)m_strings.size());
+            for (const auto str : m_strings)
+            {
+                append_u32(body, (uint32_t)str->length());
+                const char* chars = (const char*)str->data();
+                body->insert(body->end(), chars, chars + str->length() * sizeof(pal::char_t));
+                body->resize((body->size() + 3) & ~(size_t)3, '\0');
+            }
+            body->insert(body->end(), m_records.begin(), m_records.end());
+        }
+
+    private:
+        static void append_u32(std::vector<char>* body, uint32_t value)
+        {
+            const char* bytes = (const char*)&value;
+            body->insert(body->end(), bytes, bytes + sizeof(value));
+        }
+
+        std::vector<const pal::string_t*> m_strings;
+        std::unordered_map<pal::string_t, uint32_t> m_string_index;
+        std::vector<char> m_records;
+    };
+
+    class deps_binary_reader_t
+    {
+    public:
+        deps_binary_reader_t(const char* data, size_t length)
+            : m_cur(data)
+            , m_end(data + length)
+        {
+        }
+
+        bool read_u32(uint32_t* value)
+        {
+            return read(value, sizeof(*value));
+        }
+
+        bool read(void* data, size_t length)
+        {
+            if (length > (size_t)(m_end - m_cur))
+            {
+                return false;
+            }
+            memcpy(data, m_cur, length);
+            m_cur += length;
+            return true;
+        }
+
+        // Reads a string reference that must point into the string table.
+        bool read_string_ref(const std::vector<deps_binary_string_t>& strings, const deps_binary_string_t** str)
+        {
+            uint32_t index;
+            if (!read_u32(&index) || index >= strings.size())
+            {
+                return false;
+            }
+            *str = &strings[index];
+            return true;
+        }
+
+        bool read_string_table(std::vector<deps_binary_string_t>* strings)
+        {
+            uint32_t count;
+            if (!read_u32(&count) || count > (size_t)(m_end - m_cur) / sizeof(uint32_t))
+            {
+                return false;
+            }
+
+            strings->resize(count);
+            for (auto& str : *strings)
+            {
+                uint32_t length;
+                if (!read_u32(&length) || length > (size_t)(m_end - m_cur) / sizeof(pal::char_t))
+                {
+                    return false;
+                }
+
+                size_t bytes = length * sizeof(pal::char_t);
+                size_t padded = (bytes + 3) & ~(size_t)3;
+                if (padded > (size_t)(m_end - m_cur))
+                {
+                    return false;
+                }
+
+                // The table starts 4-byte aligned in the mapping, so are the strings.
+                str.data = (const pal::char_t*)m_cur;
+                str.length = length;
+                m_cur += padded;
+            }
+            return true;
+        }
+
+        bool at_end() const
+        {
+            return m_cur == m_end;
+        }
+
+    private:
+        const char* m_cur;
+        const char* m_end;
+    };
+}
+
+// Returns an empty path if there is no cache directory to keep the sidecar in.
+pal::string_t deps_json_t::get_binary_deps_path(const pal::string_t& deps_path)
+{
+    pal::string_t bin_path;
+    if (!host_env::get(host_env::startup_cache, &bin_path) || !pal::realpath(&bin_path))
+    {
+        return pal::string_t();
+    }
+
+    std::size_t hash = std::hash<pal::string_t>()(deps_path);
+    pal::stringstream_t file_name;
+    file_name << strip_file_ext(get_filename(deps_path)) << _X(".") << std::hex << hash << _X(".bin");
+    append_path(&bin_path, file_name.str().c_str());
+    return bin_path;
+}
+
+bool deps_json_t::binary_deps_enabled()
+{
+    pal::string_t cache_dir;
+    return host_env::is_enabled(host_env::binary_deps) && host_env::get(host_env::startup_cache, &cache_dir);
+}
+
+bool deps_json_t::load_binary(const pal::string_t& deps_path, bool is_framework_dependent, const pal::string_t& rid_key)
+{
+    int64_t deps_write_time, deps_size;
+    if (!pal::get_file_stamp(deps_path, &deps_write_time, &deps_size))
+    {
+        return false;
+    }
+
+    pal::string_t bin_path = get_binary_deps_path(deps_path);
+    if (bin_path.empty())
+    {
+        return false;
+    }
+
+    size_t length = 0;
+    const char* data = (const char*)pal::map_file_readonly(bin_path, &length);
+    if (data == nullptr)
+    {
+        trace::verbose(_X("Binary dependencies manifest [%s] is not present"), bin_path.c_str());
+        return false;
+    }
+
+    timing::increment(timing::files_parsed);
+
+    deps_binary_header_t header;
+    bool loaded = false;
+    if (length >= sizeof(header))
+    {
+        memcpy(&header, data, sizeof(header));
+        loaded = memcmp(header.magic, deps_binary_magic, sizeof(deps_binary_magic)) == 0 &&
+            header.format_version == deps_binary_format_version &&
+            header.char_size == sizeof(pal::char_t) &&
+            header.is_framework_dependent == (is_framework_dependent ? 1 : 0) &&
+            header.deps_write_time == deps_write_time &&
+            header.deps_size == deps_size &&
+            header.checksum == compute_checksum(data + sizeof(header), length - sizeof(header));
+    }
+
+    if (loaded)
+    {
+        loaded = load_binary_body(data + sizeof(header), length - sizeof(header), deps_path, rid_key);
+    }
+
+    pal::unmap_file(data, length);
+
+    if (!loaded)
+    {
+        trace::verbose(_X("Binary dependencies manifest [%s] is stale or invalid, using [%s]"), bin_path.c_str(), deps_path.c_str());
+
+        // Discard anything partially read.
+        for (auto& entries : m_deps_entries)
+        {
+            entries.clear();
+        }
+        m_ni_entries.clear();
+        m_packages.clear();
+        m_rid_fallback_graph.clear();
+        return false;
+    }
+
+    trace::verbose(_X("Loaded binary dependencies manifest [%s]"), bin_path.c_str());
+    return true;
+}
+
+bool deps_json_t::load_binary_body(const char* data, size_t length, const pal::string_t& deps_path, const pal::string_t& rid_key)
+{
+    deps_binary_reader_t reader(data, length);
+
+    std::vector<deps_binary_string_t> strings;
+    if (!reader.read_string_table(&strings))
+    {
+        return false;
+    }
+
+    const deps_binary_string_t* str;
+    if (!reader.read_string_ref(strings, &str) || !str->equals(rid_key) ||
+        !reader.read_string_ref(strings, &str) || !str->equals(deps_path))
+    {
+        return false;
+    }
+
+    uint32_t count;
+    if (!reader.read_u32(&count))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t fallback_count;
+        if (!reader.read_string_ref(strings, &str) || !reader.read_u32(&fallback_count))
+        {
+            return false;
+        }
+
+        auto& fallbacks = m_rid_fallback_graph[str->str()];
+        for (uint32_t j = 0; j < fallback_count; ++j)
+        {
+            if (!reader.read_string_ref(strings, &str))
+            {
+                return false;
+            }
+            fallbacks.push_back(str->str());
+        }
+    }
+
+    for (int i = 0; i < deps_entry_t::asset_types::count; ++i)
+    {
+        if (!reader.read_u32(&count))
+        {
+            return false;
+        }
+
+        m_deps_entries[i].reserve(count);
+        for (uint32_t j = 0; j < count; ++j)
+        {
+            deps_binary_entry_t record;
+            if (!reader.read(&record, sizeof(record)))
+            {
+                return false;
+            }
+
+            for (int k = 0; k < string_field_count; ++k)
+            {
+                if (record.strings[k] >= strings.size())
+                {
+                    return false;
+                }
+            }
+
+            for (int k = 0; k < 4; ++k)
+            {
+                if (!version_t::is_valid_component(record.assembly_version[k]) || !version_t::is_valid_component(record.file_version[k]))
+                {
+                    return false;
+                }
+            }
+
+            auto field = [&](deps_binary_string_field field) { return strings[record.strings[field]].str(); };
+
+            deps_entry_t entry;
+            entry.deps_file = field(deps_file);
+            entry.library_type = field(library_type);
+            entry.library_name = field(library_name);
+            entry.library_version = field(library_version);
+            entry.library_hash = field(library_hash);
+            entry.library_path = field(library_path);
+            entry.library_hash_path = field(library_hash_path);
+            entry.runtime_store_manifest_list = field(runtime_store_manifest_list);
+            entry.asset_type = (deps_entry_t::asset_types) i;
+            entry.asset.name = field(asset_name);
+            entry.asset.relative_path = field(asset_relative_path);
+            entry.asset.assembly_version = version_t(record.assembly_version[0], record.assembly_version[1], record.assembly_version[2], record.assembly_version[3]);
+            entry.asset.file_version = version_t(record.file_version[0], record.file_version[1], record.file_version[2], record.file_version[3]);
+            entry.is_serviceable = (record.flags & entry_is_serviceable) != 0;
+            entry.is_rid_specific = (record.flags & entry_is_rid_specific) != 0;
+            entry.package_id = deps_entry_t::get_package_id(entry.library_name + _X("/") + entry.library_version);
+
+            m_deps_entries[i].push_back(std::move(entry));
+        }
+    }
+
+    if (!reader.read_u32(&count))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t index;
+        if (!reader.read_string_ref(strings, &str) || !reader.read_u32(&index) ||
+            index >= m_deps_entries[deps_entry_t::asset_types::runtime].size())
+        {
+            return false;
+        }
+        m_ni_entries[str->str()] = index;
+    }
+
+    // Only the package names are needed to answer has_package.
+    if (!reader.read_u32(&count))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!reader.read_string_ref(strings, &str))
+        {
+            return false;
+        }
+        add_package(str->str());
+    }
+
+    return reader.at_end();
+}
+
+void deps_json_t::save_binary(const pal::string_t& deps_path, bool is_framework_dependent, const pal::string_t& rid_key) const
+{
+    pal::string_t bin_path = get_binary_deps_path(deps_path);
+    if (bin_path.empty())
+    {
+        return;
+    }
+
+    deps_binary_header_t header;
+    memcpy(header.magic, deps_binary_magic, sizeof(deps_binary_magic));
+    header.format_version = deps_binary_format_version;
+    header.char_size = sizeof(pal::char_t);
+    header.is_framework_dependent = is_framework_dependent ? 1 : 0;
+    if (!pal::get_file_stamp(deps_path, &header.deps_write_time, &header.deps_size))
+    {
+        return;
+    }
+
+    deps_binary_writer_t writer;
+
+    writer.write_u32(writer.add_string(rid_key));
+    writer.write_u32(writer.add_string(deps_path));
+
+    writer.write_u32((uint32_t)m_rid_fallback_graph.size());
+    for (const auto& rid : m_rid_fallback_graph)
+    {
+        writer.write_u32(writer.add_string(rid.first));
+        writer.write_u32((uint32_t)rid.second.size());
+        for (const auto& fallback : rid.second)
+        {
+            writer.write_u32(writer.add_string(fallback));
+        }
+    }
+
+    for (int i = 0; i < deps_entry_t::asset_types::count; ++i)
+    {
+        writer.write_u32((uint32_t)m_deps_entries[i].size());
+        for (const auto& entry : m_deps_entries[i])
+        {
+            deps_binary_entry_t record;
+            record.strings[deps_file] = writer.add_string(entry.deps_file);
+            record.strings[library_type] = writer.add_string(entry.library_type);
+            record.strings[library_name] = writer.add_string(entry.library_name);
+            record.strings[library_version] = writer.add_string(entry.library_version);
+            record.strings[library_hash] = writer.add_string(entry.library_hash);
+            record.strings[library_path] = writer.add_string(entry.library_path);
+            record.strings[library_hash_path] = writer.add_string(entry.library_hash_path);
+            record.strings[runtime_store_manifest_list] = writer.add_string(entry.runtime_store_manifest_list);
+            record.strings[asset_name] = writer.add_string(entry.asset.name);
+            record.strings[asset_relative_path] = writer.add_string(entry.asset.relative_path);
+
+            const version_t& av = entry.asset.assembly_version;
+            const version_t& fv = entry.asset.file_version;
+            record.assembly_version[0] = av.get_major();
+            record.assembly_version[1] = av.get_minor();
+            record.assembly_version[2] = av.get_build();
+            record.assembly_version[3] = av.get_revision();
+            record.file_version[0] = fv.get_major();
+            record.file_version[1] = fv.get_minor();
+            record.file_version[2] = fv.get_build();
+            record.file_version[3] = fv.get_revision();
+
+            record.flags = (entry.is_serviceable ? entry_is_serviceable : 0) |
+                (entry.is_rid_specific ? entry_is_rid_specific : 0);
+
+            writer.write(&record, sizeof(record));
+        }
+    }
+
+    writer.write_u32((uint32_t)m_ni_entries.size());
+    for (const auto& ni : m_ni_entries)
+    {
+        writer.write_u32(writer.add_string(ni.first));
+        writer.write_u32((uint32_t)ni.second);
+    }
+
+    std::vector<const pal::string_t*> packages;
+    for (const auto& package : m_assets.libs)
+    {
+        packages.push_back(&package.first);
+    }
+    for (const auto& package : m_rid_assets.libs)
+    {
+        if (!package.second.rid_assets.empty() && !m_assets.libs.count(package.first))
+        {
+            packages.push_back(&package.first);
+        }
+    }
+    writer.write_u32((uint32_t)packages.size());
+    for (const auto package : packages)
+    {
+        writer.write_u32(writer.add_string(*package));
+    }
+
+    std::vector<char> body;
+    writer.get_body(&body);
+    header.checksum = compute_checksum(body.data(), body.size());
+
+    // Write to a temporary file of this process and move it in place so that readers never map a
+    // partially written manifest, and concurrent launches never write the same file.
+    pal::string_t tmp_path = get_temp_file_path(bin_path);
+    {
+        std::ofstream file(tmp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.good())
+        {
+            trace::verbose(_X("Could not create binary dependencies manifest [%s]"), bin_path.c_str());
+            return;
+        }
+
+        file.write((const char*)&header, sizeof(header));
+        file.write(body.data(), body.size());
+        file.close();
+        if (file.fail())
+        {
+            trace::verbose(_X("Could not write binary dependencies manifest [%s]"), bin_path.c_str());
+            pal::remove_file(tmp_path);
+            return;
+        }
+    }
+
+    if (pal::rename_file(tmp_path, bin_path))
+    {
+        trace::verbose(_X("Wrote binary dependencies manifest [%s]"), bin_path.c_str());
+    }
+    else
+    {
+        pal::remove_file(tmp_path);
+    }
+}
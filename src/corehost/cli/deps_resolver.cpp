@@ -4,8 +4,12 @@
 #include <set>
 #include <functional>
 #include <cassert>
+#include <atomic>
+#include <thread>
+#include <system_error>
 
 #include "trace.h"
+#include "timing.h"
 #include "deps_entry.h"
 #include "deps_format.h"
 #include "deps_resolver.h"
@@ -79,6 +83,28 @@ pal::string_t get_deps_filename(const pal::string_t& path)
     return path.substr(name_pos + 1);
 }
 
+// -----------------------------------------------------------------------------
+// The counter of the hits of a kind of probe configuration, followed by the one
+// of its misses.
+//
+timing::counter get_probe_hit_counter(const probe_config_t& config)
+{
+    if (config.is_fx())
+    {
+        return timing::probe_hits_fx;
+    }
+    else if (config.is_app())
+    {
+        return timing::probe_hits_app;
+    }
+    else if (config.only_serviceable_assets)
+    {
+        return timing::probe_hits_servicing;
+    }
+
+    return timing::probe_hits_lookup;
+}
+
 } // end of anonymous namespace
 
   // -----------------------------------------------------------------------------
@@ -86,21 +112,54 @@ pal::string_t get_deps_filename(const pal::string_t& path)
   // "asset_name" be part of the "items" paths.
   //
 void deps_resolver_t::add_tpa_asset(
-    const deps_resolved_asset_t& resolved_asset,
+    deps_resolved_asset_t&& resolved_asset,
     name_to_resolved_asset_map_t* items)
 {
     name_to_resolved_asset_map_t::iterator existing = items->find(resolved_asset.asset.name);
     if (existing == items->end())
     {
-        trace::verbose(_X("Adding tpa entry: %s, AssemblyVersion: %s, FileVersion: %s"),
-            resolved_asset.resolved_path.c_str(),
-            resolved_asset.asset.assembly_version.as_str().c_str(),
-            resolved_asset.asset.file_version.as_str().c_str());
+        if (trace::is_enabled(trace::level_t::verbose))
+        {
+            trace::verbose(_X("Adding tpa entry: %s, AssemblyVersion: %s, FileVersion: %s"),
+                resolved_asset.resolved_path.c_str(),
+                resolved_asset.asset.assembly_version.as_str().c_str(),
+                resolved_asset.asset.file_version.as_str().c_str());
+        }
 
-        items->emplace(resolved_asset.asset.name, resolved_asset);
+        items->emplace(resolved_asset.asset.name, std::move(resolved_asset));
     }
 }
 
+// -----------------------------------------------------------------------------
+// Probe the TPA candidates in chunks on several threads. Placeholders are not
+// probed, the same as when the entries are processed.
+//
+std::vector<deps_resolver_t::probe_result_t> deps_resolver_t::probe_concurrently(const std::vector<tpa_candidate_t>& candidates)
+{
+    std::vector<probe_result_t> results(candidates.size());
+
+    const size_t chunk_size = 32;
+    std::vector<std::function<void()>> probes;
+    for (size_t start = 0; start < candidates.size(); start += chunk_size)
+    {
+        size_t end = std::min(start + chunk_size, candidates.size());
+        probes.push_back([&, start, end]()
+        {
+            for (size_t i = start; i < end; ++i)
+            {
+                const auto& candidate = candidates[i];
+                if (!ends_with(candidate.entry->asset.relative_path, _X("/_._"), false))
+                {
+                    results[i].first = probe_deps_entry(*candidate.entry, *candidate.deps_dir, candidate.fx_level, &results[i].second);
+                }
+            }
+        });
+    }
+
+    run_concurrently(probes);
+    return results;
+}
+
 // -----------------------------------------------------------------------------
 // Load local assemblies by priority order of their file extensions and
 // unique-fied  by their simple name.
@@ -114,37 +173,64 @@ void deps_resolver_t::get_dir_assemblies(
     trace::verbose(_X("Adding files from %s dir %s"), dir_name.c_str(), dir.c_str());
 
     // Managed extensions in priority order, pick DLL over EXE and NI over IL.
-    const pal::string_t managed_ext[] = { _X(".ni.dll"), _X(".dll"), _X(".ni.exe"), _X(".exe") };
+    const pal::char_t* const managed_ext[] = { _X(".ni.dll"), _X(".dll"), _X(".ni.exe"), _X(".exe") };
+    const size_t ni_ext_length = 3;
+    const size_t il_ext_length = 4;
 
     // List of files in the dir
     std::vector<pal::string_t> files;
     pal::readdir(dir, &files);
 
-    for (const auto& ext : managed_ext)
+    // Classify the files by extension in a single pass, keeping the listing order within
+    // each extension. A native image also matches the IL extension under its ".ni" name.
+    std::vector<std::pair<const pal::string_t*, size_t>> matches[sizeof(managed_ext) / sizeof(managed_ext[0])];
+    for (const auto& file : files)
     {
-        for (const auto& file : files)
+        // Nothing to do if file length is smaller than expected ext.
+        size_t length = file.length();
+        if (length <= il_ext_length || file[length - il_ext_length] != _X('.'))
         {
-            // Nothing to do if file length is smaller than expected ext.
-            if (file.length() <= ext.length())
-            {
-                continue;
-            }
+            continue;
+        }
 
-            auto file_name = file.substr(0, file.length() - ext.length());
-            auto file_ext = file.substr(file_name.length());
+        size_t il_index;
+        const pal::char_t* il_ext = file.c_str() + length - il_ext_length;
+        if (pal::strcasecmp(il_ext, managed_ext[1]) == 0)
+        {
+            il_index = 1;
+        }
+        else if (pal::strcasecmp(il_ext, managed_ext[3]) == 0)
+        {
+            il_index = 3;
+        }
+        else
+        {
+            continue;
+        }
 
-            // Ext did not match expected ext, skip this file.
-            if (pal::strcasecmp(file_ext.c_str(), ext.c_str()))
-            {
-                continue;
-            }
+        matches[il_index].emplace_back(&file, length - il_ext_length);
+
+        size_t ni_length = il_ext_length + ni_ext_length;
+        if (length > ni_length && pal::strncasecmp(file.c_str() + length - ni_length, managed_ext[il_index - 1], ni_ext_length) == 0)
+        {
+            matches[il_index - 1].emplace_back(&file, length - ni_length);
+        }
+    }
+
+    for (const auto& ext_matches : matches)
+    {
+        for (const auto& match : ext_matches)
+        {
+            const pal::string_t& file = *match.first;
+            pal::string_t file_name = file.substr(0, match.second);
 
             // Already added entry for this asset, by priority order skip this ext
-            if (items->count(file_name))
+            name_to_resolved_asset_map_t::iterator existing = items->find(file_name);
+            if (existing != items->end())
             {
                 trace::verbose(_X("Skipping %s because the %s already exists in %s assemblies"),
                     file.c_str(),
-                    items->find(file_name)->second.asset.relative_path.c_str(),
+                    existing->second.asset.relative_path.c_str(),
                     dir_name.c_str());
 
                 continue;
@@ -163,9 +249,8 @@ void deps_resolver_t::get_dir_assemblies(
                 dir_name.c_str(),
                 file_path.c_str());
 
-            deps_asset_t asset(file_name, file, empty, empty);
-            deps_resolved_asset_t resolved_asset(asset, file_path);
-            add_tpa_asset(resolved_asset, items);
+            deps_asset_t asset(std::move(file_name), file, empty, empty);
+            add_tpa_asset(deps_resolved_asset_t(std::move(asset), std::move(file_path)), items);
         }
     }
 }
@@ -179,13 +264,13 @@ void deps_resolver_t::setup_shared_store_probes(
         if (pal::directory_exists(shared))
         {
             // Shared Store probe: DOTNET_SHARED_STORE
-            m_probes.push_back(probe_config_t::lookup(shared));
+            add_shared_store_probe(shared);
         }
     }
 
     if (pal::directory_exists(args.dotnet_shared_store))
     {
-        m_probes.push_back(probe_config_t::lookup(args.dotnet_shared_store));
+        add_shared_store_probe(args.dotnet_shared_store);
     }
 
     for (const auto& global_shared : args.global_shared_stores)
@@ -193,11 +278,28 @@ void deps_resolver_t::setup_shared_store_probes(
         if (global_shared != args.dotnet_shared_store && pal::directory_exists(global_shared))
         {
             // Shared Store probe: DOTNET_SHARED_STORE
-            m_probes.push_back(probe_config_t::lookup(global_shared));
+            add_shared_store_probe(global_shared);
         }
     }
 }
 
+// -----------------------------------------------------------------------------
+// Add a probe for a runtime store, looking entries up in the index of the store
+// when it ships one.
+//
+void deps_resolver_t::add_shared_store_probe(const pal::string_t& store_dir)
+{
+    std::unique_ptr<store_index_t> index(new store_index_t());
+    if (!index->load(store_dir))
+    {
+        m_probes.push_back(probe_config_t::lookup(store_dir));
+        return;
+    }
+
+    m_probes.push_back(probe_config_t::store(store_dir, index.get()));
+    m_store_indexes.push_back(std::move(index));
+}
+
 pal::string_t deps_resolver_t::get_lookup_probe_directories()
 {
     pal::string_t directories;
@@ -213,6 +315,75 @@ pal::string_t deps_resolver_t::get_lookup_probe_directories()
     return directories;
 }
 
+void deps_resolver_t::get_probed_paths(std::vector<pal::string_t>* paths)
+{
+    std::unordered_set<pal::string_t> seen;
+    auto add_path = [&](const pal::string_t& path)
+    {
+        if (seen.insert(path).second)
+        {
+            paths->push_back(path);
+        }
+    };
+
+    for (const auto& lookup : m_additional_deps_lookups)
+    {
+        add_path(lookup);
+    }
+    for (const auto& file : m_additional_deps_files)
+    {
+        add_path(file);
+    }
+
+    std::vector<const deps_json_t*> deps;
+    deps.push_back(&get_deps());
+    for (const auto& additional_deps : m_additional_deps)
+    {
+        deps.push_back(additional_deps.get());
+    }
+    for (int i = 1; i < m_fx_definitions.size(); ++i)
+    {
+        deps.push_back(&m_fx_definitions[i]->get_deps());
+    }
+
+    // A package that shows up in a servicing, probe or store location later on changes what its
+    // entries resolve to, and so does an asset patched in place. The package directory tells the
+    // former, so only the assets of the packages that exist are looked at.
+    pal::string_t package_dir;
+    for (const deps_json_t* json : deps)
+    {
+        for (int type = 0; type < deps_entry_t::asset_types::count; ++type)
+        {
+            for (const auto& entry : json->get_entries(static_cast<deps_entry_t::asset_types>(type)))
+            {
+                for (size_t index : m_probe_pipelines[type][entry.is_serviceable ? 1 : 0])
+                {
+                    const auto& config = m_probes[index];
+                    if (config.is_fx() || config.is_app())
+                    {
+                        continue;
+                    }
+
+                    entry.to_package_dir(config.probe_dir, &package_dir);
+                    add_path(package_dir);
+                    if (m_dir_cache.directory_exists(package_dir))
+                    {
+                        pal::string_t relative_path = entry.asset.relative_path;
+                        if (_X('/') != DIR_SEPARATOR)
+                        {
+                            replace_char(&relative_path, _X('/'), DIR_SEPARATOR);
+                        }
+
+                        pal::string_t asset_path = package_dir;
+                        append_path(&asset_path, relative_path.c_str());
+                        add_path(asset_path);
+                    }
+                }
+            }
+        }
+    }
+}
+
 void deps_resolver_t::setup_probe_config(
     const hostpolicy_init_t& init,
     const arguments_t& args)
@@ -254,7 +425,27 @@ void deps_resolver_t::setup_probe_config(
         m_probes.push_back(probe_config_t::lookup(probe));
     }
 
-    if (trace::is_enabled())
+    // Filter the probes on what is known before probing, so that an entry only visits the
+    // configurations that can match it.
+    for (int type = 0; type < deps_entry_t::asset_types::count; ++type)
+    {
+        for (int serviceable = 0; serviceable < 2; ++serviceable)
+        {
+            auto& pipeline = m_probe_pipelines[type][serviceable];
+            for (size_t i = 0; i < m_probes.size(); ++i)
+            {
+                const auto& config = m_probes[i];
+                if ((config.only_serviceable_assets && !serviceable) ||
+                    (config.only_runtime_assets && type != deps_entry_t::asset_types::runtime))
+                {
+                    continue;
+                }
+                pipeline.push_back(i);
+            }
+        }
+    }
+
+    if (trace::is_enabled(trace::level_t::verbose))
     {
         trace::verbose(_X("-- Listing probe configurations..."));
         for (const auto& pc : m_probes)
@@ -280,22 +471,13 @@ bool deps_resolver_t::probe_deps_entry(const deps_entry_t& entry, const pal::str
 {
     candidate->clear();
 
-    for (const auto& config : m_probes)
+    for (size_t index : m_probe_pipelines[entry.asset_type][entry.is_serviceable ? 1 : 0])
     {
+        const auto& config = m_probes[index];
+        const pal::string_t& probe_dir = config.probe_dir;
+        timing::counter hit_counter = get_probe_hit_counter(config);
         trace::verbose(_X("  Considering entry [%s/%s/%s], probe dir [%s], probe fx level:%d, entry fx level:%d"),
-            entry.library_name.c_str(), entry.library_version.c_str(), entry.asset.relative_path.c_str(), config.probe_dir.c_str(), config.fx_level, fx_level);
-
-        if (config.only_serviceable_assets && !entry.is_serviceable)
-        {
-            trace::verbose(_X("    Skipping... not serviceable asset"));
-            continue;
-        }
-        if (config.only_runtime_assets && entry.asset_type != deps_entry_t::asset_types::runtime)
-        {
-            trace::verbose(_X("    Skipping... not runtime asset"));
-            continue;
-        }
-        pal::string_t probe_dir = config.probe_dir;
+            entry.library_name.c_str(), entry.library_version.c_str(), entry.asset.relative_path.c_str(), probe_dir.c_str(), config.fx_level, fx_level);
 
         if (config.is_fx())
         {
@@ -310,9 +492,10 @@ bool deps_resolver_t::probe_deps_entry(const deps_entry_t& entry, const pal::str
                 // If the deps json has the package name and version, then someone has already done rid selection and
                 // put the right asset in the dir. So checking just package name and version would suffice.
                 // No need to check further for the exact asset relative sub path.
-                if (config.probe_deps_json->has_package(entry.library_name, entry.library_version) && entry.to_dir_path(probe_dir, candidate))
+                if (config.probe_deps_json->has_package(entry) && entry.to_dir_path(probe_dir, candidate, &m_dir_cache))
                 {
                     trace::verbose(_X("    Probed deps json and matched '%s'"), candidate->c_str());
+                    timing::increment(hit_counter);
                     return true;
                 }
             }
@@ -328,18 +511,20 @@ bool deps_resolver_t::probe_deps_entry(const deps_entry_t& entry, const pal::str
             {
                 if (entry.is_rid_specific)
                 {
-                    if (entry.to_rel_path(deps_dir, candidate))
+                    if (entry.to_rel_path(deps_dir, candidate, &m_dir_cache))
                     {
                         trace::verbose(_X("    Probed deps dir and matched '%s'"), candidate->c_str());
+                        timing::increment(hit_counter);
                         return true;
                     }
                 }
                 else
                 {
                     // Non-rid assets, lookup in the published dir.
-                    if (entry.to_dir_path(deps_dir, candidate))
+                    if (entry.to_dir_path(deps_dir, candidate, &m_dir_cache))
                     {
                         trace::verbose(_X("    Probed deps dir and matched '%s'"), candidate->c_str());
+                        timing::increment(hit_counter);
                         return true;
                     }
                 }
@@ -347,13 +532,24 @@ bool deps_resolver_t::probe_deps_entry(const deps_entry_t& entry, const pal::str
 
             trace::verbose(_X("    Skipping... not found in deps dir '%s'"), deps_dir.c_str());
         }
-        else if (entry.to_full_path(probe_dir, candidate))
+        else if (config.store_index != nullptr)
+        {
+            if (entry.to_indexed_path(probe_dir, *config.store_index, candidate))
+            {
+                trace::verbose(_X("    Probed store index and matched '%s'"), candidate->c_str());
+                timing::increment(hit_counter);
+                return true;
+            }
+        }
+        else if (entry.to_full_path(probe_dir, candidate, &m_dir_cache))
         {
             trace::verbose(_X("    Probed package dir and matched '%s'"), candidate->c_str());
+            timing::increment(hit_counter);
             return true;
         }
 
         trace::verbose(_X("    Skipping... not found in probe dir '%s'"), probe_dir.c_str());
+        timing::increment(static_cast<timing::counter>(hit_counter + 1));
         // continue to try next probe config
     }
     return false;
@@ -400,17 +596,66 @@ bool report_missing_assembly_in_manifest(const deps_entry_t& entry, bool continu
     return continueResolving;
 }
 
+/**
+ *  Whether the runtime binder, which looks for "<name>.ni.dll", "<name>.dll", "<name>.ni.exe"
+ *  and "<name>.exe" in each of the APP_PATHS directories in turn, finds exactly the resolved
+ *  asset. The directories are listed once by the dir cache, so this costs no file system
+ *  round trip per assembly.
+ */
+bool deps_resolver_t::is_found_by_app_paths(
+        const std::vector<pal::string_t>& app_dirs,
+        const deps_resolved_asset_t& asset)
+{
+    const pal::char_t* const probed_exts[] = { _X(".ni.dll"), _X(".dll"), _X(".ni.exe"), _X(".exe") };
+
+    pal::string_t dir = get_directory(asset.resolved_path);
+    if (get_filename(asset.resolved_path) != asset.asset.name + _X(".dll"))
+    {
+        return false;
+    }
+
+    for (const auto& app_dir : app_dirs)
+    {
+        bool is_asset_dir = app_dir == dir;
+        for (const pal::char_t* ext : probed_exts)
+        {
+            if (is_asset_dir && pal::strcmp(ext, _X(".dll")) == 0)
+            {
+                return true;
+            }
+
+            pal::string_t candidate = app_dir + asset.asset.name + ext;
+            if (m_dir_cache.file_exists(candidate))
+            {
+                return false;
+            }
+        }
+    }
+
+    return false;
+}
+
 /**
  *  Resolve the TPA assembly locations
+ *
+ *  In lazy TPA mode (DOTNET_HOST_LAZY_TPA=1) the app directory and the framework directories
+ *  are handed to the runtime as APP_PATHS, and the assemblies that the runtime finds there by
+ *  itself are left out of the TPA. The runtime then looks them up when they are first loaded,
+ *  so their paths are neither resolved nor passed at startup, and only the assemblies found in
+ *  other locations (servicing, probe paths, stores, RID specific subdirectories) or shadowed by
+ *  another directory are listed. Unlike the TPA, APP_PATHS also expose the assemblies of those
+ *  directories that no deps file lists, and a directory symlink is only resolved for the
+ *  directory, not for each assembly.
  */
 bool deps_resolver_t::resolve_tpa_list(
         pal::string_t* output,
+        pal::string_t* app_paths,
         std::unordered_set<pal::string_t>* breadcrumb)
 {
     const std::vector<deps_entry_t> empty(0);
     name_to_resolved_asset_map_t items;
 
-    auto process_entry = [&](const pal::string_t& deps_dir, const deps_entry_t& entry, int fx_level) -> bool
+    auto process_entry = [&](const pal::string_t& deps_dir, const deps_entry_t& entry, int fx_level, const probe_result_t* probed) -> bool
     {
         if (breadcrumb != nullptr && entry.is_serviceable)
         {
@@ -424,17 +669,25 @@ bool deps_resolver_t::resolve_tpa_list(
             return true;
         }
 
-        trace::info(_X("Processing TPA for deps entry [%s, %s, %s]"), entry.library_name.c_str(), entry.library_version.c_str(), entry.asset.relative_path.c_str());
+        trace::verbose(_X("Processing TPA for deps entry [%s, %s, %s]"), entry.library_name.c_str(), entry.library_version.c_str(), entry.asset.relative_path.c_str());
 
         pal::string_t resolved_path;
+        auto probe = [&]() -> bool
+        {
+            if (probed != nullptr)
+            {
+                resolved_path = probed->second;
+                return probed->first;
+            }
+            return probe_deps_entry(entry, deps_dir, fx_level, &resolved_path);
+        };
 
         name_to_resolved_asset_map_t::iterator existing = items.find(entry.asset.name);
         if (existing == items.end())
         {
-            if (probe_deps_entry(entry, deps_dir, fx_level, &resolved_path))
+            if (probe())
             {
-                deps_resolved_asset_t resolved_asset(entry.asset, resolved_path);
-                add_tpa_asset(resolved_asset, &items);
+                add_tpa_asset(deps_resolved_asset_t(entry.asset, std::move(resolved_path)), &items);
                 return true;
             }
 
@@ -466,21 +719,22 @@ bool deps_resolver_t::resolve_tpa_list(
             if (entry.asset.assembly_version > existing_entry->asset.assembly_version ||
                 (entry.asset.assembly_version == existing_entry->asset.assembly_version && entry.asset.file_version >= existing_entry->asset.file_version))
             {
-                if (probe_deps_entry(entry, deps_dir, fx_level, &resolved_path))
+                if (probe())
                 {
                     // If the path is the same, then no need to replace
                     if (resolved_path != existing_entry->resolved_path)
                     {
-                        trace::verbose(_X("Replacing deps entry [%s, AssemblyVersion:%s, FileVersion:%s] with [%s, AssemblyVersion:%s, FileVersion:%s]"),
-                            existing_entry->resolved_path.c_str(), existing_entry->asset.assembly_version.as_str().c_str(), existing_entry->asset.file_version.as_str().c_str(),
-                            resolved_path.c_str(), entry.asset.assembly_version.as_str().c_str(), entry.asset.file_version.as_str().c_str());
+                        if (trace::is_enabled(trace::level_t::verbose))
+                        {
+                            trace::verbose(_X("Replacing deps entry [%s, AssemblyVersion:%s, FileVersion:%s] with [%s, AssemblyVersion:%s, FileVersion:%s]"),
+                                existing_entry->resolved_path.c_str(), existing_entry->asset.assembly_version.as_str().c_str(), existing_entry->asset.file_version.as_str().c_str(),
+                                resolved_path.c_str(), entry.asset.assembly_version.as_str().c_str(), entry.asset.file_version.as_str().c_str());
+                        }
 
                         existing_entry = nullptr;
                         items.erase(existing);
 
-                        deps_asset_t asset(entry.asset.name, entry.asset.relative_path, entry.asset.assembly_version, entry.asset.file_version);
-                        deps_resolved_asset_t resolved_asset(asset, resolved_path);
-                        add_tpa_asset(resolved_asset, &items);
+                        add_tpa_asset(deps_resolved_asset_t(entry.asset, std::move(resolved_path)), &items);
                     }
                 }
                 else if (fx_level != 0)
@@ -500,61 +754,126 @@ bool deps_resolver_t::resolve_tpa_list(
     // TODO: Remove: the deps should contain the managed DLL.
     // Workaround for: csc.deps.json doesn't have the csc.dll
     deps_asset_t asset(get_filename_without_ext(m_managed_app), get_filename(m_managed_app), version_t(), version_t());
-    deps_resolved_asset_t resolved_asset(asset, m_managed_app);
-    add_tpa_asset(resolved_asset, &items);
+    add_tpa_asset(deps_resolved_asset_t(std::move(asset), m_managed_app), &items);
 
-    // Add the app's entries
-    const auto& deps_entries = get_deps().get_entries(deps_entry_t::asset_types::runtime);
-    for (const auto& entry : deps_entries)
+    // The entries in the order they are merged: the app's, the additional deps' and then the
+    // frameworks' from the highest level down.
+    std::vector<tpa_candidate_t> candidates;
+    for (const auto& entry : get_deps().get_entries(deps_entry_t::asset_types::runtime))
     {
-        if (!process_entry(m_app_dir, entry, 0))
-        {
-            return false;
-        }
+        candidates.push_back(tpa_candidate_t { &m_app_dir, &entry, 0 });
     }
+    size_t app_candidates = candidates.size();
 
-    // If the deps file wasn't present or has missing entries, then
-    // add the app local assemblies to the TPA.
-    if (!get_deps().exists())
+    for (const auto& additional_deps : m_additional_deps)
     {
-        // Obtain the local assemblies in the app dir.
-        get_dir_assemblies(m_app_dir, _X("local"), &items);
+        for (const auto& entry : additional_deps->get_entries(deps_entry_t::asset_types::runtime))
+        {
+            candidates.push_back(tpa_candidate_t { &m_app_dir, &entry, 0 });
+        }
     }
 
-    // If additional deps files were specified that need to be treated as part of the
-    // application, then add them to the mix as well.
-    for (const auto& additional_deps : m_additional_deps)
+    if (m_is_framework_dependent)
     {
-        auto additional_deps_entries = additional_deps->get_entries(deps_entry_t::asset_types::runtime);
-        for (auto entry : additional_deps_entries)
+        for (int i = 1; i < m_fx_definitions.size(); ++i)
         {
-            if (!process_entry(m_app_dir, entry, 0))
+            for (const auto& entry : m_fx_definitions[i]->get_deps().get_entries(deps_entry_t::asset_types::runtime))
             {
-                return false;
+                candidates.push_back(tpa_candidate_t { &m_fx_definitions[i]->get_dir(), &entry, i });
             }
         }
     }
 
-    // Probe FX deps entries after app assemblies are added.
-    for (int i = 1; i < m_fx_definitions.size(); ++i)
+    // Probing is independent of the merge, so it can be done up front on several threads.
+    // The merge below still runs in order and only consumes the results, so the precedence
+    // rules of add_tpa_asset are unchanged.
+    std::vector<probe_result_t> probed;
+    if (m_parallel_probing)
     {
-        const auto& deps_entries = m_is_framework_dependent ? m_fx_definitions[i]->get_deps().get_entries(deps_entry_t::asset_types::runtime) : empty;
-        for (const auto& entry : deps_entries)
+        probed = probe_concurrently(candidates);
+    }
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        // If the deps file wasn't present or has missing entries, then
+        // add the app local assemblies to the TPA.
+        if (i == app_candidates && !get_deps().exists())
+        {
+            // Obtain the local assemblies in the app dir.
+            get_dir_assemblies(m_app_dir, _X("local"), &items);
+        }
+
+        const auto& candidate = candidates[i];
+        if (!process_entry(*candidate.deps_dir, *candidate.entry, candidate.fx_level, probed.empty() ? nullptr : &probed[i]))
         {
-            if (!process_entry(m_fx_definitions[i]->get_dir(), entry, i))
+            return false;
+        }
+    }
+
+    // The app's entries were the last ones.
+    if (candidates.size() == app_candidates && !get_deps().exists())
+    {
+        get_dir_assemblies(m_app_dir, _X("local"), &items);
+    }
+
+    // The directories in the order the runtime probes them: the app's and then the frameworks'
+    // from the highest level down, the same precedence as the merge above.
+    std::vector<pal::string_t> app_dirs;
+    if (m_lazy_tpa)
+    {
+        // With a trailing separator, like the directories of the resolved paths.
+        auto add_app_dir = [&](pal::string_t dir)
+        {
+            remove_trailing_dir_seperator(&dir);
+            dir.push_back(DIR_SEPARATOR);
+            app_dirs.push_back(dir);
+        };
+
+        add_app_dir(m_app_dir);
+        for (int i = 1; m_is_framework_dependent && i < m_fx_definitions.size(); ++i)
+        {
+            add_app_dir(m_fx_definitions[i]->get_dir());
+        }
+
+        size_t lazy_count = 0;
+        for (auto iter = items.begin(); iter != items.end(); )
+        {
+            if (is_found_by_app_paths(app_dirs, iter->second))
             {
-                return false;
+                iter = items.erase(iter);
+                ++lazy_count;
             }
+            else
+            {
+                ++iter;
+            }
+        }
+
+        trace::verbose(_X("Lazy TPA mode left %d assemblies to be found in the app and framework directories, %d are listed"), (int)lazy_count, (int)items.size());
+
+        for (auto& dir : app_dirs)
+        {
+            // Workaround for CoreFX not being able to resolve sym links.
+            pal::realpath(&dir);
+            app_paths->append(dir);
+            app_paths->push_back(PATH_SEPARATOR);
         }
     }
 
-    // Convert the paths into a string and return it 
-    for (const auto& item : items)
+    // Convert the paths into a string and return it. The length is known once the
+    // paths are resolved, so the output is allocated once.
+    size_t length = output->size();
+    for (auto& item : items)
     {
         // Workaround for CoreFX not being able to resolve sym links.
-        pal::string_t real_asset_path = item.second.resolved_path;
-        pal::realpath(&real_asset_path);
-        output->append(real_asset_path);
+        pal::realpath(&item.second.resolved_path);
+        length += item.second.resolved_path.size() + 1;
+    }
+
+    output->reserve(length);
+    for (const auto& item : items)
+    {
+        output->append(item.second.resolved_path);
         output->push_back(PATH_SEPARATOR);
     }
 
@@ -612,6 +931,7 @@ void deps_resolver_t::resolve_additional_deps(const hostpolicy_init_t& init)
         // If it's a single deps file, insert it in 'm_additional_deps_files'
         if (ends_with(additional_deps_path, _X(".deps.json"), false))
         {
+            m_additional_deps_lookups.push_back(additional_deps_path);
             if (pal::file_exists(additional_deps_path))
             {
                 trace::verbose(_X("Using specified additional deps.json: '%s'"), 
@@ -638,6 +958,7 @@ void deps_resolver_t::resolve_additional_deps(const hostpolicy_init_t& init)
                 append_path(&additional_deps_path_fx, _X("shared"));
                 append_path(&additional_deps_path_fx, m_fx_definitions[i]->get_name().c_str());
                 trace::verbose(_X("Searching for most compatible deps directory in [%s]"), additional_deps_path_fx.c_str());
+                m_additional_deps_lookups.push_back(additional_deps_path_fx);
                 std::vector<pal::string_t> deps_dirs;
                 pal::readdir_onlydirectories(additional_deps_path_fx, &deps_dirs);
 
@@ -665,6 +986,7 @@ void deps_resolver_t::resolve_additional_deps(const hostpolicy_init_t& init)
                     trace::verbose(_X("Found additional deps directory [%s]"), most_compatible_deps_folder_version.as_str().c_str());
 
                     append_path(&additional_deps_path_fx, most_compatible_deps_folder_version.as_str().c_str());
+                    m_additional_deps_lookups.push_back(additional_deps_path_fx);
 
                     // The resulting list will be empty if 'additional_deps_path_fx' is not a valid directory path
                     std::vector<pal::string_t> list;
@@ -683,11 +1005,48 @@ void deps_resolver_t::resolve_additional_deps(const hostpolicy_init_t& init)
         }
     }
 
-    auto rids = get_root_framework(m_fx_definitions).get_deps().get_rid_fallback_graph();
-    for (pal::string_t json_file : m_additional_deps_files)
+}
+
+/**
+ *  Parse the deps files of the app, its frameworks and the additional deps.
+ *
+ *  The framework dependent manifests need the RID fallback graph of the root
+ *  framework only when they are processed, so all files are read concurrently
+ *  and then processed against the graph in framework order.
+ */
+void deps_resolver_t::load_deps_files()
+{
+    timing::phase_t phase(_X("hostpolicy/parse_deps"));
+
+    int root_framework = m_fx_definitions.size() - 1;
+
+    for (size_t i = 0; i < m_additional_deps_files.size(); ++i)
+    {
+        m_additional_deps.push_back(std::unique_ptr<deps_json_t>(new deps_json_t()));
+    }
+
+    std::vector<std::function<void()>> reads;
+    reads.push_back([&]() { m_fx_definitions[root_framework]->parse_deps(); });
+    for (int i = 0; i < root_framework; ++i)
+    {
+        reads.push_back([this, i]() { m_fx_definitions[i]->prefetch_deps(); });
+    }
+    for (size_t i = 0; i < m_additional_deps.size(); ++i)
+    {
+        reads.push_back([this, i]() { m_additional_deps[i]->prefetch(m_additional_deps_files[i]); });
+    }
+
+    run_concurrently(reads);
+
+    // The rid graph is obtained from the root framework
+    const auto& rids = m_fx_definitions[root_framework]->get_deps().get_rid_fallback_graph();
+    for (int i = root_framework - 1; i >= 0; --i)
     {
-        m_additional_deps.push_back(std::unique_ptr<deps_json_t>(
-            new deps_json_t(true, json_file, rids)));
+        m_fx_definitions[i]->parse_deps(rids);
+    }
+    for (size_t i = 0; i < m_additional_deps.size(); ++i)
+    {
+        m_additional_deps[i]->parse(true, m_additional_deps_files[i], rids);
     }
 }
 
@@ -792,8 +1151,8 @@ bool deps_resolver_t::resolve_probe_dirs(
     // Handle any additional deps.json that were specified.
     for (const auto& additional_deps : m_additional_deps)
     {
-        const auto additional_deps_entries = additional_deps->get_entries(asset_type);
-        for (const auto entry : additional_deps_entries)
+        const auto& additional_deps_entries = additional_deps->get_entries(asset_type);
+        for (const auto& entry : additional_deps_entries)
         {
             if (!add_package_cache_entry(entry, m_app_dir, 0))
             {
@@ -836,7 +1195,9 @@ bool deps_resolver_t::resolve_probe_dirs(
 //
 bool deps_resolver_t::resolve_probe_paths(probe_paths_t* probe_paths, std::unordered_set<pal::string_t>* breadcrumb)
 {
-    if (!resolve_tpa_list(&probe_paths->tpa, breadcrumb))
+    timing::phase_t phase(_X("hostpolicy/resolve_probe_paths"));
+
+    if (!resolve_tpa_list(&probe_paths->tpa, &probe_paths->app_paths, breadcrumb))
     {
         return false;
     }
@@ -857,3 +1218,22 @@ bool deps_resolver_t::resolve_probe_paths(probe_paths_t* probe_paths, std::unord
 
     return true;
 }
+
+/**
+ * Resolve only the native search directories, along with coreclr and the jit that are found
+ * while probing for them; the TPA and resource directories are left empty.
+ */
+bool deps_resolver_t::resolve_native_probe_paths(probe_paths_t* probe_paths)
+{
+    timing::phase_t phase(_X("hostpolicy/resolve_native_probe_paths"));
+
+    if (!resolve_probe_dirs(deps_entry_t::asset_types::native, &probe_paths->native, nullptr))
+    {
+        return false;
+    }
+
+    probe_paths->coreclr = m_coreclr_path;
+    probe_paths->clrjit = m_clrjit_path;
+
+    return true;
+}
@@ -13,11 +13,14 @@
 #include "deps_format.h"
 #include "deps_entry.h"
 #include "runtime_config.h"
+#include "host_env.h"
 
 // Probe paths to be resolved for ordering
 struct probe_paths_t
 {
     pal::string_t tpa;
+    // Directories the runtime probes for the assemblies that lazy TPA mode leaves out of the TPA
+    pal::string_t app_paths;
     pal::string_t native;
     pal::string_t resources;
     pal::string_t coreclr;
@@ -26,9 +29,9 @@ struct probe_paths_t
 
 struct deps_resolved_asset_t
 {
-    deps_resolved_asset_t(const deps_asset_t& asset, const pal::string_t& resolved_path)
-        : asset(asset)
-        , resolved_path(resolved_path) { }
+    deps_resolved_asset_t(deps_asset_t asset, pal::string_t resolved_path)
+        : asset(std::move(asset))
+        , resolved_path(std::move(resolved_path)) { }
 
     deps_asset_t asset;
     pal::string_t resolved_path;
@@ -45,6 +48,8 @@ public:
         , m_managed_app(args.managed_application)
         , m_is_framework_dependent(init.is_framework_dependent)
         , m_core_servicing(args.core_servicing)
+        , m_parallel_probing(parallel_probing_enabled())
+        , m_lazy_tpa(host_env::is_enabled(host_env::lazy_tpa))
     {
         int root_framework = m_fx_definitions.size() - 1;
 
@@ -61,19 +66,10 @@ public:
                 m_fx_definitions[i]->set_deps_file(fx_deps_file);
                 trace::verbose(_X("Using Fx %s deps file"), fx_deps_file.c_str());
             }
-
-            if (i == root_framework)
-            {
-                m_fx_definitions[i]->parse_deps();
-            }
-            else
-            {
-                // The rid graph is obtained from the root framework
-                m_fx_definitions[i]->parse_deps(m_fx_definitions[root_framework]->get_deps().get_rid_fallback_graph());
-            }
         }
 
         resolve_additional_deps(init);
+        load_deps_files();
 
         setup_additional_probes(args.probe_paths);
         setup_probe_config(init, args);
@@ -117,8 +113,15 @@ public:
         const hostpolicy_init_t& init,
         const arguments_t& args);
 
+    void add_shared_store_probe(const pal::string_t& store_dir);
+
     pal::string_t get_lookup_probe_directories();
 
+    // Paths outside of the deps files and frameworks that the resolution depends on, whether they
+    // exist or not: the additional deps files and the package directories and assets of every
+    // entry in the servicing, additional probe and store locations.
+    void get_probed_paths(std::vector<pal::string_t>* paths);
+
     void setup_probe_config(
         const hostpolicy_init_t& init,
         const arguments_t& args);
@@ -130,6 +133,9 @@ public:
         probe_paths_t* probe_paths,
         std::unordered_set<pal::string_t>* breadcrumb);
 
+    bool resolve_native_probe_paths(
+        probe_paths_t* probe_paths);
+
     void init_known_entry_path(
         const deps_entry_t& entry,
         const pal::string_t& path);
@@ -137,6 +143,8 @@ public:
     void resolve_additional_deps(
         const hostpolicy_init_t& init);
 
+    void load_deps_files();
+
     const deps_json_t& get_deps() const
     {
         return get_app(m_fx_definitions).get_deps();
@@ -175,8 +183,14 @@ private:
     // Resolve order for TPA lookup.
     bool resolve_tpa_list(
         pal::string_t* output,
+        pal::string_t* app_paths,
         std::unordered_set<pal::string_t>* breadcrumb);
 
+    // Whether the runtime finds the resolved asset by probing the lazy TPA directories.
+    bool is_found_by_app_paths(
+        const std::vector<pal::string_t>& app_dirs,
+        const deps_resolved_asset_t& asset);
+
     // Resolve order for culture and native DLL lookup.
     bool resolve_probe_dirs(
         deps_entry_t::asset_types asset_type,
@@ -189,6 +203,20 @@ private:
         const pal::string_t& dir_name,
         name_to_resolved_asset_map_t* items);
 
+    // A deps entry to be merged into the TPA and the deps dir it is probed in.
+    struct tpa_candidate_t
+    {
+        const pal::string_t* deps_dir;
+        const deps_entry_t* entry;
+        int fx_level;
+    };
+
+    // Whether the entry was found and its resolved path.
+    typedef std::pair<bool, pal::string_t> probe_result_t;
+
+    // Probe the candidates ahead of the TPA merge, on several threads.
+    std::vector<probe_result_t> probe_concurrently(const std::vector<tpa_candidate_t>& candidates);
+
     // Probe entry in probe configurations and deps dir.
     bool probe_deps_entry(
         const deps_entry_t& entry,
@@ -201,7 +229,7 @@ private:
     pal::string_t m_app_dir;
 
     void add_tpa_asset(
-        const deps_resolved_asset_t& asset,
+        deps_resolved_asset_t&& asset,
         name_to_resolved_asset_map_t* items);
 
     // The managed application the dependencies are being resolved for.
@@ -222,15 +250,33 @@ private:
     // The filepaths for the app custom deps
     std::vector<pal::string_t> m_additional_deps_files;
 
+    // The additional deps files and directories looked at, whether they exist or not
+    std::vector<pal::string_t> m_additional_deps_lookups;
+
     // Custom deps files for the app
     std::vector< std::unique_ptr<deps_json_t> > m_additional_deps;
 
     // Various probe configurations.
     std::vector<probe_config_t> m_probes;
 
+    // Indexes into m_probes of the configurations that apply to an asset type, for entries
+    // that are not serviceable and for those that are. Built once the probes are set up.
+    std::vector<size_t> m_probe_pipelines[deps_entry_t::asset_types::count][2];
+
     // Fallback probe dir
     std::vector<pal::string_t> m_additional_probes;
 
+    // Indexes of the runtime stores that have one, referenced by their probe configurations.
+    std::vector<std::unique_ptr<store_index_t>> m_store_indexes;
+
+    // Listings of the directories looked at by probe_deps_entry
+    dir_cache_t m_dir_cache;
+
+    bool m_parallel_probing;
+
+    // Leave the assemblies of the app and framework directories out of the TPA, see resolve_tpa_list.
+    bool m_lazy_tpa;
+
     // Is the deps file for an app using shared frameworks?
     bool m_is_framework_dependent;
 };
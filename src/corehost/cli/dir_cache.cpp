@@ -0,0 +1,97 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pal.h"
+#include "trace.h"
+#include "dir_cache.h"
+
+namespace
+{
+#if defined(_WIN32) || defined(__APPLE__)
+    // The file systems are case insensitive by default, so names are compared
+    // in lower case and a match is confirmed against the file system.
+    const bool case_insensitive = true;
+#else
+    const bool case_insensitive = false;
+#endif
+
+    pal::string_t get_key(const pal::string_t& name)
+    {
+        return case_insensitive ? pal::to_lower(name) : name;
+    }
+}
+
+const std::unordered_set<pal::string_t>& dir_cache_t::get_dir_entries(const pal::string_t& dir)
+{
+    pal::string_t key = get_key(dir);
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto iter = m_dirs.find(key);
+        if (iter != m_dirs.end())
+        {
+            return iter->second;
+        }
+    }
+
+    // The directory is listed outside the lock so that concurrent probes of different
+    // directories overlap; if two threads list the same one, the first to finish wins.
+    std::vector<pal::string_t> files;
+    pal::readdir(dir, &files);
+
+    std::unordered_set<pal::string_t> entries;
+    for (const auto& file : files)
+    {
+        entries.insert(get_key(file));
+    }
+
+    trace::verbose(_X("Listed %d entries in probe directory [%s]"), (int) entries.size(), dir.c_str());
+
+    // The map is node based, so the returned set stays valid as other directories are added.
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_dirs.emplace(std::move(key), std::move(entries)).first->second;
+}
+
+bool dir_cache_t::file_exists(const pal::string_t& path)
+{
+#if defined(_WIN32)
+    size_t pos = path.find_last_of(_X("/\\"));
+#else
+    size_t pos = path.find_last_of(DIR_SEPARATOR);
+#endif
+
+    // Only paths that name an entry in a directory are cached.
+    if (pos == pal::string_t::npos || pos == 0 || pos + 1 == path.length())
+    {
+        return pal::file_exists(path);
+    }
+
+    const auto& entries = get_dir_entries(path.substr(0, pos));
+    if (entries.count(get_key(path.substr(pos + 1))) == 0)
+    {
+        return false;
+    }
+
+    return !case_insensitive || pal::file_exists(path);
+}
+
+bool dir_cache_t::directory_exists(const pal::string_t& dir)
+{
+    pal::string_t key = get_key(dir);
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto iter = m_dir_exists.find(key);
+        if (iter != m_dir_exists.end())
+        {
+            return iter->second;
+        }
+    }
+
+    bool exists = pal::directory_exists(dir);
+    if (!exists)
+    {
+        trace::verbose(_X("Probe directory [%s] does not exist, skipping the files under it"), dir.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_dir_exists.emplace(std::move(key), exists).first->second;
+}
@@ -0,0 +1,36 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef __DIR_CACHE_H__
+#define __DIR_CACHE_H__
+
+#include "pal.h"
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * Remembers the contents of the directories queried while probing, so that each
+ * directory is listed once instead of every candidate path being stat'ed.
+ *
+ * Whether a directory exists can also be asked without listing its parent; the answer
+ * is remembered, so a missing package directory is only checked once.
+ *
+ * The cache is meant to live for a single resolution; files added to a directory
+ * after it was listed are not seen. It can be queried from several threads.
+ */
+class dir_cache_t
+{
+public:
+    bool file_exists(const pal::string_t& path);
+    bool directory_exists(const pal::string_t& dir);
+
+private:
+    const std::unordered_set<pal::string_t>& get_dir_entries(const pal::string_t& dir);
+
+    std::mutex m_lock;
+    std::unordered_map<pal::string_t, std::unordered_set<pal::string_t>> m_dirs;
+    std::unordered_map<pal::string_t, bool> m_dir_exists;
+};
+
+#endif // __DIR_CACHE_H__
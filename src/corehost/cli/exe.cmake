@@ -26,6 +26,8 @@ include_directories(../fxr)
 list(APPEND SOURCES
     ../../corehost.cpp
     ../../common/trace.cpp
+    ../../common/timing.cpp
+    ../../common/host_env.cpp
     ../../common/utils.cpp)
 
 if(WIN32)
@@ -42,3 +42,8 @@ void fx_definition_t::parse_deps(const deps_json_t::rid_fallback_graph_t& graph)
 {
     m_deps.parse(true, m_deps_file, graph);
 }
+
+void fx_definition_t::prefetch_deps()
+{
+    m_deps.prefetch(m_deps_file);
+}
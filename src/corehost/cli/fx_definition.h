@@ -24,6 +24,7 @@ public:
     const pal::string_t& get_found_version() const { return m_found_version; }
     const pal::string_t& get_dir() const { return m_dir; }
     const runtime_config_t& get_runtime_config() const { return m_runtime_config; }
+    runtime_config_t& get_runtime_config() { return m_runtime_config; }
     void parse_runtime_config(const pal::string_t& path, const pal::string_t& dev_path, const runtime_config_t* higher_layer_config, const runtime_config_t* app_config);
 
     const pal::string_t& get_deps_file() const { return m_deps_file; }
@@ -31,6 +32,7 @@ public:
     const deps_json_t& get_deps() const { return m_deps; }
     void parse_deps();
     void parse_deps(const deps_json_t::rid_fallback_graph_t& graph);
+    void prefetch_deps();
 
 private:
     pal::string_t m_name;
@@ -0,0 +1,60 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pal.h"
+#include "trace.h"
+#include "dir_listing_cache.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    struct entry_t
+    {
+        bool exists;
+        int64_t last_write_time;
+        int64_t size;
+        dir_listing_cache_t::listing_t listing;
+    };
+
+    std::mutex g_listing_lock;
+    std::unordered_map<pal::string_t, entry_t> g_listings;
+}
+
+dir_listing_cache_t::listing_t dir_listing_cache_t::get_directories(const pal::string_t& dir)
+{
+    entry_t current;
+    current.exists = pal::get_file_stamp(dir, &current.last_write_time, &current.size);
+    if (!current.exists)
+    {
+        current.last_write_time = 0;
+        current.size = 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_listing_lock);
+        auto iter = g_listings.find(dir);
+        if (iter != g_listings.end() &&
+            iter->second.exists == current.exists &&
+            iter->second.last_write_time == current.last_write_time &&
+            iter->second.size == current.size)
+        {
+            return iter->second.listing;
+        }
+    }
+
+    // List outside of the lock so that unrelated directories are not serialized behind it.
+    auto list = std::make_shared<std::vector<pal::string_t>>();
+    if (current.exists)
+    {
+        pal::readdir_onlydirectories(dir, list.get());
+    }
+
+    trace::verbose(_X("Listed %d directories in [%s]"), (int) list->size(), dir.c_str());
+
+    current.listing = list;
+
+    std::lock_guard<std::mutex> lock(g_listing_lock);
+    g_listings[dir] = current;
+    return current.listing;
+}
@@ -0,0 +1,28 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef __DIR_LISTING_CACHE_H__
+#define __DIR_LISTING_CACHE_H__
+
+#include "pal.h"
+#include <memory>
+
+/**
+ * Process-lifetime cache of the sub-directories of install locations ("<hive>/sdk",
+ * "<hive>/shared" and "<hive>/shared/<fx_name>").
+ *
+ * Hosts such as IDEs call the hostfxr APIs many times from one process, so listings are
+ * kept across calls and revalidated against the timestamp of the listed directory, which
+ * changes whenever an entry is added or removed. Listings are shared rather than copied so
+ * that callers can keep one while another thread replaces it.
+ */
+class dir_listing_cache_t
+{
+public:
+    typedef std::shared_ptr<const std::vector<pal::string_t>> listing_t;
+
+    // Returns the sub-directories of "dir"; the listing is empty if "dir" does not exist.
+    static listing_t get_directories(const pal::string_t& dir);
+};
+
+#endif // __DIR_LISTING_CACHE_H__
@@ -2,7 +2,9 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <cassert>
+#include "dir_listing_cache.h"
 #include "framework_info.h"
+#include "fx_version_catalog.h"
 #include "pal.h"
 #include "trace.h"
 #include "utils.h"
@@ -72,7 +74,7 @@ bool compare_by_name_and_version(const framework_info &a, const framework_info &
             else
             {
                 // Read all frameworks, including "Microsoft.NETCore.App"
-                pal::readdir_onlydirectories(fx_shared_dir, &fx_names);
+                fx_names = *dir_listing_cache_t::get_directories(fx_shared_dir);
             }
 
             for (pal::string_t fx_name : fx_names)
@@ -84,19 +86,17 @@ bool compare_by_name_and_version(const framework_info &a, const framework_info &
                 {
                     trace::verbose(_X("Gathering FX locations in [%s]"), fx_dir.c_str());
 
-                    std::vector<pal::string_t> versions;
-                    pal::readdir_onlydirectories(fx_dir, &versions);
-                    for (const auto& ver : versions)
+                    // The catalog only holds the version-numbered folders.
+                    fx_version_catalog_t::versions_t versions = fx_version_catalog_t::get_versions(fx_dir);
+                    for (const auto& parsed : *versions)
                     {
-                        // Make sure we filter out any non-version folders.
-                        fx_ver_t parsed(-1, -1, -1);
-                        if (fx_ver_t::parse(ver, &parsed, false))
+                        if (trace::is_enabled(trace::level_t::verbose))
                         {
-                            trace::verbose(_X("Found FX version [%s]"), ver.c_str());
-
-                            framework_info info(fx_name, fx_dir, parsed);
-                            framework_infos->push_back(info);
+                            trace::verbose(_X("Found FX version [%s]"), parsed.as_str().c_str());
                         }
+
+                        framework_info info(fx_name, fx_dir, parsed);
+                        framework_infos->push_back(info);
                     }
                 }
             }
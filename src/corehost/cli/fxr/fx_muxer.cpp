@@ -1,7 +1,10 @@
 // Copyright (c) .NET Foundation and contributors. All rights reserved.
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cstring>
 #include "args.h"
 #include "cpprest/json.h"
 #include "deps_format.h"
@@ -9,7 +12,10 @@
 #include "framework_info.h"
 #include "fx_definition.h"
 #include "fx_muxer.h"
+#include "fx_resolution_cache.h"
 #include "fx_ver.h"
+#include "fx_version_catalog.h"
+#include "host_env.h"
 #include "host_startup_info.h"
 #include "libhost.h"
 #include "pal.h"
@@ -17,6 +23,7 @@
 #include "sdk_info.h"
 #include "sdk_resolver.h"
 #include "trace.h"
+#include "timing.h"
 #include "utils.h"
 
 /**
@@ -77,21 +84,94 @@ void handle_missing_framework_error(
     }
 }
 
-/**
-* Resolve the hostpolicy version from deps.
-*  - Scan the deps file's libraries section and find the hostpolicy version in the file.
-*/
-pal::string_t resolve_hostpolicy_version_from_deps(const pal::string_t& deps_json)
+namespace
 {
-    trace::verbose(_X("--- Resolving %s version from deps json [%s]"), LIBHOSTPOLICY_NAME, deps_json.c_str());
+    // The same prefix as read_hostpolicy_version_from_deps looks for, in UTF-8.
+    const char hostpolicy_library_prefix[] = "Microsoft.NETCore.DotNetHostPolicy/";
 
-    pal::string_t retval;
-    if (!pal::file_exists(deps_json))
+    bool is_json_whitespace(char c)
     {
-        trace::verbose(_X("Dependency manifest [%s] does not exist"), deps_json.c_str());
-        return retval;
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    // Compares "length" UTF-8 bytes with an ASCII "prefix", ignoring case like starts_with.
+    bool ascii_equals_ignore_case(const char* value, const char* prefix, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (std::tolower((unsigned char)value[i]) != std::tolower((unsigned char)prefix[i]))
+            {
+                return false;
+            }
+        }
+        return true;
     }
 
+    // Finds the version of the first property named "Microsoft.NETCore.DotNetHostPolicy/<version>" without
+    // parsing the manifest. A library has the same key in the "targets" and "libraries" sections, so the
+    // first one found has the version listed in the libraries. Returns false if escape sequences in the manifest could
+    // hide the name, which only the JSON reader resolves.
+    bool scan_hostpolicy_version(const char* begin, const char* end, pal::string_t* version)
+    {
+        const size_t prefix_length = sizeof(hostpolicy_library_prefix) - 1;
+        for (const char* pos = begin; pos < end; ++pos)
+        {
+            pos = static_cast<const char*>(std::memchr(pos, '"', end - pos));
+            if (pos == nullptr)
+            {
+                break;
+            }
+
+            const char* name = pos + 1;
+            if ((size_t)(end - name) <= prefix_length ||
+                !ascii_equals_ignore_case(name, hostpolicy_library_prefix, prefix_length))
+            {
+                continue;
+            }
+
+            const char* version_begin = name + prefix_length;
+            const char* version_end = static_cast<const char*>(std::memchr(version_begin, '"', end - version_begin));
+            if (version_end == nullptr || std::find(version_begin, version_end, '\\') != version_end)
+            {
+                return false;
+            }
+
+            // Only a property name is followed by a colon.
+            const char* next = version_end + 1;
+            while (next < end && is_json_whitespace(*next))
+            {
+                ++next;
+            }
+
+            if (next < end && *next == ':')
+            {
+                return pal::utf8_palstring(std::string(version_begin, version_end), version);
+            }
+
+            pos = version_end;
+        }
+
+        // Not found, unless the name is written with escapes.
+        static const char* const escapes[] = { "\\u", "\\/" };
+        for (const char* escape : escapes)
+        {
+            if (std::search(begin, end, escape, escape + 2) != end)
+            {
+                return false;
+            }
+        }
+
+        version->clear();
+        return true;
+    }
+}
+
+/**
+* Read the hostpolicy version from the deps file's libraries section with the JSON reader.
+*/
+pal::string_t read_hostpolicy_version_from_deps(const pal::string_t& deps_json)
+{
+    pal::string_t retval;
     pal::ifstream_t file(deps_json);
     if (!file.good())
     {
@@ -106,29 +186,99 @@ pal::string_t resolve_hostpolicy_version_from_deps(const pal::string_t& deps_jso
 
     try
     {
-        const auto root = json_value::parse(file);
-        const auto& json = root.as_object();
-        const auto& libraries = json.at(_X("libraries")).as_object();
+        typedef web::json::reader::token json_token;
+
+        timing::increment(timing::files_parsed);
+
+        // Only the names of the libraries are needed; hostpolicy parses the manifest itself,
+        // so everything else is skipped without being materialized.
+        web::json::reader reader(file);
+        if (reader.read() != json_token::begin_object)
+        {
+            throw web::json::json_exception(_X("not an object"));
+        }
 
         // Look up the root package instead of the "runtime" package because we can't do a full rid resolution.
         // i.e., look for "Microsoft.NETCore.DotNetHostPolicy/" followed by version.
         pal::string_t prefix = _X("Microsoft.NETCore.DotNetHostPolicy/");
-        for (const auto& library : libraries)
+        bool has_libraries = false;
+        while (reader.read() == json_token::property_name)
         {
-            if (starts_with(library.first, prefix, false))
+            if (reader.as_string() != _X("libraries"))
             {
-                // Extract the version information that occurs after '/'
-                retval = library.first.substr(prefix.size());
-                break;
+                reader.skip();
+                continue;
+            }
+
+            if (reader.read() != json_token::begin_object)
+            {
+                throw web::json::json_exception(_X("not an object"));
+            }
+
+            has_libraries = true;
+            retval.clear();
+            bool found = false;
+            while (reader.read() == json_token::property_name)
+            {
+                if (!found && starts_with(reader.as_string(), prefix, false))
+                {
+                    // Extract the version information that occurs after '/'
+                    retval = reader.as_string().substr(prefix.size());
+                    found = true;
+                }
+                reader.skip();
             }
         }
+
+        // Fails if anything follows the document.
+        reader.read();
+
+        if (!has_libraries)
+        {
+            throw web::json::json_exception(_X("Key not found"));
+        }
     }
     catch (const std::exception& je)
     {
         pal::string_t jes;
         (void)pal::utf8_palstring(je.what(), &jes);
         trace::error(_X("A JSON parsing exception occurred in [%s]: %s"), deps_json.c_str(), jes.c_str());
+        retval.clear();
     }
+    return retval;
+}
+
+/**
+* Resolve the hostpolicy version from deps.
+*  - Scan the deps file for the hostpolicy library and take its version. The JSON reader is only
+*    used when the scan cannot tell, hostpolicy parses and validates the deps file itself.
+*/
+pal::string_t resolve_hostpolicy_version_from_deps(const pal::string_t& deps_json)
+{
+    trace::verbose(_X("--- Resolving %s version from deps json [%s]"), LIBHOSTPOLICY_NAME, deps_json.c_str());
+
+    pal::string_t retval;
+    if (!pal::file_exists(deps_json))
+    {
+        trace::verbose(_X("Dependency manifest [%s] does not exist"), deps_json.c_str());
+        return retval;
+    }
+
+    file_contents_t contents;
+    if (!contents.load(deps_json))
+    {
+        trace::verbose(_X("Dependency manifest [%s] could not be opened"), deps_json.c_str());
+        return retval;
+    }
+
+    const char* begin = contents.begin();
+    (void)skip_utf8_bom(&begin, contents.end());
+    if (!scan_hostpolicy_version(begin, contents.end(), &retval))
+    {
+        trace::verbose(_X("Dependency manifest [%s] has escape sequences, reading its libraries"), deps_json.c_str());
+        retval = read_hostpolicy_version_from_deps(deps_json);
+    }
+
     trace::verbose(_X("Resolved version %s from dependency manifest file [%s]"), retval.c_str(), deps_json.c_str());
     return retval;
 }
@@ -354,6 +504,7 @@ bool fx_muxer_t::resolve_hostpolicy_dir(
     return false;
 }
 
+// The version list must be sorted in ascending order, see fx_version_catalog_t.
 fx_ver_t fx_muxer_t::resolve_framework_version(const std::vector<fx_ver_t>& version_list,
     const pal::string_t& fx_ver,
     const fx_ver_t& specified,
@@ -362,99 +513,88 @@ fx_ver_t fx_muxer_t::resolve_framework_version(const std::vector<fx_ver_t>& vers
 {
     trace::verbose(_X("Attempting FX roll forward starting from [%s]"), fx_ver.c_str());
 
+    assert(std::is_sorted(version_list.begin(), version_list.end()));
+
     fx_ver_t most_compatible = specified;
     if (!specified.is_prerelease())
     {
         if (roll_fwd_on_no_candidate_fx != roll_fwd_on_no_candidate_fx_option::disabled)
         {
-            fx_ver_t next_lowest(-1, -1, -1);
+            // The candidates are the versions greater than or equal to the specified one, restricted
+            // to the same major version when only rolling forward on minor.
+            auto candidates_begin = std::lower_bound(version_list.begin(), version_list.end(), specified);
+            auto candidates_end = version_list.end();
+            if (roll_fwd_on_no_candidate_fx == roll_fwd_on_no_candidate_fx_option::minor)
+            {
+                candidates_end = std::upper_bound(candidates_begin, candidates_end, specified,
+                    [](const fx_ver_t& a, const fx_ver_t& b) { return a.get_major() < b.get_major(); });
+            }
 
             // Look for the least production version
             trace::verbose(_X("'Roll forward on no candidate fx' enabled with value [%d]. Looking for the least production greater than or equal to [%s]"),
                 roll_fwd_on_no_candidate_fx, fx_ver.c_str());
 
-            for (const auto& ver : version_list)
-            {
-                if (!ver.is_prerelease() && ver >= specified)
-                {
-                    if (roll_fwd_on_no_candidate_fx == roll_fwd_on_no_candidate_fx_option::minor)
-                    {
-                        // We only want to roll forward on minor
-                        if (ver.get_major() != specified.get_major())
-                        {
-                            continue;
-                        }
-                    }
-                    next_lowest = (next_lowest == fx_ver_t(-1, -1, -1)) ? ver : std::min(next_lowest, ver);
-                }
-            }
+            auto next_lowest = std::find_if(candidates_begin, candidates_end,
+                [](const fx_ver_t& ver) { return !ver.is_prerelease(); });
 
-            if (next_lowest == fx_ver_t(-1, -1, -1))
+            if (next_lowest == candidates_end)
             {
                 // Look for the least preview version
                 trace::verbose(_X("No production greater than or equal to [%s] found. Looking for the least preview greater than [%s]"),
                     fx_ver.c_str(), fx_ver.c_str());
 
-                for (const auto& ver : version_list)
-                {
-                    if (ver.is_prerelease() && ver >= specified)
-                    {
-                        if (roll_fwd_on_no_candidate_fx == roll_fwd_on_no_candidate_fx_option::minor)
-                        {
-                            // We only want to roll forward on minor
-                            if (ver.get_major() != specified.get_major())
-                            {
-                                continue;
-                            }
-                        }
-                        next_lowest = (next_lowest == fx_ver_t(-1, -1, -1)) ? ver : std::min(next_lowest, ver);
-                    }
-                }
+                next_lowest = std::find_if(candidates_begin, candidates_end,
+                    [](const fx_ver_t& ver) { return ver.is_prerelease(); });
             }
 
-            if (next_lowest == fx_ver_t(-1, -1, -1))
+            if (next_lowest == candidates_end)
             {
                 trace::verbose(_X("No preview greater than or equal to [%s] found."), fx_ver.c_str());
             }
             else
             {
-                trace::verbose(_X("Found version [%s]"), next_lowest.as_str().c_str());
-                most_compatible = next_lowest;
+                trace::verbose(_X("Found version [%s]"), next_lowest->as_str().c_str());
+                most_compatible = *next_lowest;
             }
         }
 
         if (patch_roll_fwd)
         {
             trace::verbose(_X("Applying patch roll forward from [%s]"), most_compatible.as_str().c_str());
-            for (const auto& ver : version_list)
-            {
-                trace::verbose(_X("Inspecting version... [%s]"), ver.as_str().c_str());
 
-                if (most_compatible.is_prerelease() == ver.is_prerelease() && // prevent production from rolling forward to preview on patch
-                    ver.get_major() == most_compatible.get_major() &&
-                    ver.get_minor() == most_compatible.get_minor())
+            // Pick the greatest that differs only in patch. Production does not roll forward to preview on patch.
+            auto same_minor = std::equal_range(version_list.begin(), version_list.end(), most_compatible,
+                [](const fx_ver_t& a, const fx_ver_t& b) {
+                    return a.get_major() < b.get_major() || (a.get_major() == b.get_major() && a.get_minor() < b.get_minor());
+                });
+
+            for (auto iter = same_minor.second; iter != same_minor.first; --iter)
+            {
+                const fx_ver_t& ver = *(iter - 1);
+                if (ver.is_prerelease() == most_compatible.is_prerelease())
                 {
-                    // Pick the greatest that differs only in patch.
+                    trace::verbose(_X("Inspecting version... [%s]"), ver.as_str().c_str());
                     most_compatible = std::max(ver, most_compatible);
+                    break;
                 }
             }
         }
     }
     else
     {
-        for (const auto& ver : version_list)
+        // Pick the smallest prerelease that is greater than specified, preventing roll forward to production.
+        // Any such version immediately follows the specified one.
+        auto iter = std::upper_bound(version_list.begin(), version_list.end(), specified);
+        if (iter != version_list.end())
         {
-            trace::verbose(_X("Inspecting version... [%s]"), ver.as_str().c_str());
-
-            //both production and prerelease.
-            if (ver.is_prerelease() && // prevent roll forward to production.
-                ver.get_major() == specified.get_major() &&
-                ver.get_minor() == specified.get_minor() &&
-                ver.get_patch() == specified.get_patch() &&
-                ver > specified)
+            trace::verbose(_X("Inspecting version... [%s]"), iter->as_str().c_str());
+
+            if (iter->is_prerelease() &&
+                iter->get_major() == specified.get_major() &&
+                iter->get_minor() == specified.get_minor() &&
+                iter->get_patch() == specified.get_patch())
             {
-                // Pick the smallest prerelease that is greater than specified.
-                most_compatible = (most_compatible == specified) ? ver : std::min(ver, most_compatible);
+                most_compatible = *iter;
             }
         }
     }
@@ -466,7 +606,8 @@ fx_definition_t* fx_muxer_t::resolve_fx(
     host_mode_t mode,
     const runtime_config_t& config,
     const pal::string_t& dotnet_dir,
-    const pal::string_t& specified_fx_version
+    const pal::string_t& specified_fx_version,
+    fx_resolution_cache_t* cache
 )
 {
     // If invoking using FX dotnet.exe, use own directory.
@@ -480,6 +621,7 @@ fx_definition_t* fx_muxer_t::resolve_fx(
 
     trace::verbose(_X("--- Resolving FX directory, name '%s' version '%s'"),
         config.get_fx_name().c_str(), config.get_fx_version().c_str());
+    timing::increment(timing::fx_resolutions);
 
     const auto fx_ver = specified_fx_version.empty() ? config.get_fx_version() : specified_fx_version;
     fx_ver_t specified(-1, -1, -1);
@@ -520,82 +662,145 @@ fx_definition_t* fx_muxer_t::resolve_fx(
     pal::string_t selected_fx_version;
     fx_ver_t selected_ver(-1, -1, -1);
 
-    for (pal::string_t dir : hive_dir)
+    // The selection only depends on the reference, the roll forward settings and the versions
+    // present in each hive's framework directory.
+    pal::string_t cache_request;
+    std::vector<pal::string_t> cache_inputs;
+    if (cache->is_enabled())
+    {
+        pal::stringstream_t request;
+        request << _X("fx|") << config.get_fx_name() << _X("|") << fx_ver << _X("|") << specified_fx_version.empty() << _X("|")
+            << config.get_patch_roll_fwd() << _X("|") << static_cast<int>(config.get_roll_fwd_on_no_candidate_fx());
+        for (const auto& dir : hive_dir)
+        {
+            request << _X("|") << dir;
+        }
+        cache_request = request.str();
+
+        for (const auto& dir : hive_dir)
+        {
+            cache_inputs.push_back(dir);
+            append_path(&cache_inputs.back(), _X("shared"));
+            append_path(&cache_inputs.back(), config.get_fx_name().c_str());
+        }
+
+        std::vector<pal::string_t> cached;
+        if (cache->try_get(cache_request, &cached) && cached.size() == 2 && pal::directory_exists(cached[0]))
+        {
+            trace::verbose(_X("Chose FX version [%s] from the framework resolution cache"), cached[0].c_str());
+            return new fx_definition_t(config.get_fx_name(), cached[0], fx_ver, cached[1]);
+        }
+    }
+
+    // With parallel probing each hive is searched on its own thread, so that a hive on a slow disk
+    // or network share delays the resolution by its own latency only. The results are then merged
+    // in order either way.
+    struct hive_result_t
     {
-        auto fx_dir = dir;
-        trace::verbose(_X("Searching FX directory in [%s]"), fx_dir.c_str());
+        hive_result_t() : do_roll_forward(false), exists(false), resolved_ver(-1, -1, -1) { }
 
-        append_path(&fx_dir, _X("shared"));
-        append_path(&fx_dir, config.get_fx_name().c_str());
+        bool do_roll_forward;
+        bool exists;
+        pal::string_t fx_dir;
+        fx_ver_t resolved_ver;
+        pal::string_t resolved_ver_str;
+    };
 
-        bool do_roll_forward = false;
-        if (specified_fx_version.empty())
+    std::vector<hive_result_t> hive_results(hive_dir.size());
+    std::vector<std::function<void()>> hive_searches;
+    for (size_t i = 0; i < hive_dir.size(); ++i)
+    {
+        hive_searches.push_back([&, i]()
         {
-            if (!specified.is_prerelease())
+            hive_result_t& result = hive_results[i];
+            pal::string_t& fx_dir = result.fx_dir;
+            fx_dir = hive_dir[i];
+            trace::verbose(_X("Searching FX directory in [%s]"), fx_dir.c_str());
+
+            append_path(&fx_dir, _X("shared"));
+            append_path(&fx_dir, config.get_fx_name().c_str());
+
+            bool do_roll_forward = false;
+            if (specified_fx_version.empty())
             {
-                // If production and no roll forward use given version.
-                do_roll_forward = (config.get_patch_roll_fwd()) || (config.get_roll_fwd_on_no_candidate_fx() != roll_fwd_on_no_candidate_fx_option::disabled);
+                if (!specified.is_prerelease())
+                {
+                    // If production and no roll forward use given version.
+                    do_roll_forward = (config.get_patch_roll_fwd()) || (config.get_roll_fwd_on_no_candidate_fx() != roll_fwd_on_no_candidate_fx_option::disabled);
+                }
+                else
+                {
+                    // Prerelease, but roll forward only if version doesn't exist.
+                    pal::string_t ver_dir = fx_dir;
+                    append_path(&ver_dir, fx_ver.c_str());
+                    do_roll_forward = !pal::directory_exists(ver_dir);
+                }
+            }
+
+            result.do_roll_forward = do_roll_forward;
+            if (!do_roll_forward)
+            {
+                append_path(&fx_dir, fx_ver.c_str());
+                timing::increment(timing::fx_versions_considered);
+                result.exists = pal::directory_exists(fx_dir);
             }
             else
             {
-                // Prerelease, but roll forward only if version doesn't exist.
-                pal::string_t ver_dir = fx_dir;
-                append_path(&ver_dir, fx_ver.c_str());
-                do_roll_forward = !pal::directory_exists(ver_dir);
+                fx_version_catalog_t::versions_t installed = fx_version_catalog_t::get_versions(fx_dir);
+                timing::add(timing::fx_versions_considered, installed->size());
+
+                result.resolved_ver = resolve_framework_version(*installed, fx_ver, specified, config.get_patch_roll_fwd(), config.get_roll_fwd_on_no_candidate_fx());
+                result.resolved_ver_str = result.resolved_ver.as_str();
+                append_path(&fx_dir, result.resolved_ver_str.c_str());
+                result.exists = pal::directory_exists(fx_dir);
             }
+        });
+    }
+
+    if (parallel_probing_enabled() && hive_searches.size() > 1)
+    {
+        run_concurrently(hive_searches);
+    }
+    else
+    {
+        for (const auto& search : hive_searches)
+        {
+            search();
         }
+    }
 
-        if (!do_roll_forward)
+    for (const auto& result : hive_results)
+    {
+        if (!result.do_roll_forward)
         {
             trace::verbose(_X("Did not roll forward because specified version='%s', patch_roll_fwd=%d, roll_fwd_on_no_candidate_fx=%d, chose [%s]"),
                 specified_fx_version.c_str(), config.get_patch_roll_fwd(), config.get_roll_fwd_on_no_candidate_fx(), fx_ver.c_str());
 
-            append_path(&fx_dir, fx_ver.c_str());
-            if (pal::directory_exists(fx_dir))
+            if (result.exists)
             {
-                selected_fx_dir = fx_dir;
+                selected_fx_dir = result.fx_dir;
                 selected_fx_version = fx_ver;
                 break;
             }
         }
-        else
+        else if (result.exists)
         {
-            std::vector<pal::string_t> list;
-            std::vector<fx_ver_t> version_list;
-            pal::readdir_onlydirectories(fx_dir, &list);
-
-            for (const auto& version : list)
+            fx_ver_t resolved_ver = result.resolved_ver;
+            if (selected_ver != fx_ver_t(-1, -1, -1))
             {
-                fx_ver_t ver(-1, -1, -1);
-                if (fx_ver_t::parse(version, &ver, false))
-                {
-                    version_list.push_back(ver);
-                }
+                // Compare the previous hive_dir selection with the current hive_dir to see which one is the better match
+                std::vector<fx_ver_t> version_list;
+                version_list.push_back(std::min(resolved_ver, selected_ver));
+                version_list.push_back(std::max(resolved_ver, selected_ver));
+                resolved_ver = resolve_framework_version(version_list, fx_ver, specified, config.get_patch_roll_fwd(), config.get_roll_fwd_on_no_candidate_fx());
             }
 
-            fx_ver_t resolved_ver = resolve_framework_version(version_list, fx_ver, specified, config.get_patch_roll_fwd(), config.get_roll_fwd_on_no_candidate_fx());
-
-            pal::string_t resolved_ver_str = resolved_ver.as_str();
-            append_path(&fx_dir, resolved_ver_str.c_str());
-
-            if (pal::directory_exists(fx_dir))
+            if (resolved_ver != selected_ver)
             {
-                if (selected_ver != fx_ver_t(-1, -1, -1))
-                {
-                    // Compare the previous hive_dir selection with the current hive_dir to see which one is the better match
-                    std::vector<fx_ver_t> version_list;
-                    version_list.push_back(resolved_ver);
-                    version_list.push_back(selected_ver);
-                    resolved_ver = resolve_framework_version(version_list, fx_ver, specified, config.get_patch_roll_fwd(), config.get_roll_fwd_on_no_candidate_fx());
-                }
-
-                if (resolved_ver != selected_ver)
-                {
-                    trace::verbose(_X("Changing Selected FX version from [%s] to [%s]"), selected_fx_dir.c_str(), fx_dir.c_str());
-                    selected_ver = resolved_ver;
-                    selected_fx_dir = fx_dir;
-                    selected_fx_version = resolved_ver_str;
-                }
+                trace::verbose(_X("Changing Selected FX version from [%s] to [%s]"), selected_fx_dir.c_str(), result.fx_dir.c_str());
+                selected_ver = resolved_ver;
+                selected_fx_dir = result.fx_dir;
+                selected_fx_version = result.resolved_ver_str;
             }
         }
     }
@@ -607,6 +812,7 @@ fx_definition_t* fx_muxer_t::resolve_fx(
     }
 
     trace::verbose(_X("Chose FX version [%s]"), selected_fx_dir.c_str());
+    cache->set(cache_request, cache_inputs, { selected_fx_dir, selected_fx_version });
 
     return new fx_definition_t(config.get_fx_name(), selected_fx_dir, fx_ver, selected_fx_version);
 }
@@ -872,6 +1078,9 @@ int fx_muxer_t::read_config_and_execute(
     int32_t buffer_size,
     int32_t* required_buffer_size)
 {
+    // Covers the hostfxr startup, up to loading hostpolicy.
+    timing::phase_t phase(_X("hostfxr/read_config_and_execute"));
+
     pal::string_t opts_fx_version = _X("--fx-version");
     pal::string_t opts_roll_fwd_on_no_candidate_fx = _X("--roll-forward-on-no-candidate-fx");
     pal::string_t opts_deps_file = _X("--depsfile");
@@ -897,13 +1106,17 @@ int fx_muxer_t::read_config_and_execute(
     auto app = new fx_definition_t();
     fx_definitions.push_back(std::unique_ptr<fx_definition_t>(app));
 
+    timing::phase_t config_phase(_X("hostfxr/read_config"));
     int rc = read_config(*app, app_candidate, runtime_config);
     if (rc)
     {
         return rc;
     }
+    config_phase.end();
 
-    auto app_config = app->get_runtime_config();
+    // The app's config is the top layer; the frameworks' layers are chained through references
+    // to the layer above them, so none of them is copied.
+    runtime_config_t& app_config = app->get_runtime_config();
     bool is_framework_dependent = app_config.get_is_framework_dependent();
 
     // These settings are only valid for framework-dependent apps
@@ -926,7 +1139,7 @@ int fx_muxer_t::read_config_and_execute(
         app_config.force_roll_fwd_on_no_candidate_fx(static_cast<roll_fwd_on_no_candidate_fx_option>(pal::xtoi(roll_fwd_on_no_candidate_fx.c_str())));
     }
 
-    auto config = app_config;
+    const runtime_config_t* config = &app_config;
 
     pal::string_t additional_deps_serialized;
     if (is_framework_dependent)
@@ -936,18 +1149,21 @@ int fx_muxer_t::read_config_and_execute(
         if (additional_deps_serialized.empty())
         {
             // additional_deps_serialized stays empty if DOTNET_ADDITIONAL_DEPS env var is not defined
-            pal::getenv(_X("DOTNET_ADDITIONAL_DEPS"), &additional_deps_serialized);
+            host_env::get(host_env::additional_deps, &additional_deps_serialized);
         }
 
         // Obtain frameworks\platforms
+        fx_resolution_cache_t fx_cache(host_info.dotnet_root);
         auto version = fx_version_specified;
-        while (!config.get_fx_name().empty() && !config.get_fx_version().empty())
+        while (!config->get_fx_name().empty() && !config->get_fx_version().empty())
         {
-            fx_definition_t* fx = resolve_fx(mode, config, host_info.dotnet_root, version);
+            timing::phase_t fx_phase(_X("hostfxr/resolve_fx"), timing::resolve_fx_us, config->get_fx_name());
+            fx_definition_t* fx = resolve_fx(mode, *config, host_info.dotnet_root, version, &fx_cache);
+            fx_phase.end();
             if (fx == nullptr)
             {
-                pal::string_t searched_version = fx_version_specified.empty() ? config.get_fx_version() : fx_version_specified;
-                handle_missing_framework_error(mode, config.get_fx_name(), searched_version, pal::string_t(), host_info.dotnet_root);
+                pal::string_t searched_version = fx_version_specified.empty() ? config->get_fx_version() : fx_version_specified;
+                handle_missing_framework_error(mode, config->get_fx_name(), searched_version, pal::string_t(), host_info.dotnet_root);
                 return FrameworkMissingFailure;
             }
 
@@ -955,19 +1171,21 @@ int fx_muxer_t::read_config_and_execute(
 
             pal::string_t config_file;
             pal::string_t dev_config_file;
-            get_runtime_config_paths(fx->get_dir(), config.get_fx_name(), &config_file, &dev_config_file);
-            fx->parse_runtime_config(config_file, dev_config_file, &config, &app_config);
+            get_runtime_config_paths(fx->get_dir(), config->get_fx_name(), &config_file, &dev_config_file);
+            fx->parse_runtime_config(config_file, dev_config_file, config, &app_config);
 
-            config = fx->get_runtime_config();
-            if (!config.is_valid())
+            config = &fx->get_runtime_config();
+            if (!config->is_valid())
             {
-                trace::error(_X("Invalid framework config.json [%s]"), config.get_path().c_str());
+                trace::error(_X("Invalid framework config.json [%s]"), config->get_path().c_str());
                 return StatusCode::InvalidConfigFile;
             }
 
             // Only the first framework can have a specified version (through --fx-version)
             version.clear();
         }
+
+        fx_cache.save();
     }
 
     // Append specified probe paths first and then config file probe paths into realpaths.
@@ -991,20 +1209,33 @@ int fx_muxer_t::read_config_and_execute(
     }
 
     trace::verbose(_X("Executing as a %s app as per config file [%s]"),
-        (is_framework_dependent ? _X("framework-dependent") : _X("self-contained")), config.get_path().c_str());
+        (is_framework_dependent ? _X("framework-dependent") : _X("self-contained")), config->get_path().c_str());
 
     pal::string_t impl_dir;
+#if FEATURE_STATIC_HOST
+    // hostpolicy is linked into the host, so there is no library to search for.
+    impl_dir = host_info.dotnet_root;
+    trace::verbose(_X("Using the %s linked into the host"), LIBHOSTPOLICY_NAME);
+#else
+    timing::phase_t hostpolicy_phase(_X("hostfxr/resolve_hostpolicy_dir"));
     if (!resolve_hostpolicy_dir(mode, host_info.dotnet_root, fx_definitions, app_candidate, deps_file, fx_version_specified, probe_realpaths, &impl_dir))
     {
         return CoreHostLibMissingFailure;
     }
+    hostpolicy_phase.end();
+#endif
 
     corehost_init_t init(host_command, host_info, deps_file, additional_deps_serialized, probe_realpaths, mode, fx_definitions);
+    phase.end();
 
     if (host_command.size() == 0)
     {
         rc = execute_app(impl_dir, &init, new_argc, new_argv);
     }
+    else if (host_command == _X("keep-runtime"))
+    {
+        rc = execute_app_keep_runtime(impl_dir, &init, new_argc, new_argv);
+    }
     else
     {
         rc = execute_host_command(impl_dir, &init, new_argc, new_argv, out_buffer, buffer_size, required_buffer_size);
@@ -1026,6 +1257,9 @@ int fx_muxer_t::execute(
     int32_t buffer_size,
     int32_t* required_buffer_size)
 {
+    // The same directories are canonicalized many times while resolving the app.
+    realpath_cache_scope_t realpath_cache;
+
     // Detect invocation mode
     host_mode_t mode = detect_operating_mode(host_info);
 
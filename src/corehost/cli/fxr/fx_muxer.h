@@ -4,6 +4,7 @@
 class corehost_init_t;
 class runtime_config_t;
 class fx_definition_t; 
+class fx_resolution_cache_t;
 struct fx_ver_t;
 struct host_startup_info_t;
 
@@ -15,6 +16,12 @@ int execute_app(
     const int argc,
     const pal::char_t* argv[]);
 
+int execute_app_keep_runtime(
+    const pal::string_t& impl_dll_dir,
+    corehost_init_t* init,
+    const int argc,
+    const pal::char_t* argv[]);
+
 int execute_host_command(
     const pal::string_t& impl_dll_dir,
     corehost_init_t* init,
@@ -105,6 +112,7 @@ private:
         host_mode_t mode,
         const runtime_config_t& config,
         const pal::string_t& dotnet_dir,
-        const pal::string_t& specified_fx_version);
+        const pal::string_t& specified_fx_version,
+        fx_resolution_cache_t* cache);
     static void muxer_usage(bool is_sdk_present);
 };
@@ -0,0 +1,259 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pal.h"
+#include "utils.h"
+#include "trace.h"
+#include "host_env.h"
+#include "fx_resolution_cache.h"
+
+namespace
+{
+    const char fx_cache_header[] = "dotnet-host-fx-cache-v2";
+    const char fx_cache_trailer[] = "end";
+
+    // Stale requests are never removed individually, so the file is bounded instead.
+    const size_t max_entries = 256;
+
+    void write_line(std::ofstream& file, const pal::string_t& value)
+    {
+        std::vector<char> utf8;
+        pal::pal_utf8string(value, &utf8);
+        file << utf8.data() << '\n';
+    }
+
+    bool read_line(pal::ifstream_t& file, pal::string_t* value)
+    {
+        std::string line;
+        if (!std::getline(file, line))
+        {
+            return false;
+        }
+
+        return pal::utf8_palstring(line, value);
+    }
+
+    bool read_count(pal::ifstream_t& file, size_t* count)
+    {
+        pal::string_t line;
+        unsigned num;
+        if (!read_line(file, &line) || !try_stou(line, &num))
+        {
+            return false;
+        }
+
+        *count = num;
+        return true;
+    }
+
+    // Missing paths get an empty stamp, so that creating them invalidates the result too.
+    std::vector<pal::string_t> get_stamps(const std::vector<pal::string_t>& paths)
+    {
+        std::vector<file_stamp_t> stamps;
+        get_file_stamps(paths, &stamps);
+
+        std::vector<pal::string_t> result;
+        for (const auto& stamp : stamps)
+        {
+            pal::stringstream_t value;
+            if (stamp.exists)
+            {
+                value << stamp.last_write_time << _X("|") << stamp.size;
+            }
+            result.push_back(value.str());
+        }
+
+        return result;
+    }
+}
+
+fx_resolution_cache_t::fx_resolution_cache_t(const pal::string_t& dotnet_root)
+    : m_dirty(false)
+{
+    pal::string_t cache_dir;
+    if (!host_env::get(host_env::startup_cache, &cache_dir) || !pal::realpath(&cache_dir))
+    {
+        return;
+    }
+
+    std::size_t hash = std::hash<pal::string_t>()(dotnet_root);
+    pal::stringstream_t file_name;
+    file_name << _X("fx.") << std::hex << hash << _X(".fxcache");
+
+    m_cache_file = cache_dir;
+    append_path(&m_cache_file, file_name.str().c_str());
+
+    load();
+}
+
+void fx_resolution_cache_t::load()
+{
+    pal::ifstream_t file(m_cache_file);
+    if (!file.good())
+    {
+        trace::verbose(_X("Framework resolution cache [%s] does not exist"), m_cache_file.c_str());
+        return;
+    }
+
+    std::string header;
+    pal::string_t version;
+    size_t entry_count;
+    if (!std::getline(file, header) || header != fx_cache_header ||
+        !read_line(file, &version) || version != _STRINGIFY(HOST_FXR_PKG_VER) ||
+        !read_count(file, &entry_count))
+    {
+        trace::verbose(_X("Framework resolution cache [%s] has an unknown format"), m_cache_file.c_str());
+        return;
+    }
+
+    std::map<pal::string_t, entry_t> entries;
+    for (size_t i = 0; i < entry_count; ++i)
+    {
+        pal::string_t request;
+        entry_t entry;
+        size_t input_count, value_count;
+        bool valid = read_line(file, &request) && read_count(file, &input_count);
+        for (size_t j = 0; valid && j < input_count; ++j)
+        {
+            pal::string_t path, stamp;
+            valid = read_line(file, &path) && read_line(file, &stamp);
+            entry.inputs.emplace_back(std::move(path), std::move(stamp));
+        }
+
+        valid = valid && read_count(file, &value_count);
+        for (size_t j = 0; valid && j < value_count; ++j)
+        {
+            pal::string_t value;
+            valid = read_line(file, &value);
+            entry.values.push_back(std::move(value));
+        }
+
+        if (!valid)
+        {
+            trace::verbose(_X("Framework resolution cache [%s] is truncated"), m_cache_file.c_str());
+            return;
+        }
+
+        entries[request] = std::move(entry);
+    }
+
+    // The trailer guards against reading a cache that is still being written.
+    std::string trailer;
+    if (!std::getline(file, trailer) || trailer != fx_cache_trailer)
+    {
+        trace::verbose(_X("Framework resolution cache [%s] is truncated"), m_cache_file.c_str());
+        return;
+    }
+
+    m_entries = std::move(entries);
+    trace::verbose(_X("Read %d entries from framework resolution cache [%s]"), (int) m_entries.size(), m_cache_file.c_str());
+}
+
+bool fx_resolution_cache_t::try_get(const pal::string_t& request, std::vector<pal::string_t>* values) const
+{
+    auto iter = m_entries.find(request);
+    if (iter == m_entries.end())
+    {
+        return false;
+    }
+
+    const auto& inputs = iter->second.inputs;
+    std::vector<pal::string_t> paths;
+    for (const auto& input : inputs)
+    {
+        paths.push_back(input.first);
+    }
+
+    std::vector<pal::string_t> stamps = get_stamps(paths);
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        if (stamps[i] != inputs[i].second)
+        {
+            trace::verbose(_X("Framework resolution cache entry for [%s] is stale, [%s] changed"), request.c_str(), inputs[i].first.c_str());
+            return false;
+        }
+    }
+
+    *values = iter->second.values;
+    return true;
+}
+
+void fx_resolution_cache_t::set(const pal::string_t& request, const std::vector<pal::string_t>& inputs, const std::vector<pal::string_t>& values)
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    if (m_entries.size() >= max_entries && m_entries.find(request) == m_entries.end())
+    {
+        m_entries.clear();
+    }
+
+    auto& entry = m_entries[request];
+    std::vector<pal::string_t> stamps = get_stamps(inputs);
+    entry.inputs.clear();
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        entry.inputs.emplace_back(inputs[i], std::move(stamps[i]));
+    }
+    entry.values = values;
+    m_dirty = true;
+}
+
+void fx_resolution_cache_t::save() const
+{
+    if (!is_enabled() || !m_dirty)
+    {
+        return;
+    }
+
+    // Write to a temporary file and move it in place so that readers never see a partially written
+    // cache. Concurrent writers, in this process or others, each use their own file; the last one
+    // moved in place wins.
+    pal::string_t tmp_path = get_temp_file_path(m_cache_file);
+    std::ofstream file(tmp_path, std::ios::out | std::ios::trunc);
+    if (!file.good())
+    {
+        trace::verbose(_X("Failed to open framework resolution cache [%s] for writing"), m_cache_file.c_str());
+        return;
+    }
+
+    file << fx_cache_header << '\n';
+    write_line(file, _STRINGIFY(HOST_FXR_PKG_VER));
+    file << m_entries.size() << '\n';
+    for (const auto& entry : m_entries)
+    {
+        write_line(file, entry.first);
+        file << entry.second.inputs.size() << '\n';
+        for (const auto& input : entry.second.inputs)
+        {
+            write_line(file, input.first);
+            write_line(file, input.second);
+        }
+        file << entry.second.values.size() << '\n';
+        for (const auto& value : entry.second.values)
+        {
+            write_line(file, value);
+        }
+    }
+
+    file << fx_cache_trailer << '\n';
+    file.close();
+
+    if (file.fail())
+    {
+        trace::verbose(_X("Failed to write framework resolution cache [%s]"), m_cache_file.c_str());
+        pal::remove_file(tmp_path);
+        return;
+    }
+
+    if (pal::rename_file(tmp_path, m_cache_file))
+    {
+        trace::verbose(_X("Wrote framework resolution cache [%s]"), m_cache_file.c_str());
+    }
+    else
+    {
+        pal::remove_file(tmp_path);
+    }
+}
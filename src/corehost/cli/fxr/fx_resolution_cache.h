@@ -0,0 +1,49 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef __FX_RESOLUTION_CACHE_H__
+#define __FX_RESOLUTION_CACHE_H__
+
+#include "pal.h"
+#include <map>
+
+/**
+ * Persists the results of framework roll forward and SDK resolution so that repeated
+ * launches from the same dotnet root can skip listing install directories and parsing
+ * global.json.
+ *
+ * The cache is opt-in and shares the DOTNET_HOST_STARTUP_CACHE directory with the
+ * hostpolicy startup cache. Each result is keyed by the request that produced it and is
+ * only reused while the timestamp and size of every file and directory recorded with it
+ * are unchanged; e.g. installing or removing a framework version changes the timestamp
+ * of its "shared/<name>" directory.
+ */
+class fx_resolution_cache_t
+{
+public:
+    explicit fx_resolution_cache_t(const pal::string_t& dotnet_root);
+
+    bool is_enabled() const { return !m_cache_file.empty(); }
+
+    bool try_get(const pal::string_t& request, std::vector<pal::string_t>* values) const;
+    void set(const pal::string_t& request, const std::vector<pal::string_t>& inputs, const std::vector<pal::string_t>& values);
+
+    // Writes the cache back if any result was added or replaced.
+    void save() const;
+
+private:
+    struct entry_t
+    {
+        // Pairs of path and stamp, in the order they were recorded.
+        std::vector<std::pair<pal::string_t, pal::string_t>> inputs;
+        std::vector<pal::string_t> values;
+    };
+
+    void load();
+
+    pal::string_t m_cache_file;
+    std::map<pal::string_t, entry_t> m_entries;
+    bool m_dirty;
+};
+
+#endif // __FX_RESOLUTION_CACHE_H__
@@ -1,71 +1,66 @@
 // Copyright (c) .NET Foundation and contributors. All rights reserved.
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include "pal.h"
 #include "utils.h"
 #include "fx_ver.h"
 
 fx_ver_t::fx_ver_t(int major, int minor, int patch, const pal::string_t& pre, const pal::string_t& build)
-    : m_major(major)
-    , m_minor(minor)
-    , m_patch(patch)
-    , m_pre(pre)
-    , m_build(build)
+    : fx_ver_t(major, minor, patch)
 {
+    set_tags(pre.data(), pre.size(), build.data(), build.size());
 }
 
 fx_ver_t::fx_ver_t(int major, int minor, int patch, const pal::string_t& pre)
-    : fx_ver_t(major, minor, patch, pre, _X(""))
+    : fx_ver_t(major, minor, patch)
 {
+    set_tags(pre.data(), pre.size(), nullptr, 0);
 }
 
 fx_ver_t::fx_ver_t(int major, int minor, int patch)
-    : fx_ver_t(major, minor, patch, _X(""), _X(""))
-{
-}
-
-bool fx_ver_t::operator ==(const fx_ver_t& b) const
-{
-    return compare(*this, b) == 0;
-}
-
-bool fx_ver_t::operator !=(const fx_ver_t& b) const
-{
-    return !operator ==(b);
-}
-
-bool fx_ver_t::operator <(const fx_ver_t& b) const
-{
-    return compare(*this, b) < 0;
-}
-
-bool fx_ver_t::operator >(const fx_ver_t& b) const
+    : m_major(major)
+    , m_minor(minor)
+    , m_patch(patch)
+    , m_pre_length(0)
+    , m_build_length(0)
+    , m_tags()
 {
-    return compare(*this, b) > 0;
 }
 
-bool fx_ver_t::operator <=(const fx_ver_t& b) const
+void fx_ver_t::set_tags(const pal::char_t* pre, size_t pre_length, const pal::char_t* build, size_t build_length)
 {
-    return compare(*this, b) <= 0;
-}
+    assert(pre_length <= UINT16_MAX && build_length <= UINT16_MAX);
+    m_pre_length = static_cast<uint16_t>(pre_length);
+    m_build_length = static_cast<uint16_t>(build_length);
 
-bool fx_ver_t::operator >=(const fx_ver_t& b) const
-{
-    return compare(*this, b) >= 0;
+    if (pre_length + build_length <= inline_tag_size)
+    {
+        std::copy(pre, pre + pre_length, m_tags);
+        std::copy(build, build + build_length, m_tags + pre_length);
+        m_long_tags.clear();
+    }
+    else
+    {
+        m_long_tags.assign(pre, pre_length);
+        m_long_tags.append(build, build_length);
+    }
 }
 
 pal::string_t fx_ver_t::as_str() const
 {
     pal::stringstream_t stream;
     stream << m_major << _X(".") << m_minor << _X(".") << m_patch;
-    if (!m_pre.empty())
+    const pal::char_t* tag = tags();
+    if (m_pre_length != 0)
     {
-        stream << m_pre;
+        stream << pal::string_t(tag, m_pre_length);
     }
-    if (!m_build.empty())
+    if (m_build_length != 0)
     {
-        stream << _X("+") << m_build;
+        stream << _X("+") << pal::string_t(tag + m_pre_length, m_build_length);
     }
     return stream.str();
 }
@@ -85,41 +80,74 @@ pal::string_t fx_ver_t::patch_glob() const
 }
 
 /* static */
-int fx_ver_t::compare(const fx_ver_t&a, const fx_ver_t& b)
+int fx_ver_t::compare_tag(const pal::char_t* a, size_t a_length, const pal::char_t* b, size_t b_length)
 {
-    // compare(u.v.w-p+b, x.y.z-q+c)
-    if (a.m_major != b.m_major)
+    // Same ordering as std::basic_string::compare.
+    int cmp = std::char_traits<pal::char_t>::compare(a, b, std::min(a_length, b_length));
+    if (cmp != 0)
     {
-        return (a.m_major > b.m_major) ? 1 : -1;
+        return cmp;
     }
 
-    if (a.m_minor != b.m_minor)
-    {
-        return (a.m_minor > b.m_minor) ? 1 : -1;
-    }
-
-    if (a.m_patch != b.m_patch)
-    {
-        return (a.m_patch > b.m_patch) ? 1 : -1;
-    }
+    return (a_length == b_length) ? 0 : (a_length < b_length ? -1 : 1);
+}
 
-    if (a.m_pre.empty() != b.m_pre.empty())
+/* static */
+int fx_ver_t::compare_tags(const fx_ver_t& a, const fx_ver_t& b)
+{
+    if ((a.m_pre_length == 0) != (b.m_pre_length == 0))
     {
         // Either a is empty or b is empty
-        return a.m_pre.empty() ? 1 : -1;
+        return (a.m_pre_length == 0) ? 1 : -1;
     }
 
     // Either both are empty or both are non-empty (may be equal)
-    int pre_cmp = a.m_pre.compare(b.m_pre);
+    const pal::char_t* a_tags = a.tags();
+    const pal::char_t* b_tags = b.tags();
+    int pre_cmp = compare_tag(a_tags, a.m_pre_length, b_tags, b.m_pre_length);
     if (pre_cmp != 0)
     {
         return pre_cmp;
     }
-    
-    return a.m_build.compare(b.m_build);
+
+    return compare_tag(a_tags + a.m_pre_length, a.m_build_length, b_tags + b.m_pre_length, b.m_build_length);
 }
 
-bool parse_internal(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_production)
+namespace
+{
+    // Parses the digits in [start, end) without copying them out of the version string.
+    bool try_parse_number(const pal::string_t& ver, size_t start, size_t end, unsigned* num)
+    {
+        if (start >= end)
+        {
+            return false;
+        }
+
+        unsigned value = 0;
+        for (size_t i = start; i < end; ++i)
+        {
+            pal::char_t c = ver[i];
+            if (c < _X('0') || c > _X('9'))
+            {
+                return false;
+            }
+
+            unsigned digit = c - _X('0');
+            if (value > (UINT_MAX - digit) / 10)
+            {
+                return false;
+            }
+
+            value = value * 10 + digit;
+        }
+
+        *num = value;
+        return true;
+    }
+}
+
+/* static */
+bool fx_ver_t::parse_internal(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_production)
 {
     size_t maj_start = 0;
     size_t maj_sep = ver.find(_X('.'));
@@ -128,7 +156,7 @@ bool parse_internal(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_
         return false;
     }
     unsigned major = 0;
-    if (!try_stou(ver.substr(maj_start, maj_sep), &major))
+    if (!try_parse_number(ver, maj_start, maj_sep, &major))
     {
         return false;
     }
@@ -141,7 +169,7 @@ bool parse_internal(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_
     }
 
     unsigned minor = 0;
-    if (!try_stou(ver.substr(min_start, min_sep - min_start), &minor))
+    if (!try_parse_number(ver, min_start, min_sep, &minor))
     {
         return false;
     }
@@ -151,7 +179,7 @@ bool parse_internal(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_
     size_t pat_sep = index_of_non_numeric(ver, pat_start);
     if (pat_sep == pal::string_t::npos)
     {
-        if (!try_stou(ver.substr(pat_start), &patch))
+        if (!try_parse_number(ver, pat_start, ver.size(), &patch))
         {
             return false;
         }
@@ -166,24 +194,26 @@ bool parse_internal(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_
         return false;
     }
 
-    if (!try_stou(ver.substr(pat_start, pat_sep - pat_start), &patch))
+    if (!try_parse_number(ver, pat_start, pat_sep, &patch))
     {
         return false;
     }
 
     size_t pre_start = pat_sep;
     size_t pre_sep = ver.find(_X('+'), pre_start);
+    size_t build_start = ver.size();
     if (pre_sep == pal::string_t::npos)
     {
-        *fx_ver = fx_ver_t(major, minor, patch, ver.substr(pre_start));
-        return true;
+        pre_sep = ver.size();
     }
     else
     {
-        size_t build_start = pre_sep + 1;
-        *fx_ver = fx_ver_t(major, minor, patch, ver.substr(pre_start, pre_sep - pre_start), ver.substr(build_start));
-        return true;
+        build_start = pre_sep + 1;
     }
+
+    *fx_ver = fx_ver_t(major, minor, patch);
+    fx_ver->set_tags(ver.data() + pre_start, pre_sep - pre_start, ver.data() + build_start, ver.size() - build_start);
+    return true;
 }
 
 /* static */
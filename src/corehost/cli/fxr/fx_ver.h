@@ -8,6 +8,10 @@
 
 // Note: This is not SemVer (esp., in comparing pre-release part, fx_ver_t does not
 // compare multiple dot separated identifiers individually.) ex: 1.0.0-beta.2 vs. 1.0.0-beta.11
+//
+// Versions are listed, parsed, sorted and compared for every install location, so the
+// prerelease and build tags are kept inline: parsing, copying and comparing a version does
+// not allocate unless its tags exceed inline_tag_size characters.
 struct fx_ver_t
 {
     fx_ver_t(int major, int minor, int patch);
@@ -22,29 +26,66 @@ struct fx_ver_t
     void set_minor(int m) { m_minor = m; }
     void set_patch(int p) { m_patch = p; }
 
-    bool is_prerelease() const { return !m_pre.empty(); }
+    bool is_prerelease() const { return m_pre_length != 0; }
+    bool has_build() const { return m_build_length != 0; }
 
     pal::string_t as_str() const;
     pal::string_t prerelease_glob() const;
     pal::string_t patch_glob() const;
 
-    bool operator ==(const fx_ver_t& b) const;
-    bool operator !=(const fx_ver_t& b) const;
-    bool operator <(const fx_ver_t& b) const;
-    bool operator >(const fx_ver_t& b) const;
-    bool operator <=(const fx_ver_t& b) const;
-    bool operator >=(const fx_ver_t& b) const;
+    bool operator ==(const fx_ver_t& b) const { return compare(*this, b) == 0; }
+    bool operator !=(const fx_ver_t& b) const { return compare(*this, b) != 0; }
+    bool operator <(const fx_ver_t& b) const { return compare(*this, b) < 0; }
+    bool operator >(const fx_ver_t& b) const { return compare(*this, b) > 0; }
+    bool operator <=(const fx_ver_t& b) const { return compare(*this, b) <= 0; }
+    bool operator >=(const fx_ver_t& b) const { return compare(*this, b) >= 0; }
 
     static bool parse(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_production = false);
 
 private:
+    // Covers tags such as "-preview2-25407-01" or "-rc1-final".
+    static const size_t inline_tag_size = 24;
+
+    // The prerelease tag (including its leading '-') followed by the build tag (without its '+').
+    void set_tags(const pal::char_t* pre, size_t pre_length, const pal::char_t* build, size_t build_length);
+    const pal::char_t* tags() const { return m_long_tags.empty() ? m_tags : m_long_tags.c_str(); }
+
     int m_major;
     int m_minor;
     int m_patch;
-    pal::string_t m_pre;
-    pal::string_t m_build;
+    uint16_t m_pre_length;
+    uint16_t m_build_length;
+    pal::char_t m_tags[inline_tag_size];
+    pal::string_t m_long_tags;
+
+    static bool parse_internal(const pal::string_t& ver, fx_ver_t* fx_ver, bool parse_only_production);
+    static int compare_tag(const pal::char_t* a, size_t a_length, const pal::char_t* b, size_t b_length);
+    static int compare(const fx_ver_t& a, const fx_ver_t& b)
+    {
+        // compare(u.v.w-p+b, x.y.z-q+c)
+        if (a.m_major != b.m_major)
+        {
+            return (a.m_major > b.m_major) ? 1 : -1;
+        }
+
+        if (a.m_minor != b.m_minor)
+        {
+            return (a.m_minor > b.m_minor) ? 1 : -1;
+        }
+
+        if (a.m_patch != b.m_patch)
+        {
+            return (a.m_patch > b.m_patch) ? 1 : -1;
+        }
+
+        if ((a.m_pre_length | a.m_build_length | b.m_pre_length | b.m_build_length) == 0)
+        {
+            return 0;
+        }
 
-    static int compare(const fx_ver_t&a, const fx_ver_t& b);
+        return compare_tags(a, b);
+    }
+    static int compare_tags(const fx_ver_t& a, const fx_ver_t& b);
 };
 
-#endif // __FX_VER_H__
\ No newline at end of file
+#endif // __FX_VER_H__
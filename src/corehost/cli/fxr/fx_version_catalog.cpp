@@ -0,0 +1,56 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pal.h"
+#include "trace.h"
+#include "fx_version_catalog.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    struct entry_t
+    {
+        // The listing the versions were parsed from; a new listing means the directory changed.
+        dir_listing_cache_t::listing_t listing;
+        fx_version_catalog_t::versions_t versions;
+    };
+
+    std::mutex g_catalog_lock;
+    std::unordered_map<pal::string_t, entry_t> g_catalog;
+}
+
+fx_version_catalog_t::versions_t fx_version_catalog_t::get_versions(const pal::string_t& fx_dir)
+{
+    dir_listing_cache_t::listing_t listing = dir_listing_cache_t::get_directories(fx_dir);
+
+    {
+        std::lock_guard<std::mutex> lock(g_catalog_lock);
+        auto iter = g_catalog.find(fx_dir);
+        if (iter != g_catalog.end() && iter->second.listing == listing)
+        {
+            return iter->second.versions;
+        }
+    }
+
+    auto versions = std::make_shared<std::vector<fx_ver_t>>();
+    for (const auto& version : *listing)
+    {
+        fx_ver_t ver(-1, -1, -1);
+        if (fx_ver_t::parse(version, &ver, false))
+        {
+            versions->push_back(ver);
+        }
+    }
+
+    std::stable_sort(versions->begin(), versions->end());
+
+    trace::verbose(_X("Found %d framework versions in [%s]"), (int) versions->size(), fx_dir.c_str());
+
+    std::lock_guard<std::mutex> lock(g_catalog_lock);
+    auto& entry = g_catalog[fx_dir];
+    entry.listing = listing;
+    entry.versions = versions;
+    return entry.versions;
+}
@@ -0,0 +1,28 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef __FX_VERSION_CATALOG_H__
+#define __FX_VERSION_CATALOG_H__
+
+#include "pal.h"
+#include "fx_ver.h"
+#include "dir_listing_cache.h"
+
+/**
+ * Catalog of the versions installed for a framework in a hive ("<hive>/shared/<fx_name>"),
+ * or of the SDKs installed in a hive ("<hive>/sdk").
+ *
+ * Version names are parsed once per listing of the framework directory, so repeated
+ * hostfxr calls in one process only reparse after a version is installed or removed;
+ * the versions are kept sorted so that roll forward can use binary searches.
+ */
+class fx_version_catalog_t
+{
+public:
+    typedef std::shared_ptr<const std::vector<fx_ver_t>> versions_t;
+
+    // Returns the versions found in "fx_dir" in ascending order.
+    static versions_t get_versions(const pal::string_t& fx_dir);
+};
+
+#endif // __FX_VERSION_CATALOG_H__
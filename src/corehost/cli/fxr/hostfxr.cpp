@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include "trace.h"
+#include "timing.h"
 #include "pal.h"
 #include "utils.h"
 #include "fx_ver.h"
@@ -12,11 +13,121 @@
 #include "runtime_config.h"
 #include "sdk_info.h"
 #include "sdk_resolver.h"
+#include <mutex>
 
 typedef int(*corehost_load_fn) (const host_interface_t* init);
 typedef int(*corehost_main_fn) (const int argc, const pal::char_t* argv[]);
 typedef int(*corehost_main_with_output_buffer_fn) (const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size);
 typedef int(*corehost_unload_fn) ();
+typedef int(*corehost_main_with_init_fn) (const host_interface_t* init, const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size);
+typedef int(*corehost_shutdown_runtime_fn) ();
+typedef int(*corehost_get_startup_stats_fn) (startup_stats_result_fn result);
+
+#if FEATURE_STATIC_HOST
+// hostpolicy is linked into the same executable.
+SHARED_API int corehost_load(host_interface_t* init);
+SHARED_API int corehost_main(const int argc, const pal::char_t* argv[]);
+SHARED_API int corehost_main_with_output_buffer(const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size);
+SHARED_API int corehost_main_keep_runtime(const int argc, const pal::char_t* argv[]);
+SHARED_API int corehost_shutdown_runtime();
+SHARED_API int corehost_get_startup_stats(startup_stats_result_fn result);
+SHARED_API int corehost_unload();
+SHARED_API int corehost_main_with_init(host_interface_t* init, const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size);
+#endif
+
+namespace
+{
+    // hostpolicy builds without corehost_main_with_init keep the state handed over by
+    // corehost_load in a global until the matching corehost_main call, so with them the host
+    // commands, which may be issued from several threads at once, run their load, main and unload
+    // sequence one at a time. They do not run managed code and cannot call back into hostfxr
+    // while holding it.
+    std::mutex g_host_command_lock;
+
+    // The hostpolicy whose runtime is kept by hostfxr_main_keep_runtime, loaded until hostfxr_shutdown_runtime.
+    std::mutex g_kept_host_lock;
+    pal::dll_t g_kept_host;
+    pal::string_t g_kept_host_dir;
+    corehost_shutdown_runtime_fn g_kept_host_shutdown = nullptr;
+
+    // The statistics of the hostpolicy that is running an app or keeps a runtime, for
+    // hostfxr_get_startup_stats. Null if there is none, or if it is too old to report them.
+    std::mutex g_host_stats_lock;
+    corehost_get_startup_stats_fn g_host_stats = nullptr;
+    std::vector<pal::string_t>* g_host_stats_names = nullptr;
+    std::vector<int64_t>* g_host_stats_values = nullptr;
+
+    // Returns the previous one, an app can run another app in the same process.
+    corehost_get_startup_stats_fn set_host_stats(corehost_get_startup_stats_fn host_stats)
+    {
+#if FEATURE_STATIC_HOST
+        // hostpolicy shares the statistics of hostfxr, they are reported once.
+        host_stats = nullptr;
+#endif
+        std::lock_guard<std::mutex> lock(g_host_stats_lock);
+        std::swap(g_host_stats, host_stats);
+        return host_stats;
+    }
+
+    // Called under g_host_stats_lock.
+    void append_host_stats(int32_t count, const pal::char_t* names[], const int64_t values[])
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            g_host_stats_names->push_back(pal::string_t(_X("hostpolicy/")) + names[i]);
+            g_host_stats_values->push_back(values[i]);
+        }
+    }
+
+    pal::proc_t get_host_symbol(pal::dll_t h_host, const char* name)
+    {
+#if FEATURE_STATIC_HOST
+        struct entry_point_t
+        {
+            const char* name;
+            pal::proc_t proc;
+        };
+
+        static const entry_point_t entry_points[] =
+        {
+            { "corehost_load", (pal::proc_t)&corehost_load },
+            { "corehost_main", (pal::proc_t)&corehost_main },
+            { "corehost_main_with_output_buffer", (pal::proc_t)&corehost_main_with_output_buffer },
+            { "corehost_main_keep_runtime", (pal::proc_t)&corehost_main_keep_runtime },
+            { "corehost_shutdown_runtime", (pal::proc_t)&corehost_shutdown_runtime },
+            { "corehost_get_startup_stats", (pal::proc_t)&corehost_get_startup_stats },
+            { "corehost_unload", (pal::proc_t)&corehost_unload },
+            { "corehost_main_with_init", (pal::proc_t)&corehost_main_with_init },
+        };
+
+        for (const auto& entry_point : entry_points)
+        {
+            if (strcmp(entry_point.name, name) == 0)
+            {
+                return entry_point.proc;
+            }
+        }
+
+        return nullptr;
+#else
+        return pal::get_symbol(h_host, name);
+#endif
+    }
+
+    // Returns the entry point that runs an app or host command with the state handed over in the
+    // same call, or null if hostpolicy only has the corehost_load, main and unload sequence.
+    corehost_main_with_init_fn get_host_main_with_init(pal::dll_t h_host)
+    {
+        return (corehost_main_with_init_fn)get_host_symbol(h_host, "corehost_main_with_init");
+    }
+
+    void unload_host_library(pal::dll_t h_host)
+    {
+#if !FEATURE_STATIC_HOST
+        pal::unload_library(h_host);
+#endif
+    }
+}
 
 int load_host_library_common(
     const pal::string_t& lib_dir,
@@ -25,6 +136,11 @@ int load_host_library_common(
     corehost_load_fn* load_fn,
     corehost_unload_fn* unload_fn)
 {
+#if FEATURE_STATIC_HOST
+    // Nothing to load, the entry points are linked in.
+    host_path.clear();
+    *h_host = nullptr;
+#else
     if (!library_exists_in_dir(lib_dir, LIBHOSTPOLICY_NAME, &host_path))
     {
         return StatusCode::CoreHostLibMissingFailure;
@@ -36,10 +152,11 @@ int load_host_library_common(
         trace::info(_X("Load library of %s failed"), host_path.c_str());
         return StatusCode::CoreHostLibLoadFailure;
     }
+#endif
 
     // Obtain entrypoint symbols
-    *load_fn = (corehost_load_fn)pal::get_symbol(*h_host, "corehost_load");
-    *unload_fn = (corehost_unload_fn)pal::get_symbol(*h_host, "corehost_unload");
+    *load_fn = (corehost_load_fn)get_host_symbol(*h_host, "corehost_load");
+    *unload_fn = (corehost_unload_fn)get_host_symbol(*h_host, "corehost_unload");
 
     return (*load_fn != nullptr) && (*unload_fn != nullptr)
         ? StatusCode::Success
@@ -61,7 +178,7 @@ int load_host_library(
     }
 
     // Obtain entrypoint symbol
-    *main_fn = (corehost_main_fn)pal::get_symbol(*h_host, "corehost_main");
+    *main_fn = (corehost_main_fn)get_host_symbol(*h_host, "corehost_main");
 
     return (*main_fn != nullptr)
         ? StatusCode::Success
@@ -83,7 +200,7 @@ int load_host_library_with_return(
     }
 
     // Obtain entrypoint symbol
-    *main_fn = (corehost_main_with_output_buffer_fn)pal::get_symbol(*h_host, "corehost_main_with_output_buffer");
+    *main_fn = (corehost_main_with_output_buffer_fn)get_host_symbol(*h_host, "corehost_main_with_output_buffer");
 
     return (*main_fn != nullptr)
         ? StatusCode::Success
@@ -111,14 +228,114 @@ int execute_app(
     // Previous hostfxr trace messages must be printed before calling trace::setup in hostpolicy
     trace::flush();
 
+    corehost_get_startup_stats_fn outer_stats = set_host_stats(
+        (corehost_get_startup_stats_fn)get_host_symbol(corehost, "corehost_get_startup_stats"));
+
+    const host_interface_t& intf = init->get_host_init_data();
+    corehost_main_with_init_fn host_main_with_init = get_host_main_with_init(corehost);
+    if (host_main_with_init != nullptr)
+    {
+        code = host_main_with_init(&intf, argc, argv, nullptr, 0, nullptr);
+    }
+    else if ((code = host_load(&intf)) == 0)
+    {
+        code = host_main(argc, argv);
+        (void)host_unload();
+    }
+
+    set_host_stats(outer_stats);
+    unload_host_library(corehost);
+
+    return code;
+}
+
+int execute_app_keep_runtime(
+    const pal::string_t& impl_dll_dir,
+    corehost_init_t* init,
+    const int argc,
+    const pal::char_t* argv[])
+{
+    pal::dll_t corehost;
+    corehost_main_fn host_main = nullptr;
+    corehost_load_fn host_load = nullptr;
+    corehost_unload_fn host_unload = nullptr;
+    corehost_shutdown_runtime_fn host_shutdown = nullptr;
+    bool keep;
+
+    // Only the loading is done under the lock, the app may call back into hostfxr.
+    {
+        std::lock_guard<std::mutex> lock(g_kept_host_lock);
+        if (!g_kept_host_dir.empty() && !pal::are_paths_equal_with_normalized_casing(g_kept_host_dir, impl_dll_dir))
+        {
+            trace::error(_X("The app resolved %s from [%s], but the running runtime uses the one from [%s]"), LIBHOSTPOLICY_NAME, impl_dll_dir.c_str(), g_kept_host_dir.c_str());
+            return StatusCode::HostRuntimeIncompatible;
+        }
+
+        pal::string_t host_path;
+        int code = load_host_library_common(impl_dll_dir, host_path, &corehost, &host_load, &host_unload);
+        if (code == StatusCode::Success)
+        {
+            host_main = (corehost_main_fn)get_host_symbol(corehost, "corehost_main_keep_runtime");
+            host_shutdown = (corehost_shutdown_runtime_fn)get_host_symbol(corehost, "corehost_shutdown_runtime");
+            code = (host_main != nullptr) && (host_shutdown != nullptr)
+                ? StatusCode::Success
+                : StatusCode::CoreHostEntryPointFailure;
+        }
+
+        if (code != StatusCode::Success)
+        {
+            trace::error(_X("An error occurred while loading required library %s from [%s]"), LIBHOSTPOLICY_NAME, impl_dll_dir.c_str());
+            return code;
+        }
+
+        // The first load is kept with the runtime, later ones only add a reference to it.
+        keep = g_kept_host_dir.empty();
+        if (keep)
+        {
+            g_kept_host = corehost;
+            g_kept_host_dir = impl_dll_dir;
+            g_kept_host_shutdown = host_shutdown;
+            set_host_stats((corehost_get_startup_stats_fn)get_host_symbol(corehost, "corehost_get_startup_stats"));
+        }
+    }
+
+    // Previous hostfxr trace messages must be printed before calling trace::setup in hostpolicy
+    trace::flush();
+
+    int code;
     const host_interface_t& intf = init->get_host_init_data();
-    if ((code = host_load(&intf)) == 0)
+    corehost_main_with_init_fn host_main_with_init = get_host_main_with_init(corehost);
+    if (host_main_with_init != nullptr)
+    {
+        code = host_main_with_init(&intf, argc, argv, nullptr, 0, nullptr);
+    }
+    else if ((code = host_load(&intf)) == 0)
     {
         code = host_main(argc, argv);
         (void)host_unload();
     }
 
-    pal::unload_library(corehost);
+    if (!keep)
+    {
+        unload_host_library(corehost);
+    }
+
+    return code;
+}
+
+int shutdown_kept_runtime()
+{
+    std::lock_guard<std::mutex> lock(g_kept_host_lock);
+    if (g_kept_host_dir.empty())
+    {
+        return StatusCode::Success;
+    }
+
+    int code = g_kept_host_shutdown();
+    set_host_stats(nullptr);
+    unload_host_library(g_kept_host);
+    g_kept_host_dir.clear();
+    g_kept_host_shutdown = nullptr;
 
     return code;
 }
@@ -149,13 +366,22 @@ int execute_host_command(
     trace::flush();
 
     const host_interface_t& intf = init->get_host_init_data();
-    if ((code = host_load(&intf)) == 0)
+    corehost_main_with_init_fn host_main_with_init = get_host_main_with_init(corehost);
+    if (host_main_with_init != nullptr)
     {
-        code = host_main(argc, argv, result_buffer, buffer_size, required_buffer_size);
-        (void)host_unload();
+        code = host_main_with_init(&intf, argc, argv, result_buffer, buffer_size, required_buffer_size);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(g_host_command_lock);
+        if ((code = host_load(&intf)) == 0)
+        {
+            code = host_main(argc, argv, result_buffer, buffer_size, required_buffer_size);
+            (void)host_unload();
+        }
     }
 
-    pal::unload_library(corehost);
+    unload_host_library(corehost);
 
     return code;
 }
@@ -185,6 +411,50 @@ SHARED_API int hostfxr_main(const int argc, const pal::char_t* argv[])
     return muxer.execute(pal::string_t(), argc, argv, startup_info, nullptr, 0, nullptr);
 }
 
+//
+// Runs an app like hostfxr_main, but keeps the runtime initialized once the app returns; later
+// calls execute their app in that runtime instead of resolving and initializing a new one.
+//
+// Later apps must resolve to the same hostpolicy, CoreCLR and frameworks as the first one, or the
+// call fails with HostRuntimeIncompatible. Their dependencies are only found through the trusted
+// assemblies of the first one, so they must also resolve to the same runtime properties, trusted
+// assemblies and native and resource search paths, or the call fails with KeptRuntimeMismatch.
+// An app is only checked the first time it is executed.
+//
+// Apps are executed outside of any lock, so they may call back into this function. The runtime
+// is shut down by hostfxr_shutdown_runtime.
+//
+// Return value:
+//   The exit code of the app, or a failure from resolving or starting the runtime.
+//
+SHARED_API int hostfxr_main_keep_runtime(const int argc, const pal::char_t* argv[])
+{
+    trace::setup();
+
+    trace::info(_X("--- Invoked hostfxr [commit hash: %s] hostfxr_main_keep_runtime"), _STRINGIFY(REPO_COMMIT_HASH));
+
+    host_startup_info_t startup_info;
+    startup_info.parse(argc, argv);
+
+    fx_muxer_t muxer;
+    return muxer.execute(_X("keep-runtime"), argc, argv, startup_info, nullptr, 0, nullptr);
+}
+
+//
+// Shuts down the runtime kept by hostfxr_main_keep_runtime, if any.
+//
+// Return value:
+//   The latched exit code of the runtime, or 0 if no runtime was kept.
+//
+SHARED_API int hostfxr_shutdown_runtime()
+{
+    trace::setup();
+
+    trace::info(_X("--- Invoked hostfxr [commit hash: %s] hostfxr_shutdown_runtime"), _STRINGIFY(REPO_COMMIT_HASH));
+
+    return shutdown_kept_runtime();
+}
+
 // [OBSOLETE] Replaced by hostfxr_resolve_sdk2
 //
 // Determines the directory location of the SDK accounting for
@@ -514,3 +784,194 @@ SHARED_API int32_t hostfxr_get_native_search_directories(const int argc, const p
     int rc = muxer.execute(_X("get-native-search-directories"), argc, argv, startup_info, buffer, buffer_size, required_buffer_size);
     return rc;
 }
+
+//
+// Returns the properties that the host would initialize the runtime
+// with for the specified app, without starting the runtime.
+//
+// These are the resolved TRUSTED_PLATFORM_ASSEMBLIES,
+// NATIVE_DLL_SEARCH_DIRECTORIES, PLATFORM_RESOURCE_ROOTS, JIT_PATH,
+// FX_DEPS_FILE, PROBING_DIRECTORIES and the other host properties,
+// followed by the configProperties of the runtime config.
+//
+// Returned format is a sequence of null-terminated keys, each
+// followed by its null-terminated value, and then by a final null
+// terminator.
+//
+// Invoked by tools that prewarm an app at deploy time, e.g. by
+// reading the files of the TPA into the file system cache. The
+// resolution is persisted as for a launch of the app, so with
+// DOTNET_HOST_STARTUP_CACHE the first launch reuses it instead of
+// resolving again.
+//
+// Parameters:
+//    argc
+//      The number of argv arguments
+//
+//    argv
+//      The standard arguments normally passed to dotnet.exe
+//      for launching the application.
+//
+//    buffer
+//      The buffer where the properties and terminators will be
+//      written.
+//
+//    buffer_size
+//      The size of the buffer argument in pal::char_t units.
+//
+//    required_buffer_size
+//      If the return value is HostApiBufferTooSmall, then
+//      required_buffer_size is set to the minimium buffer
+//      size necessary to contain the result including the
+//      final null terminator.
+//
+// Return value:
+//   0 on success, otherwise failure
+//   0x80008098 - Buffer is too small (HostApiBufferTooSmall)
+//
+// String encoding:
+//   Windows     - UTF-16 (pal::char_t is 2 byte wchar_t)
+//   Unix        - UTF-8  (pal::char_t is 1 byte char)
+//
+SHARED_API int32_t hostfxr_get_runtime_properties(const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size)
+{
+    trace::setup();
+
+    trace::info(_X("--- Invoked hostfxr_get_runtime_properties [commit hash: %s] main"), _STRINGIFY(REPO_COMMIT_HASH));
+
+    if (buffer_size < 0 || (buffer_size > 0 && buffer == nullptr) || required_buffer_size == nullptr)
+    {
+        trace::error(_X("hostfxr_get_runtime_properties received an invalid argument."));
+        return InvalidArgFailure;
+    }
+
+    host_startup_info_t startup_info;
+    startup_info.parse(argc, argv);
+
+    fx_muxer_t muxer;
+    return muxer.execute(_X("get-runtime-properties"), argc, argv, startup_info, buffer, buffer_size, required_buffer_size);
+}
+
+//
+// Resolves the dependencies of a self-contained app and freezes them in
+// the "<app>.startupmanifest" file next to it, which later launches of
+// the app read instead of resolving again.
+//
+// Invoked as a publish step; launches never write the manifest. The
+// manifest is not written, and an existing one is not used, while a
+// servicing, additional probing or runtime store location is configured.
+//
+// Parameters:
+//    argc
+//      The number of argv arguments
+//
+//    argv
+//      The standard arguments normally passed to the app's executable
+//      for launching the application.
+//
+//    buffer
+//      The buffer where the path of the manifest will be written.
+//
+//    buffer_size
+//      The size of the buffer argument in pal::char_t units.
+//
+//    required_buffer_size
+//      If the return value is HostApiBufferTooSmall, then
+//      required_buffer_size is set to the minimium buffer
+//      size necessary to contain the result including the
+//      null terminator.
+//
+// Return value:
+//   0 on success, otherwise failure
+//   0x80008098 - Buffer is too small (HostApiBufferTooSmall)
+//   0x8000809d - The manifest could not be written (StartupManifestWriteFailure)
+//
+// String encoding:
+//   Windows     - UTF-16 (pal::char_t is 2 byte wchar_t)
+//   Unix        - UTF-8  (pal::char_t is 1 byte char)
+//
+SHARED_API int32_t hostfxr_write_startup_manifest(const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size)
+{
+    trace::setup();
+
+    trace::info(_X("--- Invoked hostfxr_write_startup_manifest [commit hash: %s] main"), _STRINGIFY(REPO_COMMIT_HASH));
+
+    if (buffer_size < 0 || (buffer_size > 0 && buffer == nullptr) || required_buffer_size == nullptr)
+    {
+        trace::error(_X("hostfxr_write_startup_manifest received an invalid argument."));
+        return InvalidArgFailure;
+    }
+
+    host_startup_info_t startup_info;
+    startup_info.parse(argc, argv);
+
+    fx_muxer_t muxer;
+    return muxer.execute(_X("write-startup-manifest"), argc, argv, startup_info, buffer, buffer_size, required_buffer_size);
+}
+
+//
+// Returns the counters and durations of the host startup in this process, for
+// monitoring agents that poll them once the app is running.
+//
+// The statistics of hostfxr are named "hostfxr/<name>". Those of the hostpolicy
+// running the app, or keeping a runtime for hostfxr_main_keep_runtime, follow
+// named "hostpolicy/<name>". They include the file system operations, files and
+// bytes read, framework versions considered, hits and misses of each kind of
+// probe, and the time spent resolving frameworks and dependencies and binding
+// and initializing CoreCLR, in microseconds. The values accumulate over the
+// life of the process.
+//
+// Parameters:
+//    result
+//      Callback invoked with the statistics. The arrays and their elements
+//      are valid for the duration of the call.
+//
+// Return value:
+//   0 on success, otherwise failure
+//
+// String encoding:
+//   Windows     - UTF-16 (pal::char_t is 2 byte wchar_t)
+//   Unix        - UTF-8  (pal::char_t is 1 byte char)
+//
+SHARED_API int32_t hostfxr_get_startup_stats(startup_stats_result_fn result)
+{
+    if (result == nullptr)
+    {
+        return StatusCode::InvalidArgFailure;
+    }
+
+    std::vector<const pal::char_t*> own_names;
+    std::vector<int64_t> own_values;
+    timing::get_stats(&own_names, &own_values);
+
+    std::vector<pal::string_t> names;
+    std::vector<int64_t> values;
+    for (size_t i = 0; i < own_names.size(); ++i)
+    {
+        names.push_back(pal::string_t(_X("hostfxr/")) + own_names[i]);
+        values.push_back(own_values[i]);
+    }
+
+    {
+        // Held while hostpolicy reports, so that it is not unloaded meanwhile.
+        std::lock_guard<std::mutex> lock(g_host_stats_lock);
+        if (g_host_stats != nullptr)
+        {
+            g_host_stats_names = &names;
+            g_host_stats_values = &values;
+            (void)g_host_stats(append_host_stats);
+            g_host_stats_names = nullptr;
+            g_host_stats_values = nullptr;
+        }
+    }
+
+    std::vector<const pal::char_t*> names_cstr;
+    names_cstr.reserve(names.size());
+    for (const auto& name : names)
+    {
+        names_cstr.push_back(name.c_str());
+    }
+
+    result((int32_t)names_cstr.size(), names_cstr.data(), values.data());
+    return StatusCode::Success;
+}
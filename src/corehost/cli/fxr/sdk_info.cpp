@@ -2,6 +2,7 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <cassert>
+#include "fx_version_catalog.h"
 #include "pal.h"
 #include "sdk_info.h"
 #include "trace.h"
@@ -76,23 +77,19 @@ void sdk_info::get_all_sdk_infos(
 
         if (pal::directory_exists(base_dir))
         {
-            std::vector<pal::string_t> versions;
-            pal::readdir_onlydirectories(base_dir, &versions);
-            for (const auto& ver : versions)
+            // The catalog only holds the version-numbered folders.
+            fx_version_catalog_t::versions_t versions = fx_version_catalog_t::get_versions(base_dir);
+            for (const auto& parsed : *versions)
             {
-                // Make sure we filter out any non-version folders.
-                fx_ver_t parsed(-1, -1, -1);
-                if (fx_ver_t::parse(ver, &parsed, false))
-                {
-                    trace::verbose(_X("Found SDK version [%s]"), ver.c_str());
+                pal::string_t ver = parsed.as_str();
+                trace::verbose(_X("Found SDK version [%s]"), ver.c_str());
 
-                    auto full_dir = base_dir;
-                    append_path(&full_dir, ver.c_str());
+                auto full_dir = base_dir;
+                append_path(&full_dir, ver.c_str());
 
-                    sdk_info info(base_dir, full_dir, parsed, hive_depth);
+                sdk_info info(base_dir, full_dir, parsed, hive_depth);
 
-                    sdk_infos->push_back(info);
-                }
+                sdk_infos->push_back(info);
             }
         }
 
@@ -4,7 +4,9 @@
 #include "sdk_resolver.h"
 
 #include "cpprest/json.h"
+#include "fx_resolution_cache.h"
 #include "fx_ver.h"
+#include "fx_version_catalog.h"
 #include "trace.h"
 #include "utils.h"
 
@@ -87,26 +89,31 @@ pal::string_t resolve_sdk_version(pal::string_t sdk_path, bool disallow_prerelea
     trace::verbose(_X("--- Resolving SDK version from SDK dir [%s]"), sdk_path.c_str());
 
     pal::string_t retval;
-    std::vector<pal::string_t> versions;
-
-    pal::readdir_onlydirectories(sdk_path, &versions);
+    // The versions are sorted, so the first one that qualifies from the end is the greatest.
+    fx_version_catalog_t::versions_t versions = fx_version_catalog_t::get_versions(sdk_path);
     fx_ver_t max_ver(-1, -1, -1);
-    for (const auto& version : versions)
+    for (auto iter = versions->rbegin(); iter != versions->rend(); ++iter)
     {
-        trace::verbose(_X("Considering version... [%s]"), version.c_str());
+        const fx_ver_t& ver = *iter;
+        if (trace::is_enabled(trace::level_t::verbose))
+        {
+            trace::verbose(_X("Considering version... [%s]"), ver.as_str().c_str());
+        }
 
-        fx_ver_t ver(-1, -1, -1);
-        if (fx_ver_t::parse(version, &ver, disallow_prerelease))
+        if (disallow_prerelease && (ver.is_prerelease() || ver.has_build()))
         {
-            if (global_cli_version.empty() ||
-                // If a global cli version is specified:
-                //   pick the greatest version that differs only in the 'minor-patch'
-                //   and is semantically greater than or equal to the global cli version specified.
-                (ver.get_major() == specified.get_major() && ver.get_minor() == specified.get_minor() &&
-                (ver.get_patch() / 100) == (specified.get_patch() / 100) && ver >= specified))
-            {
-                max_ver = std::max(ver, max_ver);
-            }
+            continue;
+        }
+
+        if (global_cli_version.empty() ||
+            // If a global cli version is specified:
+            //   pick the greatest version that differs only in the 'minor-patch'
+            //   and is semantically greater than or equal to the global cli version specified.
+            (ver.get_major() == specified.get_major() && ver.get_minor() == specified.get_minor() &&
+            (ver.get_patch() / 100) == (specified.get_patch() / 100) && ver >= specified))
+        {
+            max_ver = ver;
+            break;
         }
     }
 
@@ -162,6 +169,59 @@ bool sdk_resolver_t::resolve_sdk_dotnet_path(
     bool disallow_prerelease,
     pal::string_t* global_json_path)
 {
+    std::vector<pal::string_t> hive_dir;
+    std::vector<pal::string_t> global_dirs;
+    bool multilevel_lookup = multilevel_lookup_enabled();
+
+    pal::string_t dotnet_root_temp;
+    if (!dotnet_root.empty())
+    {
+        // dotnet_root contains DIR_SEPARATOR appended that we need to remove.
+        dotnet_root_temp = dotnet_root;
+        remove_trailing_dir_seperator(&dotnet_root_temp);
+        hive_dir.push_back(dotnet_root_temp);
+    }
+
+    if (multilevel_lookup && pal::get_global_dotnet_dirs(&global_dirs))
+    {
+        for (pal::string_t dir : global_dirs)
+        {
+            // Avoid duplicate of dotnet_root_temp
+            if (!pal::are_paths_equal_with_normalized_casing(dir, dotnet_root_temp))
+            {
+                hive_dir.push_back(dir);
+            }
+        }
+    }
+
+    // A result is reused only while every global.json probed on the way up from the working
+    // directory (found or not) and the sdk directories of the hives are unchanged.
+    fx_resolution_cache_t cache(dotnet_root);
+    pal::string_t cache_request;
+    std::vector<pal::string_t> cache_inputs;
+    if (cache.is_enabled())
+    {
+        pal::stringstream_t request;
+        request << _X("sdk|") << cwd << _X("|") << disallow_prerelease;
+        for (const auto& dir : hive_dir)
+        {
+            request << _X("|") << dir;
+        }
+        cache_request = request.str();
+
+        std::vector<pal::string_t> cached;
+        if (cache.try_get(cache_request, &cached) && cached.size() == 2 && pal::directory_exists(cached[0]))
+        {
+            trace::verbose(_X("Found CLI SDK in: %s from the framework resolution cache"), cached[0].c_str());
+            cli_sdk->assign(cached[0]);
+            if (global_json_path != nullptr && !cached[1].empty())
+            {
+                global_json_path->assign(cached[1]);
+            }
+            return true;
+        }
+    }
+
     pal::string_t global;
 
     if (!cwd.empty())
@@ -170,6 +230,7 @@ bool sdk_resolver_t::resolve_sdk_dotnet_path(
         {
             pal::string_t file = cur_dir;
             append_path(&file, _X("global.json"));
+            cache_inputs.push_back(file);
 
             trace::verbose(_X("Probing path [%s] for global.json"), file.c_str());
             if (pal::file_exists(file))
@@ -187,80 +248,85 @@ bool sdk_resolver_t::resolve_sdk_dotnet_path(
         }
     }
 
-    std::vector<pal::string_t> hive_dir;
-    std::vector<pal::string_t> global_dirs;
-    bool multilevel_lookup = multilevel_lookup_enabled();
+    pal::string_t cli_version;
+    pal::string_t sdk_path;
+    pal::string_t global_cli_version;
 
-    pal::string_t dotnet_root_temp;
-    if (!dotnet_root.empty())
+    if (!global.empty())
     {
-        // dotnet_root contains DIR_SEPARATOR appended that we need to remove.
-        dotnet_root_temp = dotnet_root;
-        remove_trailing_dir_seperator(&dotnet_root_temp);
-        hive_dir.push_back(dotnet_root_temp);
+        global_cli_version = resolve_cli_version(global);
     }
 
-    if (multilevel_lookup && pal::get_global_dotnet_dirs(&global_dirs))
+    // With parallel probing the hives are searched concurrently, the results are merged in order
+    // either way, see fx_muxer_t::resolve_fx.
+    struct hive_result_t
     {
-        for (pal::string_t dir : global_dirs)
+        pal::string_t sdk_path;
+        bool global_version_exists;
+        pal::string_t new_cli_version;
+    };
+
+    std::vector<hive_result_t> hive_results(hive_dir.size());
+    std::vector<std::function<void()>> hive_searches;
+    for (size_t i = 0; i < hive_dir.size(); ++i)
+    {
+        hive_searches.push_back([&, i]()
         {
-            // Avoid duplicate of dotnet_root_temp
-            if (!pal::are_paths_equal_with_normalized_casing(dir, dotnet_root_temp))
+            hive_result_t& result = hive_results[i];
+            trace::verbose(_X("Searching SDK directory in [%s]"), hive_dir[i].c_str());
+            result.sdk_path = hive_dir[i];
+            append_path(&result.sdk_path, _X("sdk"));
+
+            result.global_version_exists = false;
+            if (!global_cli_version.empty())
             {
-                hive_dir.push_back(dir);
+                pal::string_t probing_sdk_path = result.sdk_path;
+                append_path(&probing_sdk_path, global_cli_version.c_str());
+                result.global_version_exists = pal::directory_exists(probing_sdk_path);
             }
-        }
-    }
 
-    pal::string_t cli_version;
-    pal::string_t sdk_path;
-    pal::string_t global_cli_version;
+            if (!result.global_version_exists)
+            {
+                result.new_cli_version = resolve_sdk_version(result.sdk_path, disallow_prerelease, global_cli_version);
+            }
+        });
+    }
 
-    if (!global.empty())
+    if (parallel_probing_enabled() && hive_searches.size() > 1)
     {
-        global_cli_version = resolve_cli_version(global);
+        run_concurrently(hive_searches);
+    }
+    else
+    {
+        for (const auto& search : hive_searches)
+        {
+            search();
+        }
     }
 
-    for (pal::string_t dir : hive_dir)
+    for (const auto& result : hive_results)
     {
-        trace::verbose(_X("Searching SDK directory in [%s]"), dir.c_str());
-        pal::string_t current_sdk_path = dir;
-        append_path(&current_sdk_path, _X("sdk"));
+        cache_inputs.push_back(result.sdk_path);
 
-        if (global_cli_version.empty())
+        if (!global_cli_version.empty() && global_json_path != nullptr)
         {
-            pal::string_t new_cli_version = resolve_sdk_version(current_sdk_path, disallow_prerelease, global_cli_version);
-            if (higher_sdk_version(new_cli_version, &cli_version))
-            {
-                sdk_path = current_sdk_path;
-            }
+            global_json_path->assign(global);
         }
-        else
-        {
-            if (global_json_path != nullptr)
-            {
-                global_json_path->assign(global);
-            }
 
-            pal::string_t probing_sdk_path = current_sdk_path;
+        if (result.global_version_exists)
+        {
+            pal::string_t probing_sdk_path = result.sdk_path;
             append_path(&probing_sdk_path, global_cli_version.c_str());
+            trace::verbose(_X("CLI directory [%s] from global.json exists"), probing_sdk_path.c_str());
+            cli_version = global_cli_version;
+            sdk_path = result.sdk_path;
+            //  Use the first matching version
+            break;
+        }
 
-            if (pal::directory_exists(probing_sdk_path))
-            {
-                trace::verbose(_X("CLI directory [%s] from global.json exists"), probing_sdk_path.c_str());
-                cli_version = global_cli_version;
-                sdk_path = current_sdk_path;
-                //  Use the first matching version
-                break;
-            }
-            else
-            {
-                pal::string_t new_cli_version = resolve_sdk_version(current_sdk_path, disallow_prerelease, global_cli_version);
-                if (higher_sdk_version(new_cli_version, &cli_version))
-                {
-                    sdk_path = current_sdk_path;
-                }
-            }
+        if (higher_sdk_version(result.new_cli_version, &cli_version))
+        {
+            sdk_path = result.sdk_path;
         }
     }
 
@@ -269,6 +335,9 @@ bool sdk_resolver_t::resolve_sdk_dotnet_path(
         append_path(&sdk_path, cli_version.c_str());
         cli_sdk->assign(sdk_path);
         trace::verbose(_X("Found CLI SDK in: %s"), cli_sdk->c_str());
+
+        cache.set(cache_request, cache_inputs, { sdk_path, global_cli_version.empty() ? pal::string_t() : global });
+        cache.save();
         return true;
     }
 
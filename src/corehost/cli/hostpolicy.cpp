@@ -4,6 +4,7 @@
 #include "pal.h"
 #include "args.h"
 #include "trace.h"
+#include "timing.h"
 #include "deps_resolver.h"
 #include "fx_muxer.h"
 #include "utils.h"
@@ -12,49 +13,438 @@
 #include "libhost.h"
 #include "error_codes.h"
 #include "breadcrumbs.h"
+#include "host_env.h"
 #include "host_startup_info.h"
+#include "startup_cache.h"
 
+#include <mutex>
+#include <thread>
+#include <system_error>
+
+// The state handed over by corehost_load to the corehost_main* call that follows it. Hosts that
+// call from several threads at once use corehost_main_with_init instead, which does not share it.
 hostpolicy_init_t g_init;
 
-int run(const arguments_t& args, pal::string_t* out_host_command_result = nullptr)
+namespace
 {
-    // Load the deps resolver
-    deps_resolver_t resolver(g_init, args);
+    // CoreCLR is expected in the root framework, or next to a self-contained app. The deps may
+    // still place it elsewhere, so this is only used to get a head start on loading it.
+    pal::string_t get_expected_clr_dir(const hostpolicy_init_t& init, const arguments_t& args)
+    {
+        if (init.is_framework_dependent && !init.fx_definitions.empty())
+        {
+            return get_root_framework(init.fx_definitions).get_dir();
+        }
+
+        return args.app_root;
+    }
 
-    pal::string_t resolver_errors;
-    if (!resolver.valid(&resolver_errors))
+    // Starts reading the runtime images from disk so that the reads overlap with the resolution.
+    void readahead_runtime(const pal::string_t& clr_dir)
     {
-        trace::error(_X("Error initializing the dependency resolver: %s"), resolver_errors.c_str());
-        return StatusCode::ResolverInitFailure;
+        timing::phase_t phase(_X("hostpolicy/readahead_runtime"));
+
+        const pal::char_t* const images[] = { LIBCORECLR_NAME, LIBCLRJIT_NAME, CORELIB_NAME };
+        for (const pal::char_t* image : images)
+        {
+            pal::string_t path = clr_dir;
+            append_path(&path, image);
+            if (pal::readahead_file(path))
+            {
+                trace::verbose(_X("Requested readahead of [%s]"), path.c_str());
+            }
+        }
     }
 
+    bool early_bind_enabled()
+    {
+        return host_env::is_enabled(host_env::early_coreclr_bind);
+    }
+
+    /**
+     * Binds CoreCLR from the expected directory on a worker thread while the dependencies
+     * are resolved. The binding is kept only if the resolved CoreCLR is the expected one;
+     * otherwise it is undone and CoreCLR is bound as usual.
+     */
+    class early_bind_t
+    {
+    public:
+        early_bind_t() : m_bound(false) { }
+        ~early_bind_t() { join(); }
+
+        void start(const pal::string_t& clr_dir)
+        {
+            m_clr_dir = clr_dir;
+            if (!pal::realpath(&m_clr_dir, true))
+            {
+                return;
+            }
+
+            try
+            {
+                m_thread = std::thread([this]() { m_bound = coreclr::bind(m_clr_dir); });
+            }
+            catch (const std::system_error&)
+            {
+                trace::verbose(_X("Failed to start a thread to bind CoreCLR, it will be bound after resolution"));
+            }
+        }
+
+        // Returns whether CoreCLR from 'clr_dir' is bound.
+        bool finish(const pal::string_t& clr_dir)
+        {
+            join();
+            if (!m_bound)
+            {
+                return false;
+            }
+
+            pal::string_t resolved_dir = clr_dir;
+            remove_trailing_dir_seperator(&resolved_dir);
+            if (!pal::are_paths_equal_with_normalized_casing(m_clr_dir, resolved_dir))
+            {
+                trace::verbose(_X("CoreCLR was bound early from '%s' but resolved to '%s', rebinding"), m_clr_dir.c_str(), clr_dir.c_str());
+                coreclr::unload();
+                m_bound = false;
+                return false;
+            }
+
+            trace::verbose(_X("CoreCLR was bound early from '%s'"), m_clr_dir.c_str());
+            return true;
+        }
+
+    private:
+        void join()
+        {
+            if (m_thread.joinable())
+            {
+                m_thread.join();
+            }
+        }
+
+        pal::string_t m_clr_dir;
+        bool m_bound;
+        std::thread m_thread;
+    };
+
+    int resolve_dependencies(hostpolicy_init_t& init, const arguments_t& args, bool breadcrumbs_enabled, bool native_only, bool probed_paths_needed, startup_cache_entry_t* resolved)
+    {
+        timing::phase_t phase(_X("hostpolicy/resolve_dependencies"), timing::resolve_dependencies_us);
+
+        // Load the deps resolver
+        deps_resolver_t resolver(init, args);
+
+        pal::string_t resolver_errors;
+        if (!resolver.valid(&resolver_errors))
+        {
+            trace::error(_X("Error initializing the dependency resolver: %s"), resolver_errors.c_str());
+            return StatusCode::ResolverInitFailure;
+        }
+
+        if (native_only)
+        {
+            return resolver.resolve_native_probe_paths(&resolved->probe_paths) ? 0 : StatusCode::ResolverResolveFailure;
+        }
+
+        if (breadcrumbs_enabled)
+        {
+            pal::string_t policy_name = _STRINGIFY(HOST_POLICY_PKG_NAME);
+            pal::string_t policy_version = _STRINGIFY(HOST_POLICY_PKG_VER);
+
+            // Always insert the hostpolicy that the code is running on.
+            resolved->breadcrumbs.insert(policy_name);
+            resolved->breadcrumbs.insert(policy_name + _X(",") + policy_version);
+
+            if (!resolver.resolve_probe_paths(&resolved->probe_paths, &resolved->breadcrumbs))
+            {
+                return StatusCode::ResolverResolveFailure;
+            }
+        }
+        else
+        {
+            if (!resolver.resolve_probe_paths(&resolved->probe_paths, nullptr))
+            {
+                return StatusCode::ResolverResolveFailure;
+            }
+        }
+
+        if (resolver.get_fx_definitions().size() >= 2)
+        {
+            // Use the root fx to define FX_DEPS_FILE
+            resolved->fx_deps_file = get_root_framework(resolver.get_fx_definitions()).get_deps_file();
+        }
+
+        // Get all deps files
+        for (int i = 0; i < resolver.get_fx_definitions().size(); ++i)
+        {
+            resolved->deps_files += resolver.get_fx_definitions()[i]->get_deps_file();
+            if (i < resolver.get_fx_definitions().size() - 1)
+            {
+                resolved->deps_files += _X(";");
+            }
+        }
+
+        resolved->probe_directories = resolver.get_lookup_probe_directories();
+
+        if (resolver.is_framework_dependent())
+        {
+            resolved->clr_library_version = get_root_framework(resolver.get_fx_definitions()).get_found_version();
+        }
+        else
+        {
+            resolved->clr_library_version = resolver.get_coreclr_library_version();
+        }
+
+        // Only a resolution that is persisted needs to tell what it depends on.
+        if (probed_paths_needed)
+        {
+            resolver.get_probed_paths(&resolved->probed_paths);
+        }
+
+        return 0;
+    }
+    // Frees the memory held by the value, which clear() keeps around for reuse.
+    template <typename T>
+    void release(T* value)
+    {
+        T released;
+        std::swap(*value, released);
+    }
+
+    // The app and framework models, with their deps and runtime config, are only needed to resolve the app.
+    void release_resolution_state(hostpolicy_init_t& init)
+    {
+        release(&init.cfg_keys);
+        release(&init.cfg_values);
+        release(&init.additional_deps_serialized);
+        release(&init.probe_paths);
+        release(&init.fx_definitions);
+    }
+
+    int execute_app(const arguments_t& args, coreclr::host_handle_t host_handle, coreclr::domain_id_t domain_id, unsigned int* exit_code)
+    {
+        // Initialize clr strings for arguments
+        std::vector<std::vector<char>> argv_strs(args.app_argc);
+        std::vector<const char*> argv(args.app_argc);
+        for (int i = 0; i < args.app_argc; i++)
+        {
+            pal::pal_clrstring(args.app_argv[i], &argv_strs[i]);
+            argv[i] = argv_strs[i].data();
+        }
+
+        if (trace::is_enabled())
+        {
+            pal::string_t arg_str;
+            for (int i = 0; i < argv.size(); i++)
+            {
+                pal::string_t cur;
+                pal::clr_palstring(argv[i], &cur);
+                arg_str.append(cur);
+                arg_str.append(_X(","));
+            }
+            trace::info(_X("Launch host: %s, app: %s, argc: %d, args: %s"), args.host_path.c_str(),
+                args.managed_application.c_str(), args.app_argc, arg_str.c_str());
+        }
+
+        std::vector<char> managed_app;
+        pal::pal_clrstring(args.managed_application, &managed_app);
+
+        // Previous hostpolicy trace messages must be printed before executing assembly
+        trace::flush();
+
+        // Execute the application
+        auto hr = coreclr::execute_assembly(
+            host_handle,
+            domain_id,
+            argv.size(),
+            argv.data(),
+            managed_app.data(),
+            exit_code);
+
+        if (!SUCCEEDED(hr))
+        {
+            trace::error(_X("Failed to execute managed app, HRESULT: 0x%X"), hr);
+            return StatusCode::CoreClrExeFailure;
+        }
+
+        return 0;
+    }
+
+    typedef std::vector<std::pair<pal::string_t, pal::string_t>> properties_t;
+
+    /**
+     * A runtime that corehost_main_keep_runtime leaves initialized after executing the first app,
+     * so that later apps are executed in it without initializing CoreCLR again. It keeps the
+     * properties, and so the trusted assemblies, of the first app; later apps have to resolve to
+     * the same CoreCLR, frameworks and properties, and are checked once.
+     */
+    struct kept_runtime_t
+    {
+        kept_runtime_t() : initialized(false), host_handle(nullptr), domain_id(0) { }
+
+        bool initialized;
+        coreclr::host_handle_t host_handle;
+        coreclr::domain_id_t domain_id;
+        pal::string_t clr_path;
+        pal::string_t fx_deps_file;
+        properties_t properties;
+        std::unordered_set<pal::string_t> apps;
+    };
+
+    // Guards the kept runtime state; apps are executed outside of it so that they may re-enter.
+    std::mutex g_kept_runtime_lock;
+    kept_runtime_t g_kept_runtime;
+
+    pal::string_t get_kept_app_key(const arguments_t& args)
+    {
+        return args.managed_application + PATH_SEPARATOR + args.deps_path;
+    }
+
+    const pal::string_t* find_property(const properties_t& properties, const pal::string_t& key)
+    {
+        for (const auto& property : properties)
+        {
+            if (property.first == key)
+            {
+                return &property.second;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // The path lists are compared as sets, their order depends on the order of resolution.
+    bool are_property_values_equal(const pal::string_t& key, const pal::string_t& value, const pal::string_t& kept_value)
+    {
+        if (key != _X("TRUSTED_PLATFORM_ASSEMBLIES") &&
+            key != _X("NATIVE_DLL_SEARCH_DIRECTORIES") &&
+            key != _X("PLATFORM_RESOURCE_ROOTS") &&
+            key != _X("APP_PATHS"))
+        {
+            return value == kept_value;
+        }
+
+        std::unordered_set<pal::string_t> paths[2];
+        const pal::string_t* values[] = { &value, &kept_value };
+        for (int i = 0; i < 2; ++i)
+        {
+            pal::string_t path;
+            pal::stringstream_t ss(*values[i]);
+            while (std::getline(ss, path, PATH_SEPARATOR))
+            {
+                if (!path.empty())
+                {
+                    paths[i].insert(path);
+                }
+            }
+        }
+
+        return paths[0] == paths[1];
+    }
+
+    // Checks that the properties of an app not executed in the kept runtime before, the trusted
+    // assemblies and the native and resource search paths included, are those the runtime was
+    // initialized with; its dependencies are only found through them.
+    int check_kept_runtime(const arguments_t& args, const properties_t& properties, const kept_runtime_t& kept_runtime)
+    {
+        const properties_t* sets[] = { &properties, &kept_runtime.properties };
+        for (const properties_t* set : sets)
+        {
+            for (const auto& property : *set)
+            {
+                const pal::string_t* value = find_property(properties, property.first);
+                const pal::string_t* kept_value = find_property(kept_runtime.properties, property.first);
+                if (value == nullptr || kept_value == nullptr || !are_property_values_equal(property.first, *value, *kept_value))
+                {
+                    trace::error(_X("The app [%s] resolves the property [%s] to [%s], it cannot be executed in the running runtime which has it set to [%s]"),
+                        args.managed_application.c_str(), property.first.c_str(), value == nullptr ? _X("") : value->c_str(), kept_value == nullptr ? _X("") : kept_value->c_str());
+                    return StatusCode::KeptRuntimeMismatch;
+                }
+            }
+        }
+
+        return 0;
+    }
+}
+
+int run(hostpolicy_init_t& init, const arguments_t& args, pal::string_t* out_host_command_result = nullptr, kept_runtime_t* kept_runtime = nullptr)
+{
+    // An app executed in a kept runtime is only resolved, to check it against the runtime.
+    bool kept_runtime_check = kept_runtime != nullptr && kept_runtime->initialized;
+
     // Setup breadcrumbs. Breadcrumbs are not enabled for API calls because they do not execute
     // the app and may be re-entry
-    probe_paths_t probe_paths;
-    std::unordered_set<pal::string_t> breadcrumbs;
-    bool breadcrumbs_enabled = (out_host_command_result == nullptr);
+    bool breadcrumbs_enabled = (out_host_command_result == nullptr) && !kept_runtime_check;
+
+    // Covers the hostpolicy startup, up to executing the app.
+    timing::phase_t run_phase(_X("hostpolicy/run"));
+
+    // The same directories are canonicalized many times while resolving the dependencies.
+    realpath_cache_scope_t realpath_cache;
+
+    // API calls do not start the runtime.
+    early_bind_t early_bind;
     if (breadcrumbs_enabled)
     {
-        pal::string_t policy_name = _STRINGIFY(HOST_POLICY_PKG_NAME);
-        pal::string_t policy_version = _STRINGIFY(HOST_POLICY_PKG_VER);
+        pal::string_t expected_clr_dir = get_expected_clr_dir(init, args);
+        readahead_runtime(expected_clr_dir);
+        if (early_bind_enabled())
+        {
+            early_bind.start(expected_clr_dir);
+        }
+    }
+
+    // Native search directories do not need the managed assets, so only the native ones are
+    // resolved for them; a full startup that populated the startup cache is reused as well.
+    bool native_search_dirs_only = pal::strcasecmp(init.host_command.c_str(), _X("get-native-search-directories")) == 0;
 
-        // Always insert the hostpolicy that the code is running on.
-        breadcrumbs.insert(policy_name);
-        breadcrumbs.insert(policy_name + _X(",") + policy_version);
+    // The runtime properties are computed ahead of launches to prewarm them, so their resolution
+    // is persisted like that of an app launch for the launches to reuse.
+    bool runtime_properties_only = kept_runtime_check || pal::strcasecmp(init.host_command.c_str(), _X("get-runtime-properties")) == 0;
+    bool persist_resolution = breadcrumbs_enabled || runtime_properties_only;
+
+    // The startup manifest is written at publish time from a fresh resolution, with the
+    // breadcrumbs that launches would write.
+    startup_cache_entry_t resolved;
+    startup_manifest_t startup_manifest(init, args);
+    if (pal::strcasecmp(init.host_command.c_str(), _X("write-startup-manifest")) == 0)
+    {
+        int rc = resolve_dependencies(init, args, true, false, false, &resolved);
+        if (rc != 0)
+        {
+            return rc;
+        }
 
-        if (!resolver.resolve_probe_paths(&probe_paths, &breadcrumbs))
+        if (!startup_manifest.write(resolved))
         {
-            return StatusCode::ResolverResolveFailure;
+            return StatusCode::StartupManifestWriteFailure;
         }
+
+        assert(out_host_command_result != nullptr);
+        *out_host_command_result = startup_manifest.get_file();
+        return 0;
     }
-    else
+
+    if (!startup_manifest.try_read(&resolved))
     {
-        if (!resolver.resolve_probe_paths(&probe_paths, nullptr))
+        startup_cache_t startup_cache(init, args);
+
+        // Only app launches and prewarming collect breadcrumbs, so only they may populate the cache.
+        if (!startup_cache.try_read(&resolved) && !(persist_resolution && startup_cache.try_read_or_lock(&resolved)))
         {
-            return StatusCode::ResolverResolveFailure;
+            int rc = resolve_dependencies(init, args, persist_resolution, native_search_dirs_only, persist_resolution && startup_cache.is_enabled(), &resolved);
+            if (rc != 0)
+            {
+                return rc;
+            }
+
+            startup_cache.write(resolved);
         }
     }
 
+    probe_paths_t& probe_paths = resolved.probe_paths;
+    std::unordered_set<pal::string_t>& breadcrumbs = resolved.breadcrumbs;
+
     pal::string_t clr_path = probe_paths.coreclr;
     if (clr_path.empty() || !pal::realpath(&clr_path))
     {
@@ -62,6 +452,22 @@ int run(const arguments_t& args, pal::string_t* out_host_command_result = nullpt
         return StatusCode::CoreClrResolveFailure;
     }
 
+    if (native_search_dirs_only)
+    {
+        assert(out_host_command_result != nullptr);
+        *out_host_command_result = probe_paths.native;
+        return 0;
+    }
+
+    if (kept_runtime_check &&
+        (!pal::are_paths_equal_with_normalized_casing(clr_path, kept_runtime->clr_path) ||
+         !pal::are_paths_equal_with_normalized_casing(resolved.fx_deps_file, kept_runtime->fx_deps_file)))
+    {
+        trace::error(_X("The app [%s] uses CoreCLR [%s] and framework [%s], it cannot be executed in the running runtime from [%s] and framework [%s]"),
+            args.managed_application.c_str(), clr_path.c_str(), resolved.fx_deps_file.c_str(), kept_runtime->clr_path.c_str(), kept_runtime->fx_deps_file.c_str());
+        return StatusCode::HostRuntimeIncompatible;
+    }
+
     // Get path in which CoreCLR is present.
     pal::string_t clr_dir = get_directory(clr_path);
 
@@ -70,7 +476,9 @@ int run(const arguments_t& args, pal::string_t* out_host_command_result = nullpt
     append_path(&corelib_path, CORELIB_NAME);
 
     // Append CoreLib path
-    if (probe_paths.tpa.back() != PATH_SEPARATOR)
+    probe_paths.tpa.reserve(probe_paths.tpa.size() + corelib_path.size() + 2);
+    // The TPA is empty if lazy TPA mode left out every assembly.
+    if (!probe_paths.tpa.empty() && probe_paths.tpa.back() != PATH_SEPARATOR)
     {
         probe_paths.tpa.push_back(PATH_SEPARATOR);
     }
@@ -107,130 +515,147 @@ int run(const arguments_t& args, pal::string_t* out_host_command_result = nullpt
         "FX_PRODUCT_VERSION"
     };
 
-    // Note: these variables' lifetime should be longer than coreclr_initialize.
-    std::vector<char> tpa_paths_cstr, app_base_cstr, native_dirs_cstr, resources_dirs_cstr, fx_deps, deps, clrjit_path_cstr, probe_directories, clr_library_version;
-    pal::pal_clrstring(probe_paths.tpa, &tpa_paths_cstr);
-    pal::pal_clrstring(args.app_root, &app_base_cstr);
-    pal::pal_clrstring(probe_paths.native, &native_dirs_cstr);
-    pal::pal_clrstring(probe_paths.resources, &resources_dirs_cstr);
-
-    pal::string_t fx_deps_str;
-    if (resolver.get_fx_definitions().size() >= 2)
-    {
-        // Use the root fx to define FX_DEPS_FILE
-        fx_deps_str = get_root_framework(resolver.get_fx_definitions()).get_deps_file();
-    }
-    pal::pal_clrstring(fx_deps_str, &fx_deps);
-
-    // Get all deps files
-    pal::string_t allDeps;
-    for (int i = 0; i < resolver.get_fx_definitions().size(); ++i)
+    // Note: the buffer's lifetime should be longer than coreclr_initialize. All resolved strings are
+    // transcoded into it at once, and passed as they are where the CLR encoding matches. The
+    // transcoded values are looked up by these indices, in the order of resolved_values.
+    enum resolved_value_index_t
     {
-        allDeps += resolver.get_fx_definitions()[i]->get_deps_file();
-        if (i < resolver.get_fx_definitions().size() - 1)
-        {
-            allDeps += _X(";");
-        }
-    }
-    pal::pal_clrstring(allDeps, &deps);
-
-    pal::pal_clrstring(resolver.get_lookup_probe_directories(), &probe_directories);
-
-    if (resolver.is_framework_dependent())
-    {
-        pal::pal_clrstring(get_root_framework(resolver.get_fx_definitions()).get_found_version() , &clr_library_version);
-    }
-    else
-    {
-        pal::pal_clrstring(resolver.get_coreclr_library_version(), &clr_library_version);
-    }
+        app_base_index,
+        tpa_index,
+        native_index,
+        resources_index,
+        deps_files_index,
+        fx_deps_file_index,
+        probe_directories_index,
+        clr_library_version_index,
+        clrjit_path_index,
+        app_paths_index,
+        resolved_value_count
+    };
+    std::vector<const pal::string_t*> resolved_values = {
+        &args.app_root,
+        &probe_paths.tpa,
+        &probe_paths.native,
+        &probe_paths.resources,
+        &resolved.deps_files,
+        &resolved.fx_deps_file,
+        &resolved.probe_directories,
+        &resolved.clr_library_version,
+        &clrjit_path,
+        &probe_paths.app_paths
+    };
+    std::vector<char> clr_values_buffer;
+    std::vector<const char*> clr_values;
+    assert(resolved_values.size() == resolved_value_count);
+    pal::clr_cstrs(resolved_values, &clr_values_buffer, &clr_values);
+    const char* app_base = clr_values[app_base_index];
 
     std::vector<const char*> property_values = {
         // TRUSTED_PLATFORM_ASSEMBLIES
-        tpa_paths_cstr.data(),
+        clr_values[tpa_index],
         // NATIVE_DLL_SEARCH_DIRECTORIES
-        native_dirs_cstr.data(),
+        clr_values[native_index],
         // PLATFORM_RESOURCE_ROOTS
-        resources_dirs_cstr.data(),
+        clr_values[resources_index],
         // AppDomainCompatSwitch
         "UseLatestBehaviorWhenTFMNotSpecified",
         // APP_CONTEXT_BASE_DIRECTORY
-        app_base_cstr.data(),
+        app_base,
         // APP_CONTEXT_DEPS_FILES,
-        deps.data(),
+        clr_values[deps_files_index],
         // FX_DEPS_FILE
-        fx_deps.data(),
+        clr_values[fx_deps_file_index],
         //PROBING_DIRECTORIES
-        probe_directories.data(),
+        clr_values[probe_directories_index],
         //FX_PRODUCT_VERSION
-        clr_library_version.data()
+        clr_values[clr_library_version_index]
     };
 
     if (!clrjit_path.empty())
     {
-        pal::pal_clrstring(clrjit_path, &clrjit_path_cstr);
         property_keys.push_back("JIT_PATH");
-        property_values.push_back(clrjit_path_cstr.data());
+        property_values.push_back(clr_values[clrjit_path_index]);
     }
 
     bool set_app_paths = false;
 
     // Runtime options config properties.
-    for (int i = 0; i < g_init.cfg_keys.size(); ++i)
+    for (int i = 0; i < init.cfg_keys.size(); ++i)
     {
         // Provide opt-in compatible behavior by using the switch to set APP_PATHS
-        if (pal::cstrcasecmp(g_init.cfg_keys[i].data(), "Microsoft.NETCore.DotNetHostPolicy.SetAppPaths") == 0)
+        if (pal::cstrcasecmp(init.cfg_keys[i].data(), "Microsoft.NETCore.DotNetHostPolicy.SetAppPaths") == 0)
         {
-            set_app_paths = (pal::cstrcasecmp(g_init.cfg_values[i].data(), "true") == 0);
+            set_app_paths = (pal::cstrcasecmp(init.cfg_values[i].data(), "true") == 0);
         }
 
-        property_keys.push_back(g_init.cfg_keys[i].data());
-        property_values.push_back(g_init.cfg_values[i].data());
+        property_keys.push_back(init.cfg_keys[i].data());
+        property_values.push_back(init.cfg_values[i].data());
     }
 
-    // App paths and App NI paths
-    if (set_app_paths)
+    // App paths and App NI paths. In lazy TPA mode, the app paths are the directories in which
+    // the runtime looks for the assemblies left out of the TPA, the app's included.
+    if (set_app_paths || !probe_paths.app_paths.empty())
     {
         property_keys.push_back("APP_PATHS");
+        property_values.push_back(probe_paths.app_paths.empty() ? app_base : clr_values[app_paths_index]);
+    }
+
+    if (set_app_paths)
+    {
         property_keys.push_back("APP_NI_PATHS");
-        property_values.push_back(app_base_cstr.data());
-        property_values.push_back(app_base_cstr.data());
+        property_values.push_back(app_base);
     }
 
     size_t property_size = property_keys.size();
     assert(property_keys.size() == property_values.size());
 
-    unsigned int exit_code = 1;
-
-    // Check for host command(s)
-    if (pal::strcasecmp(g_init.host_command.c_str(), _X("get-native-search-directories")) == 0)
+    // The kept runtime is checked against, and keeps, the properties as the app resolved them.
+    properties_t properties;
+    if (kept_runtime != nullptr)
     {
-        // Verify property_keys[1] contains the correct information
-        if (pal::cstrcasecmp(property_keys[1], "NATIVE_DLL_SEARCH_DIRECTORIES"))
+        for (size_t i = 0; i < property_size; ++i)
         {
-            trace::error(_X("get-native-search-directories failed to find NATIVE_DLL_SEARCH_DIRECTORIES property"));
-            exit_code = HostApiFailed;
+            pal::string_t key, val;
+            pal::clr_palstring(property_keys[i], &key);
+            pal::clr_palstring(property_values[i], &val);
+            properties.emplace_back(key, val);
         }
-        else
+    }
+
+    if (kept_runtime_check)
+    {
+        return check_kept_runtime(args, properties, *kept_runtime);
+    }
+
+    if (runtime_properties_only)
+    {
+        // Each key and value is followed by a null character.
+        assert(out_host_command_result != nullptr);
+        out_host_command_result->clear();
+        for (size_t i = 0; i < property_size; ++i)
         {
-            assert(out_host_command_result != nullptr);
-            pal::clr_palstring(property_values[1], out_host_command_result);
-            exit_code = 0; // Success
+            pal::string_t key, val;
+            pal::clr_palstring(property_keys[i], &key);
+            pal::clr_palstring(property_values[i], &val);
+            trace::verbose(_X("Property %s = %s"), key.c_str(), val.c_str());
+            out_host_command_result->append(key).push_back(_X('\0'));
+            out_host_command_result->append(val).push_back(_X('\0'));
         }
-
-        return exit_code;
+        return 0;
     }
 
     // Bind CoreCLR
     trace::verbose(_X("CoreCLR path = '%s', CoreCLR dir = '%s'"), clr_path.c_str(), clr_dir.c_str());
-    if (!coreclr::bind(clr_dir))
+    timing::phase_t bind_phase(_X("hostpolicy/coreclr_bind"), timing::coreclr_bind_us);
+    if (!early_bind.finish(clr_dir) && !coreclr::bind(clr_dir))
     {
         trace::error(_X("Failed to bind to CoreCLR at '%s'"), clr_path.c_str());
         return StatusCode::CoreClrBindFailure;
     }
+    bind_phase.end();
 
     // Verbose logging
-    if (trace::is_enabled())
+    if (trace::is_enabled(trace::level_t::verbose))
     {
         for (size_t i = 0; i < property_size; ++i)
         {
@@ -247,6 +672,7 @@ int run(const arguments_t& args, pal::string_t* out_host_command_result = nullpt
     // Initialize CoreCLR
     coreclr::host_handle_t host_handle;
     coreclr::domain_id_t domain_id;
+    timing::phase_t initialize_phase(_X("hostpolicy/coreclr_initialize"), timing::coreclr_initialize_us);
     auto hr = coreclr::initialize(
         host_path.data(),
         "clrhost",
@@ -260,53 +686,46 @@ int run(const arguments_t& args, pal::string_t* out_host_command_result = nullpt
         trace::error(_X("Failed to initialize CoreCLR, HRESULT: 0x%X"), hr);
         return StatusCode::CoreClrInitFailure;
     }
-
-    // Initialize clr strings for arguments
-    std::vector<std::vector<char>> argv_strs(args.app_argc);
-    std::vector<const char*> argv(args.app_argc);
-    for (int i = 0; i < args.app_argc; i++)
-    {
-        pal::pal_clrstring(args.app_argv[i], &argv_strs[i]);
-        argv[i] = argv_strs[i].data();
-    }
-
-    if (trace::is_enabled())
-    {
-        pal::string_t arg_str;
-        for (int i = 0; i < argv.size(); i++)
-        {
-            pal::string_t cur;
-            pal::clr_palstring(argv[i], &cur);
-            arg_str.append(cur);
-            arg_str.append(_X(","));
-        }
-        trace::info(_X("Launch host: %s, app: %s, argc: %d, args: %s"), args.host_path.c_str(),
-            args.managed_application.c_str(), args.app_argc, arg_str.c_str());
-    }
-
-    std::vector<char> managed_app;
-    pal::pal_clrstring(args.managed_application, &managed_app);
+    initialize_phase.end();
 
     // Leave breadcrumbs for servicing.
     breadcrumb_writer_t writer(breadcrumbs_enabled, &breadcrumbs);
     writer.begin_write();
 
-    // Previous hostpolicy trace messages must be printed before executing assembly
-    trace::flush();
+    // CoreCLR copies the properties while initializing, so it does not reference anything the
+    // host resolved. Release it before the app executes rather than keep it for as long as the
+    // app runs; only the breadcrumbs are still used, by the writer.
+    release(&property_keys);
+    release(&property_values);
+    release(&clr_values);
+    release(&clr_values_buffer);
+    release(&host_path);
+    release(&resolved.probe_paths);
+    release(&resolved.deps_files);
+    release(&resolved.probe_directories);
+    release_resolution_state(init);
+    pal::trim_heap();
+
+    if (kept_runtime != nullptr)
+    {
+        // The caller executes the app, and any later ones, once the runtime is kept.
+        kept_runtime->initialized = true;
+        kept_runtime->host_handle = host_handle;
+        kept_runtime->domain_id = domain_id;
+        kept_runtime->clr_path = clr_path;
+        kept_runtime->fx_deps_file = resolved.fx_deps_file;
+        kept_runtime->properties = std::move(properties);
+        kept_runtime->apps.insert(get_kept_app_key(args));
+        return 0;
+    }
 
-    // Execute the application
-    hr = coreclr::execute_assembly(
-        host_handle,
-        domain_id,
-        argv.size(),
-        argv.data(),
-        managed_app.data(),
-        &exit_code);
+    run_phase.end();
 
-    if (!SUCCEEDED(hr))
+    unsigned int exit_code = 1;
+    int rc = execute_app(args, host_handle, domain_id, &exit_code);
+    if (rc != 0)
     {
-        trace::error(_X("Failed to execute managed app, HRESULT: 0x%X"), hr);
-        return StatusCode::CoreClrExeFailure;
+        return rc;
     }
 
     // Shut down the CoreCLR
@@ -320,7 +739,7 @@ int run(const arguments_t& args, pal::string_t* out_host_command_result = nullpt
 
     return exit_code;
 
-    // The breadcrumb destructor will join to the background thread to finish writing
+    // The breadcrumb destructor will wait for the background thread to finish writing
 }
 
 SHARED_API int corehost_load(host_interface_t* init)
@@ -338,7 +757,7 @@ SHARED_API int corehost_load(host_interface_t* init)
     return 0;
 }
 
-int corehost_main_init(const int argc, const pal::char_t* argv[], const pal::string_t location, arguments_t& args)
+int corehost_main_init(hostpolicy_init_t& init, const int argc, const pal::char_t* argv[], const pal::string_t location, arguments_t& args)
 {
     if (trace::is_enabled())
     {
@@ -356,21 +775,21 @@ int corehost_main_init(const int argc, const pal::char_t* argv[], const pal::str
         }
         trace::info(_X("}"));
 
-        trace::info(_X("Deps file: %s"), g_init.deps_file.c_str());
-        for (const auto& probe : g_init.probe_paths)
+        trace::info(_X("Deps file: %s"), init.deps_file.c_str());
+        for (const auto& probe : init.probe_paths)
         {
             trace::info(_X("Additional probe dir: %s"), probe.c_str());
         }
     }
 
     // Take care of arguments
-    if (!g_init.host_info.is_valid())
+    if (!init.host_info.is_valid())
     {
         // For backwards compat (older hostfxr), default the host_info
-        g_init.host_info.parse(argc, argv);
+        init.host_info.parse(argc, argv);
     }
 
-    if (!parse_arguments(g_init, argc, argv, &args))
+    if (!parse_arguments(init, argc, argv, &args))
     {
         return StatusCode::LibHostInvalidArgs;
     }
@@ -382,29 +801,34 @@ int corehost_main_init(const int argc, const pal::char_t* argv[], const pal::str
     return 0;
 }
 
-SHARED_API int corehost_main(const int argc, const pal::char_t* argv[])
+int run_app(hostpolicy_init_t& init, const int argc, const pal::char_t* argv[])
 {
     arguments_t args;
-    int rc = corehost_main_init(argc, argv, _X(""), args);
+    int rc = corehost_main_init(init, argc, argv, _X(""), args);
     if (!rc)
     {
-        rc = run(args);
+        rc = run(init, args);
     }
 
     return rc;
 }
 
-SHARED_API int corehost_main_with_output_buffer(const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size)
+int run_host_command(hostpolicy_init_t& init, const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size)
 {
     arguments_t args;
 
-    int rc = corehost_main_init(argc, argv, _X("corehost_main_with_output_buffer "), args);
+    int rc = corehost_main_init(init, argc, argv, _X("corehost_main_with_output_buffer "), args);
     if (!rc)
     {
-        if (g_init.host_command == _X("get-native-search-directories"))
+        // The runtime properties are written as null terminated keys and values, followed by
+        // the terminator of the result.
+        bool runtime_properties = pal::strcasecmp(init.host_command.c_str(), _X("get-runtime-properties")) == 0;
+        if (pal::strcasecmp(init.host_command.c_str(), _X("get-native-search-directories")) == 0 ||
+            pal::strcasecmp(init.host_command.c_str(), _X("write-startup-manifest")) == 0 ||
+            runtime_properties)
         {
             pal::string_t output_string;
-            rc = run(args, &output_string);
+            rc = run(init, args, &output_string);
             if (!rc)
             {
                 // Get length in character count not including null terminator
@@ -414,20 +838,20 @@ SHARED_API int corehost_main_with_output_buffer(const int argc, const pal::char_
                 {
                     rc = HostApiBufferTooSmall;
                     *required_buffer_size = len + 1;
-                    trace::info(_X("get-native-search-directories failed with buffer too small"), output_string.c_str());
+                    trace::info(_X("%s failed with buffer too small"), init.host_command.c_str());
                 }
                 else
                 {
                     output_string.copy(buffer, len);
                     buffer[len] = '\0';
                     *required_buffer_size = 0;
-                    trace::info(_X("get-native-search-directories success: %s"), output_string.c_str());
+                    trace::info(_X("%s success: %s"), init.host_command.c_str(), runtime_properties ? _X("") : output_string.c_str());
                 }
             }
         }
         else
         {
-            trace::error(_X("Unknown command: %s"), g_init.host_command.c_str());
+            trace::error(_X("Unknown command: %s"), init.host_command.c_str());
             rc = LibHostUnknownCommand;
         }
     }
@@ -435,7 +859,139 @@ SHARED_API int corehost_main_with_output_buffer(const int argc, const pal::char_
     return rc;
 }
 
+// Runs the app like run_app, but leaves the runtime initialized afterwards; if a runtime was
+// left by an earlier call, the app is executed in it instead. The runtime is kept until
+// corehost_shutdown_runtime, hostpolicy must stay loaded until then.
+int run_app_keep_runtime(hostpolicy_init_t& init, const int argc, const pal::char_t* argv[])
+{
+    arguments_t args;
+    int rc = corehost_main_init(init, argc, argv, _X("corehost_main_keep_runtime "), args);
+    if (rc)
+    {
+        return rc;
+    }
+
+    coreclr::host_handle_t host_handle;
+    coreclr::domain_id_t domain_id;
+    {
+        std::lock_guard<std::mutex> lock(g_kept_runtime_lock);
+        if (!g_kept_runtime.initialized)
+        {
+            rc = run(init, args, nullptr, &g_kept_runtime);
+        }
+        else
+        {
+            pal::string_t app_key = get_kept_app_key(args);
+            if (g_kept_runtime.apps.count(app_key) == 0)
+            {
+                rc = run(init, args, nullptr, &g_kept_runtime);
+                if (!rc)
+                {
+                    g_kept_runtime.apps.insert(app_key);
+                }
+            }
+            else
+            {
+                trace::verbose(_X("Reusing the running runtime for [%s]"), args.managed_application.c_str());
+            }
+        }
+
+        if (rc)
+        {
+            return rc;
+        }
+
+        host_handle = g_kept_runtime.host_handle;
+        domain_id = g_kept_runtime.domain_id;
+    }
+
+    unsigned int exit_code = 1;
+    rc = execute_app(args, host_handle, domain_id, &exit_code);
+    return rc ? rc : exit_code;
+}
+
+SHARED_API int corehost_main(const int argc, const pal::char_t* argv[])
+{
+    return run_app(g_init, argc, argv);
+}
+
+SHARED_API int corehost_main_with_output_buffer(const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size)
+{
+    return run_host_command(g_init, argc, argv, buffer, buffer_size, required_buffer_size);
+}
+
+SHARED_API int corehost_main_keep_runtime(const int argc, const pal::char_t* argv[])
+{
+    return run_app_keep_runtime(g_init, argc, argv);
+}
+
+// Does what corehost_load, the corehost_main* function for the host command and corehost_unload
+// do in turn, but in one call and with the state handed over kept local to it, so that hostfxr
+// may call it from several threads at once. The buffer is only used by the host commands that
+// return a result.
+SHARED_API int corehost_main_with_init(host_interface_t* init_data, const int argc, const pal::char_t* argv[], pal::char_t buffer[], int32_t buffer_size, int32_t* required_buffer_size)
+{
+    trace::setup();
+
+    hostpolicy_init_t init;
+    int rc;
+    if (!hostpolicy_init_t::init(init_data, &init))
+    {
+        rc = StatusCode::LibHostInitFailure;
+    }
+    else if (init.host_command.empty())
+    {
+        rc = run_app(init, argc, argv);
+    }
+    else if (init.host_command == _X("keep-runtime"))
+    {
+        rc = run_app_keep_runtime(init, argc, argv);
+    }
+    else
+    {
+        rc = run_host_command(init, argc, argv, buffer, buffer_size, required_buffer_size);
+    }
+
+    trace::close();
+    return rc;
+}
+
+// Shuts down a runtime kept by corehost_main_keep_runtime and returns its latched exit code.
+SHARED_API int corehost_shutdown_runtime()
+{
+    std::lock_guard<std::mutex> lock(g_kept_runtime_lock);
+    if (!g_kept_runtime.initialized)
+    {
+        return 0;
+    }
+
+    int exit_code = 0;
+    auto hr = coreclr::shutdown(g_kept_runtime.host_handle, g_kept_runtime.domain_id, &exit_code);
+    if (!SUCCEEDED(hr))
+    {
+        trace::warning(_X("Failed to shut down CoreCLR, HRESULT: 0x%X"), hr);
+    }
+
+    coreclr::unload();
+    g_kept_runtime = kept_runtime_t();
+
+    return exit_code;
+}
+
+// Returns the counters and durations hostpolicy has accumulated in this process, see timing::get_stats.
+SHARED_API int corehost_get_startup_stats(startup_stats_result_fn result)
+{
+    std::vector<const pal::char_t*> names;
+    std::vector<int64_t> values;
+    timing::get_stats(&names, &values);
+    result((int32_t)names.size(), names.data(), values.data());
+    return 0;
+}
+
 SHARED_API int corehost_unload()
 {
+    // Write out a buffered trace file before hostfxr continues tracing to it, and
+    // do not leak its handle when hostpolicy is unloaded.
+    trace::close();
     return 0;
 }
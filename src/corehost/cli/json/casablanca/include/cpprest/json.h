@@ -1931,6 +1931,105 @@ public:
     /// <param name="val">The JSON value object read from the stream.</param>
     /// <returns>The input stream object.</returns>
     _ASYNCRTIMP utility::istream_t& __cdecl operator >> (utility::istream_t &is, json::value &val);
+
+    namespace details
+    {
+        class _Reader;
+    }
+
+    /// <summary>
+    /// A forward-only reader that reports the tokens of a JSON document as they are scanned,
+    /// without materializing a tree of json::value objects.
+    /// </summary>
+    /// <remarks>
+    /// The reader validates the structure of the document and throws json_exception on malformed
+    /// input. Like value::parse, it uses the "C" locale on the calling thread while it is alive.
+    /// </remarks>
+    class reader
+    {
+    public:
+        enum class token
+        {
+            none,
+            begin_object,
+            end_object,
+            begin_array,
+            end_array,
+            property_name,
+            string,
+            number,
+            boolean,
+            null,
+            end_of_document
+        };
+
+        /// <summary>
+        /// Creates a reader over the contents of an input stream using the native platform character width.
+        /// </summary>
+        _ASYNCRTIMP reader(utility::istream_t &input);
+
+#ifdef _WIN32
+        /// <summary>
+        /// Creates a reader over the contents of a single-byte (UTF8) stream.
+        /// </summary>
+        _ASYNCRTIMP reader(std::istream &input);
+#endif
+
+        /// <summary>
+        /// Creates a reader over UTF8 text in memory, such as a mapped file.
+        /// </summary>
+        /// <remarks>
+        /// Strings without escape sequences are copied straight from the input, which must stay
+        /// valid for the lifetime of the reader.
+        /// </remarks>
+        _ASYNCRTIMP reader(const char *begin, const char *end);
+
+        _ASYNCRTIMP ~reader();
+
+        /// <summary>
+        /// Advances to the next token of the document.
+        /// </summary>
+        /// <returns>The kind of the token that was read.</returns>
+        _ASYNCRTIMP token read();
+
+        /// <summary>
+        /// Gets the kind of the current token.
+        /// </summary>
+        _ASYNCRTIMP token current() const;
+
+        /// <summary>
+        /// Gets the text of the current property name or string token.
+        /// </summary>
+        _ASYNCRTIMP const utility::string_t& as_string() const;
+
+        /// <summary>
+        /// Gets the value of the current boolean token.
+        /// </summary>
+        _ASYNCRTIMP bool as_bool() const;
+
+        /// <summary>
+        /// Gets the value of the current number token as an integer.
+        /// </summary>
+        _ASYNCRTIMP int as_integer() const;
+
+        /// <summary>
+        /// Skips the current value. On a property name this skips the value of the property;
+        /// on the start of an object or array this skips to its matching end.
+        /// </summary>
+        _ASYNCRTIMP void skip();
+
+        /// <summary>
+        /// Materializes the value that starts at the current token. On a property name this
+        /// reads the value of the property.
+        /// </summary>
+        _ASYNCRTIMP json::value read_value();
+
+    private:
+        reader(const reader&);
+        reader& operator=(const reader&);
+
+        std::unique_ptr<details::_Reader> m_impl;
+    };
 }}
 
 #endif
@@ -26,6 +26,11 @@
 #include "stdafx.h"
 #include <cstdlib>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#define JSON_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning(disable : 4127) // allow expressions like while(true) pass
 #endif
@@ -73,6 +78,101 @@ void SetErrorCode(Token &tk, json_error jsonErrorCode)
     tk.m_error = std::error_code(jsonErrorCode, json_error_category());
 }
 
+//
+// Bulk scanning of buffered input. The scanners only look for the characters that end a run;
+// whatever they stop at is handled by the regular per-character code.
+//
+
+template <typename CharType>
+inline bool IsAsciiWhitespace(CharType ch)
+{
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+template <typename CharType>
+inline bool IsPlainStringCharacter(CharType ch)
+{
+    return ch != '"' && ch != '\\' && !(ch >= CharType(0x0) && ch < CharType(0x20));
+}
+
+// Returns the first character in [p, end) that is not ASCII whitespace.
+template <typename CharType>
+const CharType* ScanWhitespace(const CharType* p, const CharType* end)
+{
+    while (p != end && IsAsciiWhitespace(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+// Returns the first quote, backslash or control character in [p, end).
+template <typename CharType>
+const CharType* ScanStringCharacters(const CharType* p, const CharType* end)
+{
+    while (p != end && IsPlainStringCharacter(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+#if defined(JSON_SCAN_SSE2)
+inline unsigned FirstSetBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// UTF8 input is scanned 16 bytes at a time; bytes of multi-byte sequences are never whitespace,
+// quotes, backslashes or control characters, so they need no special handling.
+inline const char* ScanWhitespace(const char* p, const char* end)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i tab_to_cr = _mm_set1_epi8('\r' - '\t');
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i offset = _mm_sub_epi8(chars, tab);
+        __m128i is_space = _mm_or_si128(
+            _mm_cmpeq_epi8(chars, space),
+            _mm_cmpeq_epi8(_mm_min_epu8(offset, tab_to_cr), offset));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(is_space)) ^ 0xffff;
+        if (mask != 0)
+        {
+            return p + FirstSetBit(mask);
+        }
+    }
+    return ScanWhitespace<char>(p, end);
+}
+
+inline const char* ScanStringCharacters(const char* p, const char* end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i last_control = _mm_set1_epi8(0x1f);
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(chars, last_control), chars));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (mask != 0)
+        {
+            return p + FirstSetBit(mask);
+        }
+    }
+    return ScanStringCharacters<char>(p, end);
+}
+#endif
+
 template <typename CharType>
 class JSON_Parser
 {
@@ -80,7 +180,8 @@ public:
     JSON_Parser()
         : m_currentLine(1),
           m_currentColumn(1),
-          m_currentParsingDepth(0)
+          m_currentParsingDepth(0),
+          m_stringSlices(false)
     { }
 
     struct Location
@@ -109,11 +210,16 @@ public:
             TKN_Comment
         };
 
-        Token() : kind(TKN_EOF) {}
+        Token() : kind(TKN_EOF), slice_begin(nullptr), slice_length(0) {}
 
         Kind kind;
         std::basic_string<CharType> string_val;
 
+        // With string slices enabled, a string literal without escapes is not copied to
+        // string_val; its text is [slice_begin, slice_begin + slice_length) of the input.
+        const CharType* slice_begin;
+        size_t slice_length;
+
         typename JSON_Parser<CharType>::Location start;
 
         union
@@ -132,6 +238,13 @@ public:
 
     void GetNextToken(Token &);
 
+    // Only parsers over contiguous input support slices; the input must outlive each token.
+    void EnableStringSlices() { m_stringSlices = true; }
+
+    // Consumes the rest of the object or array opened by 'open' without building tokens
+    // for its contents; on success 'result' is the matching close token.
+    void SkipContainer(CharType open, Token &);
+
     web::json::value ParseValue(typename JSON_Parser<CharType>::Token &first)
     {
 #ifndef _WIN32
@@ -156,6 +269,20 @@ protected:
     virtual bool CompleteStringLiteral(Token &token);
     bool handle_unescape_char(Token &token);
 
+    // Returns the input that is available without reading further, so that whitespace and
+    // string bodies can be scanned in bulk; the range is empty when nothing is buffered.
+    virtual void GetBufferedCharacters(const CharType** begin, const CharType** end)
+    {
+        *begin = *end = nullptr;
+    }
+
+    // Consumes the first 'count' characters returned by GetBufferedCharacters.
+    virtual void ConsumeBufferedCharacters(size_t) { }
+
+    // Consumes the buffered run of characters that need no handling inside a string literal,
+    // appending it to the token unless 'token' is null, and returns its length.
+    size_t ConsumeStringCharacters(Token *token);
+
 private:
 
     bool CompleteNumberLiteral(CharType first, Token &token);
@@ -176,6 +303,7 @@ private:
         tk.kind = kind;
         tk.start = start;
         tk.string_val.clear();
+        tk.slice_begin = nullptr;
     }
 
     void CreateToken(typename JSON_Parser<CharType>::Token& tk, typename Token::Kind kind)
@@ -184,6 +312,7 @@ private:
         tk.start.m_line = m_currentLine;
         tk.start.m_column = m_currentColumn;
         tk.string_val.clear();
+        tk.slice_begin = nullptr;
     }
 
 protected:
@@ -191,6 +320,7 @@ protected:
     size_t m_currentLine;
     size_t m_currentColumn;
     size_t m_currentParsingDepth;
+    bool m_stringSlices;
 
 // The DEBUG macro is defined in XCode but we don't in our CMakeList
 // so for now we will keep the same on debug and release. In the future
@@ -223,10 +353,32 @@ protected:
     virtual typename JSON_Parser<CharType>::int_type NextCharacter();
     virtual typename JSON_Parser<CharType>::int_type PeekCharacter();
 
+    virtual void GetBufferedCharacters(const CharType** begin, const CharType** end);
+    virtual void ConsumeBufferedCharacters(size_t count);
+
 private:
     typename std::basic_streambuf<CharType, std::char_traits<CharType>>* m_streambuf;
 };
 
+// The get area of a stream buffer is only exposed to derived classes; this reaches it through
+// member pointers named in a derived class, which is valid for any stream buffer.
+template <typename CharType>
+struct _Streambuf_access : std::basic_streambuf<CharType, std::char_traits<CharType>>
+{
+    typedef std::basic_streambuf<CharType, std::char_traits<CharType>> streambuf;
+
+    static void get_area(streambuf* buf, const CharType** begin, const CharType** end)
+    {
+        *begin = (buf->*(&_Streambuf_access::gptr))();
+        *end = (buf->*(&_Streambuf_access::egptr))();
+    }
+
+    static void consume(streambuf* buf, size_t count)
+    {
+        (buf->*(&_Streambuf_access::gbump))(static_cast<int>(count));
+    }
+};
+
 template <typename CharType>
 class JSON_StringParser : public JSON_Parser<CharType>
 {
@@ -238,11 +390,29 @@ public:
         m_endpos = m_position+string.size();
     }
 
+    JSON_StringParser(const CharType* begin, const CharType* end)
+        : m_position(begin),
+          m_startpos(begin),
+          m_endpos(end)
+    {
+    }
+
 protected:
 
     virtual typename JSON_Parser<CharType>::int_type NextCharacter();
     virtual typename JSON_Parser<CharType>::int_type PeekCharacter();
 
+    virtual void GetBufferedCharacters(const CharType** begin, const CharType** end)
+    {
+        *begin = m_position;
+        *end = m_endpos;
+    }
+
+    virtual void ConsumeBufferedCharacters(size_t count)
+    {
+        m_position += count;
+    }
+
     virtual bool CompleteComment(typename JSON_Parser<CharType>::Token &token);
     virtual bool CompleteStringLiteral(typename JSON_Parser<CharType>::Token &token);
 
@@ -278,6 +448,18 @@ typename JSON_Parser<CharType>::int_type JSON_StreamParser<CharType>::PeekCharac
     return m_streambuf->sgetc();
 }
 
+template <typename CharType>
+void JSON_StreamParser<CharType>::GetBufferedCharacters(const CharType** begin, const CharType** end)
+{
+    _Streambuf_access<CharType>::get_area(m_streambuf, begin, end);
+}
+
+template <typename CharType>
+void JSON_StreamParser<CharType>::ConsumeBufferedCharacters(size_t count)
+{
+    _Streambuf_access<CharType>::consume(m_streambuf, count);
+}
+
 template <typename CharType>
 typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::NextCharacter()
 {
@@ -314,6 +496,34 @@ typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::PeekCharac
 template <typename CharType>
 typename JSON_Parser<CharType>::int_type JSON_Parser<CharType>::EatWhitespace()
 {
+   // Skip the buffered whitespace in bulk, then let the loop below read the character that
+   // ended it (or refill the buffer).
+   while (true)
+   {
+       const CharType* begin;
+       const CharType* end;
+       GetBufferedCharacters(&begin, &end);
+       const CharType* p = ScanWhitespace(begin, end);
+       if (p == begin)
+       {
+           break;
+       }
+
+       const CharType* line_start = begin;
+       for (const CharType* nl = std::find(begin, p, '\n'); nl != p; nl = std::find(nl + 1, p, '\n'))
+       {
+           m_currentLine += 1;
+           line_start = nl + 1;
+       }
+       m_currentColumn = (line_start == begin ? m_currentColumn : 0) + (p - line_start);
+
+       ConsumeBufferedCharacters(p - begin);
+       if (p != end)
+       {
+           break;
+       }
+   }
+
    auto ch = NextCharacter();
 
    while ( ch != eof<CharType>() && iswspace(static_cast<wint_t>(ch)))
@@ -784,10 +994,32 @@ inline bool JSON_Parser<CharType>::handle_unescape_char(Token &token)
     }
 }
 
+template <typename CharType>
+size_t JSON_Parser<CharType>::ConsumeStringCharacters(Token *token)
+{
+    const CharType* begin;
+    const CharType* end;
+    GetBufferedCharacters(&begin, &end);
+    const size_t count = ScanStringCharacters(begin, end) - begin;
+    if (count != 0)
+    {
+        if (token != nullptr)
+        {
+            token->string_val.append(begin, count);
+        }
+
+        // String runs never contain a newline.
+        m_currentColumn += count;
+        ConsumeBufferedCharacters(count);
+    }
+    return count;
+}
+
 template <typename CharType>
 bool JSON_Parser<CharType>::CompleteStringLiteral(Token &token)
 {
     token.has_unescape_symbol = false;
+    ConsumeStringCharacters(&token);
     auto ch = NextCharacter();
     while ( ch != '"' )
     {
@@ -806,6 +1038,7 @@ bool JSON_Parser<CharType>::CompleteStringLiteral(Token &token)
 
             token.string_val.push_back(static_cast<CharType>(ch));
         }
+        ConsumeStringCharacters(&token);
         ch = NextCharacter();
     }
 
@@ -831,6 +1064,8 @@ bool JSON_StringParser<CharType>::CompleteStringLiteral(typename JSON_Parser<Cha
     auto start = m_position;
     token.has_unescape_symbol = false;
 
+    // Plain runs are copied along with the rest of the literal, so they are only skipped here.
+    this->ConsumeStringCharacters(nullptr);
     auto ch = JSON_StringParser<CharType>::NextCharacter();
 
     while (ch != '"')
@@ -856,17 +1091,106 @@ bool JSON_StringParser<CharType>::CompleteStringLiteral(typename JSON_Parser<Cha
             return false;
         }
 
+        this->ConsumeStringCharacters(nullptr);
         ch = JSON_StringParser<CharType>::NextCharacter();
     }
 
     const size_t numChars = m_position - start - 1;
-    token.string_val.append(start, numChars);
+    if (this->m_stringSlices && !token.has_unescape_symbol)
+    {
+        token.slice_begin = start;
+        token.slice_length = numChars;
+    }
+    else
+    {
+        token.string_val.append(start, numChars);
+    }
 
     token.kind = JSON_Parser<CharType>::Token::TKN_StringLiteral;
 
     return true;
 }
 
+template <typename CharType>
+void JSON_Parser<CharType>::SkipContainer(CharType open, typename JSON_Parser<CharType>::Token& result)
+{
+    // Only brackets, string literals (which may contain brackets) and comments matter here;
+    // everything else is consumed as-is. The nesting is bounded, so no allocation is needed.
+    bool in_object[JSON_Parser<CharType>::maxParsingDepth];
+    size_t depth = 0;
+    in_object[depth++] = open == '{';
+
+    CreateToken(result, Token::TKN_EOF);
+
+    while (depth > 0)
+    {
+        // Keep the location current so that errors point into the skipped value.
+        result.start.m_line = m_currentLine;
+        result.start.m_column = m_currentColumn;
+
+        auto ch = NextCharacter();
+        switch (ch)
+        {
+        case '{':
+        case '[':
+            if (++m_currentParsingDepth > JSON_Parser<CharType>::maxParsingDepth)
+            {
+                SetErrorCode(result, json_error::nesting);
+                return;
+            }
+            in_object[depth++] = ch == '{';
+            break;
+
+        case '}':
+        case ']':
+            if (in_object[--depth] != (ch == '}'))
+            {
+                SetErrorCode(result, json_error::mismatched_brances);
+                return;
+            }
+            --m_currentParsingDepth;
+            if (depth == 0)
+            {
+                CreateToken(result, ch == '}' ? Token::TKN_CloseBrace : Token::TKN_CloseBracket);
+            }
+            break;
+
+        case '"':
+            ConsumeStringCharacters(nullptr);
+            for (ch = NextCharacter(); ch != '"'; ConsumeStringCharacters(nullptr), ch = NextCharacter())
+            {
+                if (ch == '\\')
+                {
+                    ch = NextCharacter();
+                }
+                if (ch == eof<CharType>())
+                {
+                    SetErrorCode(result, json_error::malformed_string_literal);
+                    return;
+                }
+            }
+            break;
+
+        case '/':
+            if (!CompleteComment(result))
+            {
+                SetErrorCode(result, json_error::malformed_comment);
+                return;
+            }
+            result.kind = Token::TKN_EOF;
+            break;
+
+        default:
+            if (ch == eof<CharType>())
+            {
+                SetErrorCode(result, open == '{' ? json_error::malformed_object_literal : json_error::malformed_array_literal);
+                return;
+            }
+            break;
+        }
+    }
+}
+
 template <typename CharType>
 void JSON_Parser<CharType>::GetNextToken(typename JSON_Parser<CharType>::Token& result)
 {
@@ -1144,8 +1468,385 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(t
     }
 }
 
+//
+// JSON Reader
+//
+
+class _Reader
+{
+public:
+    _Reader()
+        : m_current(web::json::reader::token::none),
+          m_boolean(false)
+    { }
+
+    virtual ~_Reader() { }
+
+    virtual web::json::reader::token read() = 0;
+    virtual void skip_container() = 0;
+
+    web::json::reader::token current() const { return m_current; }
+    const utility::string_t& as_string() const { return m_string; }
+    bool as_bool() const { return m_boolean; }
+    const web::json::value& as_number() const { return m_number; }
+
+protected:
+    web::json::reader::token m_current;
+    utility::string_t m_string;
+    bool m_boolean;
+    web::json::value m_number;
+};
+
+#ifdef _WIN32
+inline void AssignSlice(utility::string_t& str, const char* begin, size_t length)
+{
+    str = utility::conversions::to_string_t(std::string(begin, length));
+}
+#endif
+
+inline void AssignSlice(utility::string_t& str, const utility::char_t* begin, size_t length)
+{
+    // Reuses the capacity of the previous string, so most tokens do not allocate.
+    str.assign(begin, length);
+}
+
+template <typename CharType, typename Parser = JSON_StreamParser<CharType>>
+class _Reader_impl : public _Reader
+{
+public:
+    _Reader_impl(std::basic_istream<CharType> &input)
+        : m_parser(input),
+          m_state(expect_value)
+    { }
+
+    _Reader_impl(const CharType* begin, const CharType* end)
+        : m_parser(begin, end),
+          m_state(expect_value)
+    {
+        m_parser.EnableStringSlices();
+    }
+
+    virtual web::json::reader::token read();
+    virtual void skip_container();
+
+private:
+    typedef typename JSON_Parser<CharType>::Token Token;
+
+    enum state
+    {
+        expect_value,
+        expect_first_property,
+        expect_property,
+        expect_first_element,
+        expect_separator,
+        done
+    };
+
+    void next_token()
+    {
+        m_parser.GetNextToken(m_tkn);
+        if (m_tkn.m_error)
+        {
+            CreateException(m_tkn, utility::conversions::to_string_t(m_tkn.m_error.message()));
+        }
+    }
+
+#if defined(_WIN32)
+    __declspec(noreturn)
+#else
+    __attribute__((noreturn))
+#endif
+    void fail(json_error error)
+    {
+        SetErrorCode(m_tkn, error);
+        CreateException(m_tkn, utility::conversions::to_string_t(m_tkn.m_error.message()));
+    }
+
+    void set_string(Token &tkn)
+    {
+        if (tkn.slice_begin != nullptr)
+        {
+            AssignSlice(m_string, tkn.slice_begin, tkn.slice_length);
+        }
+        else
+        {
+            m_string = utility::conversions::to_string_t(std::move(tkn.string_val));
+        }
+    }
+
+    web::json::reader::token produce(web::json::reader::token token, state next)
+    {
+        m_state = next;
+        m_current = token;
+        return token;
+    }
+
+    web::json::reader::token on_property();
+    web::json::reader::token on_value();
+    web::json::reader::token on_end();
+
+#ifndef _WIN32
+    utility::details::scoped_c_thread_locale m_locale;
+#endif
+    Parser m_parser;
+    Token m_tkn;
+    std::vector<bool> m_in_object;
+    state m_state;
+};
+
+template <typename CharType, typename Parser>
+web::json::reader::token _Reader_impl<CharType, Parser>::read()
+{
+    switch (m_state)
+    {
+    case expect_value:
+        next_token();
+        return on_value();
+
+    case expect_first_property:
+        next_token();
+        if (m_tkn.kind == Token::TKN_CloseBrace)
+        {
+            return on_end();
+        }
+        return on_property();
+
+    case expect_property:
+        next_token();
+        return on_property();
+
+    case expect_first_element:
+        next_token();
+        if (m_tkn.kind == Token::TKN_CloseBracket)
+        {
+            return on_end();
+        }
+        return on_value();
+
+    case expect_separator:
+        next_token();
+        if (m_in_object.empty())
+        {
+            if (m_tkn.kind != Token::TKN_EOF)
+            {
+                fail(json_error::left_over_character_in_stream);
+            }
+            return produce(web::json::reader::token::end_of_document, done);
+        }
+
+        if (m_tkn.kind == Token::TKN_Comma)
+        {
+            next_token();
+            return m_in_object.back() ? on_property() : on_value();
+        }
+
+        if ((m_in_object.back() && m_tkn.kind == Token::TKN_CloseBrace) ||
+            (!m_in_object.back() && m_tkn.kind == Token::TKN_CloseBracket))
+        {
+            return on_end();
+        }
+
+        fail(m_in_object.back() ? json_error::malformed_object_literal : json_error::malformed_array_literal);
+
+    case done:
+    default:
+        return produce(web::json::reader::token::end_of_document, done);
+    }
+}
+
+template <typename CharType, typename Parser>
+void _Reader_impl<CharType, Parser>::skip_container()
+{
+    // Only valid right after begin_object / begin_array, before any of the contents were read.
+    m_parser.SkipContainer(m_in_object.back() ? '{' : '[', m_tkn);
+    if (m_tkn.m_error)
+    {
+        CreateException(m_tkn, utility::conversions::to_string_t(m_tkn.m_error.message()));
+    }
+    on_end();
+}
+
+template <typename CharType, typename Parser>
+web::json::reader::token _Reader_impl<CharType, Parser>::on_property()
+{
+    if (m_tkn.kind != Token::TKN_StringLiteral)
+    {
+        fail(json_error::malformed_object_literal);
+    }
+    set_string(m_tkn);
+
+    next_token();
+    if (m_tkn.kind != Token::TKN_Colon)
+    {
+        fail(json_error::malformed_object_literal);
+    }
+
+    return produce(web::json::reader::token::property_name, expect_value);
+}
+
+template <typename CharType, typename Parser>
+web::json::reader::token _Reader_impl<CharType, Parser>::on_value()
+{
+    switch (m_tkn.kind)
+    {
+    case Token::TKN_OpenBrace:
+        m_in_object.push_back(true);
+        return produce(web::json::reader::token::begin_object, expect_first_property);
+
+    case Token::TKN_OpenBracket:
+        m_in_object.push_back(false);
+        return produce(web::json::reader::token::begin_array, expect_first_element);
+
+    case Token::TKN_StringLiteral:
+        set_string(m_tkn);
+        return produce(web::json::reader::token::string, expect_separator);
+
+    case Token::TKN_IntegerLiteral:
+        m_number = m_tkn.signed_number ? web::json::value(m_tkn.int64_val) : web::json::value(m_tkn.uint64_val);
+        return produce(web::json::reader::token::number, expect_separator);
+
+    case Token::TKN_NumberLiteral:
+        m_number = web::json::value(m_tkn.double_val);
+        return produce(web::json::reader::token::number, expect_separator);
+
+    case Token::TKN_BooleanLiteral:
+        m_boolean = m_tkn.boolean_val;
+        return produce(web::json::reader::token::boolean, expect_separator);
+
+    case Token::TKN_NullLiteral:
+        return produce(web::json::reader::token::null, expect_separator);
+
+    default:
+        fail(json_error::malformed_token);
+    }
+}
+
+template <typename CharType, typename Parser>
+web::json::reader::token _Reader_impl<CharType, Parser>::on_end()
+{
+    bool in_object = m_in_object.back();
+    m_in_object.pop_back();
+    return produce(in_object ? web::json::reader::token::end_object : web::json::reader::token::end_array, expect_separator);
+}
+
 }}}
 
+web::json::reader::reader(utility::istream_t &input)
+    : m_impl(new web::json::details::_Reader_impl<utility::char_t>(input))
+{
+}
+
+#ifdef _WIN32
+web::json::reader::reader(std::istream &input)
+    : m_impl(new web::json::details::_Reader_impl<char>(input))
+{
+}
+#endif
+
+web::json::reader::reader(const char *begin, const char *end)
+    : m_impl(new web::json::details::_Reader_impl<char, web::json::details::JSON_StringParser<char>>(begin, end))
+{
+}
+
+web::json::reader::~reader()
+{
+}
+
+web::json::reader::token web::json::reader::read()
+{
+    return m_impl->read();
+}
+
+web::json::reader::token web::json::reader::current() const
+{
+    return m_impl->current();
+}
+
+const utility::string_t& web::json::reader::as_string() const
+{
+    if (current() != token::string && current() != token::property_name)
+    {
+        throw web::json::json_exception(_XPLATSTR("The current token is not a string"));
+    }
+    return m_impl->as_string();
+}
+
+bool web::json::reader::as_bool() const
+{
+    if (current() != token::boolean)
+    {
+        throw web::json::json_exception(_XPLATSTR("The current token is not a boolean"));
+    }
+    return m_impl->as_bool();
+}
+
+int web::json::reader::as_integer() const
+{
+    if (current() != token::number)
+    {
+        throw web::json::json_exception(_XPLATSTR("The current token is not a number"));
+    }
+    return m_impl->as_number().as_integer();
+}
+
+void web::json::reader::skip()
+{
+    if (current() == token::property_name)
+    {
+        read();
+    }
+
+    if (current() != token::begin_object && current() != token::begin_array)
+    {
+        return;
+    }
+
+    m_impl->skip_container();
+}
+
+web::json::value web::json::reader::read_value()
+{
+    if (current() == token::property_name)
+    {
+        read();
+    }
+
+    switch (current())
+    {
+    case token::begin_object:
+        {
+            auto result = web::json::value::object();
+            while (read() != token::end_object)
+            {
+                utility::string_t name = m_impl->as_string();
+                read();
+                result[name] = read_value();
+            }
+            return result;
+        }
+    case token::begin_array:
+        {
+            auto result = web::json::value::array();
+            size_t index = 0;
+            while (read() != token::end_array)
+            {
+                result[index++] = read_value();
+            }
+            return result;
+        }
+    case token::string:
+        return web::json::value(m_impl->as_string());
+    case token::number:
+        return m_impl->as_number();
+    case token::boolean:
+        return web::json::value(m_impl->as_bool());
+    case token::null:
+        return web::json::value::null();
+    default:
+        throw web::json::json_exception(_XPLATSTR("The current token does not start a value"));
+    }
+}
+
 static web::json::value _parse_stream(utility::istream_t &stream)
 {
     web::json::details::JSON_StreamParser<utility::char_t> parser(stream);
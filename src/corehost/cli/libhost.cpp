@@ -6,6 +6,22 @@
 #include "trace.h"
 #include "libhost.h"
 #include "host_startup_info.h"
+#include "host_env.h"
+
+namespace
+{
+    // In production mode, set with DOTNET_HOST_PRODUCTION_MODE=1, the deployment is locked
+    // down and never has a runtimeconfig.dev.json; it is not looked for, and neither are the
+    // probing paths it would add.
+    void apply_production_mode(pal::string_t* dev_cfg)
+    {
+        if (host_env::is_enabled(host_env::production_mode))
+        {
+            trace::verbose(_X("Production mode, ignoring the dev runtime config %s"), dev_cfg->c_str());
+            dev_cfg->clear();
+        }
+    }
+}
 
 void get_runtime_config_paths_from_app(const pal::string_t& app, pal::string_t* cfg, pal::string_t* dev_cfg)
 {
@@ -32,6 +48,7 @@ void get_runtime_config_paths_from_arg(const pal::string_t& arg, pal::string_t*
 
     dev_cfg->assign(dev_json_path);
     cfg->assign(json_path);
+    apply_production_mode(dev_cfg);
 }
 
 void get_runtime_config_paths(const pal::string_t& path, const pal::string_t& name, pal::string_t* cfg, pal::string_t* dev_cfg)
@@ -47,6 +64,7 @@ void get_runtime_config_paths(const pal::string_t& path, const pal::string_t& na
     dev_cfg->assign(dev_json_path);
 
     trace::verbose(_X("Runtime config is cfg=%s dev=%s"), json_path.c_str(), dev_json_path.c_str());
+    apply_production_mode(dev_cfg);
 }
 
 host_mode_t detect_operating_mode(const host_startup_info_t& host_info)
@@ -82,7 +100,7 @@ void try_patch_roll_forward_in_dir(const pal::string_t& cur_dir, const fx_ver_t&
 {
     pal::string_t path = cur_dir;
 
-    if (trace::is_enabled())
+    if (trace::is_enabled(trace::level_t::verbose))
     {
         pal::string_t start_str = start_ver.as_str();
         trace::verbose(_X("Reading patch roll forward candidates in dir [%s] for version [%s]"), path.c_str(), start_str.c_str());
@@ -105,7 +123,7 @@ void try_patch_roll_forward_in_dir(const pal::string_t& cur_dir, const fx_ver_t&
     }
     max_str->assign(max_ver.as_str());
 
-    if (trace::is_enabled())
+    if (trace::is_enabled(trace::level_t::verbose))
     {
         pal::string_t start_str = start_ver.as_str();
         trace::verbose(_X("Patch roll forwarded [%s] -> [%s] in [%s]"), start_str.c_str(), max_str->c_str(), path.c_str());
@@ -116,7 +134,7 @@ void try_prerelease_roll_forward_in_dir(const pal::string_t& cur_dir, const fx_v
 {
     pal::string_t path = cur_dir;
 
-    if (trace::is_enabled())
+    if (trace::is_enabled(trace::level_t::verbose))
     {
         pal::string_t start_str = start_ver.as_str();
         trace::verbose(_X("Reading prerelease roll forward candidates in dir [%s] for version [%s]"), path.c_str(), start_str.c_str());
@@ -140,7 +158,7 @@ void try_prerelease_roll_forward_in_dir(const pal::string_t& cur_dir, const fx_v
     }
     max_str->assign(max_ver.as_str());
 
-    if (trace::is_enabled())
+    if (trace::is_enabled(trace::level_t::verbose))
     {
         pal::string_t start_str = start_ver.as_str();
         trace::verbose(_X("Prerelease roll forwarded [%s] -> [%s] in [%s]"), start_str.c_str(), max_str->c_str(), path.c_str());
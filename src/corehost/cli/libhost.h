@@ -9,6 +9,7 @@
 #include "runtime_config.h"
 #include "fx_definition.h"
 #include "fx_ver.h"
+#include "host_env.h"
 
 enum host_mode_t
 {
@@ -61,6 +62,8 @@ struct host_interface_t
     const pal::char_t* host_info_host_path;
     const pal::char_t* host_info_dotnet_root;
     const pal::char_t* host_info_app_path;
+    strarr_t host_env_names;
+    strarr_t host_env_values;
     // !! WARNING / WARNING / WARNING / WARNING / WARNING / WARNING / WARNING / WARNING / WARNING
     // !! 1. Only append to this structure to maintain compat.
     // !! 2. Any nested structs should not use compiler specific padding (pack with _HOST_INTERFACE_PACK)
@@ -94,11 +97,20 @@ static_assert(offsetof(host_interface_t, host_command) == 26 * sizeof(size_t), "
 static_assert(offsetof(host_interface_t, host_info_host_path) == 27 * sizeof(size_t), "Struct offset breaks backwards compatibility");
 static_assert(offsetof(host_interface_t, host_info_dotnet_root) == 28 * sizeof(size_t), "Struct offset breaks backwards compatibility");
 static_assert(offsetof(host_interface_t, host_info_app_path) == 29 * sizeof(size_t), "Struct offset breaks backwards compatibility");
-static_assert(sizeof(host_interface_t) == 30 * sizeof(size_t), "Did you add static asserts for the newly added fields?");
+static_assert(offsetof(host_interface_t, host_env_names) == 30 * sizeof(size_t), "Struct offset breaks backwards compatibility");
+static_assert(offsetof(host_interface_t, host_env_values) == 32 * sizeof(size_t), "Struct offset breaks backwards compatibility");
+static_assert(sizeof(host_interface_t) == 34 * sizeof(size_t), "Did you add static asserts for the newly added fields?");
 
 #define HOST_INTERFACE_LAYOUT_VERSION_HI 0x16041101 // YYMMDD:nn always increases when layout breaks compat.
 #define HOST_INTERFACE_LAYOUT_VERSION_LO sizeof(host_interface_t)
 
+// Receives the startup statistics of a host component as name and value pairs. The arrays
+// are valid for the duration of the call.
+typedef void (*startup_stats_result_fn)(
+    int32_t count,
+    const pal::char_t* names[],
+    const int64_t values[]);
+
 class corehost_init_t
 {
 private:
@@ -128,6 +140,8 @@ private:
     const pal::string_t m_host_info_host_path;
     const pal::string_t m_host_info_dotnet_root;
     const pal::string_t m_host_info_app_path;
+    std::vector<const pal::char_t*> m_host_env_names_cstr;
+    std::vector<const pal::char_t*> m_host_env_values_cstr;
 public:
     corehost_init_t(
         const pal::string_t& host_command,
@@ -168,10 +182,12 @@ public:
             m_fx_found_versions.push_back(fx->get_found_version());
         }
 
-        for (const auto& kv : combined_properties)
+        m_clr_keys.reserve(combined_properties.size());
+        m_clr_values.reserve(combined_properties.size());
+        for (auto& kv : combined_properties)
         {
             m_clr_keys.push_back(kv.first);
-            m_clr_values.push_back(kv.second);
+            m_clr_values.push_back(std::move(kv.second));
         }
 
         make_cstr_arr(m_fx_names, &m_fx_names_cstr);
@@ -180,6 +196,8 @@ public:
         make_cstr_arr(m_fx_found_versions, &m_fx_found_versions_cstr);
         make_cstr_arr(m_clr_keys, &m_clr_keys_cstr);
         make_cstr_arr(m_clr_values, &m_clr_values_cstr);
+
+        host_env::get_snapshot(&m_host_env_names_cstr, &m_host_env_values_cstr);
     }
 
     const pal::string_t& tfm() const
@@ -245,6 +263,11 @@ public:
         hi.host_info_dotnet_root = m_host_info_dotnet_root.c_str();
         hi.host_info_app_path = m_host_info_app_path.c_str();
 
+        hi.host_env_names.len = m_host_env_names_cstr.size();
+        hi.host_env_names.arr = m_host_env_names_cstr.data();
+        hi.host_env_values.len = m_host_env_values_cstr.size();
+        hi.host_env_values.arr = m_host_env_values_cstr.data();
+
         return hi;
     }
 
@@ -326,7 +349,6 @@ struct hostpolicy_init_t
             fx_requested_ver = input->fx_ver;
         }
 
-        int fx_count = 0;
         if (input->version_lo >= offsetof(host_interface_t, fx_names) + sizeof(input->fx_names))
         {
             int fx_count = input->fx_names.len;
@@ -391,6 +413,13 @@ struct hostpolicy_init_t
             // For the backwards compat case, this will be later initialized with argv[0]
         }
 
+        // An older hostfxr leaves hostpolicy to read the environment itself.
+        if (input->version_lo >= offsetof(host_interface_t, host_env_values) + sizeof(input->host_env_values))
+        {
+            assert(input->host_env_names.len == input->host_env_values.len);
+            host_env::set_snapshot(input->host_env_names.len, input->host_env_names.arr, input->host_env_values.arr);
+        }
+
         return true;
     }
 
@@ -3,11 +3,48 @@
 
 #include "pal.h"
 #include "trace.h"
+#include "timing.h"
+#include "host_env.h"
 #include "utils.h"
 #include "cpprest/json.h"
 #include "runtime_config.h"
 #include <cassert>
 
+namespace
+{
+    // Reads the "runtimeOptions" section of a runtimeconfig file. The rest of the
+    // document is validated while it is streamed but is not materialized.
+    bool read_runtime_options(const char* begin, const char* end, json_value* opts)
+    {
+        typedef web::json::reader::token json_token;
+
+        timing::increment(timing::files_parsed);
+
+        web::json::reader reader(begin, end);
+        if (reader.read() != json_token::begin_object)
+        {
+            throw web::json::json_exception(_X("not an object"));
+        }
+
+        bool found = false;
+        while (reader.read() == json_token::property_name)
+        {
+            if (reader.as_string() == _X("runtimeOptions"))
+            {
+                *opts = reader.read_value();
+                found = true;
+            }
+            else
+            {
+                reader.skip();
+            }
+        }
+
+        // Fails if anything follows the document.
+        reader.read();
+        return found;
+    }
+}
 
 // The semantics of applying the runtimeconfig.json values follows, in the following steps from
 // first to last, where last always wins. These steps are also annotated in the code here.
@@ -44,7 +81,7 @@ void runtime_config_t::parse(const pal::string_t& path, const pal::string_t& dev
         // Since there is no previous config, this is the app's config, so default m_roll_fwd_on_no_candidate_fx from the env variable.
         // The value will be overwritten during parsing if the setting exists in the config file.
         pal::string_t env_no_candidate;
-        if (pal::getenv(_X("DOTNET_ROLL_FORWARD_ON_NO_CANDIDATE_FX"), &env_no_candidate))
+        if (host_env::get(host_env::roll_forward_on_no_candidate_fx, &env_no_candidate))
         {
             m_roll_fwd_on_no_candidate_fx = static_cast<roll_fwd_on_no_candidate_fx_option>(pal::xtoi(env_no_candidate.c_str()));
             m_fx_global.set_roll_fwd_on_no_candidate_fx(m_roll_fwd_on_no_candidate_fx);
@@ -210,6 +247,12 @@ bool runtime_config_t::parse_framework(const json_object& fx_obj)
 
 bool runtime_config_t::ensure_dev_config_parsed()
 {
+    // There is no dev config to read in production mode.
+    if (m_dev_path.empty())
+    {
+        return true;
+    }
+
     trace::verbose(_X("Attempting to read dev runtime config: %s"), m_dev_path.c_str());
 
     pal::string_t retval;
@@ -219,26 +262,25 @@ bool runtime_config_t::ensure_dev_config_parsed()
         return true;
     }
 
-    pal::ifstream_t file(m_dev_path);
-    if (!file.good())
+    file_contents_t file;
+    if (!file.load(m_dev_path))
     {
         trace::verbose(_X("File stream not good %s"), m_dev_path.c_str());
         return false;
     }
 
-    if (skip_utf8_bom(&file))
+    const char* begin = file.begin();
+    if (skip_utf8_bom(&begin, file.end()))
     {
         trace::verbose(_X("UTF-8 BOM skipped while reading [%s]"), m_dev_path.c_str());
     }
     
     try
     {
-        const auto root = json_value::parse(file);
-        const auto& json = root.as_object();
-        const auto iter = json.find(_X("runtimeOptions"));
-        if (iter != json.end())
+        json_value opts;
+        if (read_runtime_options(begin, file.end(), &opts))
         {
-            parse_opts(iter->second);
+            parse_opts(opts);
         }
     }
     catch (const std::exception& je)
@@ -267,14 +309,15 @@ bool runtime_config_t::ensure_parsed(const runtime_config_t* app_config)
         return true;
     }
 
-    pal::ifstream_t file(m_path);
-    if (!file.good())
+    file_contents_t file;
+    if (!file.load(m_path))
     {
         trace::verbose(_X("File stream not good %s"), m_path.c_str());
         return false;
     }
 
-    if (skip_utf8_bom(&file))
+    const char* begin = file.begin();
+    if (skip_utf8_bom(&begin, file.end()))
     {
         trace::verbose(_X("UTF-8 BOM skipped while reading [%s]"), m_path.c_str());
     }
@@ -282,12 +325,10 @@ bool runtime_config_t::ensure_parsed(const runtime_config_t* app_config)
     bool rc = true;
     try
     {
-        const auto root = json_value::parse(file);
-        const auto& json = root.as_object();
-        const auto iter = json.find(_X("runtimeOptions"));
-        if (iter != json.end())
+        json_value opts;
+        if (read_runtime_options(begin, file.end(), &opts))
         {
-            rc = parse_opts(iter->second);
+            rc = parse_opts(opts);
 
             if (rc)
             {
@@ -295,7 +336,7 @@ bool runtime_config_t::ensure_parsed(const runtime_config_t* app_config)
                 {
                     // If there is no app_config yet, then we are the app
                     // Read the additionalFrameworks section so we can apply later when each framework's runtimeconfig is read
-                    const auto& opts_obj = iter->second.as_object();
+                    const auto& opts_obj = opts.as_object();
                     const auto iter = opts_obj.find(_X("additionalFrameworks"));
                     if (iter != opts_obj.end())
                     {
@@ -399,9 +440,7 @@ void runtime_config_t::combine_properties(std::unordered_map<pal::string_t, pal:
 {
     for (const auto& kv : m_properties)
     {
-        if (combined_properties.find(kv.first) == combined_properties.end())
-        {
-            combined_properties[kv.first] = kv.second;
-        }
+        // Does not replace an existing value, a single lookup either way.
+        combined_properties.emplace(kv.first, kv.second);
     }
 }
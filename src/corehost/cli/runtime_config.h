@@ -77,6 +77,14 @@ class runtime_config_t
 {
 public:
     runtime_config_t();
+
+    // Each layer is owned by its framework definition and the lower layers refer to it,
+    // so a config is moved at most and never copied.
+    runtime_config_t(const runtime_config_t&) = delete;
+    runtime_config_t& operator=(const runtime_config_t&) = delete;
+    runtime_config_t(runtime_config_t&&) = default;
+    runtime_config_t& operator=(runtime_config_t&&) = default;
+
     void parse(const pal::string_t& path, const pal::string_t& dev_path, const runtime_config_t* higher_layer_config, const runtime_config_t* app_config);
     bool is_valid() const { return m_valid; }
     const pal::string_t& get_path() const { return m_path; }
@@ -0,0 +1,836 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pal.h"
+#include "utils.h"
+#include "trace.h"
+#include "host_env.h"
+#include "startup_cache.h"
+
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    const char startup_cache_header[] = "dotnet-host-startup-cache-v3";
+    const char startup_cache_trailer[] = "end";
+
+    void write_line(std::ofstream& file, const pal::string_t& value)
+    {
+        std::vector<char> utf8;
+        pal::pal_utf8string(value, &utf8);
+        file << utf8.data() << '\n';
+    }
+
+    // Reads the lines of a cache file mapped in memory. The mapping shares the cached pages
+    // with every other process that reads the same cache.
+    class line_reader_t
+    {
+    public:
+        line_reader_t(const char* data, size_t length)
+            : m_pos(data)
+            , m_end(data + length) { }
+
+        bool get_line(std::string* line)
+        {
+            if (m_pos == m_end)
+            {
+                return false;
+            }
+
+            const char* eol = static_cast<const char*>(std::memchr(m_pos, '\n', m_end - m_pos));
+            const char* next = (eol == nullptr) ? m_end : eol + 1;
+            if (eol == nullptr)
+            {
+                eol = m_end;
+            }
+
+            // The file is written in text mode, which uses CRLF on Windows.
+            if (eol != m_pos && *(eol - 1) == '\r')
+            {
+                --eol;
+            }
+
+            line->assign(m_pos, eol);
+            m_pos = next;
+            return true;
+        }
+
+    private:
+        const char* m_pos;
+        const char* m_end;
+    };
+
+    bool read_line(line_reader_t& file, pal::string_t* value)
+    {
+        std::string line;
+        if (!file.get_line(&line))
+        {
+            return false;
+        }
+
+        return pal::utf8_palstring(line, value);
+    }
+
+    bool read_count(line_reader_t& file, size_t* count)
+    {
+        pal::string_t line;
+        unsigned num;
+        if (!read_line(file, &line) || !try_stou(line, &num))
+        {
+            return false;
+        }
+
+        *count = num;
+        return true;
+    }
+
+    pal::string_t format_stamp(const file_stamp_t& stamp)
+    {
+        if (!stamp.exists)
+        {
+            return pal::string_t();
+        }
+
+        pal::stringstream_t str;
+        str << stamp.last_write_time << _X("|") << stamp.size;
+        return str.str();
+    }
+
+    void write_probed_paths(std::ofstream& file, const std::vector<pal::string_t>& paths)
+    {
+        std::vector<file_stamp_t> stamps;
+        get_file_stamps(paths, &stamps);
+
+        file << paths.size() << '\n';
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            write_line(file, paths[i]);
+            write_line(file, format_stamp(stamps[i]));
+        }
+    }
+
+    // Reads the probed paths and checks that they are stamped the same as when they were written.
+    bool read_probed_paths(line_reader_t& file, const pal::string_t& cache_file, std::vector<pal::string_t>* paths)
+    {
+        size_t count = 0;
+        bool read = read_count(file, &count);
+
+        std::vector<pal::string_t> expected;
+        pal::string_t path, stamp;
+        for (size_t i = 0; read && i < count; ++i)
+        {
+            read = read_line(file, &path) && read_line(file, &stamp);
+            paths->push_back(path);
+            expected.push_back(stamp);
+        }
+
+        if (!read)
+        {
+            trace::verbose(_X("Startup cache [%s] is truncated"), cache_file.c_str());
+            return false;
+        }
+
+        std::vector<file_stamp_t> stamps;
+        get_file_stamps(*paths, &stamps);
+        for (size_t i = 0; i < stamps.size(); ++i)
+        {
+            pal::string_t stamp = format_stamp(stamps[i]);
+            if (stamp != expected[i])
+            {
+                trace::verbose(_X("Startup cache [%s] is stale, [%s] changed from [%s] to [%s]"),
+                    cache_file.c_str(), (*paths)[i].c_str(), expected[i].c_str(), stamp.c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+startup_cache_t::startup_cache_t(const hostpolicy_init_t& init, const arguments_t& args)
+    : m_lock_state(lock_state_t::none)
+    , m_lock()
+{
+    pal::string_t cache_dir;
+    if (!host_env::get(host_env::startup_cache, &cache_dir) || !pal::realpath(&cache_dir))
+    {
+        return;
+    }
+
+    add_key(_X("hostpolicy"), pal::string_t(_STRINGIFY(HOST_POLICY_PKG_VER)) + _X(",") + _STRINGIFY(REPO_COMMIT_HASH));
+    add_key(_X("host"), args.host_path);
+    add_key(_X("app"), args.managed_application);
+    add_key(_X("host_mode"), pal::to_string(init.host_mode));
+    add_key(_X("framework_dependent"), pal::to_string(init.is_framework_dependent));
+    add_key(_X("tfm"), init.tfm);
+    add_key(_X("additional_deps"), init.additional_deps_serialized);
+
+    pal::string_t rid;
+    (void) host_env::get(host_env::runtime_id, &rid);
+    add_key(_X("rid"), rid);
+    add_key(_X("lazy_tpa"), pal::to_string(host_env::is_enabled(host_env::lazy_tpa)));
+
+    add_file_key(_X("app_root"), args.app_root);
+
+    pal::string_t config_file, dev_config_file;
+    get_runtime_config_paths_from_app(args.managed_application, &config_file, &dev_config_file);
+    add_file_key(_X("runtime_config"), config_file);
+    add_file_key(_X("runtime_dev_config"), dev_config_file);
+
+    for (size_t i = 0; i < init.fx_definitions.size(); ++i)
+    {
+        const auto& fx = init.fx_definitions[i];
+        if (i == 0)
+        {
+            add_file_key(_X("deps"), args.deps_path);
+            continue;
+        }
+
+        pal::string_t fx_deps = fx->get_dir();
+        append_path(&fx_deps, (fx->get_name() + _X(".deps.json")).c_str());
+
+        add_key(_X("fx"), fx->get_name() + _X(",") + fx->get_found_version());
+        add_file_key(_X("fx_dir"), fx->get_dir());
+        add_file_key(_X("fx_deps"), fx_deps);
+    }
+
+    for (size_t i = 0; i < init.cfg_keys.size(); ++i)
+    {
+        pal::string_t key, value;
+        pal::clr_palstring(init.cfg_keys[i].data(), &key);
+        pal::clr_palstring(init.cfg_values[i].data(), &value);
+        add_key(_X("property"), key + _X("=") + value);
+    }
+
+    add_file_key(_X("servicing"), args.core_servicing);
+    for (const auto& probe : args.probe_paths)
+    {
+        add_file_key(_X("probe"), probe);
+    }
+    for (const auto& store : args.env_shared_store)
+    {
+        add_file_key(_X("env_store"), store);
+    }
+    add_file_key(_X("dotnet_store"), args.dotnet_shared_store);
+    for (const auto& store : args.global_shared_stores)
+    {
+        add_file_key(_X("global_store"), store);
+    }
+
+    stamp_file_keys();
+
+    // Different apps (or the same app through different deps files) get their own entries.
+    std::size_t hash = std::hash<pal::string_t>()(args.managed_application + PATH_SEPARATOR + args.deps_path);
+    pal::stringstream_t file_name;
+    file_name << get_filename(args.managed_application) << _X(".") << std::hex << hash << _X(".startupcache");
+
+    m_cache_file = cache_dir;
+    append_path(&m_cache_file, file_name.str().c_str());
+
+    trace::verbose(_X("Using startup cache file [%s]"), m_cache_file.c_str());
+}
+
+void startup_cache_t::add_key(const pal::char_t* name, const pal::string_t& value)
+{
+    m_key.push_back(pal::string_t(name) + _X("=") + value);
+}
+
+void startup_cache_t::add_file_key(const pal::char_t* name, const pal::string_t& path)
+{
+    // The stamp is added by stamp_file_keys, together with those of the other files.
+    m_file_keys.push_back(m_key.size());
+    m_file_paths.push_back(path);
+    add_key(name, path + _X("|"));
+}
+
+void startup_cache_t::stamp_file_keys()
+{
+    std::vector<file_stamp_t> stamps;
+    get_file_stamps(m_file_paths, &stamps);
+
+    for (size_t i = 0; i < stamps.size(); ++i)
+    {
+        m_key[m_file_keys[i]].append(format_stamp(stamps[i]));
+    }
+}
+
+bool startup_cache_t::try_read(startup_cache_entry_t* entry) const
+{
+    if (!is_enabled())
+    {
+        return false;
+    }
+
+    size_t length;
+    const void* mapping = pal::map_file_readonly(m_cache_file, &length);
+    if (mapping == nullptr)
+    {
+        trace::verbose(_X("Startup cache [%s] does not exist"), m_cache_file.c_str());
+        return false;
+    }
+
+    bool read = read_mapped(static_cast<const char*>(mapping), length, entry);
+    pal::unmap_file(mapping, length);
+    return read;
+}
+
+bool startup_cache_t::read_mapped(const char* data, size_t length, startup_cache_entry_t* entry) const
+{
+    line_reader_t file(data, length);
+    std::string header;
+    if (!file.get_line(&header) || header != startup_cache_header)
+    {
+        trace::verbose(_X("Startup cache [%s] has an unknown format"), m_cache_file.c_str());
+        return false;
+    }
+
+    size_t key_count;
+    if (!read_count(file, &key_count) || key_count != m_key.size())
+    {
+        trace::verbose(_X("Startup cache [%s] is stale"), m_cache_file.c_str());
+        return false;
+    }
+
+    pal::string_t line;
+    for (const auto& key : m_key)
+    {
+        if (!read_line(file, &line) || line != key)
+        {
+            trace::verbose(_X("Startup cache [%s] is stale, expected [%s] but found [%s]"), m_cache_file.c_str(), key.c_str(), line.c_str());
+            return false;
+        }
+    }
+
+    startup_cache_entry_t result;
+    if (!read_probed_paths(file, m_cache_file, &result.probed_paths))
+    {
+        return false;
+    }
+
+    size_t breadcrumb_count;
+    if (!read_line(file, &result.probe_paths.tpa) ||
+        !read_line(file, &result.probe_paths.app_paths) ||
+        !read_line(file, &result.probe_paths.native) ||
+        !read_line(file, &result.probe_paths.resources) ||
+        !read_line(file, &result.probe_paths.coreclr) ||
+        !read_line(file, &result.probe_paths.clrjit) ||
+        !read_line(file, &result.fx_deps_file) ||
+        !read_line(file, &result.deps_files) ||
+        !read_line(file, &result.probe_directories) ||
+        !read_line(file, &result.clr_library_version) ||
+        !read_count(file, &breadcrumb_count))
+    {
+        trace::verbose(_X("Startup cache [%s] is truncated"), m_cache_file.c_str());
+        return false;
+    }
+
+    for (size_t i = 0; i < breadcrumb_count; ++i)
+    {
+        if (!read_line(file, &line))
+        {
+            trace::verbose(_X("Startup cache [%s] is truncated"), m_cache_file.c_str());
+            return false;
+        }
+        result.breadcrumbs.insert(line);
+    }
+
+    // The trailer guards against reading a cache that is still being written.
+    std::string trailer;
+    if (!file.get_line(&trailer) || trailer != startup_cache_trailer)
+    {
+        trace::verbose(_X("Startup cache [%s] is truncated"), m_cache_file.c_str());
+        return false;
+    }
+
+    // The cached coreclr must still be there; everything else is validated by the key.
+    if (!coreclr_exists_in_dir(get_directory(result.probe_paths.coreclr)))
+    {
+        trace::verbose(_X("Startup cache [%s] refers to a missing CoreCLR [%s]"), m_cache_file.c_str(), result.probe_paths.coreclr.c_str());
+        return false;
+    }
+
+    *entry = std::move(result);
+    trace::verbose(_X("Using probe paths from startup cache [%s]"), m_cache_file.c_str());
+    return true;
+}
+
+bool startup_cache_t::try_read_or_lock(startup_cache_entry_t* entry)
+{
+    if (!is_enabled())
+    {
+        return false;
+    }
+
+    // Concurrent launches of the same app wait for the one that holds the lock to populate
+    // the cache, rather than all resolving the same dependencies. A lock that cannot be
+    // created at all does not coordinate anything, so then every launch may write.
+    const int max_waits = 100;
+    const std::chrono::milliseconds wait_time(10);
+
+    pal::string_t lock_path = m_cache_file + _X(".lock");
+    for (int waits = 0; ; ++waits)
+    {
+        bool contended;
+        if (pal::try_lock_file(lock_path, &m_lock, &contended))
+        {
+            m_lock_state = lock_state_t::locked;
+
+            // The previous holder may have populated the cache just before releasing the lock.
+            return try_read(entry);
+        }
+
+        if (!contended)
+        {
+            m_lock_state = lock_state_t::unavailable;
+            return false;
+        }
+
+        if (waits == max_waits)
+        {
+            trace::verbose(_X("Startup cache [%s] is still being populated, resolving without it"), m_cache_file.c_str());
+            return false;
+        }
+
+        std::this_thread::sleep_for(wait_time);
+        if (try_read(entry))
+        {
+            return true;
+        }
+    }
+}
+
+startup_cache_t::~startup_cache_t()
+{
+    unlock();
+}
+
+void startup_cache_t::unlock()
+{
+    if (m_lock_state == lock_state_t::locked)
+    {
+        pal::unlock_file(m_lock);
+        m_lock_state = lock_state_t::none;
+    }
+}
+
+void startup_cache_t::write(const startup_cache_entry_t& entry)
+{
+    // Only the launch that holds the lock writes, the others were waiting for it.
+    if (!is_enabled() || m_lock_state == lock_state_t::none)
+    {
+        return;
+    }
+
+    write_file(entry);
+    unlock();
+}
+
+void startup_cache_t::write_file(const startup_cache_entry_t& entry) const
+{
+    // Write to a temporary file and move it in place so that readers never map a partially written cache.
+    // Launches that could not take the lock all write, so each one uses a file of its own.
+    pal::string_t tmp_path = get_temp_file_path(m_cache_file);
+    std::ofstream file(tmp_path, std::ios::out | std::ios::trunc);
+    if (!file.good())
+    {
+        trace::verbose(_X("Failed to open startup cache [%s] for writing"), m_cache_file.c_str());
+        return;
+    }
+
+    file << startup_cache_header << '\n';
+    file << m_key.size() << '\n';
+    for (const auto& key : m_key)
+    {
+        write_line(file, key);
+    }
+
+    write_probed_paths(file, entry.probed_paths);
+
+    write_line(file, entry.probe_paths.tpa);
+    write_line(file, entry.probe_paths.app_paths);
+    write_line(file, entry.probe_paths.native);
+    write_line(file, entry.probe_paths.resources);
+    write_line(file, entry.probe_paths.coreclr);
+    write_line(file, entry.probe_paths.clrjit);
+    write_line(file, entry.fx_deps_file);
+    write_line(file, entry.deps_files);
+    write_line(file, entry.probe_directories);
+    write_line(file, entry.clr_library_version);
+
+    file << entry.breadcrumbs.size() << '\n';
+    for (const auto& breadcrumb : entry.breadcrumbs)
+    {
+        write_line(file, breadcrumb);
+    }
+
+    file << startup_cache_trailer << '\n';
+    file.close();
+
+    if (file.fail())
+    {
+        trace::verbose(_X("Failed to write startup cache [%s]"), m_cache_file.c_str());
+        pal::remove_file(tmp_path);
+        return;
+    }
+
+    if (pal::rename_file(tmp_path, m_cache_file))
+    {
+        trace::verbose(_X("Wrote startup cache [%s]"), m_cache_file.c_str());
+    }
+    else
+    {
+        pal::remove_file(tmp_path);
+    }
+}
+
+namespace
+{
+    const char startup_manifest_header[] = "dotnet-host-startup-manifest-v3";
+
+    // Stamps a file by its content rather than its timestamp, which copying the app does not keep.
+    pal::string_t get_content_stamp(const pal::string_t& path)
+    {
+        size_t length;
+        const void* mapping = pal::map_file_readonly(path, &length);
+        if (mapping == nullptr)
+        {
+            return pal::string_t();
+        }
+
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        const unsigned char* data = static_cast<const unsigned char*>(mapping);
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash = (hash ^ data[i]) * 1099511628211ULL;
+        }
+
+        pal::unmap_file(mapping, length);
+
+        pal::stringstream_t stamp;
+        stamp << length << _X("|") << std::hex << hash;
+        return stamp.str();
+    }
+}
+
+startup_manifest_t::startup_manifest_t(const hostpolicy_init_t& init, const arguments_t& args)
+    : m_args(args)
+    , m_additional_deps(init.additional_deps_serialized)
+{
+    // Only self-contained apps have a resolution that is fixed at publish time.
+    if (init.is_framework_dependent || !pal::file_exists(args.deps_path))
+    {
+        return;
+    }
+
+    pal::string_t dev_config_file;
+    get_runtime_config_paths_from_app(args.managed_application, &m_config_file, &dev_config_file);
+
+    m_manifest_file = args.app_root;
+    append_path(&m_manifest_file, (get_filename_without_ext(args.managed_application) + _X(".startupmanifest")).c_str());
+
+    // The manifest does not record what is in the servicing, probe and store locations, so it is
+    // only used without them. Those that are configured may get the app's packages at any time,
+    // the machine-wide stores once they are installed.
+    pal::string_t servicing;
+    if (!args.core_servicing.empty())
+    {
+        m_overriding_location = args.core_servicing;
+    }
+    else if (host_env::get(host_env::servicing, &servicing) && !servicing.empty())
+    {
+        m_overriding_location = servicing;
+    }
+    else if (!args.probe_paths.empty())
+    {
+        m_overriding_location = args.probe_paths.front();
+    }
+    else if (!args.env_shared_store.empty())
+    {
+        m_overriding_location = args.env_shared_store.front();
+    }
+    else
+    {
+        std::vector<pal::string_t> stores = args.global_shared_stores;
+        stores.push_back(args.dotnet_shared_store);
+        for (const auto& store : stores)
+        {
+            if (!store.empty() && pal::directory_exists(store))
+            {
+                m_overriding_location = store;
+                break;
+            }
+        }
+    }
+}
+
+std::vector<pal::string_t> startup_manifest_t::get_key() const
+{
+    std::vector<pal::string_t> key;
+    key.push_back(pal::string_t(_X("hostpolicy=")) + _STRINGIFY(HOST_POLICY_PKG_VER) + _X(",") + _STRINGIFY(REPO_COMMIT_HASH));
+    key.push_back(_X("additional_deps=") + m_additional_deps);
+
+    pal::string_t rid;
+    (void) host_env::get(host_env::runtime_id, &rid);
+    key.push_back(_X("rid=") + rid);
+    key.push_back(_X("lazy_tpa=") + pal::to_string(host_env::is_enabled(host_env::lazy_tpa)));
+
+    key.push_back(_X("deps=") + get_content_stamp(m_args.deps_path));
+    key.push_back(_X("runtime_config=") + get_content_stamp(m_config_file));
+    return key;
+}
+
+// Paths under the app root are stored relative to it; the app root itself is stored as ".".
+bool startup_manifest_t::to_relative(const pal::string_t& paths, bool allow_outside, pal::string_t* relative) const
+{
+    pal::string_t root = m_args.app_root;
+    remove_trailing_dir_seperator(&root);
+
+    relative->clear();
+    size_t start = 0;
+    while (start <= paths.size())
+    {
+        size_t end = paths.find(PATH_SEPARATOR, start);
+        if (end == pal::string_t::npos)
+        {
+            end = paths.size();
+        }
+
+        pal::string_t path = paths.substr(start, end - start);
+        if (path.empty())
+        {
+            // Keep empty entries, e.g. from a trailing separator.
+        }
+        else if (path == root)
+        {
+            path = _X(".");
+        }
+        else if (path.size() > root.size() && path[root.size()] == DIR_SEPARATOR && starts_with(path, root, true))
+        {
+            path.erase(0, root.size() + 1);
+        }
+        else if (!allow_outside)
+        {
+            trace::error(_X("Cannot write startup manifest [%s], [%s] is outside of the app"), m_manifest_file.c_str(), path.c_str());
+            return false;
+        }
+
+        relative->append(path);
+        if (end < paths.size())
+        {
+            relative->push_back(PATH_SEPARATOR);
+        }
+        start = end + 1;
+    }
+
+    return true;
+}
+
+pal::string_t startup_manifest_t::to_absolute(const pal::string_t& paths) const
+{
+    pal::string_t root = m_args.app_root;
+    remove_trailing_dir_seperator(&root);
+
+    pal::string_t absolute;
+    absolute.reserve(paths.size() + root.size() * 16);
+    size_t start = 0;
+    while (start <= paths.size())
+    {
+        size_t end = paths.find(PATH_SEPARATOR, start);
+        if (end == pal::string_t::npos)
+        {
+            end = paths.size();
+        }
+
+        if (end > start)
+        {
+            if (end - start == 1 && paths[start] == _X('.'))
+            {
+                absolute.append(root);
+            }
+            else
+            {
+                pal::string_t path = paths.substr(start, end - start);
+                if (!pal::is_path_rooted(path))
+                {
+                    absolute.append(root);
+                    absolute.push_back(DIR_SEPARATOR);
+                }
+                absolute.append(path);
+            }
+        }
+
+        if (end < paths.size())
+        {
+            absolute.push_back(PATH_SEPARATOR);
+        }
+        start = end + 1;
+    }
+
+    return absolute;
+}
+
+bool startup_manifest_t::try_read(startup_cache_entry_t* entry) const
+{
+    if (!is_enabled())
+    {
+        return false;
+    }
+
+    size_t length;
+    const void* mapping = pal::map_file_readonly(m_manifest_file, &length);
+    if (mapping == nullptr)
+    {
+        return false;
+    }
+
+    if (!m_overriding_location.empty())
+    {
+        trace::verbose(_X("Not using startup manifest [%s], [%s] may override the published assets"), m_manifest_file.c_str(), m_overriding_location.c_str());
+        pal::unmap_file(mapping, length);
+        return false;
+    }
+
+    line_reader_t file(static_cast<const char*>(mapping), length);
+    std::vector<pal::string_t> key = get_key();
+
+    std::string header;
+    size_t key_count;
+    bool valid = file.get_line(&header) && header == startup_manifest_header &&
+        read_count(file, &key_count) && key_count == key.size();
+
+    pal::string_t line;
+    for (size_t i = 0; valid && i < key.size(); ++i)
+    {
+        valid = read_line(file, &line) && line == key[i];
+        if (!valid)
+        {
+            trace::verbose(_X("Startup manifest [%s] is stale, expected [%s] but found [%s]"), m_manifest_file.c_str(), key[i].c_str(), line.c_str());
+        }
+    }
+
+    startup_cache_entry_t result;
+    pal::string_t tpa, app_paths, native, resources, coreclr, clrjit, deps_files, probe_directories;
+    size_t breadcrumb_count = 0;
+    valid = valid &&
+        read_line(file, &tpa) &&
+        read_line(file, &app_paths) &&
+        read_line(file, &native) &&
+        read_line(file, &resources) &&
+        read_line(file, &coreclr) &&
+        read_line(file, &clrjit) &&
+        read_line(file, &deps_files) &&
+        read_line(file, &probe_directories) &&
+        read_line(file, &result.clr_library_version) &&
+        read_count(file, &breadcrumb_count);
+
+    for (size_t i = 0; valid && i < breadcrumb_count; ++i)
+    {
+        valid = read_line(file, &line);
+        result.breadcrumbs.insert(line);
+    }
+
+    std::string trailer;
+    valid = valid && file.get_line(&trailer) && trailer == startup_cache_trailer;
+    pal::unmap_file(mapping, length);
+
+    if (!valid)
+    {
+        trace::verbose(_X("Startup manifest [%s] does not match the app"), m_manifest_file.c_str());
+        return false;
+    }
+
+    result.probe_paths.tpa = to_absolute(tpa);
+    result.probe_paths.app_paths = to_absolute(app_paths);
+    result.probe_paths.native = to_absolute(native);
+    result.probe_paths.resources = to_absolute(resources);
+    result.probe_paths.coreclr = to_absolute(coreclr);
+    result.probe_paths.clrjit = to_absolute(clrjit);
+    result.deps_files = to_absolute(deps_files);
+    result.probe_directories = to_absolute(probe_directories);
+
+    if (!coreclr_exists_in_dir(get_directory(result.probe_paths.coreclr)))
+    {
+        trace::verbose(_X("Startup manifest [%s] refers to a missing CoreCLR [%s]"), m_manifest_file.c_str(), result.probe_paths.coreclr.c_str());
+        return false;
+    }
+
+    *entry = std::move(result);
+    trace::verbose(_X("Using probe paths from startup manifest [%s]"), m_manifest_file.c_str());
+    return true;
+}
+
+bool startup_manifest_t::write(const startup_cache_entry_t& entry) const
+{
+    if (!is_enabled())
+    {
+        trace::error(_X("A startup manifest can only be written for a self-contained app with a deps file [%s]"), m_args.deps_path.c_str());
+        return false;
+    }
+
+    if (!m_overriding_location.empty())
+    {
+        trace::error(_X("Cannot write startup manifest [%s], [%s] may override the published assets"), m_manifest_file.c_str(), m_overriding_location.c_str());
+        return false;
+    }
+
+    pal::string_t tpa, app_paths, native, resources, coreclr, clrjit, deps_files, probe_directories;
+    if (!to_relative(entry.probe_paths.tpa, false, &tpa) ||
+        !to_relative(entry.probe_paths.app_paths, false, &app_paths) ||
+        !to_relative(entry.probe_paths.native, false, &native) ||
+        !to_relative(entry.probe_paths.resources, false, &resources) ||
+        !to_relative(entry.probe_paths.coreclr, false, &coreclr) ||
+        !to_relative(entry.probe_paths.clrjit, false, &clrjit) ||
+        !to_relative(entry.deps_files, false, &deps_files) ||
+        !to_relative(entry.probe_directories, true, &probe_directories))
+    {
+        return false;
+    }
+
+    pal::string_t tmp_path = get_temp_file_path(m_manifest_file);
+    std::ofstream file(tmp_path, std::ios::out | std::ios::trunc);
+    if (!file.good())
+    {
+        trace::error(_X("Failed to open startup manifest [%s] for writing"), m_manifest_file.c_str());
+        return false;
+    }
+
+    std::vector<pal::string_t> key = get_key();
+    file << startup_manifest_header << '\n';
+    file << key.size() << '\n';
+    for (const auto& line : key)
+    {
+        write_line(file, line);
+    }
+
+    write_line(file, tpa);
+    write_line(file, app_paths);
+    write_line(file, native);
+    write_line(file, resources);
+    write_line(file, coreclr);
+    write_line(file, clrjit);
+    write_line(file, deps_files);
+    write_line(file, probe_directories);
+    write_line(file, entry.clr_library_version);
+
+    file << entry.breadcrumbs.size() << '\n';
+    for (const auto& breadcrumb : entry.breadcrumbs)
+    {
+        write_line(file, breadcrumb);
+    }
+
+    file << startup_cache_trailer << '\n';
+    file.close();
+
+    if (file.fail() || !pal::rename_file(tmp_path, m_manifest_file))
+    {
+        trace::error(_X("Failed to write startup manifest [%s]"), m_manifest_file.c_str());
+        pal::remove_file(tmp_path);
+        return false;
+    }
+
+    trace::verbose(_X("Wrote startup manifest [%s]"), m_manifest_file.c_str());
+    return true;
+}
@@ -0,0 +1,126 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef __STARTUP_CACHE_H__
+#define __STARTUP_CACHE_H__
+
+#include "pal.h"
+#include "args.h"
+#include "libhost.h"
+#include "deps_resolver.h"
+
+// Results of the dependency resolution that are persisted by the startup cache.
+struct startup_cache_entry_t
+{
+    probe_paths_t probe_paths;
+    pal::string_t fx_deps_file;
+    pal::string_t deps_files;
+    pal::string_t probe_directories;
+    pal::string_t clr_library_version;
+    std::unordered_set<pal::string_t> breadcrumbs;
+
+    // The paths outside of the key that the resolution depends on, see deps_resolver_t::get_probed_paths.
+    std::vector<pal::string_t> probed_paths;
+};
+
+/**
+ * Persists the resolved probe paths so that subsequent launches of the same app
+ * can skip parsing the deps files and probing for assets.
+ *
+ * The cache is opt-in and is enabled by pointing DOTNET_HOST_STARTUP_CACHE at a
+ * writable directory. An entry is only reused when its key matches exactly; the key
+ * covers the hostpolicy build, the resolved frameworks, the runtime properties, the
+ * probe locations and the timestamp and size of every deps/config file and directory
+ * that takes part in the resolution. The entry also records the timestamp and size of the
+ * additional deps files and of the packages looked for in the servicing, probe and store
+ * locations, and is only reused while they are unchanged.
+ *
+ * The cache file is shared by every process that launches the app: readers map it and
+ * writers replace it atomically, and a lock next to it lets concurrent launches wait for
+ * the first one to populate the cache instead of all resolving the same dependencies.
+ */
+class startup_cache_t
+{
+public:
+    startup_cache_t(const hostpolicy_init_t& init, const arguments_t& args);
+    ~startup_cache_t();
+
+    bool is_enabled() const { return !m_cache_file.empty(); }
+
+    bool try_read(startup_cache_entry_t* entry) const;
+
+    // On a miss, takes the lock that allows populating the cache, waiting a bounded time for
+    // another launch that holds it. Returns true if the entry was read meanwhile.
+    bool try_read_or_lock(startup_cache_entry_t* entry);
+
+    // Writes the entry if the lock was taken, or if there is no lock to take, and then
+    // releases the lock.
+    void write(const startup_cache_entry_t& entry);
+
+private:
+    enum class lock_state_t
+    {
+        none,
+        locked,
+        unavailable
+    };
+
+    bool read_mapped(const char* data, size_t length, startup_cache_entry_t* entry) const;
+    void write_file(const startup_cache_entry_t& entry) const;
+    void unlock();
+    void add_key(const pal::char_t* name, const pal::string_t& value);
+    void add_file_key(const pal::char_t* name, const pal::string_t& path);
+    void stamp_file_keys();
+
+    pal::string_t m_cache_file;
+    std::vector<pal::string_t> m_key;
+
+    // The keys that name a file and the paths of those files.
+    std::vector<size_t> m_file_keys;
+    std::vector<pal::string_t> m_file_paths;
+
+    lock_state_t m_lock_state;
+    pal::file_lock_t m_lock;
+};
+
+/**
+ * A startup manifest frozen next to a self-contained app when it is published.
+ *
+ * The resolution of a self-contained app only depends on what was published with it, so
+ * the resolved probe paths are stored relative to the app root in "<app>.startupmanifest"
+ * and survive copying the app to another location. The manifest is written at publish time
+ * through hostfxr_write_startup_manifest, never by a launch, and only when every resolved
+ * asset is inside the app root.
+ *
+ * Later launches read it instead of parsing the deps file and probing while its key matches;
+ * the key covers the hostpolicy build and the content of the deps and runtime config files.
+ * Assets in servicing, additional probe or store locations take precedence over the published
+ * ones, so the manifest is neither written nor used while such a location is configured.
+ */
+class startup_manifest_t
+{
+public:
+    startup_manifest_t(const hostpolicy_init_t& init, const arguments_t& args);
+
+    bool is_enabled() const { return !m_manifest_file.empty(); }
+
+    const pal::string_t& get_file() const { return m_manifest_file; }
+
+    bool try_read(startup_cache_entry_t* entry) const;
+    bool write(const startup_cache_entry_t& entry) const;
+
+private:
+    std::vector<pal::string_t> get_key() const;
+    bool to_relative(const pal::string_t& paths, bool allow_outside, pal::string_t* relative) const;
+    pal::string_t to_absolute(const pal::string_t& paths) const;
+
+    const arguments_t& m_args;
+    pal::string_t m_manifest_file;
+    pal::string_t m_config_file;
+    pal::string_t m_additional_deps;
+
+    // A servicing, probe or store location that may override the published assets, if any.
+    pal::string_t m_overriding_location;
+};
+
+#endif // __STARTUP_CACHE_H__
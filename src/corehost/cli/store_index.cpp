@@ -0,0 +1,98 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pal.h"
+#include "utils.h"
+#include "trace.h"
+#include "store_index.h"
+
+#include <cstring>
+
+namespace
+{
+    const char store_index_header[] = "dotnet-runtime-store-index-v1";
+
+#if defined(_WIN32) || defined(__APPLE__)
+    // The file systems are case insensitive by default, the same as in dir_cache_t.
+    const bool case_insensitive = true;
+#else
+    const bool case_insensitive = false;
+#endif
+
+    pal::string_t get_key(const pal::string_t& path)
+    {
+        return case_insensitive ? pal::to_lower(path) : path;
+    }
+}
+
+bool store_index_t::load(const pal::string_t& store_dir)
+{
+    pal::string_t index_file = store_dir;
+    append_path(&index_file, RUNTIME_STORE_INDEX_FILE_NAME);
+
+    int64_t index_time, store_time, size;
+    if (!pal::get_file_stamp(index_file, &index_time, &size) ||
+        !pal::get_file_stamp(store_dir, &store_time, &size))
+    {
+        return false;
+    }
+
+    // The index is written after the packages, so the store directory is not newer unless
+    // packages were added or removed since.
+    if (store_time > index_time)
+    {
+        trace::verbose(_X("Ignoring the runtime store index [%s], the store was modified after it"), index_file.c_str());
+        return false;
+    }
+
+    file_contents_t contents;
+    if (!contents.load(index_file))
+    {
+        return false;
+    }
+
+    const char* pos = contents.begin();
+    const char* end = contents.end();
+    (void) skip_utf8_bom(&pos, end);
+
+    bool has_header = false;
+    pal::string_t path;
+    while (pos < end)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* next = (eol == nullptr) ? end : eol + 1;
+        if (eol == nullptr)
+        {
+            eol = end;
+        }
+        if (eol != pos && *(eol - 1) == '\r')
+        {
+            --eol;
+        }
+
+        std::string line(pos, eol);
+        pos = next;
+
+        if (!has_header)
+        {
+            if (line != store_index_header)
+            {
+                trace::verbose(_X("Ignoring the runtime store index [%s], it has an unknown format"), index_file.c_str());
+                return false;
+            }
+            has_header = true;
+        }
+        else if (!line.empty() && pal::utf8_palstring(line, &path))
+        {
+            m_files.insert(get_key(path));
+        }
+    }
+
+    trace::verbose(_X("Loaded %d files from the runtime store index [%s]"), (int) m_files.size(), index_file.c_str());
+    return has_header;
+}
+
+bool store_index_t::contains(const pal::string_t& relative_path) const
+{
+    return m_files.count(get_key(relative_path)) != 0;
+}
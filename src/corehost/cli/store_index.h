@@ -0,0 +1,38 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef __STORE_INDEX_H__
+#define __STORE_INDEX_H__
+
+#include "pal.h"
+#include <unordered_set>
+
+#define RUNTIME_STORE_INDEX_FILE_NAME _X("store.index")
+
+/**
+ * The files of a runtime store (<store>/<arch>/<tfm>), read from the index that
+ * ships with the store, so that store probes are lookups instead of file checks.
+ *
+ * The index is a UTF-8 text file named "store.index" in the store directory. Its first
+ * line is "dotnet-runtime-store-index-v1", followed by one line per file in the store
+ * giving its path relative to the store directory with '/' separators, e.g.
+ * "microsoft.aspnetcore.mvc/2.0.0/lib/netstandard2.0/Microsoft.AspNetCore.Mvc.dll".
+ *
+ * The index is authoritative: files that it does not list are not looked for. It has to
+ * be written in place after the packages, and it is ignored if the store directory was
+ * modified after it, as happens when a package is added to or removed from the store.
+ */
+class store_index_t
+{
+public:
+    // Returns false if the store has no usable index.
+    bool load(const pal::string_t& store_dir);
+
+    // Whether the store has the file at "relative_path", which uses '/' separators.
+    bool contains(const pal::string_t& relative_path) const;
+
+private:
+    std::unordered_set<pal::string_t> m_files;
+};
+
+#endif // __STORE_INDEX_H__
@@ -11,63 +11,43 @@
 // -- if version_t is an empty value (-1 for all segments) then as_str() returns an empty string
 // -- Different terminology; fx_ver_t(major, minor, patch, build) vs version_t(major, minor, build, revision)
 
-version_t::version_t() : version_t(-1, -1, -1, -1) { }
-
 version_t::version_t(int major, int minor, int build, int revision)
-    : m_major(major)
-    , m_minor(minor)
-    , m_build(build)
-    , m_revision(revision) { }
-
-bool version_t::operator ==(const version_t& b) const
-{
-    return compare(*this, b) == 0;
-}
-
-bool version_t::operator !=(const version_t& b) const
-{
-    return !operator ==(b);
-}
-
-bool version_t::operator <(const version_t& b) const
-{
-    return compare(*this, b) < 0;
-}
-
-bool version_t::operator >(const version_t& b) const
-{
-    return compare(*this, b) > 0;
-}
-
-bool version_t::operator <=(const version_t& b) const
+    : m_key(0)
+    , m_count(0)
 {
-    return compare(*this, b) <= 0;
-}
+    const int components[] = { major, minor, build, revision };
+    for (int component : components)
+    {
+        assert(is_valid_component(component));
+        if (component < 0 || component > max_component)
+        {
+            break;
+        }
 
-bool version_t::operator >=(const version_t& b) const
-{
-    return compare(*this, b) >= 0;
+        m_key |= (uint64_t)component << ((3 - m_count) * 16);
+        ++m_count;
+    }
 }
 
 pal::string_t version_t::as_str() const
 {
     pal::stringstream_t stream;
 
-    if (m_major >= 0)
+    if (get_major() >= 0)
     {
-        stream << m_major;
+        stream << get_major();
 
-        if (m_minor >= 0)
+        if (get_minor() >= 0)
         {
-            stream << _X(".") << m_minor;
+            stream << _X(".") << get_minor();
 
-            if (m_build >= 0)
+            if (get_build() >= 0)
             {
-                stream << _X(".") << m_build;
+                stream << _X(".") << get_build();
 
-                if (m_revision >= 0)
+                if (get_revision() >= 0)
                 {
-                    stream << _X(".") << m_revision;
+                    stream << _X(".") << get_revision();
                 }
             }
         }
@@ -76,87 +56,53 @@ pal::string_t version_t::as_str() const
     return stream.str();
 }
 
-/*static*/ int version_t::compare(const version_t&a, const version_t& b)
+// Reads the component at "pos" and the separator after it, if any, without copying the string.
+bool parse_component(const pal::string_t& ver, size_t* pos, int* component, bool* more)
 {
-    if (a.m_major != b.m_major)
-    {
-        return (a.m_major > b.m_major) ? 1 : -1;
-    }
-
-    if (a.m_minor != b.m_minor)
-    {
-        return (a.m_minor > b.m_minor) ? 1 : -1;
-    }
-
-    if (a.m_build != b.m_build)
+    size_t i = *pos;
+    unsigned value = 0;
+    for (; i < ver.length() && ver[i] >= _X('0') && ver[i] <= _X('9'); ++i)
     {
-        return (a.m_build > b.m_build) ? 1 : -1;
+        value = value * 10 + (ver[i] - _X('0'));
+        if (value > version_t::max_component)
+        {
+            return false;
+        }
     }
 
-    if (a.m_revision != b.m_revision)
+    // A component has at least one digit and is followed by a separator or the end.
+    if (i == *pos || (i < ver.length() && ver[i] != _X('.')))
     {
-        return (a.m_revision > b.m_revision) ? 1 : -1;
+        return false;
     }
 
-    return 0;
+    *component = (int)value;
+    *more = i < ver.length();
+    *pos = i + 1;
+    return true;
 }
 
 bool parse_internal(const pal::string_t& ver, version_t* ver_out)
 {
-    unsigned major = -1;
-    size_t maj_start = 0;
-    size_t maj_sep = ver.find(_X('.'));
-    if (maj_sep == pal::string_t::npos)
-    {
-        return false; // minor required
-    }
-    if (!try_stou(ver.substr(maj_start, maj_sep), &major))
-    {
-        return false;
-    }
-
-    unsigned minor = -1;
-    size_t min_start = maj_sep + 1;
-    size_t min_sep = ver.find(_X('.'), min_start);
-    if (min_sep == pal::string_t::npos)
-    {
-        if (!try_stou(ver.substr(min_start), &minor))
-        {
-            return false;
-        }
-        *ver_out = version_t(major, minor, -1, -1);
-        return true; // build and revision not required
-    }
-    if (!try_stou(ver.substr(min_start, min_sep - min_start), &minor))
+    int components[4] = { -1, -1, -1, -1 };
+    size_t pos = 0;
+    bool more = true;
+    int count = 0;
+    while (more)
     {
-        return false;
-    }
-
-    unsigned build = -1;
-    size_t build_start = min_sep + 1;
-    size_t build_sep = ver.find(_X('.'), build_start);
-    if (build_sep == pal::string_t::npos)
-    {
-        if (!try_stou(ver.substr(build_start), &build))
+        if (count == 4 || !parse_component(ver, &pos, &components[count], &more))
         {
             return false;
         }
-        *ver_out = version_t(major, minor, build, -1);
-        return true; // revision not required
-    }
-    if (!try_stou(ver.substr(build_start, build_sep - build_start), &build))
-    {
-        return false;
+        ++count;
     }
 
-    unsigned revision = -1;
-    size_t revision_start = build_sep + 1;
-    if (!try_stou(ver.substr(revision_start), &revision))
+    if (count < 2)
     {
-        return false;
+        return false; // minor required
     }
-    *ver_out = version_t(major, minor, build, revision);
 
+    *ver_out = version_t(components[0], components[1], components[2], components[3]);
     return true;
 }
 
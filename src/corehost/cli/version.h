@@ -7,39 +7,49 @@
 #include "pal.h"
 #include "utils.h"
 
+// The components are packed into a single key, 16 bits each from the major version down,
+// which covers the full range of an assembly or file version component (0 to 65535). An
+// absent component (-1) is zero in the key, and the number of leading present components
+// is kept next to it; once a component is absent, the following ones are absent too.
+// Comparing the key and then the count orders an absent component below all present ones.
 struct version_t
 {
-    version_t();
+    static const int max_component = 0xffff;
+
+    version_t() : m_key(0), m_count(0) { }
     version_t(int major, int minor, int build, int revision);
 
-    int get_major() const { return m_major; }
-    int get_minor() const { return m_minor; }
-    int get_build() const { return m_build; }
-    int get_revision() const { return m_revision; }
+    int get_major() const { return get_component(0); }
+    int get_minor() const { return get_component(1); }
+    int get_build() const { return get_component(2); }
+    int get_revision() const { return get_component(3); }
 
-    void set_major(int m) { m_major = m; }
-    void set_minor(int m) { m_minor = m; }
-    void set_build(int m) { m_build = m; }
-    void set_revision(int m) { m_revision = m; }
+    void set_major(int m) { *this = version_t(m, get_minor(), get_build(), get_revision()); }
+    void set_minor(int m) { *this = version_t(get_major(), m, get_build(), get_revision()); }
+    void set_build(int m) { *this = version_t(get_major(), get_minor(), m, get_revision()); }
+    void set_revision(int m) { *this = version_t(get_major(), get_minor(), get_build(), m); }
 
     pal::string_t as_str() const;
 
-    bool operator ==(const version_t& b) const;
-    bool operator !=(const version_t& b) const;
-    bool operator <(const version_t& b) const;
-    bool operator >(const version_t& b) const;
-    bool operator <=(const version_t& b) const;
-    bool operator >=(const version_t& b) const;
+    bool operator ==(const version_t& b) const { return m_key == b.m_key && m_count == b.m_count; }
+    bool operator !=(const version_t& b) const { return !operator ==(b); }
+    bool operator <(const version_t& b) const { return m_key < b.m_key || (m_key == b.m_key && m_count < b.m_count); }
+    bool operator >(const version_t& b) const { return b < *this; }
+    bool operator <=(const version_t& b) const { return !(b < *this); }
+    bool operator >=(const version_t& b) const { return !(*this < b); }
+
+    static bool is_valid_component(int value) { return value >= -1 && value <= max_component; }
 
     static bool parse(const pal::string_t& ver, version_t* ver_out);
 
 private:
-    int m_major;
-    int m_minor;
-    int m_build;
-    int m_revision;
+    uint64_t m_key;
+    int m_count;
 
-    static int compare(const version_t&a, const version_t& b);
+    int get_component(int index) const
+    {
+        return index < m_count ? (int)((m_key >> ((3 - index) * 16)) & 0xffff) : -1;
+    }
 };
 
 #endif // __VERSION_H__
\ No newline at end of file
@@ -0,0 +1,129 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "host_env.h"
+#include "trace.h"
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+    const pal::char_t* const g_names[host_env::count] =
+    {
+        _X("DOTNET_MULTILEVEL_LOOKUP"),
+        _X("DOTNET_ROLL_FORWARD_ON_NO_CANDIDATE_FX"),
+        _X("DOTNET_ADDITIONAL_DEPS"),
+        _X("DOTNET_SHARED_STORE"),
+        _X("CORE_BREADCRUMBS"),
+        _X("CORE_SERVICING"),
+        _X("DOTNET_RUNTIME_ID"),
+        _X("DOTNET_HOST_PARALLEL_PROBING"),
+        _X("DOTNET_HOST_STARTUP_CACHE"),
+        _X("DOTNET_HOST_BINARY_DEPS"),
+        _X("DOTNET_HOST_EARLY_CORECLR_BIND"),
+        _X("DOTNET_HOST_PRODUCTION_MODE"),
+        _X("DOTNET_HOST_LAZY_TPA"),
+        _X("DOTNET_ROOT"),
+        _X("DOTNET_ROOT(x86)"),
+    };
+
+    // Written once under the lock and only read after g_ready is set.
+    std::mutex g_lock;
+    std::atomic<bool> g_ready(false);
+    pal::string_t g_values[host_env::count];
+    bool g_is_set[host_env::count];
+
+    // The environment is read once per process. Hosting API calls made later by a long-lived
+    // host see the values of the first one, even if the host changed the environment since.
+    void ensure_snapshot()
+    {
+        if (g_ready.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(g_lock);
+        if (g_ready.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        for (int i = 0; i < host_env::count; ++i)
+        {
+            g_is_set[i] = pal::getenv(g_names[i], &g_values[i]);
+        }
+
+        g_ready.store(true, std::memory_order_release);
+    }
+}
+
+const pal::char_t* host_env::get_name(var_t var)
+{
+    return g_names[var];
+}
+
+bool host_env::get(var_t var, pal::string_t* recv)
+{
+    ensure_snapshot();
+
+    recv->clear();
+    if (!g_is_set[var])
+    {
+        return false;
+    }
+
+    recv->assign(g_values[var]);
+    return true;
+}
+
+bool host_env::is_enabled(var_t var)
+{
+    ensure_snapshot();
+    return g_is_set[var] && pal::xtoi(g_values[var].c_str()) == 1;
+}
+
+void host_env::get_snapshot(std::vector<const pal::char_t*>* names, std::vector<const pal::char_t*>* values)
+{
+    ensure_snapshot();
+    for (int i = 0; i < count; ++i)
+    {
+        names->push_back(g_names[i]);
+        values->push_back(g_is_set[i] ? g_values[i].c_str() : nullptr);
+    }
+}
+
+void host_env::set_snapshot(size_t count, const pal::char_t** names, const pal::char_t** values)
+{
+    std::lock_guard<std::mutex> lock(g_lock);
+    if (g_ready.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // Names this component does not know about are ignored.
+    bool passed[host_env::count] = { };
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (int j = 0; j < host_env::count; ++j)
+        {
+            if (pal::strcmp(names[i], g_names[j]) == 0)
+            {
+                passed[j] = true;
+                g_is_set[j] = values[i] != nullptr;
+                g_values[j] = g_is_set[j] ? values[i] : _X("");
+                break;
+            }
+        }
+    }
+
+    for (int j = 0; j < host_env::count; ++j)
+    {
+        if (!passed[j])
+        {
+            g_is_set[j] = pal::getenv(g_names[j], &g_values[j]);
+        }
+    }
+
+    trace::verbose(_X("Using the host environment settings passed by the host"));
+    g_ready.store(true, std::memory_order_release);
+}
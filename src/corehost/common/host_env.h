@@ -0,0 +1,63 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef HOST_ENV_H
+#define HOST_ENV_H
+
+#include "pal.h"
+
+/**
+ * Snapshot of the environment variables that configure the host.
+ *
+ * All of them are read together the first time one is needed and never again, so a
+ * setting cannot change halfway through resolving an app. hostfxr hands its snapshot to
+ * hostpolicy through host_interface_t, so both components act on the same values.
+ *
+ * The snapshot is not refreshed: a process that keeps hostfxr loaded and changes one of
+ * the variables between hosting API calls, e.g. DOTNET_ADDITIONAL_DEPS or
+ * DOTNET_SHARED_STORE, keeps getting the value of its first call.
+ *
+ * The tracing variables are not included, since tracing is set up before anything else
+ * and is needed to report on the rest.
+ */
+namespace host_env
+{
+    enum var_t
+    {
+        multilevel_lookup = 0,              // DOTNET_MULTILEVEL_LOOKUP
+        roll_forward_on_no_candidate_fx,    // DOTNET_ROLL_FORWARD_ON_NO_CANDIDATE_FX
+        additional_deps,                    // DOTNET_ADDITIONAL_DEPS
+        shared_store,                       // DOTNET_SHARED_STORE
+        breadcrumbs,                        // CORE_BREADCRUMBS
+        servicing,                          // CORE_SERVICING
+        runtime_id,                         // DOTNET_RUNTIME_ID
+        parallel_probing,                   // DOTNET_HOST_PARALLEL_PROBING
+        startup_cache,                      // DOTNET_HOST_STARTUP_CACHE
+        binary_deps,                        // DOTNET_HOST_BINARY_DEPS
+        early_coreclr_bind,                 // DOTNET_HOST_EARLY_CORECLR_BIND
+        production_mode,                    // DOTNET_HOST_PRODUCTION_MODE
+        lazy_tpa,                           // DOTNET_HOST_LAZY_TPA
+        dotnet_root,                        // DOTNET_ROOT
+        dotnet_root_x86,                    // DOTNET_ROOT(x86)
+        count
+    };
+
+    const pal::char_t* get_name(var_t var);
+
+    // Same contract as pal::getenv.
+    bool get(var_t var, pal::string_t* recv);
+
+    // True if the variable is set to 1, the convention for the opt-in host features.
+    bool is_enabled(var_t var);
+
+    // Every variable as a name and value pair; the value is null if the variable is not set.
+    // The strings stay valid for the lifetime of the process.
+    void get_snapshot(std::vector<const pal::char_t*>* names, std::vector<const pal::char_t*>* values);
+
+    // Adopts the snapshot taken by the component that loaded this one; variables missing
+    // from it are read from the environment. Has no effect if this component read the
+    // environment already.
+    void set_snapshot(size_t count, const pal::char_t** names, const pal::char_t** values);
+};
+
+#endif // HOST_ENV_H
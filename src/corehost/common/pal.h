@@ -11,6 +11,7 @@
 #include <iostream>
 #include <cstring>
 #include <cstdarg>
+#include <cstdio>
 #include <cstdint>
 #include <tuple>
 #include <unordered_map>
@@ -23,6 +24,7 @@
 
 #define NOMINMAX
 #include <windows.h>
+#include <share.h>
 
 #define xerr std::wcerr
 #define xout std::wcout
@@ -113,6 +115,7 @@ namespace pal
     typedef HRESULT hresult_t;
     typedef HMODULE dll_t;
     typedef FARPROC proc_t;
+    typedef HANDLE file_lock_t;
 
     inline string_t exe_suffix() { return _X(".exe"); }
 
@@ -131,12 +134,20 @@ namespace pal
     inline size_t strlen(const char_t* str) { return ::wcslen(str); }
     inline void err_vprintf(const char_t* format, va_list vl) { ::vfwprintf(stderr, format, vl); ::fputwc(_X('\n'), stderr); }
     inline void out_vprintf(const char_t* format, va_list vl) { ::vfwprintf(stdout, format, vl); ::fputwc(_X('\n'), stdout); }
+    inline void file_vprintf(FILE* f, const char_t* format, va_list vl) { ::vfwprintf(f, format, vl); ::fputwc(_X('\n'), f); }
+    inline FILE* file_open(const string_t& path, const char_t* mode) { return ::_wfsopen(path.c_str(), mode, _SH_DENYNO); }
 
     bool pal_utf8string(const pal::string_t& str, std::vector<char>* out);
     bool utf8_palstring(const std::string& str, pal::string_t* out);
     bool pal_clrstring(const pal::string_t& str, std::vector<char>* out);
     bool clr_palstring(const char* cstr, pal::string_t* out);
 
+    // Returns 'str' in the CLR encoding, transcoded into 'buffer' where the encodings differ.
+    const char* clr_cstr(const pal::string_t& str, std::vector<char>* buffer);
+
+    // Returns each of 'strs' in the CLR encoding, transcoded back to back into the single 'buffer'.
+    void clr_cstrs(const std::vector<const pal::string_t*>& strs, std::vector<char>* buffer, std::vector<const char*>* cstrs);
+
 #else
     #ifdef COREHOST_MAKE_DLL
         #define SHARED_API extern "C" __attribute__((__visibility__("default")))
@@ -163,6 +174,7 @@ namespace pal
     typedef int hresult_t;
     typedef void* dll_t;
     typedef void* proc_t;
+    typedef int file_lock_t;
 
     inline string_t exe_suffix() { return _X(""); }
 
@@ -181,10 +193,14 @@ namespace pal
     inline size_t strlen(const char_t* str) { return ::strlen(str); }
     inline void err_vprintf(const char_t* format, va_list vl) { ::vfprintf(stderr, format, vl); ::fputc('\n', stderr); }
     inline void out_vprintf(const char_t* format, va_list vl) { ::vfprintf(stdout, format, vl); ::fputc('\n', stdout); }
+    inline void file_vprintf(FILE* f, const char_t* format, va_list vl) { ::vfprintf(f, format, vl); ::fputc('\n', f); }
+    inline FILE* file_open(const string_t& path, const char_t* mode) { return ::fopen(path.c_str(), mode); }
     inline bool pal_utf8string(const pal::string_t& str, std::vector<char>* out) { out->assign(str.begin(), str.end()); out->push_back('\0'); return true; }
     inline bool utf8_palstring(const std::string& str, pal::string_t* out) { out->assign(str); return true; }
     inline bool pal_clrstring(const pal::string_t& str, std::vector<char>* out) { return pal_utf8string(str, out); }
     inline bool clr_palstring(const char* cstr, pal::string_t* out) { out->assign(cstr); return true; }
+    inline const char* clr_cstr(const pal::string_t& str, std::vector<char>* buffer) { return str.c_str(); }
+    inline void clr_cstrs(const std::vector<const pal::string_t*>& strs, std::vector<char>* buffer, std::vector<const char*>* cstrs) { for (const auto* str : strs) { cstrs->push_back(str->c_str()); } }
 
 #endif
 
@@ -201,8 +217,27 @@ namespace pal
     }
         
     bool touch_file(const pal::string_t& path);
+    bool rename_file(const pal::string_t& from, const pal::string_t& to);
+    bool remove_file(const pal::string_t& path);
+    int get_process_id();
+    const void* map_file_readonly(const string_t& path, size_t* length);
+    void unmap_file(const void* address, size_t length);
+    // Asks the OS to start reading the file into the cache without waiting for it.
+    bool readahead_file(const string_t& path);
+    // Takes an exclusive lock on the file, created if needed, without waiting for it. The OS
+    // releases the lock if the process exits without calling unlock_file.
+    bool try_lock_file(const string_t& path, file_lock_t* lock, bool* contended);
+    void unlock_file(file_lock_t lock);
+    // Returns the free pages of the heap to the OS, where the allocator keeps them otherwise.
+    void trim_heap();
     bool realpath(string_t* path, bool skip_error_logging = false);
+    // realpath may memoize what it resolves between these calls, which bracket a single
+    // resolution. Each one starts from an empty cache and the cache is emptied when the last
+    // one ends, so that long-lived hosts see later changes to the file system.
+    void begin_realpath_cache();
+    void end_realpath_cache();
     bool file_exists(const string_t& path);
+    bool get_file_stamp(const string_t& path, int64_t* last_write_time, int64_t* size);
     inline bool directory_exists(const string_t& path) { return file_exists(path); }
     void readdir(const string_t& path, const string_t& pattern, std::vector<pal::string_t>* list);
     void readdir(const string_t& path, std::vector<pal::string_t>* list);
@@ -4,16 +4,27 @@
 #include "pal.h"
 #include "utils.h"
 #include "trace.h"
+#include "timing.h"
+#include "host_env.h"
 
 #include <cassert>
 #include <dlfcn.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
 #include <sys/types.h>
 #include <pwd.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <fnmatch.h>
+#include <climits>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #if defined(__APPLE__)
 #include <mach-o/dyld.h>
@@ -48,6 +59,124 @@ bool pal::touch_file(const pal::string_t& path)
     return true;
 }
 
+bool pal::rename_file(const pal::string_t& from, const pal::string_t& to)
+{
+    if (::rename(from.c_str(), to.c_str()) != 0)
+    {
+        trace::verbose(_X("rename(%s, %s) failed in %s"), from.c_str(), to.c_str(), _STRINGIFY(__FUNCTION__));
+        return false;
+    }
+    return true;
+}
+
+bool pal::remove_file(const pal::string_t& path)
+{
+    if (::unlink(path.c_str()) != 0)
+    {
+        trace::verbose(_X("unlink(%s) failed in %s"), path.c_str(), _STRINGIFY(__FUNCTION__));
+        return false;
+    }
+    return true;
+}
+
+int pal::get_process_id()
+{
+    return (int) ::getpid();
+}
+
+const void* pal::map_file_readonly(const pal::string_t& path, size_t* length)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
+
+    struct stat buf;
+    if (fstat(fd, &buf) != 0 || buf.st_size == 0)
+    {
+        (void) close(fd);
+        return nullptr;
+    }
+
+    void* address = mmap(nullptr, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    (void) close(fd);
+
+    if (address == MAP_FAILED)
+    {
+        trace::verbose(_X("mmap(%s) failed in %s"), path.c_str(), _STRINGIFY(__FUNCTION__));
+        return nullptr;
+    }
+
+    *length = buf.st_size;
+    return address;
+}
+
+void pal::unmap_file(const void* address, size_t length)
+{
+    (void) munmap(const_cast<void*>(address), length);
+}
+
+void pal::trim_heap()
+{
+#if defined(__GLIBC__)
+    (void) malloc_trim(0);
+#endif
+}
+
+bool pal::readahead_file(const pal::string_t& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+#if defined(__APPLE__)
+    struct stat buf;
+    struct radvisory advice;
+    bool advised = fstat(fd, &buf) == 0;
+    if (advised)
+    {
+        advice.ra_offset = 0;
+        advice.ra_count = (int) std::min<off_t>(buf.st_size, INT_MAX);
+        advised = fcntl(fd, F_RDADVISE, &advice) != -1;
+    }
+#else
+    bool advised = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+#endif
+
+    (void) close(fd);
+    return advised;
+}
+
+bool pal::try_lock_file(const pal::string_t& path, pal::file_lock_t* lock, bool* contended)
+{
+    *contended = false;
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH));
+    if (fd == -1)
+    {
+        trace::verbose(_X("open(%s) failed in %s"), path.c_str(), _STRINGIFY(__FUNCTION__));
+        return false;
+    }
+
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        *contended = (errno == EWOULDBLOCK);
+        (void) close(fd);
+        return false;
+    }
+
+    *lock = fd;
+    return true;
+}
+
+void pal::unlock_file(pal::file_lock_t lock)
+{
+    // Closing the descriptor releases the lock.
+    (void) close(lock);
+}
+
 bool pal::getcwd(pal::string_t* recv)
 {
     recv->clear();
@@ -71,7 +200,7 @@ bool pal::load_library(const string_t* path, dll_t* dll)
     *dll = dlopen(path->c_str(), RTLD_LAZY);
     if (*dll == nullptr)
     {
-        trace::error(_X("Failed to load %s, error: %s"), path, dlerror());
+        trace::error(_X("Failed to load %s, error: %s"), path->c_str(), dlerror());
         return false;
     }
     return true;
@@ -110,7 +239,7 @@ bool pal::get_default_breadcrumb_store(string_t* recv)
 {
     recv->clear();
     pal::string_t ext;
-    if (pal::getenv(_X("CORE_BREADCRUMBS"), &ext) && pal::realpath(&ext))
+    if (host_env::get(host_env::breadcrumbs, &ext) && pal::realpath(&ext))
     {
         // We should have the path in ext.
         trace::info(_X("Realpath CORE_BREADCRUMBS [%s]"), ext.c_str());
@@ -142,7 +271,7 @@ bool pal::get_default_servicing_directory(string_t* recv)
 {
     recv->clear();
     pal::string_t ext;
-    if (pal::getenv(_X("CORE_SERVICING"), &ext) && pal::realpath(&ext))
+    if (host_env::get(host_env::servicing, &ext) && pal::realpath(&ext))
     {
         // We should have the path in ext.
         trace::info(_X("Realpath CORE_SERVICING [%s]"), ext.c_str());
@@ -216,7 +345,8 @@ pal::string_t trim_quotes(pal::string_t stringToCleanup)
 }
 
 #if defined(__APPLE__)
-pal::string_t pal::get_current_os_rid_platform()
+static
+pal::string_t compute_current_os_rid_platform()
 {
     pal::string_t ridOS;
 
@@ -257,7 +387,8 @@ pal::string_t pal::get_current_os_rid_platform()
 }
 #elif defined(__FreeBSD__)
 // On FreeBSD get major verion. Minors should be compatible
-pal::string_t pal::get_current_os_rid_platform()
+static
+pal::string_t compute_current_os_rid_platform()
 {
     pal::string_t ridOS;
 
@@ -315,7 +446,8 @@ pal::string_t normalize_linux_rid(pal::string_t rid)
     return rid;
 }
 
-pal::string_t pal::get_current_os_rid_platform()
+static
+pal::string_t compute_current_os_rid_platform()
 {
     pal::string_t ridOS;
     pal::string_t versionFile(_X("/etc/os-release"));
@@ -433,6 +565,13 @@ pal::string_t pal::get_current_os_rid_platform()
 }
 #endif
 
+pal::string_t pal::get_current_os_rid_platform()
+{
+    // The OS cannot change while the process runs, but every framework layer asks for the RID.
+    static const pal::string_t rid = compute_current_os_rid_platform();
+    return rid;
+}
+
 #if defined(__APPLE__)
 bool pal::get_own_executable_path(pal::string_t* recv)
 {
@@ -510,18 +649,198 @@ bool pal::getenv(const pal::char_t* name, pal::string_t* recv)
     return (recv->length() > 0);
 }
 
+#if !defined(MAXSYMLINKS)
+#define MAXSYMLINKS 40
+#endif
+
+namespace
+{
+    struct realpath_entry_t
+    {
+        pal::string_t path;
+        bool is_dir;
+    };
+
+    // Canonical form of every path component resolved so far in the open scopes, keyed by its
+    // canonical parent and name. The same dotnet root, shared store and probe directories are
+    // canonicalized many times during a launch, so their prefixes only need to be walked once.
+    // Only components that exist are remembered, and only while a scope is open: the file
+    // system may change between the calls of a long-lived host.
+    std::mutex g_realpath_lock;
+    std::unordered_map<pal::string_t, realpath_entry_t> g_realpath_cache;
+    int g_realpath_cache_scopes = 0;
+
+    // Appends the components of 'path' to the canonical directory 'resolved' ("" is the root),
+    // following symbolic links like ::realpath does. Returns 0 or an errno value.
+    int resolve_components(pal::string_t* resolved, bool* is_dir, const pal::string_t& path, int* links, bool cached)
+    {
+        size_t pos = 0;
+        while (pos <= path.length())
+        {
+            size_t end = path.find('/', pos);
+            if (end == pal::string_t::npos)
+            {
+                end = path.length();
+            }
+
+            if (!*is_dir)
+            {
+                return ENOTDIR;
+            }
+
+            size_t length = end - pos;
+            const pal::char_t* name = path.c_str() + pos;
+            pos = end + 1;
+
+            if (length == 0 || (length == 1 && name[0] == '.'))
+            {
+                continue;
+            }
+
+            if (length == 2 && name[0] == '.' && name[1] == '.')
+            {
+                // The prefix is canonical, so its parent is simply the preceding component.
+                size_t slash = resolved->rfind('/');
+                resolved->erase(slash == pal::string_t::npos ? 0 : slash);
+                continue;
+            }
+
+            pal::string_t candidate = *resolved;
+            candidate.push_back('/');
+            candidate.append(name, length);
+
+            if (cached)
+            {
+                auto iter = g_realpath_cache.find(candidate);
+                if (iter != g_realpath_cache.end())
+                {
+                    *resolved = iter->second.path;
+                    *is_dir = iter->second.is_dir;
+                    continue;
+                }
+            }
+
+            timing::increment(timing::file_stats);
+            struct stat buffer;
+            if (::lstat(candidate.c_str(), &buffer) != 0)
+            {
+                return errno;
+            }
+
+            realpath_entry_t entry;
+            if (S_ISLNK(buffer.st_mode))
+            {
+                if (++(*links) > MAXSYMLINKS)
+                {
+                    return ELOOP;
+                }
+
+                char target[PATH_MAX];
+                ssize_t target_length = ::readlink(candidate.c_str(), target, sizeof(target));
+                if (target_length < 0)
+                {
+                    return errno;
+                }
+                if (target_length == sizeof(target))
+                {
+                    return ENAMETOOLONG;
+                }
+
+                pal::string_t link(target, target_length);
+                entry.path = link[0] == '/' ? pal::string_t() : *resolved;
+                entry.is_dir = true;
+                int error = resolve_components(&entry.path, &entry.is_dir, link, links, cached);
+                if (error != 0)
+                {
+                    return error;
+                }
+            }
+            else
+            {
+                entry.path = candidate;
+                entry.is_dir = S_ISDIR(buffer.st_mode);
+            }
+
+            *resolved = entry.path;
+            *is_dir = entry.is_dir;
+            if (cached)
+            {
+                g_realpath_cache.emplace(std::move(candidate), std::move(entry));
+            }
+        }
+
+        return 0;
+    }
+
+    int resolve_path(const pal::string_t& path, pal::string_t* resolved)
+    {
+        if (path.empty())
+        {
+            return ENOENT;
+        }
+
+        resolved->clear();
+        if (path[0] != '/')
+        {
+            char* cwd = ::getcwd(nullptr, 0);
+            if (cwd == nullptr)
+            {
+                return errno;
+            }
+
+            resolved->assign(cwd);
+            ::free(cwd);
+            if (resolved->length() == 1)
+            {
+                resolved->clear();
+            }
+        }
+
+        bool is_dir = true;
+        int links = 0;
+        std::lock_guard<std::mutex> lock(g_realpath_lock);
+        int error = resolve_components(resolved, &is_dir, path, &links, g_realpath_cache_scopes > 0);
+        if (error == 0 && resolved->empty())
+        {
+            resolved->push_back('/');
+        }
+
+        return error;
+    }
+}
+
+// A scope that begins while another is open still starts over, since it may be a call made by
+// the app that the other one launched.
+void pal::begin_realpath_cache()
+{
+    std::lock_guard<std::mutex> lock(g_realpath_lock);
+    ++g_realpath_cache_scopes;
+    g_realpath_cache.clear();
+}
+
+void pal::end_realpath_cache()
+{
+    std::lock_guard<std::mutex> lock(g_realpath_lock);
+    if (--g_realpath_cache_scopes == 0)
+    {
+        std::unordered_map<pal::string_t, realpath_entry_t>().swap(g_realpath_cache);
+    }
+}
+
 bool pal::realpath(pal::string_t* path, bool skip_error_logging)
 {
-    auto resolved = ::realpath(path->c_str(), nullptr);
-    if (resolved == nullptr)
+    pal::string_t resolved;
+    int error = resolve_path(*path, &resolved);
+    if (error != 0)
     {
-        if (errno == ENOENT)
+        if (error == ENOENT)
         {
             return false;
         }
 
         if (!skip_error_logging)
         {
+            errno = error;
             perror("realpath()");
         }
         
@@ -529,7 +848,6 @@ bool pal::realpath(pal::string_t* path, bool skip_error_logging)
     }
 
     path->assign(resolved);
-    ::free(resolved);
     return true;
 }
 
@@ -539,82 +857,135 @@ bool pal::file_exists(const pal::string_t& path)
     {
         return false;
     }
+    timing::increment(timing::file_stats);
     struct stat buffer;
     return (::stat(path.c_str(), &buffer) == 0);
 }
 
+bool pal::get_file_stamp(const pal::string_t& path, int64_t* last_write_time, int64_t* size)
+{
+    timing::increment(timing::file_stats);
+    struct stat buffer;
+    if (path.empty() || ::stat(path.c_str(), &buffer) != 0)
+    {
+        return false;
+    }
+
+#if defined(__APPLE__)
+    *last_write_time = (int64_t)buffer.st_mtimespec.tv_sec * 1000000000 + buffer.st_mtimespec.tv_nsec;
+#else
+    *last_write_time = (int64_t)buffer.st_mtim.tv_sec * 1000000000 + buffer.st_mtim.tv_nsec;
+#endif
+    *size = (int64_t)buffer.st_size;
+    return true;
+}
+
+namespace
+{
+    // Patterns of the form "*<suffix>" are matched with a compare instead of fnmatch;
+    // "*" itself is the suffix-less case and matches every name.
+    bool get_pattern_suffix(const pal::string_t& pattern, const char** suffix)
+    {
+        if (pattern.empty() || pattern[0] != '*' || pattern.find_first_of(_X("*?[\\"), 1) != pal::string_t::npos)
+        {
+            return false;
+        }
+
+        *suffix = pattern.c_str() + 1;
+        return true;
+    }
+
+    bool matches_suffix(const char* name, size_t name_len, const char* suffix, size_t suffix_len)
+    {
+        return name_len >= suffix_len && memcmp(name + name_len - suffix_len, suffix, suffix_len) == 0;
+    }
+}
+
 static void readdir(const pal::string_t& path, const pal::string_t& pattern, bool onlydirectories, std::vector<pal::string_t>* list)
 {
     assert(list != nullptr);
 
+    timing::increment(timing::dir_listings);
     std::vector<pal::string_t>& files = *list;
 
     auto dir = opendir(path.c_str());
-    if (dir != nullptr)
+    if (dir == nullptr)
+    {
+        return;
+    }
+
+    const char* suffix = nullptr;
+    bool use_suffix = get_pattern_suffix(pattern, &suffix);
+    size_t suffix_len = use_suffix ? strlen(suffix) : 0;
+
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr)
     {
-        struct dirent* entry = nullptr;
-        while ((entry = readdir(dir)) != nullptr)
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
         {
-            if (fnmatch(pattern.c_str(), entry->d_name, FNM_PATHNAME) != 0)
+            continue;
+        }
+
+        if (use_suffix)
+        {
+            if (!matches_suffix(name, strlen(name), suffix, suffix_len))
             {
                 continue;
             }
-             
-            // We are interested in files only
-            switch (entry->d_type)
+        }
+        else if (fnmatch(pattern.c_str(), name, FNM_PATHNAME) != 0)
+        {
+            continue;
+        }
+
+        // We are interested in files only
+        switch (entry->d_type)
+        {
+        case DT_DIR:
+            break;
+
+        case DT_REG:
+            if (onlydirectories)
             {
-            case DT_DIR:
-                break;
+                continue;
+            }
+            break;
 
-            case DT_REG:
-                if (onlydirectories)
+        // Handle symlinks and file systems that do not support d_type
+        case DT_LNK:
+        case DT_UNKNOWN:
+            {
+                // Resolve the entry relative to the open directory rather than by full path.
+                struct stat sb;
+                if (fstatat(dirfd(dir), name, &sb, 0) == -1)
                 {
                     continue;
                 }
-                break;
 
-            // Handle symlinks and file systems that do not support d_type
-            case DT_LNK:
-            case DT_UNKNOWN:
+                if (onlydirectories)
                 {
-                    std::string fullFilename;
-
-                    fullFilename.append(path);
-                    fullFilename.push_back(DIR_SEPARATOR);
-                    fullFilename.append(entry->d_name);
-
-                    struct stat sb;
-                    if (stat(fullFilename.c_str(), &sb) == -1)
-                    {
-                        continue;
-                    }
-
-                    if (onlydirectories)
-                    {
-                        if (!S_ISDIR(sb.st_mode))
-                        {
-                            continue;
-                        }
-                        break;
-                    }
-                    else if (!S_ISREG(sb.st_mode) && !S_ISDIR(sb.st_mode))
+                    if (!S_ISDIR(sb.st_mode))
                     {
                         continue;
                     }
+                    break;
+                }
+                else if (!S_ISREG(sb.st_mode) && !S_ISDIR(sb.st_mode))
+                {
+                    continue;
                 }
-                break;
-
-            default:
-                continue;
             }
+            break;
 
-            pal::string_t filepath(entry->d_name);
-            if (filepath != _X(".") && filepath != _X(".."))
-            {
-                files.push_back(filepath);
-            }
+        default:
+            continue;
         }
+
+        files.emplace_back(name);
     }
+
+    closedir(dir);
 }
 
 void pal::readdir(const string_t& path, const string_t& pattern, std::vector<pal::string_t>* list)
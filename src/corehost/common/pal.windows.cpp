@@ -3,6 +3,7 @@
 
 #include "pal.h"
 #include "trace.h"
+#include "timing.h"
 #include "utils.h"
 #include "longfile.h"
 
@@ -11,6 +12,10 @@
 #include <codecvt>
 #include <ShlObj.h>
 
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
 bool GetModuleFileNameWrapper(HMODULE hModule, pal::string_t* recv)
 {
     pal::string_t path;
@@ -56,6 +61,133 @@ bool pal::touch_file(const pal::string_t& path)
     return true;
 }
 
+bool pal::rename_file(const pal::string_t& from, const pal::string_t& to)
+{
+    if (!::MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        trace::verbose(_X("Failed to rename [%s] to [%s], HRESULT: 0x%X"), from.c_str(), to.c_str(), HRESULT_FROM_WIN32(GetLastError()));
+        return false;
+    }
+    return true;
+}
+
+bool pal::remove_file(const pal::string_t& path)
+{
+    if (!::DeleteFileW(path.c_str()))
+    {
+        trace::verbose(_X("Failed to delete [%s], HRESULT: 0x%X"), path.c_str(), HRESULT_FROM_WIN32(GetLastError()));
+        return false;
+    }
+    return true;
+}
+
+int pal::get_process_id()
+{
+    return (int) ::GetCurrentProcessId();
+}
+
+const void* pal::map_file_readonly(const pal::string_t& path, size_t* length)
+{
+    HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        ::CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE map = ::CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    ::CloseHandle(file);
+    if (map == NULL)
+    {
+        trace::verbose(_X("Failed to map [%s], HRESULT: 0x%X"), path.c_str(), HRESULT_FROM_WIN32(GetLastError()));
+        return nullptr;
+    }
+
+    const void* address = ::MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(map);
+    if (address == NULL)
+    {
+        trace::verbose(_X("Failed to map a view of [%s], HRESULT: 0x%X"), path.c_str(), HRESULT_FROM_WIN32(GetLastError()));
+        return nullptr;
+    }
+
+    *length = (size_t)size.QuadPart;
+    return address;
+}
+
+void pal::unmap_file(const void* address, size_t length)
+{
+    ::UnmapViewOfFile(address);
+}
+
+void pal::trim_heap()
+{
+    // Decommits the free blocks at the end of the process heap, the CRT allocates from it.
+    (void) ::HeapCompact(::GetProcessHeap(), 0);
+}
+
+bool pal::readahead_file(const pal::string_t& path)
+{
+    // PrefetchVirtualMemory is only available starting with Windows 8.
+    typedef BOOL (WINAPI *prefetch_virtual_memory_fn)(HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
+    static prefetch_virtual_memory_fn prefetch_virtual_memory =
+        (prefetch_virtual_memory_fn)::GetProcAddress(::GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory");
+    if (prefetch_virtual_memory == nullptr)
+    {
+        return false;
+    }
+
+    size_t length;
+    const void* address = map_file_readonly(path, &length);
+    if (address == nullptr)
+    {
+        return false;
+    }
+
+    // The pages are read into the file cache asynchronously, so they outlive the view.
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<void*>(address);
+    range.NumberOfBytes = length;
+    bool prefetched = prefetch_virtual_memory(::GetCurrentProcess(), 1, &range, 0) != FALSE;
+
+    unmap_file(address, length);
+    return prefetched;
+}
+
+bool pal::try_lock_file(const pal::string_t& path, pal::file_lock_t* lock, bool* contended)
+{
+    *contended = false;
+    HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        trace::verbose(_X("Failed to open lock file [%s], HRESULT: 0x%X"), path.c_str(), HRESULT_FROM_WIN32(GetLastError()));
+        return false;
+    }
+
+    OVERLAPPED overlapped = {};
+    if (!::LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, MAXDWORD, MAXDWORD, &overlapped))
+    {
+        *contended = (GetLastError() == ERROR_LOCK_VIOLATION);
+        ::CloseHandle(file);
+        return false;
+    }
+
+    *lock = file;
+    return true;
+}
+
+void pal::unlock_file(pal::file_lock_t lock)
+{
+    // Closing the handle releases the lock.
+    ::CloseHandle(lock);
+}
+
 bool pal::getcwd(pal::string_t* recv)
 {
     recv->clear();
@@ -197,7 +329,8 @@ bool pal::get_global_dotnet_dirs(std::vector<pal::string_t>* dirs)
     return true;
 }
 
-bool pal::get_default_installation_dir(pal::string_t* recv)
+static
+bool compute_default_installation_dir(pal::string_t* recv)
 {
     pal::char_t* program_files_dir;
     if (pal::is_running_in_wow64())
@@ -218,11 +351,32 @@ bool pal::get_default_installation_dir(pal::string_t* recv)
     return true;
 }
 
+bool pal::get_default_installation_dir(pal::string_t* recv)
+{
+    // The location cannot change while the process runs, but the apphost and every framework
+    // and SDK resolution in hostfxr ask for it.
+    struct location_t
+    {
+        bool found;
+        pal::string_t dir;
+    };
+    static const location_t location = []()
+    {
+        location_t l;
+        l.found = compute_default_installation_dir(&l.dir);
+        return l;
+    }();
+
+    recv->assign(location.dir);
+    return location.found;
+}
+
 // To determine the OS version, we are going to use RtlGetVersion API
 // since GetVersion call can be shimmed on Win8.1+.
 typedef NTSTATUS (WINAPI *pFuncRtlGetVersion)(RTL_OSVERSIONINFOW *);
 
-pal::string_t pal::get_current_os_rid_platform()
+static
+pal::string_t compute_current_os_rid_platform()
 {
     pal::string_t ridOS;
     
@@ -286,6 +440,13 @@ pal::string_t pal::get_current_os_rid_platform()
     return ridOS;
 }
 
+pal::string_t pal::get_current_os_rid_platform()
+{
+    // The OS cannot change while the process runs, but every framework layer asks for the RID.
+    static const pal::string_t rid = compute_current_os_rid_platform();
+    return rid;
+}
+
 bool pal::is_path_rooted(const string_t& path)
 {
     return path.length() >= 2 && path[1] == L':';
@@ -329,37 +490,118 @@ bool pal::get_own_executable_path(string_t* recv)
     return GetModuleFileNameWrapper(NULL, recv);
 }
 
-static bool wchar_convert_helper(DWORD code_page, const char* cstr, int len, pal::string_t* out)
+namespace
 {
-    out->clear();
+    // Copies the leading ASCII run of 'str' to 'out', narrowing each character, and returns its
+    // length. ASCII is encoded identically in UTF-16 and UTF-8, so only the rest needs the OS.
+    size_t narrow_ascii(const wchar_t* str, size_t len, char* out)
+    {
+        size_t i = 0;
+#if defined(_M_X64) || defined(_M_IX86)
+        const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xff80));
+        for (; i + 16 <= len; i += 16)
+        {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i + 8));
+            __m128i mask = _mm_and_si128(_mm_or_si128(lo, hi), non_ascii);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(mask, _mm_setzero_si128())) != 0xffff)
+            {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; i < len && str[i] < 0x80; ++i)
+        {
+            out[i] = static_cast<char>(str[i]);
+        }
+        return i;
+    }
 
-    // No need of explicit null termination, so pass in the actual length.
-    size_t size = ::MultiByteToWideChar(code_page, 0, cstr, len, nullptr, 0);
-    if (size == 0)
+    // Widening counterpart of narrow_ascii.
+    size_t widen_ascii(const char* str, size_t len, wchar_t* out)
     {
-        return false;
+        size_t i = 0;
+#if defined(_M_X64) || defined(_M_IX86)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= len; i += 16)
+        {
+            __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+            if (_mm_movemask_epi8(chars) != 0)
+            {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(chars, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(chars, zero));
+        }
+#endif
+        for (; i < len && static_cast<unsigned char>(str[i]) < 0x80; ++i)
+        {
+            out[i] = static_cast<wchar_t>(str[i]);
+        }
+        return i;
+    }
+
+    // Appends 'str' as null terminated UTF-8 to 'out'; on failure 'out' is left as it was.
+    bool append_utf8(const wchar_t* str, size_t len, std::vector<char>* out)
+    {
+        size_t start = out->size();
+        out->resize(start + len + 1, '\0');
+        size_t ascii = narrow_ascii(str, len, out->data() + start);
+        if (ascii == len)
+        {
+            return true;
+        }
+
+        // An ASCII character never ends a surrogate pair, so the remainder converts on its own.
+        int rest = static_cast<int>(len - ascii);
+        int size = ::WideCharToMultiByte(CP_UTF8, 0, str + ascii, rest, nullptr, 0, nullptr, nullptr);
+        if (size == 0)
+        {
+            out->resize(start);
+            return false;
+        }
+        out->resize(start + ascii + size + 1, '\0');
+        if (::WideCharToMultiByte(CP_UTF8, 0, str + ascii, rest, out->data() + start + ascii, size, nullptr, nullptr) == 0)
+        {
+            out->resize(start);
+            return false;
+        }
+        (*out)[start + ascii + size] = '\0';
+        return true;
+    }
+
+    bool utf8_convert_helper(const char* cstr, size_t len, pal::string_t* out)
+    {
+        out->assign(len, _X('\0'));
+        size_t ascii = widen_ascii(cstr, len, &(*out)[0]);
+        if (ascii == len)
+        {
+            return true;
+        }
+
+        // No need of explicit null termination, so pass in the actual length.
+        int rest = static_cast<int>(len - ascii);
+        int size = ::MultiByteToWideChar(CP_UTF8, 0, cstr + ascii, rest, nullptr, 0);
+        if (size == 0)
+        {
+            out->clear();
+            return false;
+        }
+        out->resize(ascii + size, '\0');
+        return ::MultiByteToWideChar(CP_UTF8, 0, cstr + ascii, rest, &(*out)[ascii], size) != 0;
     }
-    out->resize(size, '\0');
-    return ::MultiByteToWideChar(code_page, 0, cstr, len, &(*out)[0], out->size()) != 0;
 }
 
 bool pal::utf8_palstring(const std::string& str, pal::string_t* out)
 {
-    return wchar_convert_helper(CP_UTF8, &str[0], str.size(), out);
+    return utf8_convert_helper(str.data(), str.size(), out);
 }
 
 bool pal::pal_utf8string(const pal::string_t& str, std::vector<char>* out)
 {
     out->clear();
-
-    // Pass -1 as we want explicit null termination in the char buffer.
-    size_t size = ::WideCharToMultiByte(CP_UTF8, 0, str.c_str(), -1, nullptr, 0, nullptr, nullptr);
-    if (size == 0)
-    {
-        return false;
-    }
-    out->resize(size, '\0');
-    return ::WideCharToMultiByte(CP_UTF8, 0, str.c_str(), -1, out->data(), out->size(), nullptr, nullptr) != 0;
+    return append_utf8(str.c_str(), str.size(), out);
 }
 
 bool pal::pal_clrstring(const pal::string_t& str, std::vector<char>* out)
@@ -369,7 +611,54 @@ bool pal::pal_clrstring(const pal::string_t& str, std::vector<char>* out)
 
 bool pal::clr_palstring(const char* cstr, pal::string_t* out)
 {
-    return wchar_convert_helper(CP_UTF8, cstr, ::strlen(cstr), out);
+    return utf8_convert_helper(cstr, ::strlen(cstr), out);
+}
+
+const char* pal::clr_cstr(const pal::string_t& str, std::vector<char>* buffer)
+{
+    if (!pal_clrstring(str, buffer) || buffer->empty())
+    {
+        buffer->assign(1, '\0');
+    }
+    return buffer->data();
+}
+
+void pal::clr_cstrs(const std::vector<const pal::string_t*>& strs, std::vector<char>* buffer, std::vector<const char*>* cstrs)
+{
+    // ASCII converts one to one, so this is usually the only allocation.
+    size_t total = 0;
+    for (const auto* str : strs)
+    {
+        total += str->size() + 1;
+    }
+
+    buffer->clear();
+    buffer->reserve(total);
+
+    // The buffer may still grow for non-ASCII strings, so record offsets until it is complete.
+    std::vector<size_t> offsets;
+    for (const auto* str : strs)
+    {
+        offsets.push_back(buffer->size());
+        if (!append_utf8(str->c_str(), str->size(), buffer))
+        {
+            buffer->push_back('\0');
+        }
+    }
+
+    for (size_t offset : offsets)
+    {
+        cstrs->push_back(buffer->data() + offset);
+    }
+}
+
+// The full path is not resolved component by component, so there is nothing to memoize.
+void pal::begin_realpath_cache()
+{
+}
+
+void pal::end_realpath_cache()
+{
 }
 
 // Return if path is valid and file exists, return true and adjust path as appropriate.
@@ -447,14 +736,41 @@ bool pal::file_exists(const string_t& path)
         return false;
     }
 
+    timing::increment(timing::file_stats);
     string_t tmp(path);
     return pal::realpath(&tmp, true);
 }
 
+bool pal::get_file_stamp(const string_t& path, int64_t* last_write_time, int64_t* size)
+{
+    if (path.empty())
+    {
+        return false;
+    }
+
+    string_t normalized_path(path);
+    if (LongFile::ShouldNormalize(normalized_path) && !pal::realpath(&normalized_path, true))
+    {
+        return false;
+    }
+
+    timing::increment(timing::file_stats);
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (GetFileAttributesExW(normalized_path.c_str(), GetFileExInfoStandard, &data) == 0)
+    {
+        return false;
+    }
+
+    *last_write_time = ((int64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    *size = ((int64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    return true;
+}
+
 static void readdir(const pal::string_t& path, const pal::string_t& pattern, bool onlydirectories, std::vector<pal::string_t>* list)
 {
     assert(list != nullptr);
 
+    timing::increment(timing::dir_listings);
     std::vector<pal::string_t>& files = *list;
     pal::string_t normalized_path(path);
 
@@ -471,7 +787,14 @@ static void readdir(const pal::string_t& path, const pal::string_t& pattern, boo
 
     WIN32_FIND_DATAW data = { 0 };
 
-    auto handle = ::FindFirstFileExW(search_string.c_str(), FindExInfoStandard, &data, FindExSearchNameMatch, NULL, 0);
+    // Short names are never used, and large fetches cut the number of kernel round trips for
+    // the big framework and store directories. Both need Windows 7, so fall back before that.
+    auto handle = ::FindFirstFileExW(search_string.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (handle == INVALID_HANDLE_VALUE && ::GetLastError() == ERROR_INVALID_PARAMETER)
+    {
+        handle = ::FindFirstFileExW(search_string.c_str(), FindExInfoStandard, &data, FindExSearchNameMatch, NULL, 0);
+    }
+
     if (handle == INVALID_HANDLE_VALUE)
     {
         return;
@@ -480,10 +803,10 @@ static void readdir(const pal::string_t& path, const pal::string_t& pattern, boo
     {
         if (!onlydirectories || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
         {
-            pal::string_t filepath(data.cFileName);
-            if (filepath != _X(".") && filepath != _X(".."))
+            const wchar_t* name = data.cFileName;
+            if (name[0] != L'.' || (name[1] != L'\0' && (name[1] != L'.' || name[2] != L'\0')))
             {
-                files.push_back(filepath);
+                files.emplace_back(name);
             }
         }
     } while (::FindNextFileW(handle, &data));
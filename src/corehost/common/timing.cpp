@@ -0,0 +1,191 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "timing.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+namespace
+{
+    bool g_timing_enabled = false;
+    pal::string_t g_timing_file;
+    std::mutex g_timing_lock;
+    std::atomic<int64_t> g_counters[timing::counter::count];
+    std::atomic<int64_t> g_durations[timing::duration_count];
+
+    const pal::char_t* const counter_names[timing::counter::count] = {
+        _X("file_stats"), _X("dir_listings"), _X("files_parsed"), _X("bytes_read"),
+        _X("fx_resolutions"), _X("fx_versions_considered"),
+        _X("probe_hits_servicing"), _X("probe_misses_servicing"),
+        _X("probe_hits_app"), _X("probe_misses_app"),
+        _X("probe_hits_fx"), _X("probe_misses_fx"),
+        _X("probe_hits_lookup"), _X("probe_misses_lookup")
+    };
+
+    const pal::char_t* const duration_names[timing::duration_count] = {
+        _X("resolve_fx_us"), _X("resolve_dependencies_us"), _X("coreclr_bind_us"), _X("coreclr_initialize_us")
+    };
+
+    int64_t now_us()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void append_json_string(pal::stringstream_t& out, const pal::string_t& value)
+    {
+        out << _X('"');
+        for (pal::char_t c : value)
+        {
+            if (c == _X('"') || c == _X('\\'))
+            {
+                out << _X('\\');
+            }
+            out << c;
+        }
+        out << _X('"');
+    }
+
+    void err_print(const pal::char_t* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        pal::err_vprintf(format, args);
+        va_end(args);
+    }
+
+    void report(const pal::string_t& line)
+    {
+        std::lock_guard<std::mutex> lock(g_timing_lock);
+        if (g_timing_file.empty())
+        {
+            err_print(_X("%s"), line.c_str());
+            return;
+        }
+
+        std::vector<char> utf8;
+        pal::pal_utf8string(line, &utf8);
+
+        std::ofstream file(g_timing_file, std::ios::out | std::ios::app);
+        file << utf8.data() << '\n';
+    }
+}
+
+//
+// Turn on phase timing for the corehost based on "COREHOST_TRACE_TIMING" env.
+//
+void timing::setup()
+{
+    pal::string_t timing_str;
+    if (!pal::getenv(_X("COREHOST_TRACE_TIMING"), &timing_str) || timing_str == _X("0"))
+    {
+        return;
+    }
+
+    g_timing_file = timing_str == _X("1") ? pal::string_t() : timing_str;
+    g_timing_enabled = true;
+}
+
+bool timing::is_enabled()
+{
+    return g_timing_enabled;
+}
+
+void timing::increment(counter c)
+{
+    g_counters[c].fetch_add(1, std::memory_order_relaxed);
+}
+
+void timing::add(counter c, int64_t value)
+{
+    g_counters[c].fetch_add(value, std::memory_order_relaxed);
+}
+
+void timing::get_stats(std::vector<const pal::char_t*>* names, std::vector<int64_t>* values)
+{
+    for (int i = 0; i < counter::count; ++i)
+    {
+        names->push_back(counter_names[i]);
+        values->push_back(g_counters[i].load(std::memory_order_relaxed));
+    }
+
+    for (int i = 0; i < duration_count; ++i)
+    {
+        names->push_back(duration_names[i]);
+        values->push_back(g_durations[i].load(std::memory_order_relaxed));
+    }
+}
+
+timing::phase_t::phase_t(const pal::char_t* name, const pal::string_t& detail)
+    : phase_t(name, duration_count, detail)
+{
+}
+
+timing::phase_t::phase_t(const pal::char_t* name, duration slot, const pal::string_t& detail)
+    : m_name(name)
+    , m_slot(slot)
+    , m_report(g_timing_enabled)
+    , m_active(g_timing_enabled || slot != duration_count)
+    , m_start(0)
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    if (m_report)
+    {
+        m_detail = detail;
+        for (int i = 0; i < counter::count; ++i)
+        {
+            m_counters[i] = g_counters[i].load(std::memory_order_relaxed);
+        }
+    }
+    m_start = now_us();
+}
+
+timing::phase_t::~phase_t()
+{
+    end();
+}
+
+void timing::phase_t::end()
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    m_active = false;
+    int64_t duration = now_us() - m_start;
+
+    if (m_slot != duration_count)
+    {
+        g_durations[m_slot].fetch_add(duration, std::memory_order_relaxed);
+    }
+
+    if (!m_report)
+    {
+        return;
+    }
+
+    pal::stringstream_t line;
+    line << _X("{\"phase\":");
+    append_json_string(line, m_name);
+    if (!m_detail.empty())
+    {
+        line << _X(",\"detail\":");
+        append_json_string(line, m_detail);
+    }
+    line << _X(",\"start_us\":") << m_start << _X(",\"duration_us\":") << duration;
+    for (int i = 0; i < counter::count; ++i)
+    {
+        line << _X(",\"") << counter_names[i] << _X("\":") << (g_counters[i].load(std::memory_order_relaxed) - m_counters[i]);
+    }
+    line << _X("}");
+
+    report(line.str());
+}
@@ -0,0 +1,85 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "pal.h"
+
+/**
+ * Startup phase timing, enabled through the "COREHOST_TRACE_TIMING" env.
+ *
+ * A value of 1 reports to stderr, any other value is the path of a file the
+ * reports are appended to. Each finished phase is reported as one JSON object
+ * per line with its monotonic start time and duration in microseconds and the
+ * file system operations and files parsed while it ran.
+ *
+ * The counters, and the durations of the phases that name a duration slot, are
+ * kept for the whole process whether or not the env is set, and are returned by
+ * the startup statistics APIs (hostfxr_get_startup_stats).
+ */
+namespace timing
+{
+    enum counter
+    {
+        file_stats = 0,
+        dir_listings,
+        files_parsed,
+        bytes_read,
+        fx_resolutions,
+        fx_versions_considered,
+
+        // Hits and misses of the deps entry probes, by kind of probe configuration.
+        probe_hits_servicing,
+        probe_misses_servicing,
+        probe_hits_app,
+        probe_misses_app,
+        probe_hits_fx,
+        probe_misses_fx,
+        probe_hits_lookup,
+        probe_misses_lookup,
+
+        count
+    };
+
+    enum duration
+    {
+        resolve_fx_us = 0,
+        resolve_dependencies_us,
+        coreclr_bind_us,
+        coreclr_initialize_us,
+        duration_count
+    };
+
+    void setup();
+    bool is_enabled();
+    void increment(counter c);
+    void add(counter c, int64_t value);
+
+    // The counters followed by the durations, in microseconds.
+    void get_stats(std::vector<const pal::char_t*>* names, std::vector<int64_t>* values);
+
+    class phase_t
+    {
+    public:
+        explicit phase_t(const pal::char_t* name, const pal::string_t& detail = pal::string_t());
+
+        // Also adds the time the phase takes to the "slot" duration.
+        phase_t(const pal::char_t* name, duration slot, const pal::string_t& detail = pal::string_t());
+        ~phase_t();
+
+        // Reports the phase now instead of at the end of the scope.
+        void end();
+
+    private:
+        const pal::char_t* m_name;
+        pal::string_t m_detail;
+        int m_slot;
+        bool m_report;
+        bool m_active;
+        int64_t m_start;
+        int64_t m_counters[counter::count];
+    };
+};
+
+#endif // TIMING_H
@@ -2,14 +2,40 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include "trace.h"
+#include "timing.h"
+#include <mutex>
 
-static bool g_enabled = false;
+trace::level_t trace::details::g_level = trace::level_t::off;
+
+// Trace output goes to stderr unless COREHOST_TRACEFILE redirects it to a file. The file
+// is fully buffered and written out by trace::flush or at process exit, so that tracing
+// costs little more than formatting the messages.
+static FILE* g_trace_file = stderr;
+static std::mutex g_trace_lock;
+static const size_t trace_file_buffer_size = 64 * 1024;
+
+// Hosting APIs may be called concurrently and each call sets up tracing, so only the first
+// setup reads the environment; the trace file is closed when the last setup is closed.
+static std::mutex g_setup_lock;
+static int g_setup_count = 0;
 
 //
 // Turn on tracing for the corehost based on "COREHOST_TRACE" env.
+// "COREHOST_TRACE_VERBOSITY" lowers the level from verbose, down to 1 for errors only.
+// "COREHOST_TRACEFILE" appends the trace to the given file instead of stderr.
+// Phase timing is set up alongside, see timing.h.
+// Each call must be paired with trace::close if the module can be unloaded.
 //
 void trace::setup()
 {
+    std::lock_guard<std::mutex> setup_lock(g_setup_lock);
+    if (g_setup_count++ > 0)
+    {
+        return;
+    }
+
+    timing::setup();
+
     // Read trace environment variable
     pal::string_t trace_str;
     if (!pal::getenv(_X("COREHOST_TRACE"), &trace_str))
@@ -21,49 +47,67 @@ void trace::setup()
     if (trace_val > 0)
     {
         trace::enable();
+
+        pal::string_t verbosity_str;
+        if (pal::getenv(_X("COREHOST_TRACE_VERBOSITY"), &verbosity_str))
+        {
+            auto verbosity = pal::xtoi(verbosity_str.c_str());
+            if (verbosity >= (int) level_t::error && verbosity < (int) level_t::verbose)
+            {
+                details::g_level = (level_t) verbosity;
+            }
+        }
+
+        pal::string_t trace_file;
+        if (g_trace_file == stderr && pal::getenv(_X("COREHOST_TRACEFILE"), &trace_file))
+        {
+            FILE* file = pal::file_open(trace_file, _X("a"));
+            if (file == nullptr)
+            {
+                trace::warning(_X("Unable to open COREHOST_TRACEFILE=%s for writing, tracing to stderr"), trace_file.c_str());
+            }
+            else
+            {
+                // Let the C runtime own the buffer, it has to outlive this module when it is unloaded.
+                ::setvbuf(file, nullptr, _IOFBF, trace_file_buffer_size);
+                g_trace_file = file;
+            }
+        }
+
         trace::info(_X("Tracing enabled"));
     }
 }
 
 void trace::enable()
 {
-    g_enabled = true;
-}
-
-bool trace::is_enabled()
-{
-    return g_enabled;
-}
-
-void trace::verbose(const pal::char_t* format, ...)
-{
-    if (g_enabled)
-    {
-        va_list args;
-        va_start(args, format);
-        pal::err_vprintf(format, args);
-        va_end(args);
-    }
+    details::g_level = level_t::verbose;
 }
 
-void trace::info(const pal::char_t* format, ...)
+void trace::details::write(const pal::char_t* format, ...)
 {
-    if (g_enabled)
-    {
-        va_list args;
-        va_start(args, format);
-        pal::err_vprintf(format, args);
-        va_end(args);
-    }
+    std::lock_guard<std::mutex> lock(g_trace_lock);
+    va_list args;
+    va_start(args, format);
+    pal::file_vprintf(g_trace_file, format, args);
+    va_end(args);
 }
 
 void trace::error(const pal::char_t* format, ...)
 {
     // Always print errors
+    std::lock_guard<std::mutex> lock(g_trace_lock);
     va_list args;
     va_start(args, format);
     pal::err_vprintf(format, args);
     va_end(args);
+
+    // Keep the redirected trace complete.
+    if (g_trace_file != stderr)
+    {
+        va_start(args, format);
+        pal::file_vprintf(g_trace_file, format, args);
+        va_end(args);
+    }
 }
 
 void trace::println(const pal::char_t* format, ...)
@@ -79,19 +123,30 @@ void trace::println()
     println(_X(""));
 }
 
-void trace::warning(const pal::char_t* format, ...)
+void trace::flush()
 {
-    if (g_enabled)
+    if (g_trace_file != stderr)
     {
-        va_list args;
-        va_start(args, format);
-        pal::err_vprintf(format, args);
-        va_end(args);
+        std::lock_guard<std::mutex> lock(g_trace_lock);
+        std::fflush(g_trace_file);
     }
-}
 
-void trace::flush()
-{
     pal::err_flush();
     pal::out_flush();
-}
\ No newline at end of file
+}
+
+void trace::close()
+{
+    std::lock_guard<std::mutex> setup_lock(g_setup_lock);
+    if (g_setup_count > 0 && --g_setup_count > 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_trace_lock);
+    if (g_trace_file != stderr)
+    {
+        std::fclose(g_trace_file);
+        g_trace_file = stderr;
+    }
+}
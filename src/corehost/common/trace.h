@@ -8,16 +8,67 @@
 
 namespace trace
 {
+    // Verbosity of the trace output, selected by COREHOST_TRACE_VERBOSITY once COREHOST_TRACE is on.
+    // Errors are always printed, regardless of the level.
+    enum class level_t
+    {
+        off = 0,
+        error = 1,
+        warning = 2,
+        info = 3,
+        verbose = 4,
+    };
+
+    namespace details
+    {
+        extern level_t g_level;
+        void write(const pal::char_t* format, ...);
+    }
+
     void setup();
     void enable();
-    bool is_enabled();
-    void verbose(const pal::char_t* format, ...);
-    void info(const pal::char_t* format, ...);
-    void warning(const pal::char_t* format, ...);
+
+    // The level checks are inline so that a disabled trace call costs a single branch.
+    // Arguments are still evaluated; guard anything that has to be computed only for
+    // the trace with is_enabled(level).
+    inline bool is_enabled() { return details::g_level != level_t::off; }
+    inline bool is_enabled(level_t level) { return details::g_level >= level; }
+
+    template <typename... Args>
+    inline void verbose(const pal::char_t* format, Args... args)
+    {
+        if (is_enabled(level_t::verbose))
+        {
+            details::write(format, args...);
+        }
+    }
+
+    template <typename... Args>
+    inline void info(const pal::char_t* format, Args... args)
+    {
+        if (is_enabled(level_t::info))
+        {
+            details::write(format, args...);
+        }
+    }
+
+    template <typename... Args>
+    inline void warning(const pal::char_t* format, Args... args)
+    {
+        if (is_enabled(level_t::warning))
+        {
+            details::write(format, args...);
+        }
+    }
+
     void error(const pal::char_t* format, ...);
     void println(const pal::char_t* format, ...);
     void println();
     void flush();
+
+    // Flushes and closes a COREHOST_TRACEFILE once every setup has been closed, later messages
+    // go to stderr until the next setup.
+    void close();
 };
 
 #endif // TRACE_H
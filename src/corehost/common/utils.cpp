@@ -3,6 +3,12 @@
 
 #include "utils.h"
 #include "trace.h"
+#include "host_env.h"
+#include "timing.h"
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
 
 bool library_exists_in_dir(const pal::string_t& lib_dir, const pal::string_t& lib_name, pal::string_t* p_lib_path)
 {
@@ -280,10 +286,57 @@ bool skip_utf8_bom(pal::ifstream_t* stream)
     return true;
 }
 
+bool skip_utf8_bom(const char** begin, const char* end)
+{
+    const char* p = *begin;
+    if (end - p < 3 ||
+            ((unsigned char)p[0] != 0xEF) ||
+            ((unsigned char)p[1] != 0xBB) ||
+            ((unsigned char)p[2] != 0xBF))
+    {
+        return false;
+    }
+
+    *begin = p + 3;
+    return true;
+}
+
+file_contents_t::~file_contents_t()
+{
+    if (m_mapping != nullptr)
+    {
+        pal::unmap_file(m_mapping, m_length);
+    }
+}
+
+bool file_contents_t::load(const pal::string_t& path)
+{
+    assert(m_mapping == nullptr && m_buffer.empty());
+
+    m_mapping = (const char*)pal::map_file_readonly(path, &m_length);
+    if (m_mapping != nullptr)
+    {
+        timing::add(timing::bytes_read, m_length);
+        return true;
+    }
+
+    // Empty files cannot be mapped; read anything that fails to map instead.
+    pal::ifstream_t file(path, std::ios::in | std::ios::binary);
+    if (!file.good())
+    {
+        return false;
+    }
+
+    m_buffer.assign(pal::istreambuf_iterator_t(file), pal::istreambuf_iterator_t());
+    m_length = m_buffer.size();
+    timing::add(timing::bytes_read, m_length);
+    return !file.bad();
+}
+
 bool get_env_shared_store_dirs(std::vector<pal::string_t>* dirs, const pal::string_t& arch, const pal::string_t& tfm)
 {
     pal::string_t path;
-    if (!pal::getenv(_X("DOTNET_SHARED_STORE"), &path))
+    if (!host_env::get(host_env::shared_store, &path))
     {
         return false;
     }
@@ -329,7 +382,7 @@ bool multilevel_lookup_enabled()
     pal::string_t env_lookup;
     bool multilevel_lookup = true;
 
-    if (pal::getenv(_X("DOTNET_MULTILEVEL_LOOKUP"), &env_lookup))
+    if (host_env::get(host_env::multilevel_lookup, &env_lookup))
     {
         auto env_val = pal::xtoi(env_lookup.c_str());
         multilevel_lookup = (env_val == 1);
@@ -337,6 +390,95 @@ bool multilevel_lookup_enabled()
     return multilevel_lookup;
 }
 
+// File system round trips are overlapped on several threads when DOTNET_HOST_PARALLEL_PROBING is 1.
+bool parallel_probing_enabled()
+{
+    return host_env::is_enabled(host_env::parallel_probing);
+}
+
+// Runs independent tasks on up to one thread per core, the calling thread included.
+// If no thread can be started the calling thread runs all tasks.
+void run_concurrently(const std::vector<std::function<void()>>& tasks)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < tasks.size(); i = next++)
+        {
+            tasks[i]();
+        }
+    };
+
+    size_t thread_count = std::min<size_t>(tasks.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    try
+    {
+        for (size_t i = 1; i < thread_count; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+    }
+    catch (const std::system_error&)
+    {
+        trace::verbose(_X("Failed to start a thread to run tasks, continuing with %d"), (int) threads.size() + 1);
+    }
+
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// Stats a batch of independent paths. Threads only pay off when each of them has a few
+// round trips to overlap, so small batches are always done on the calling thread.
+void get_file_stamps(const std::vector<pal::string_t>& paths, std::vector<file_stamp_t>* stamps)
+{
+    stamps->assign(paths.size(), file_stamp_t());
+
+    size_t thread_count = 1;
+    if (parallel_probing_enabled())
+    {
+        const size_t min_paths_per_thread = 8;
+        thread_count = std::max<size_t>(1, std::min<size_t>(paths.size() / min_paths_per_thread, std::thread::hardware_concurrency()));
+    }
+
+    auto stat_stride = [&](size_t first)
+    {
+        for (size_t i = first; i < paths.size(); i += thread_count)
+        {
+            auto& stamp = (*stamps)[i];
+            stamp.exists = pal::get_file_stamp(paths[i], &stamp.last_write_time, &stamp.size);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try
+    {
+        for (size_t i = 1; i < thread_count; ++i)
+        {
+            threads.emplace_back(stat_stride, i);
+        }
+    }
+    catch (const std::system_error&)
+    {
+        trace::verbose(_X("Failed to start a thread to stat files, continuing with %d"), (int) threads.size() + 1);
+    }
+
+    // The calling thread takes the first stride and any whose thread could not be started.
+    stat_stride(0);
+    for (size_t i = threads.size() + 1; i < thread_count; ++i)
+    {
+        stat_stride(i);
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
 bool get_file_path_from_env(const pal::char_t* env_key, pal::string_t* recv)
 {
     recv->clear();
@@ -373,12 +515,44 @@ bool try_stou(const pal::string_t& str, unsigned* num)
     return true;
 }
 
+namespace
+{
+    host_env::var_t get_dotnet_root_env_var()
+    {
+        return pal::is_running_in_wow64() ? host_env::dotnet_root_x86 : host_env::dotnet_root;
+    }
+}
+
 pal::string_t get_dotnet_root_env_var_name()
 {
-    if (pal::is_running_in_wow64())
+    return pal::string_t(host_env::get_name(get_dotnet_root_env_var()));
+}
+
+// Same as get_file_path_from_env for DOTNET_ROOT, read from the host environment snapshot.
+bool get_dotnet_root_from_env(pal::string_t* recv)
+{
+    recv->clear();
+    pal::string_t dotnet_root;
+    if (host_env::get(get_dotnet_root_env_var(), &dotnet_root))
     {
-        return pal::string_t(_X("DOTNET_ROOT(x86)"));
+        if (pal::realpath(&dotnet_root))
+        {
+            recv->assign(dotnet_root);
+            return true;
+        }
+        trace::verbose(_X("Did not find [%s] directory [%s]"), get_dotnet_root_env_var_name().c_str(), dotnet_root.c_str());
     }
 
-    return pal::string_t(_X("DOTNET_ROOT"));
+    return false;
+}
+
+// A file next to the given one to write before moving it in place. The name is unique to the
+// process and the call, so concurrent writers, in this process or others, never share one.
+pal::string_t get_temp_file_path(const pal::string_t& path)
+{
+    static std::atomic<unsigned> counter(0);
+
+    pal::stringstream_t tmp_path;
+    tmp_path << path << _X(".") << pal::get_process_id() << _X(".") << counter++ << _X(".tmp");
+    return tmp_path.str();
 }
@@ -5,6 +5,7 @@
 #define UTILS_H
 
 #include "pal.h"
+#include <functional>
 struct host_option
 {
     pal::string_t option;
@@ -22,6 +23,51 @@ struct host_option
 
 typedef std::unordered_map<pal::string_t, std::vector<pal::string_t>> opt_map_t;
 
+struct file_stamp_t
+{
+    bool exists;
+    int64_t last_write_time;
+    int64_t size;
+};
+
+// The whole contents of a file; mapped read-only when possible, read in one go otherwise.
+class file_contents_t
+{
+public:
+    file_contents_t()
+        : m_mapping(nullptr)
+        , m_length(0)
+    { }
+
+    ~file_contents_t();
+
+    // Returns false if the file could not be read.
+    bool load(const pal::string_t& path);
+
+    const char* begin() const { return m_mapping != nullptr ? m_mapping : m_buffer.data(); }
+    const char* end() const { return begin() + m_length; }
+
+private:
+    file_contents_t(const file_contents_t&);
+    file_contents_t& operator=(const file_contents_t&);
+
+    const char* m_mapping;
+    size_t m_length;
+    std::vector<char> m_buffer;
+};
+
+// Lets pal::realpath memoize what it resolves for the lifetime of the scope.
+class realpath_cache_scope_t
+{
+public:
+    realpath_cache_scope_t() { pal::begin_realpath_cache(); }
+    ~realpath_cache_scope_t() { pal::end_realpath_cache(); }
+
+private:
+    realpath_cache_scope_t(const realpath_cache_scope_t&);
+    realpath_cache_scope_t& operator=(const realpath_cache_scope_t&);
+};
+
 bool ends_with(const pal::string_t& value, const pal::string_t& suffix, bool match_case);
 bool starts_with(const pal::string_t& value, const pal::string_t& prefix, bool match_case);
 pal::string_t strip_executable_ext(const pal::string_t& filename);
@@ -47,11 +93,17 @@ bool parse_known_args(
     opt_map_t* opts,
     int* num_args);
 bool skip_utf8_bom(pal::ifstream_t* stream);
+bool skip_utf8_bom(const char** begin, const char* end);
 bool get_env_shared_store_dirs(std::vector<pal::string_t>* dirs, const pal::string_t& arch, const pal::string_t& tfm);
 bool get_global_shared_store_dirs(std::vector<pal::string_t>* dirs, const pal::string_t& arch, const pal::string_t& tfm);
 bool multilevel_lookup_enabled();
 bool get_file_path_from_env(const pal::char_t* env_key, pal::string_t* recv);
+bool parallel_probing_enabled();
+void get_file_stamps(const std::vector<pal::string_t>& paths, std::vector<file_stamp_t>* stamps);
+void run_concurrently(const std::vector<std::function<void()>>& tasks);
 size_t index_of_non_numeric(const pal::string_t& str, unsigned i);
 bool try_stou(const pal::string_t& str, unsigned* num);
 pal::string_t get_dotnet_root_env_var_name();
+bool get_dotnet_root_from_env(pal::string_t* recv);
+pal::string_t get_temp_file_path(const pal::string_t& path);
 #endif
@@ -6,6 +6,7 @@
 #include "pal.h"
 #include "trace.h"
 #include "utils.h"
+#include <algorithm>
 
 #if FEATURE_APPHOST
 #define CURHOST_TYPE    _X("apphost")
@@ -18,6 +19,11 @@
 typedef int(*hostfxr_main_fn) (const int argc, const pal::char_t* argv[]);
 typedef int(*hostfxr_main_startupinfo_fn) (const int argc, const pal::char_t* argv[], const pal::char_t* host_path, const pal::char_t* dotnet_root, const pal::char_t* app_path);
 
+#if FEATURE_STATIC_HOST
+// hostfxr is linked into the same executable.
+SHARED_API int hostfxr_main_startupinfo(const int argc, const pal::char_t* argv[], const pal::char_t* host_path, const pal::char_t* dotnet_root, const pal::char_t* app_path);
+#endif
+
 #if FEATURE_APPHOST
 
 /**
@@ -74,6 +80,94 @@ bool is_exe_enabled_for_execution(pal::string_t* app_dll)
     trace::info(_X("The managed DLL bound to this executable is: '%s'"), app_dll->c_str());
     return true;
 }
+
+/**
+ * Read the optional hostfxr location embedded in the apphost executable.
+ *
+ *    - The exe is built with a second known hash string, which means there is no hint
+ *    - For apps deployed to a fixed layout, publishing may replace it with the dotnet root and the
+ *      full path of the hostfxr library that the search below would resolve, each NUL terminated UTF-8
+ *    - The hint is only used while the hostfxr library still exists, otherwise the search runs as usual
+ *    - Note: the maximum size of both paths, including their NULs, is 4096 bytes in UTF-8
+ */
+#define EMBED_FXR_HINT_HI_PART_UTF8 "e3907a94327df167ff2f2f8440fb67f3" // SHA-256 of "fxr-hint" in UTF-8
+#define EMBED_FXR_HINT_LO_PART_UTF8 "523c217e57a6e12e606703b89e752d54"
+#define EMBED_FXR_HINT_FULL_UTF8    (EMBED_FXR_HINT_HI_PART_UTF8 EMBED_FXR_HINT_LO_PART_UTF8) // NUL terminated
+bool get_embedded_fxr_hint(pal::string_t* dotnet_root, pal::string_t* fxr_path)
+{
+    constexpr int EMBED_SZ = sizeof(EMBED_FXR_HINT_FULL_UTF8) / sizeof(EMBED_FXR_HINT_FULL_UTF8[0]);
+    constexpr int EMBED_MAX = (EMBED_SZ > 4096 ? EMBED_SZ : 4096);
+
+    // Not 'const' for the same reason as the embedded DLL name above.
+    static char embed[EMBED_MAX] = EMBED_FXR_HINT_FULL_UTF8;
+
+    static const char hi_part[] = EMBED_FXR_HINT_HI_PART_UTF8;
+    static const char lo_part[] = EMBED_FXR_HINT_LO_PART_UTF8;
+
+    size_t hi_len = (sizeof(hi_part) / sizeof(hi_part[0])) - 1;
+    size_t lo_len = (sizeof(lo_part) / sizeof(lo_part[0])) - 1;
+
+    // Both paths must be terminated within the embedded buffer.
+    const char* embed_begin = &embed[0];
+    const char* embed_end = embed_begin + EMBED_MAX;
+    const char* root_end = std::find(embed_begin, embed_end, '\0');
+    if (root_end == embed_begin || root_end == embed_end)
+    {
+        return false;
+    }
+
+    std::string root_utf8(embed_begin, root_end);
+    if (root_utf8.size() >= (hi_len + lo_len) &&
+        root_utf8.compare(0, hi_len, &hi_part[0]) == 0 &&
+        root_utf8.compare(hi_len, lo_len, &lo_part[0]) == 0)
+    {
+        return false;
+    }
+
+    const char* fxr_begin = root_end + 1;
+    const char* fxr_end = std::find(fxr_begin, embed_end, '\0');
+    if (fxr_end == fxr_begin || fxr_end == embed_end)
+    {
+        return false;
+    }
+
+    return pal::utf8_palstring(root_utf8, dotnet_root) &&
+        pal::utf8_palstring(std::string(fxr_begin, fxr_end), fxr_path);
+}
+
+// The hint is what the search resolved when the app was published; it does not apply once the
+// user points DOTNET_ROOT elsewhere, unless the app carries its own hostfxr.
+bool resolve_fxr_path_from_hint(const pal::string_t& app_root, pal::string_t* out_dotnet_root, pal::string_t* out_fxr_path)
+{
+    pal::string_t hint_root;
+    pal::string_t hint_fxr_path;
+    if (!get_embedded_fxr_hint(&hint_root, &hint_fxr_path))
+    {
+        return false;
+    }
+
+    if (!pal::are_paths_equal_with_normalized_casing(hint_root, app_root))
+    {
+        pal::string_t env_root;
+        if (get_dotnet_root_from_env(&env_root) &&
+            !pal::are_paths_equal_with_normalized_casing(env_root, hint_root))
+        {
+            trace::info(_X("Ignoring the embedded fxr hint for [%s], the runtime location is overridden by [%s]"), hint_root.c_str(), env_root.c_str());
+            return false;
+        }
+    }
+
+    if (!pal::file_exists(hint_fxr_path))
+    {
+        trace::info(_X("The embedded fxr hint [%s] is stale, searching for fxr"), hint_fxr_path.c_str());
+        return false;
+    }
+
+    trace::info(_X("Resolved fxr [%s] from the embedded hint..."), hint_fxr_path.c_str());
+    out_dotnet_root->assign(hint_root);
+    out_fxr_path->assign(hint_fxr_path);
+    return true;
+}
 #endif
 
 bool resolve_fxr_path(const pal::string_t& host_path, const pal::string_t& app_root, pal::string_t* out_dotnet_root, pal::string_t* out_fxr_path)
@@ -82,6 +176,11 @@ bool resolve_fxr_path(const pal::string_t& host_path, const pal::string_t& app_r
     host_dir.assign(get_directory(host_path));
 
 #if FEATURE_APPHOST
+    if (resolve_fxr_path_from_hint(app_root, out_dotnet_root, out_fxr_path))
+    {
+        return true;
+    }
+
     // If a hostfxr exists in app_root, then assumed self-contained.
     if (library_exists_in_dir(app_root, LIBFXR_NAME, out_fxr_path))
     {
@@ -94,7 +193,7 @@ bool resolve_fxr_path(const pal::string_t& host_path, const pal::string_t& app_r
 
     pal::string_t default_install_location;
     pal::string_t dotnet_root_env_var_name = get_dotnet_root_env_var_name();
-    if (get_file_path_from_env(dotnet_root_env_var_name.c_str(), out_dotnet_root))
+    if (get_dotnet_root_from_env(out_dotnet_root))
     {
         trace::info(_X("Using environment variable %s=[%s] as runtime location."), dotnet_root_env_var_name.c_str(), out_dotnet_root->c_str());
     }
@@ -251,6 +350,19 @@ int run(const int argc, const pal::char_t* argv[])
     app_path.append(_X(".dll"));
 #endif
 
+#if FEATURE_STATIC_HOST
+    // Only self-contained apps are supported, so the runtime is in the app directory.
+    trace::info(_X("Invoking the fx resolver linked into the host"));
+    trace::info(_X("Host path: [%s]"), host_path.c_str());
+    trace::info(_X("Dotnet path: [%s]"), app_root.c_str());
+    trace::info(_X("App path: [%s]"), app_path.c_str());
+
+    // Previous corehost trace messages must be printed before calling trace::setup in hostfxr
+    trace::flush();
+
+    (void)requires_v2_hostfxr_interface;
+    return hostfxr_main_startupinfo(argc, argv, host_path.c_str(), app_root.c_str(), app_path.c_str());
+#else
     pal::string_t dotnet_root;
     pal::string_t fxr_path;
     if (!resolve_fxr_path(host_path, app_root, &dotnet_root, &fxr_path))
@@ -318,6 +430,7 @@ int run(const int argc, const pal::char_t* argv[])
 
     pal::unload_library(fxr);
     return rc;
+#endif
 }
 
 #if defined(_WIN32)
@@ -33,5 +33,8 @@ enum StatusCode
     LibHostUnknownCommand       = 0x80008099,
     LibHostAppRootFindFailure   = 0x8000809a,
     SdkResolverResolveFailure   = 0x8000809b,
+    HostRuntimeIncompatible     = 0x8000809c,
+    StartupManifestWriteFailure = 0x8000809d,
+    KeptRuntimeMismatch         = 0x8000809e,
 };
 #endif // __ERROR_CODES_H__
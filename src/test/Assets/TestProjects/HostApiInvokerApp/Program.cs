@@ -1,5 +1,6 @@
 using System;
 using System.Collections.Generic;
+using System.IO;
 using System.Runtime.InteropServices;
 using System.Text;
 
@@ -22,6 +23,36 @@ public static class Program
             int bufferSize, 
             ref int required_buffer_size);
 
+        [DllImport("hostfxr", CharSet = OSCharSet)]
+        static extern uint hostfxr_get_runtime_properties(
+            int argc,
+            [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 0)]
+            string[] argv,
+            IntPtr buffer,
+            int bufferSize,
+            ref int required_buffer_size);
+
+        [DllImport("hostfxr", CharSet = OSCharSet)]
+        static extern uint hostfxr_write_startup_manifest(
+            int argc,
+            [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 0)]
+            string[] argv,
+            StringBuilder buffer,
+            int bufferSize,
+            ref int required_buffer_size);
+
+        [DllImport("hostfxr", CharSet = OSCharSet)]
+        static extern uint hostfxr_main_keep_runtime(
+            int argc,
+            [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 0)]
+            string[] argv);
+
+        [DllImport("hostfxr", CharSet = OSCharSet)]
+        static extern uint hostfxr_shutdown_runtime();
+
+        [DllImport("libc", CharSet = CharSet.Ansi, SetLastError = true)]
+        static extern int symlink(string target, string linkpath);
+
         [Flags]
         internal enum hostfxr_resolve_sdk2_flags_t : int
         {
@@ -115,6 +146,18 @@ public static void MainCore(string[] args)
                 case nameof(hostfxr_get_native_search_directories):
                     Test_hostfxr_get_native_search_directories(args);
                     break;
+                case nameof(hostfxr_get_runtime_properties):
+                    Test_hostfxr_get_runtime_properties(args);
+                    break;
+                case "hostfxr_get_runtime_properties_retarget":
+                    Test_hostfxr_get_runtime_properties_retarget(args);
+                    break;
+                case nameof(hostfxr_write_startup_manifest):
+                    Test_hostfxr_write_startup_manifest(args);
+                    break;
+                case nameof(hostfxr_main_keep_runtime):
+                    Test_hostfxr_main_keep_runtime(args);
+                    break;
                 case nameof(hostfxr_resolve_sdk2):
                     Test_hostfxr_resolve_sdk2(args);
                     break;
@@ -170,6 +213,175 @@ static void Test_hostfxr_get_native_search_directories(string[] args)
             }
         }
 
+        /// <summary>
+        /// Test invoking the native hostfxr api hostfxr_get_runtime_properties
+        /// </summary>
+        /// <param name="args[0]">hostfxr_get_runtime_properties</param>
+        /// <param name="args[1]">Path to dotnet.exe</param>
+        /// <param name="args[2]">Path to application</param>
+        static void Test_hostfxr_get_runtime_properties(string[] args)
+        {
+            if (args.Length != 3)
+            {
+                throw new ArgumentException("Invalid number of arguments passed");
+            }
+
+            PrintRuntimeProperties(args[1], args[2]);
+        }
+
+        /// <summary>
+        /// Test that hostfxr_get_runtime_properties sees a symbolic link to the application
+        /// directory retargeted between two calls in the same process
+        /// </summary>
+        /// <param name="args[0]">hostfxr_get_runtime_properties_retarget</param>
+        /// <param name="args[1]">Path to dotnet.exe</param>
+        /// <param name="args[2]">Path of the symbolic link to create</param>
+        /// <param name="args[3]">File name of the application</param>
+        /// <param name="args[4..]">Directories the link targets in turn, one call each</param>
+        static void Test_hostfxr_get_runtime_properties_retarget(string[] args)
+        {
+            if (args.Length < 5)
+            {
+                throw new ArgumentException("Invalid number of arguments passed");
+            }
+
+            string link = args[2];
+            string pathToApp = Path.Combine(link, args[3]);
+            for (int i = 4; i < args.Length; i++)
+            {
+                if (File.Exists(link) || Directory.Exists(link))
+                {
+                    File.Delete(link);
+                }
+
+                if (symlink(args[i], link) != 0)
+                {
+                    throw new InvalidOperationException($"symlink failed: {Marshal.GetLastWin32Error()}");
+                }
+
+                Console.WriteLine($"hostfxr_get_runtime_properties target:[{args[i]}]");
+                PrintRuntimeProperties(args[1], pathToApp);
+            }
+        }
+
+        static void PrintRuntimeProperties(string pathToDotnet, string pathToApp)
+        {
+            string[] argv = new[] { pathToDotnet, pathToApp };
+
+#if WINDOWS
+            const int charSize = 2;
+#else
+            const int charSize = 1;
+#endif
+
+            // Start with an empty buffer to get the required size
+            int required_buffer_size = 0;
+            uint rc = hostfxr_get_runtime_properties(argv.Length, argv, IntPtr.Zero, 0, ref required_buffer_size);
+
+            string result = null;
+            if (rc == HostApiBufferTooSmall)
+            {
+                int buffer_size = required_buffer_size;
+                IntPtr buffer = Marshal.AllocHGlobal(buffer_size * charSize);
+                try
+                {
+                    rc = hostfxr_get_runtime_properties(argv.Length, argv, buffer, buffer_size, ref required_buffer_size);
+                    if (rc == 0)
+                    {
+                        byte[] bytes = new byte[buffer_size * charSize];
+                        Marshal.Copy(buffer, bytes, 0, bytes.Length);
+                        result = charSize == 2 ? Encoding.Unicode.GetString(bytes) : Encoding.UTF8.GetString(bytes);
+                    }
+                }
+                finally
+                {
+                    Marshal.FreeHGlobal(buffer);
+                }
+            }
+
+            if (rc == 0 && result != null)
+            {
+                Console.WriteLine("hostfxr_get_runtime_properties:Success");
+
+                // The properties are null terminated keys and values, followed by an empty key
+                string[] parts = result.Split('\0');
+                for (int i = 0; i + 1 < parts.Length && parts[i].Length != 0; i += 2)
+                {
+                    Console.WriteLine($"hostfxr_get_runtime_properties property:[{parts[i]}={parts[i + 1]}]");
+                }
+            }
+            else
+            {
+                Console.WriteLine($"hostfxr_get_runtime_properties:Fail[{rc}]");
+            }
+        }
+
+        /// <summary>
+        /// Test invoking the native hostfxr api hostfxr_write_startup_manifest
+        /// </summary>
+        /// <param name="args[0]">hostfxr_write_startup_manifest</param>
+        /// <param name="args[1]">Path to the executable of the self-contained application</param>
+        static void Test_hostfxr_write_startup_manifest(string[] args)
+        {
+            if (args.Length != 2)
+            {
+                throw new ArgumentException("Invalid number of arguments passed");
+            }
+
+            string[] argv = new[] { args[1] };
+
+            // Start with 0 bytes allocated to test re-entry and required_buffer_size
+            StringBuilder buffer = new StringBuilder(0);
+            int required_buffer_size = 0;
+
+            uint rc = 0;
+            for (int i = 0; i < 2; i++)
+            {
+                rc = hostfxr_write_startup_manifest(argv.Length, argv, buffer, buffer.Capacity + 1, ref required_buffer_size);
+                if (rc != HostApiBufferTooSmall)
+                {
+                    break;
+                }
+
+                buffer = new StringBuilder(required_buffer_size);
+            }
+
+            if (rc == 0)
+            {
+                Console.WriteLine("hostfxr_write_startup_manifest:Success");
+                Console.WriteLine($"hostfxr_write_startup_manifest buffer:[{buffer}]");
+            }
+            else
+            {
+                Console.WriteLine($"hostfxr_write_startup_manifest:Fail[{rc}]");
+            }
+        }
+
+        /// <summary>
+        /// Test invoking the native hostfxr api hostfxr_main_keep_runtime
+        /// </summary>
+        /// <param name="args[0]">hostfxr_main_keep_runtime</param>
+        /// <param name="args[1]">Path to dotnet.exe</param>
+        /// <param name="args[2..]">Paths to the applications, executed in order in the kept runtime</param>
+        static void Test_hostfxr_main_keep_runtime(string[] args)
+        {
+            if (args.Length < 3)
+            {
+                throw new ArgumentException("Invalid number of arguments passed");
+            }
+
+            string pathToDotnet = args[1];
+            for (int i = 2; i < args.Length; i++)
+            {
+                string[] argv = new[] { pathToDotnet, args[i] };
+                uint rc = hostfxr_main_keep_runtime(argv.Length, argv);
+                Console.WriteLine($"hostfxr_main_keep_runtime app:[{args[i]}] rc:[{rc}]");
+            }
+
+            uint exitCode = hostfxr_shutdown_runtime();
+            Console.WriteLine($"hostfxr_shutdown_runtime rc:[{exitCode}]");
+        }
+
         /// <summary>
         /// Test invoking the native hostfxr api hostfxr_resolve_sdk2
         /// </summary>
@@ -0,0 +1,499 @@
+// Copyright (c) .NET Foundation and contributors. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+using FluentAssertions;
+using Microsoft.DotNet.Cli.Build.Framework;
+using Microsoft.DotNet.CoreSetup.Test;
+using Newtonsoft.Json.Linq;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+using Xunit;
+
+namespace Microsoft.DotNet.CoreSetup.Test.HostActivation.StartupSwitches
+{
+    // The opt-in host switches must not change what the runtime is given, so each test resolves
+    // the runtime properties of the app with and without the switch and compares them.
+    public class GivenThatICareAboutHostStartupSwitches : IClassFixture<GivenThatICareAboutHostStartupSwitches.SharedTestState>
+    {
+        private const string TpaProperty = "TRUSTED_PLATFORM_ASSEMBLIES";
+        private const string AppPathsProperty = "APP_PATHS";
+        private const uint KeptRuntimeMismatch = 0x8000809e;
+        private const uint LibHostSdkFindFailure = 0x80008091;
+
+        private SharedTestState sharedTestState;
+
+        public GivenThatICareAboutHostStartupSwitches(GivenThatICareAboutHostStartupSwitches.SharedTestState fixture)
+        {
+            sharedTestState = fixture;
+        }
+
+        [Fact]
+        public void Lazy_TPA_leaves_out_only_assemblies_found_in_APP_PATHS()
+        {
+            var fixture = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var appDll = fixture.TestProject.AppDll;
+
+            var expected = GetRuntimeProperties(fixture);
+            var lazy = GetRuntimeProperties(fixture, ("DOTNET_HOST_LAZY_TPA", "1"));
+
+            expected.Should().NotContainKey(AppPathsProperty);
+            lazy.Should().ContainKey(AppPathsProperty);
+
+            // The app and its framework are found through APP_PATHS, the NuGet cache is not.
+            var expectedTpa = SplitPaths(expected[TpaProperty]);
+            var lazyTpa = SplitPaths(lazy[TpaProperty]);
+            var appPaths = SplitPaths(lazy[AppPathsProperty]);
+            expectedTpa.Should().Contain(p => Path.GetFileName(p) == Path.GetFileName(appDll));
+            lazyTpa.Should().NotContain(p => Path.GetFileName(p) == Path.GetFileName(appDll));
+            lazyTpa.Should().Contain(p => Path.GetFileName(p) == "Newtonsoft.Json.dll");
+
+            // Every assembly left out is in one of the directories the runtime looks in.
+            lazyTpa.Should().BeSubsetOf(expectedTpa);
+            expectedTpa.Except(lazyTpa).Should().OnlyContain(p => appPaths.Contains(Path.GetDirectoryName(p)));
+
+            // Nothing else changes.
+            expected.Remove(TpaProperty);
+            lazy.Remove(TpaProperty);
+            lazy.Remove(AppPathsProperty);
+            lazy.Should().Equal(expected);
+        }
+
+        [Fact]
+        public void Framework_resolution_cache_resolves_the_same_properties()
+        {
+            var fixture = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var cacheDir = Path.Combine(fixture.TestProject.ProjectDirectory, "startupcache");
+            Directory.CreateDirectory(cacheDir);
+
+            var expected = GetRuntimeProperties(fixture);
+
+            // The first call writes the cache, the second one resolves the framework from it.
+            GetRuntimeProperties(fixture, ("DOTNET_HOST_STARTUP_CACHE", cacheDir)).Should().Equal(expected);
+            Directory.GetFiles(cacheDir, "*.fxcache").Should().NotBeEmpty();
+            GetRuntimeProperties(fixture, ("DOTNET_HOST_STARTUP_CACHE", cacheDir)).Should().Equal(expected);
+
+            // Every writer moves its own temporary file in place.
+            Directory.GetFiles(cacheDir, "*.tmp").Should().BeEmpty();
+        }
+
+        [Fact]
+        public void Binary_deps_manifest_resolves_the_same_properties()
+        {
+            var fixture = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var cacheDir = Path.Combine(fixture.TestProject.ProjectDirectory, "startupcache");
+            Directory.CreateDirectory(cacheDir);
+            var binaryDeps = GetBinaryDepsEnvironment(cacheDir);
+
+            var expected = GetRuntimeProperties(fixture);
+
+            // The first call writes the sidecars into the cache directory, never next to a deps.json.
+            GetRuntimeProperties(fixture, binaryDeps).Should().Equal(expected);
+            Directory.GetFiles(cacheDir, "*.bin").Should().NotBeEmpty();
+            Directory.GetFiles(Path.GetDirectoryName(fixture.TestProject.DepsJson), "*.bin").Should().BeEmpty();
+            Directory.GetFiles(fixture.BuiltDotnet.GreatestVersionSharedFxPath, "*.bin").Should().BeEmpty();
+
+            DeleteStartupCacheEntries(cacheDir);
+            GetRuntimeProperties(fixture, out CommandResult result, binaryDeps).Should().Equal(expected);
+            result.Should().HaveStdErrContaining("Loaded binary dependencies manifest");
+            Directory.GetFiles(cacheDir, "*.tmp").Should().BeEmpty();
+        }
+
+        [Fact]
+        public void Truncated_or_stale_binary_deps_manifest_is_rejected()
+        {
+            var fixture = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var cacheDir = Path.Combine(fixture.TestProject.ProjectDirectory, "startupcache");
+            Directory.CreateDirectory(cacheDir);
+            var binaryDeps = GetBinaryDepsEnvironment(cacheDir);
+
+            var expected = GetRuntimeProperties(fixture);
+            GetRuntimeProperties(fixture, binaryDeps).Should().Equal(expected);
+
+            foreach (var sidecar in Directory.GetFiles(cacheDir, "*.bin"))
+            {
+                using (var file = new FileStream(sidecar, FileMode.Open, FileAccess.Write))
+                {
+                    file.SetLength(file.Length / 2);
+                }
+            }
+
+            DeleteStartupCacheEntries(cacheDir);
+            GetRuntimeProperties(fixture, out CommandResult result, binaryDeps).Should().Equal(expected);
+            result.Should().HaveStdErrContaining("is stale or invalid");
+
+            // The sidecars were rewritten, only the one of the changed deps.json is invalid now.
+            File.SetLastWriteTimeUtc(fixture.TestProject.DepsJson, DateTime.UtcNow.AddMinutes(1));
+
+            DeleteStartupCacheEntries(cacheDir);
+            GetRuntimeProperties(fixture, out result, binaryDeps).Should().Equal(expected);
+            result.Should().HaveStdErrContaining("is stale or invalid");
+        }
+
+        [Fact]
+        public void Asset_versions_at_the_component_limits_round_trip_through_the_binary_deps_manifest()
+        {
+            var fixture = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var cacheDir = Path.Combine(fixture.TestProject.ProjectDirectory, "startupcache");
+            Directory.CreateDirectory(cacheDir);
+            var binaryDeps = GetBinaryDepsEnvironment(cacheDir);
+
+            // Every component of an assembly or file version goes up to 65535, and an absent one
+            // is kept apart from a zero. A component past the limit makes the version invalid.
+            var appDll = fixture.TestProject.AppDll;
+            string maxAssembly = Path.Combine(Path.GetDirectoryName(appDll), "MaxVersion.dll");
+            string invalidAssembly = Path.Combine(Path.GetDirectoryName(appDll), "InvalidVersion.dll");
+            File.Copy(appDll, maxAssembly);
+            File.Copy(appDll, invalidAssembly);
+            AddProjectDependency(fixture.TestProject.DepsJson, "MaxVersion", "65535.65535.65535.65535", "0.0");
+            AddProjectDependency(fixture.TestProject.DepsJson, "InvalidVersion", "1.0.0.65536", "1.0.65535");
+
+            // The first call reads the deps.json, the second one the binary manifest written by the first.
+            foreach (bool fromBinary in new[] { false, true })
+            {
+                DeleteStartupCacheEntries(cacheDir);
+                GetRuntimeProperties(fixture, out CommandResult result, binaryDeps);
+                if (fromBinary)
+                {
+                    result.Should().HaveStdErrContaining("Loaded binary dependencies manifest");
+                }
+                else
+                {
+                    result.Should().HaveStdErrContaining("Ignoring the invalid assemblyVersion '1.0.0.65536' of asset [InvalidVersion.dll]");
+                }
+
+                result.Should()
+                    .HaveStdErrContaining($"Adding tpa entry: {maxAssembly}, AssemblyVersion: 65535.65535.65535.65535, FileVersion: 0.0")
+                    .And
+                    .HaveStdErrContaining($"Adding tpa entry: {invalidAssembly}, AssemblyVersion: , FileVersion: 1.0.65535");
+            }
+        }
+
+        [Fact]
+        public void Startup_cache_is_not_used_once_a_package_is_serviced()
+        {
+            var fixture = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var cacheDir = Path.Combine(fixture.TestProject.ProjectDirectory, "startupcache");
+            var servicingDir = Path.Combine(fixture.TestProject.ProjectDirectory, "coreservicing");
+            Directory.CreateDirectory(cacheDir);
+            Directory.CreateDirectory(Path.Combine(servicingDir, "pkgs"));
+            var servicedAsset = MakeServiceable(fixture.TestProject.DepsJson, "Newtonsoft.Json");
+
+            var servicing = ("CORE_SERVICING", servicingDir);
+            var cache = ("DOTNET_HOST_STARTUP_CACHE", cacheDir);
+
+            var expected = GetRuntimeProperties(fixture, servicing);
+            GetRuntimeProperties(fixture, servicing, cache).Should().Equal(expected);
+
+            // Only the package directory shows up, the servicing root was there when the cache was written.
+            var original = SplitPaths(expected[TpaProperty]).Single(p => Path.GetFileName(p) == Path.GetFileName(servicedAsset));
+            var serviced = Path.Combine(servicingDir, "pkgs", servicedAsset);
+            Directory.CreateDirectory(Path.GetDirectoryName(serviced));
+            File.Copy(original, serviced);
+
+            expected = GetRuntimeProperties(fixture, servicing);
+            SplitPaths(expected[TpaProperty]).Should().Contain(p => p.EndsWith(servicedAsset));
+            GetRuntimeProperties(fixture, servicing, cache).Should().Equal(expected);
+        }
+
+        [Fact]
+        public void Startup_cache_is_not_used_once_an_additional_deps_file_changes()
+        {
+            var fixture = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var cacheDir = Path.Combine(fixture.TestProject.ProjectDirectory, "startupcache");
+            var additionalDeps = Path.Combine(fixture.TestProject.ProjectDirectory, "additionaldeps", "Extra.deps.json");
+            Directory.CreateDirectory(cacheDir);
+            Directory.CreateDirectory(Path.GetDirectoryName(additionalDeps));
+
+            // The additional deps file names an assembly next to the app, and then another one.
+            var appDir = Path.GetDirectoryName(fixture.TestProject.AppDll);
+            File.Copy(fixture.TestProject.AppDll, Path.Combine(appDir, "Extra.dll"));
+            File.Copy(fixture.TestProject.AppDll, Path.Combine(appDir, "ExtraLib.dll"));
+            File.WriteAllText(additionalDeps, SharedFramework.CreateDepsJson("Microsoft.NETCore.App", "Extra/1.0.0", "Extra").ToString());
+
+            var additional = ("DOTNET_ADDITIONAL_DEPS", additionalDeps);
+            var cache = ("DOTNET_HOST_STARTUP_CACHE", cacheDir);
+
+            var expected = GetRuntimeProperties(fixture, additional);
+            GetRuntimeProperties(fixture, additional, cache).Should().Equal(expected);
+
+            File.WriteAllText(additionalDeps, SharedFramework.CreateDepsJson("Microsoft.NETCore.App", "ExtraLib/1.0.0", "ExtraLib").ToString());
+
+            expected = GetRuntimeProperties(fixture, additional);
+            SplitPaths(expected[TpaProperty]).Should().Contain(p => Path.GetFileName(p) == "ExtraLib.dll");
+            GetRuntimeProperties(fixture, additional, cache).Should().Equal(expected);
+            Directory.GetFiles(cacheDir, "*.tmp").Should().BeEmpty();
+        }
+
+        // Marks the library serviceable in the deps file and returns the path of its runtime
+        // assembly in the servicing package layout.
+        private static string MakeServiceable(string depsJson, string libraryName)
+        {
+            var deps = JObject.Parse(File.ReadAllText(depsJson));
+            var library = deps["libraries"].Children<JProperty>().Single(p => p.Name.StartsWith(libraryName + "/"));
+            library.Value["serviceable"] = true;
+            File.WriteAllText(depsJson, deps.ToString());
+
+            var target = deps["targets"].Children<JProperty>().First().Value[library.Name];
+            var asset = target["runtime"].Children<JProperty>().First().Name;
+            var libraryPath = (string)library.Value["path"] ?? library.Name.ToLowerInvariant();
+            return Path.Combine(libraryPath.Split('/').Concat(asset.Split('/')).ToArray());
+        }
+
+        [Fact]
+        public void Startup_manifest_is_only_written_at_publish_time_and_resolves_the_same_properties()
+        {
+            var invoker = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var fixture = sharedTestState.PreviouslyPublishedAndRestoredStandaloneTestProjectFixture.Copy();
+            var appExe = fixture.TestProject.AppExe;
+            var appDll = fixture.TestProject.AppDll;
+            var manifest = Path.ChangeExtension(appDll, ".startupmanifest");
+
+            var expected = GetRuntimeProperties(invoker, appExe, appDll, out CommandResult result);
+
+            // Neither launches nor prewarming write the manifest.
+            Command.Create(appExe)
+                .CaptureStdErr()
+                .CaptureStdOut()
+                .Execute()
+                .Should()
+                .Pass();
+            File.Exists(manifest).Should().BeFalse();
+
+            invoker.BuiltDotnet.Exec(invoker.TestProject.AppDll, "hostfxr_write_startup_manifest", appExe)
+                .CaptureStdOut()
+                .CaptureStdErr()
+                .Execute()
+                .Should()
+                .Pass()
+                .And
+                .HaveStdOutContaining("hostfxr_write_startup_manifest:Success");
+            File.Exists(manifest).Should().BeTrue();
+
+            GetRuntimeProperties(invoker, appExe, appDll, out result, ("COREHOST_TRACE", "1")).Should().Equal(expected);
+            result.Should().HaveStdErrContaining("Using probe paths from startup manifest");
+
+            // The manifest does not know what a servicing location holds, so it is not used with one.
+            var servicingDir = Path.Combine(fixture.TestProject.ProjectDirectory, "coreservicing");
+            Directory.CreateDirectory(servicingDir);
+            GetRuntimeProperties(invoker, appExe, appDll, out result, ("CORE_SERVICING", servicingDir), ("COREHOST_TRACE", "1")).Should().Equal(expected);
+            result.Should().HaveStdErrContaining("may override the published assets");
+        }
+
+        [Fact]
+        public void Kept_runtime_does_not_execute_an_app_with_different_private_dependencies()
+        {
+            var invoker = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var app = sharedTestState.PreviouslyBuiltAndRestoredPortableTestProjectFixture.Copy();
+            var otherApp = sharedTestState.PreviouslyBuiltAndRestoredPortableTestProjectFixture.Copy();
+            var appDll = app.TestProject.AppDll;
+            var otherAppDll = otherApp.TestProject.AppDll;
+
+            // The other app resolves the same frameworks and packages, and an assembly next to it.
+            File.Copy(otherAppDll, Path.Combine(Path.GetDirectoryName(otherAppDll), "Extra.dll"));
+            AddProjectDependency(otherApp.TestProject.DepsJson, "Extra");
+
+            // The app is executed twice in the kept runtime, the other one not at all.
+            var dotnetLocation = Path.Combine(invoker.BuiltDotnet.BinPath, $"dotnet{invoker.ExeExtension}");
+            invoker.BuiltDotnet.Exec(invoker.TestProject.AppDll, "hostfxr_main_keep_runtime", dotnetLocation, appDll, appDll, otherAppDll)
+                .CaptureStdOut()
+                .CaptureStdErr()
+                .Execute()
+                .Should()
+                .Pass()
+                .And
+                .HaveStdOutContaining($"hostfxr_main_keep_runtime app:[{appDll}] rc:[0]")
+                .And
+                .HaveStdOutContaining($"hostfxr_main_keep_runtime app:[{otherAppDll}] rc:[{KeptRuntimeMismatch}]")
+                .And
+                .HaveStdErrContaining($"The app [{otherAppDll}] resolves the property [{TpaProperty}]");
+        }
+
+        [Fact]
+        public void Canonical_paths_are_not_remembered_across_calls()
+        {
+            // The invoker creates the symbolic link, which needs libc.
+            if (RuntimeInformation.IsOSPlatform(OSPlatform.Windows))
+            {
+                return;
+            }
+
+            var invoker = sharedTestState.PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Copy();
+            var app = sharedTestState.PreviouslyBuiltAndRestoredPortableTestProjectFixture.Copy();
+            var otherApp = sharedTestState.PreviouslyBuiltAndRestoredPortableTestProjectFixture.Copy();
+            var appDir = Path.GetDirectoryName(app.TestProject.AppDll);
+            var otherAppDir = Path.GetDirectoryName(otherApp.TestProject.AppDll);
+            var emptyDir = Path.Combine(app.TestProject.ProjectDirectory, "empty");
+            var link = Path.Combine(app.TestProject.ProjectDirectory, "applink");
+            Directory.CreateDirectory(emptyDir);
+
+            // The link to the app directory is retargeted between the calls, to another app and
+            // then to a directory without one, which the muxer takes for an SDK command.
+            var dotnetLocation = Path.Combine(invoker.BuiltDotnet.BinPath, $"dotnet{invoker.ExeExtension}");
+            var result = invoker.BuiltDotnet.Exec(invoker.TestProject.AppDll, "hostfxr_get_runtime_properties_retarget",
+                    dotnetLocation, link, Path.GetFileName(app.TestProject.AppDll), appDir, otherAppDir, emptyDir)
+                .CaptureStdOut()
+                .CaptureStdErr()
+                .Execute();
+            result.Should()
+                .Pass()
+                .And
+                .HaveStdOutContaining($"hostfxr_get_runtime_properties property:[APP_CONTEXT_BASE_DIRECTORY={appDir}{Path.DirectorySeparatorChar}]")
+                .And
+                .HaveStdOutContaining($"hostfxr_get_runtime_properties property:[APP_CONTEXT_BASE_DIRECTORY={otherAppDir}{Path.DirectorySeparatorChar}]")
+                .And
+                .HaveStdOutContaining($"hostfxr_get_runtime_properties:Fail[{LibHostSdkFindFailure}]");
+        }
+
+        // Adds a project library with a runtime assembly named after it to the deps file, as a
+        // dependency of the app. The assembly gets the given assembly and file versions, if any.
+        private static void AddProjectDependency(string depsJson, string libraryName, string assemblyVersion = null, string fileVersion = null)
+        {
+            var deps = JObject.Parse(File.ReadAllText(depsJson));
+            var target = (JObject)deps["targets"].Children<JProperty>().First().Value;
+            var appLibrary = target.Properties().First();
+            if (appLibrary.Value["dependencies"] == null)
+            {
+                appLibrary.Value["dependencies"] = new JObject();
+            }
+
+            appLibrary.Value["dependencies"][libraryName] = "1.0.0";
+            var asset = new JObject();
+            if (assemblyVersion != null)
+            {
+                asset.Add(new JProperty("assemblyVersion", assemblyVersion));
+            }
+
+            if (fileVersion != null)
+            {
+                asset.Add(new JProperty("fileVersion", fileVersion));
+            }
+
+            target[libraryName + "/1.0.0"] = new JObject(new JProperty("runtime", new JObject(new JProperty(libraryName + ".dll", asset))));
+            deps["libraries"][libraryName + "/1.0.0"] = new JObject(
+                new JProperty("type", "project"),
+                new JProperty("serviceable", false),
+                new JProperty("sha512", ""));
+            File.WriteAllText(depsJson, deps.ToString());
+        }
+
+        private static (string Name, string Value)[] GetBinaryDepsEnvironment(string cacheDir)
+        {
+            return new[]
+            {
+                ("DOTNET_HOST_BINARY_DEPS", "1"),
+                ("DOTNET_HOST_STARTUP_CACHE", cacheDir),
+                ("COREHOST_TRACE", "1")
+            };
+        }
+
+        // A startup cache hit skips loading the deps files, so it is removed to have them loaded.
+        private static void DeleteStartupCacheEntries(string cacheDir)
+        {
+            foreach (var entry in Directory.GetFiles(cacheDir, "*.startupcache"))
+            {
+                File.Delete(entry);
+            }
+        }
+
+        private static List<string> SplitPaths(string paths)
+        {
+            return paths.Split(new[] { Path.PathSeparator }, StringSplitOptions.RemoveEmptyEntries)
+                .Select(p => p.TrimEnd(Path.DirectorySeparatorChar))
+                .ToList();
+        }
+
+        private static Dictionary<string, string> GetRuntimeProperties(TestProjectFixture fixture, params (string Name, string Value)[] environment)
+        {
+            return GetRuntimeProperties(fixture, out CommandResult result, environment);
+        }
+
+        private static Dictionary<string, string> GetRuntimeProperties(TestProjectFixture fixture, out CommandResult result, params (string Name, string Value)[] environment)
+        {
+            var dotnetLocation = Path.Combine(fixture.BuiltDotnet.BinPath, $"dotnet{fixture.ExeExtension}");
+            return GetRuntimeProperties(fixture, dotnetLocation, fixture.TestProject.AppDll, out result, environment);
+        }
+
+        // Resolves the runtime properties of the app launched by the host through the
+        // hostfxr_get_runtime_properties of the invoker app, with the given environment variables
+        // set for the resolution.
+        private static Dictionary<string, string> GetRuntimeProperties(TestProjectFixture invoker, string hostPath, string appDll, out CommandResult result, params (string Name, string Value)[] environment)
+        {
+            var command = invoker.BuiltDotnet.Exec(invoker.TestProject.AppDll, "hostfxr_get_runtime_properties", hostPath, appDll)
+                .CaptureStdOut()
+                .CaptureStdErr();
+            foreach (var variable in environment)
+            {
+                command = command.EnvironmentVariable(variable.Name, variable.Value);
+            }
+
+            result = command.Execute();
+            result.Should()
+                .Pass()
+                .And
+                .HaveStdOutContaining("hostfxr_get_runtime_properties:Success");
+
+            const string prefix = "hostfxr_get_runtime_properties property:[";
+            var properties = new Dictionary<string, string>();
+            foreach (var line in result.StdOut.Split(new[] { '\r', '\n' }, StringSplitOptions.RemoveEmptyEntries))
+            {
+                if (line.StartsWith(prefix) && line.EndsWith("]"))
+                {
+                    string property = line.Substring(prefix.Length, line.Length - prefix.Length - 1);
+                    int separator = property.IndexOf('=');
+                    properties[property.Substring(0, separator)] = property.Substring(separator + 1);
+                }
+            }
+
+            return properties;
+        }
+
+        public class SharedTestState : IDisposable
+        {
+            public TestProjectFixture PreviouslyBuiltAndRestoredPortableApiTestProjectFixture { get; set; }
+            public TestProjectFixture PreviouslyPublishedAndRestoredStandaloneTestProjectFixture { get; set; }
+            public TestProjectFixture PreviouslyBuiltAndRestoredPortableTestProjectFixture { get; set; }
+            public RepoDirectoriesProvider RepoDirectories { get; set; }
+
+            public SharedTestState()
+            {
+                RepoDirectories = new RepoDirectoriesProvider();
+
+                PreviouslyBuiltAndRestoredPortableApiTestProjectFixture = new TestProjectFixture("HostApiInvokerApp", RepoDirectories)
+                    .EnsureRestored(RepoDirectories.CorehostPackages)
+                    .BuildProject();
+
+                if (!RuntimeInformation.IsOSPlatform(OSPlatform.Windows))
+                {
+                    // On non-Windows, we can't just P/Invoke to already loaded hostfxr, so copy it next to the app dll.
+                    var fixture = PreviouslyBuiltAndRestoredPortableApiTestProjectFixture;
+                    var hostfxr = Path.Combine(
+                        fixture.BuiltDotnet.GreatestVersionHostFxrPath,
+                        $"{fixture.SharedLibraryPrefix}hostfxr{fixture.SharedLibraryExtension}");
+
+                    File.Copy(
+                        hostfxr,
+                        Path.Combine(Path.GetDirectoryName(fixture.TestProject.AppDll), Path.GetFileName(hostfxr)));
+                }
+
+                var publishFixture = new TestProjectFixture("StandaloneApp", RepoDirectories);
+                PreviouslyPublishedAndRestoredStandaloneTestProjectFixture = publishFixture
+                    .EnsureRestoredForRid(publishFixture.CurrentRid, RepoDirectories.CorehostPackages)
+                    .PublishProject(runtime: publishFixture.CurrentRid);
+
+                PreviouslyBuiltAndRestoredPortableTestProjectFixture = new TestProjectFixture("PortableApp", RepoDirectories)
+                    .EnsureRestored(RepoDirectories.CorehostPackages)
+                    .BuildProject();
+            }
+
+            public void Dispose()
+            {
+                PreviouslyBuiltAndRestoredPortableApiTestProjectFixture.Dispose();
+                PreviouslyPublishedAndRestoredStandaloneTestProjectFixture.Dispose();
+                PreviouslyBuiltAndRestoredPortableTestProjectFixture.Dispose();
+            }
+        }
+    }
+}
@@ -638,6 +638,61 @@ public void Roll_Forward_On_No_Candidate_Fx_Fails_If_No_Higher_Version_Is_Availa
                 .HaveStdOutContaining("Microsoft.NETCore.App 9999.1.0");
         }
 
+        // The installed versions of a framework are resolved from a sorted catalog of the hive,
+        // so the roll forward rules are checked against one crowded hive with production and
+        // preview versions on each side of the requested ones.
+        [Theory]
+        [InlineData("9999.0.0", 1, "9999.0.3")]
+        [InlineData("9999.0.1", 0, "9999.0.3")]
+        [InlineData("9999.0.2", 1, "9999.0.3")]
+        [InlineData("9999.0.5", 1, "9999.1.2")]
+        [InlineData("9999.1.3", 1, "9999.2.0-preview1")]
+        [InlineData("9999.1.3", 2, "10000.0.0")]
+        [InlineData("9999.1.3", 0, null)]
+        [InlineData("9999.0.0-preview1", 1, "9999.0.0-preview1")]
+        [InlineData("9999.0.4-preview1", 1, "9999.0.4-preview2")]
+        [InlineData("9999.0.4-preview3", 1, null)]
+        public void Roll_Forward_Picks_From_The_Installed_Versions_In_Order(string requestedVersion, int rollFwdOnNoCandidateFx, string expectedVersion)
+        {
+            var fixture = PreviouslyBuiltAndRestoredPortableTestProjectFixture
+                .Copy();
+
+            var dotnet = fixture.BuiltDotnet;
+            var appDll = fixture.TestProject.AppDll;
+
+            string runtimeConfig = Path.Combine(fixture.TestProject.OutputDirectory, "SharedFxLookupPortableApp.runtimeconfig.json");
+            SharedFramework.SetRuntimeConfigJson(runtimeConfig, requestedVersion, rollFwdOnNoCandidateFx);
+
+            // Add versions in the exe folder
+            SharedFramework.AddAvailableSharedFxVersions(_builtSharedFxDir, _exeSharedFxBaseDir,
+                "10000.0.1-preview1", "9999.0.4-preview2", "9999.1.2", "9999.0.0-preview1", "10000.0.0",
+                "9999.0.1", "9999.2.0-preview1", "9999.0.3", "9999.1.0-preview1");
+
+            // Patch roll forward only moves between production versions or between previews,
+            // and a preview only rolls forward to a later preview of the same patch.
+            CommandResult result = dotnet.Exec(appDll)
+                .WorkingDirectory(_currentWorkingDir)
+                .EnvironmentVariable("COREHOST_TRACE", "1")
+                .CaptureStdOut()
+                .CaptureStdErr()
+                .Execute(fExpectedToFail: expectedVersion == null);
+
+            if (expectedVersion == null)
+            {
+                result.Should()
+                    .Fail()
+                    .And
+                    .HaveStdErrContaining("It was not possible to find any compatible framework version");
+            }
+            else
+            {
+                result.Should()
+                    .Pass()
+                    .And
+                    .HaveStdErrContaining(Path.Combine(_exeSelectedMessage, expectedVersion));
+            }
+        }
+
         [Fact]
         public void Multiple_SharedFxLookup_Independent_Roll_Forward()
         {
@@ -1012,6 +1067,64 @@ public void SharedFx_With_Higher_Version_Wins_Against_App_On_NoRollForward()
                 .NotHaveStdErrContaining($"{appAssembly}{Path.PathSeparator}");
         }
 
+        // The framework's System.Collections.Immutable has AssemblyVersion 88.0.1.2 and FileVersion 88.2.3.4.
+        // Components go up to 65535, an absent component is lower than any present one and a version with a
+        // component past the limit is ignored.
+        [Theory]
+        [InlineData("88.0.1.65535", "0.0", true)]
+        [InlineData("88.0.65535.0", "0.0", true)]
+        [InlineData("88.0.1", "99.0", false)]
+        [InlineData("88.0.1.2", "88.2.3.65535", true)]
+        [InlineData("88.0.1.2", "88.2.3", false)]
+        [InlineData("88.0.1.65536", "99.0", false)]
+        public void SharedFx_And_App_Assembly_Versions_Compare_Up_To_The_Component_Limit(string assemblyVersion, string fileVersion, bool appWins)
+        {
+            var fixture = PreviouslyBuiltAndRestoredPortableTestProjectFixture
+                .Copy();
+
+            var dotnet = fixture.BuiltDotnet;
+            var appDll = fixture.TestProject.AppDll;
+
+            // Set desired version = 7777.0.0
+            string runtimeConfig = Path.Combine(fixture.TestProject.OutputDirectory, "SharedFxLookupPortableApp.runtimeconfig.json");
+            SharedFramework.SetRuntimeConfigJson(runtimeConfig, "7777.0.0", null, useUberFramework: true);
+
+            // Add versions in the exe folder
+            SharedFramework.AddAvailableSharedFxVersions(_builtSharedFxDir, _exeSharedFxBaseDir, "9999.0.0");
+            SharedFramework.AddAvailableSharedUberFxVersions(_builtSharedUberFxDir, _exeSharedUberFxBaseDir, "9999.0.0", null, "7777.0.0");
+
+            // Copy NetCoreApp's copy of the assembly to the app location
+            string netcoreAssembly = Path.Combine(_exeSharedFxBaseDir, "9999.0.0", "System.Collections.Immutable.dll");
+            string appAssembly = Path.Combine(fixture.TestProject.OutputDirectory, "System.Collections.Immutable.dll");
+            File.Copy(netcoreAssembly, appAssembly);
+
+            // Modify the app's deps.json to add System.Collections.Immmutable
+            string appDepsJson = Path.Combine(fixture.TestProject.OutputDirectory, "SharedFxLookupPortableApp.deps.json");
+            JObject versionInfo = new JObject();
+            versionInfo.Add(new JProperty("assemblyVersion", assemblyVersion));
+            versionInfo.Add(new JProperty("fileVersion", fileVersion));
+            SharedFramework.AddReferenceToDepsJson(appDepsJson, "SharedFxLookupPortableApp/1.0.0", "System.Collections.Immutable", "1.0.0", versionInfo);
+
+            string uberAssembly = Path.Combine(_exeSharedUberFxBaseDir, "7777.0.0", "System.Collections.Immutable.dll");
+            string expectedAssembly = appWins ? appAssembly : uberAssembly;
+            string otherAssembly = appWins ? uberAssembly : appAssembly;
+            dotnet.Exec(appDll)
+                .WorkingDirectory(_currentWorkingDir)
+                .EnvironmentVariable("COREHOST_TRACE", "1")
+                .CaptureStdOut()
+                .CaptureStdErr()
+                .Execute()
+                .Should()
+                .Pass()
+                .And
+                // Verify final selection in TRUSTED_PLATFORM_ASSEMBLIES
+                .HaveStdErrContaining($"{expectedAssembly}{Path.PathSeparator}")
+                .And
+                .NotHaveStdErrContaining($"{otherAssembly}{Path.PathSeparator}")
+                .And
+                .NotHaveStdErrContaining($"{netcoreAssembly}{Path.PathSeparator}");
+        }
+
         static private JObject GetAdditionalFramework(string fxName, string fxVersion, bool? applyPatches, int? rollForwardOnNoCandidateFx)
         {
             var jobject = new JObject(new JProperty("name", fxName));